@@ -0,0 +1,83 @@
+/**
+ * bench.c - Minimal benchmark harness shared by bench_micro and loadgen
+ */
+
+#include "bench.h"
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static FILE* g_report  = NULL;
+static int   g_stdout  = -1; /* Saved stdout while quiet */
+static int   g_devnull = -1;
+
+void bench_init(void) {
+    if (!g_report) {
+        g_report = fdopen(dup(STDOUT_FILENO), "w");
+        if (!g_report) {
+            g_report = stderr;
+        }
+        setvbuf(g_report, NULL, _IOLBF, 0);
+    }
+}
+
+void bench_quiet(bool quiet) {
+    fflush(stdout);
+    if (quiet && g_stdout < 0) {
+        if (g_devnull < 0) {
+            g_devnull = open("/dev/null", O_WRONLY);
+        }
+        g_stdout = dup(STDOUT_FILENO);
+        dup2(g_devnull, STDOUT_FILENO);
+    } else if (!quiet && g_stdout >= 0) {
+        dup2(g_stdout, STDOUT_FILENO);
+        close(g_stdout);
+        g_stdout = -1;
+    }
+}
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void bench_printf(const char* fmt, ...) {
+    bench_init();
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(g_report, fmt, args);
+    va_end(args);
+}
+
+void bench_section(const char* title) {
+    bench_printf("\n== %s ==\n", title);
+}
+
+void bench_report(const char* name, size_t iterations, uint64_t elapsed_ns) {
+    double ns_per_op = iterations ? (double)elapsed_ns / iterations : 0.0;
+    double ops       = elapsed_ns ? iterations * 1e9 / elapsed_ns : 0.0;
+    bench_printf("%-40s %10zu iters %12.1f ns/op %14.0f ops/s\n", name,
+                 iterations, ns_per_op, ops);
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+uint64_t bench_percentile(uint64_t* samples, size_t count, double p) {
+    if (count == 0) {
+        return 0;
+    }
+
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    size_t rank = (size_t)(p / 100.0 * (double)(count - 1) + 0.5);
+    return samples[rank < count ? rank : count - 1];
+}
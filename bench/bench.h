@@ -0,0 +1,63 @@
+/**
+ * bench.h - Minimal benchmark harness shared by bench_micro and loadgen
+ *
+ * Timing uses CLOCK_MONOTONIC. Results go to the stream opened by
+ * bench_init, which duplicates stdout, so the printf logging of the code
+ * under test can be silenced with bench_quiet without losing the report.
+ *
+ * Usage:
+ *   bench_init();
+ *   uint64_t start = bench_now_ns();
+ *   for (size_t i = 0; i < n; i++) { ... }
+ *   bench_report("hash_md5_string", n, bench_now_ns() - start);
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Keep the compiler from optimizing a result away */
+#define BENCH_KEEP(value) __asm__ volatile("" : : "g"(value) : "memory")
+
+/**
+ * Open the report stream. Call before bench_quiet.
+ */
+void bench_init(void);
+
+/**
+ * Redirect (true) or restore (false) stdout of the code under test.
+ */
+void bench_quiet(bool quiet);
+
+/**
+ * Monotonic time in nanoseconds.
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * Print one result line: iterations, ns/op and ops/s.
+ */
+void bench_report(const char* name, size_t iterations, uint64_t elapsed_ns);
+
+/**
+ * Print a section header.
+ */
+void bench_section(const char* title);
+
+/**
+ * Value at percentile p (0..100) of samples, which get sorted in place.
+ *
+ * @return 0 when count is 0
+ */
+uint64_t bench_percentile(uint64_t* samples, size_t count, double p);
+
+/**
+ * printf to the report stream.
+ */
+void bench_printf(const char* fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+#endif /* BENCH_H */
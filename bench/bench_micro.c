@@ -0,0 +1,396 @@
+/**
+ * bench_micro.c - Microbenchmarks for the hot paths of the server
+ *
+ * Runs in-process against the real modules: the file cache (disk and
+ * memory tier), MD5 cache keys, local city search over data/cities.idx,
+ * route dispatch and JSON response rendering. Nothing touches the
+ * network; geocoding queries are taken from the index itself so every
+ * one is answered locally.
+ *
+ * Usage: bench-micro [scale]   (scale multiplies every iteration count)
+ */
+
+#include "bench.h"
+#include "city_index.h"
+#include "endpoints/routes.h"
+#include "file_cache.h"
+#include "geocoding_api.h"
+#include "hash_md5.h"
+#include "json_writer.h"
+#include "request_arena.h"
+#include "response_cache.h"
+
+#include <jansson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_CACHE_DIR_TEMPLATE "/tmp/jws-bench-XXXXXX"
+#define BENCH_CACHE_KEYS 256
+#define BENCH_PAYLOAD_SIZE 4096
+#define BENCH_MAX_QUERIES 4096
+
+static size_t g_scale = 1;
+
+/* ============= Hashing ============= */
+
+static void bench_hash_md5(void) {
+    bench_section("hash_md5");
+
+    const char* inputs[] = {"Stockholm59.329318.0686",
+                            "weather|stockholm|se|stockholm",
+                            "elpris_2024-12-31_SE3"};
+    size_t      n        = 1000000 * g_scale;
+    char        hash[33];
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        const char* input = inputs[i % 3];
+        hash_md5_string(input, strlen(input), hash, sizeof(hash));
+        BENCH_KEEP(hash[0]);
+    }
+    bench_report("hash_md5_string (short key)", n, bench_now_ns() - start);
+}
+
+/* ============= File Cache ============= */
+
+static void bench_file_cache_tier(const char* dir, size_t memory_bytes,
+                                  const char* label) {
+    FileCacheConfig config = {.cache_dir    = dir,
+                              .ttl_seconds  = 3600,
+                              .enabled      = true,
+                              .memory_bytes = memory_bytes,
+                              .extension    = ".bin"};
+
+    FileCacheInstance* cache = file_cache_create(&config);
+    if (!cache) {
+        bench_printf("  file_cache_create failed for %s\n", dir);
+        return;
+    }
+
+    static char payload[BENCH_PAYLOAD_SIZE];
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (char)('a' + i % 26);
+    }
+
+    char keys[BENCH_CACHE_KEYS][FILE_CACHE_KEY_LENGTH];
+    for (size_t i = 0; i < BENCH_CACHE_KEYS; i++) {
+        char input[32];
+        snprintf(input, sizeof(input), "bench-key-%zu", i);
+        file_cache_generate_key(cache, input, keys[i], sizeof(keys[i]));
+    }
+
+    char   name[96];
+    size_t n = 4 * BENCH_CACHE_KEYS * g_scale;
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        file_cache_save(cache, keys[i % BENCH_CACHE_KEYS], payload,
+                        sizeof(payload));
+    }
+    snprintf(name, sizeof(name), "file_cache_save 4 KiB (%s)", label);
+    bench_report(name, n, bench_now_ns() - start);
+
+    n     = 40 * BENCH_CACHE_KEYS * g_scale;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        char*  data = NULL;
+        size_t size = 0;
+        if (file_cache_load(cache, keys[i % BENCH_CACHE_KEYS], &data, &size) ==
+            FILE_CACHE_OK) {
+            BENCH_KEEP(data[0]);
+            free(data);
+        }
+    }
+    snprintf(name, sizeof(name), "file_cache_load 4 KiB (%s)", label);
+    bench_report(name, n, bench_now_ns() - start);
+
+    file_cache_clear(cache);
+    file_cache_destroy(cache);
+}
+
+static void bench_file_cache(void) {
+    bench_section("file_cache");
+
+    char dir[] = BENCH_CACHE_DIR_TEMPLATE;
+    if (!mkdtemp(dir)) {
+        bench_printf("  mkdtemp failed\n");
+        return;
+    }
+
+    bench_file_cache_tier(dir, 0, "files only");
+    bench_file_cache_tier(dir, 4 * 1048576, "memory tier");
+    rmdir(dir);
+}
+
+/* ============= City Search ============= */
+
+static int g_search_hits = 0;
+
+static void on_search(int result, GeocodingResponse* response,
+                      void* context) {
+    (void)context;
+    if (result == 0 && response && response->count > 0) {
+        g_search_hits++;
+    }
+}
+
+/**
+ * Build queries from real names of the index: prefixes of 2 to 6 bytes,
+ * so short autocomplete queries and near-exact ones are both covered
+ */
+static size_t collect_queries(const CityIndex* index,
+                              char (*queries)[CITY_INDEX_MAX_NAME]) {
+    size_t count  = city_index_count(index);
+    size_t stride = count / (BENCH_MAX_QUERIES / 5) + 1;
+    size_t found  = 0;
+
+    for (uint32_t id = 0; id < count && found + 5 <= BENCH_MAX_QUERIES;
+         id += (uint32_t)stride) {
+        CityIndexEntry entry;
+        char           normalized[CITY_INDEX_MAX_NAME];
+        if (city_index_get(index, id, &entry) != CITY_INDEX_OK ||
+            city_index_normalize(entry.name, normalized, sizeof(normalized)) <
+                2) {
+            continue;
+        }
+
+        for (size_t length = 2; length <= 6; length++) {
+            if (length > strlen(normalized)) {
+                break;
+            }
+            snprintf(queries[found++], CITY_INDEX_MAX_NAME, "%.*s",
+                     (int)length, normalized);
+        }
+    }
+    return found;
+}
+
+static void bench_city_search(void) {
+    bench_section("city search (data/cities.idx)");
+
+    CityIndex* index = NULL;
+    if (city_index_open(CITY_INDEX_DEFAULT_PATH, &index) != CITY_INDEX_OK) {
+        bench_printf("  %s missing, run 'make city-index'\n",
+                     CITY_INDEX_DEFAULT_PATH);
+        return;
+    }
+
+    char(*queries)[CITY_INDEX_MAX_NAME] =
+        malloc(BENCH_MAX_QUERIES * sizeof(*queries));
+    size_t count = queries ? collect_queries(index, queries) : 0;
+    if (count == 0) {
+        free(queries);
+        city_index_close(index);
+        return;
+    }
+    bench_printf("  %zu cities, %zu queries\n", city_index_count(index),
+                 count);
+
+    size_t   n = 200000 * g_scale;
+    uint32_t ids[CITY_INDEX_TOP_K];
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        size_t found = city_index_search(index, queries[i % count], ids,
+                                         CITY_INDEX_TOP_K);
+        BENCH_KEEP(found);
+    }
+    bench_report("city_index_search", n, bench_now_ns() - start);
+
+    /* The full local path, including result conversion and logging */
+    bench_quiet(true);
+    geocoding_api_init(NULL);
+
+    n     = 50000 * g_scale;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        geocoding_api_search_smart_async(queries[i % count], on_search, NULL);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    geocoding_api_cleanup();
+    bench_quiet(false);
+    bench_report("geocoding_api_search_smart (local)", n, elapsed);
+    bench_printf("  %d of %zu answered locally\n", g_search_hits, n);
+
+    free(queries);
+    city_index_close(index);
+}
+
+/* ============= Route Dispatch ============= */
+
+static void bench_routes(void) {
+    bench_section("route dispatch");
+
+    struct {
+        const char* method;
+        const char* path;
+    } requests[] = {{"GET", "/v1/current"}, {"GET", "/v1/weather"},
+                    {"GET", "/v1/cities"},  {"GET", "/v1/elpris"},
+                    {"GET", "/"},           {"POST", "/echo"},
+                    {"GET", "/missing"},    {"GET", "/index.html"}};
+    size_t request_count = sizeof(requests) / sizeof(requests[0]);
+    size_t lengths[sizeof(requests) / sizeof(requests[0])];
+    for (size_t i = 0; i < request_count; i++) {
+        lengths[i] = strlen(requests[i].path);
+    }
+
+    size_t   n     = 10000000 * g_scale;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        size_t       r     = i % request_count;
+        const Route* route = route_find(requests[r].method, requests[r].path,
+                                        lengths[r]);
+        BENCH_KEEP(route);
+    }
+    bench_report("route_find (mixed hits and misses)", n,
+                 bench_now_ns() - start);
+}
+
+/* ============= JSON Rendering ============= */
+
+/* Same shape as the /v1/current body */
+static char* render_writer(RequestArena* arena) {
+    JsonWriter writer;
+    json_writer_initiate(&writer, arena);
+
+    json_write_begin_object(&writer);
+    json_write_key_bool(&writer, "success", true);
+    json_write_key_object(&writer, "data");
+    json_write_key_object(&writer, "current_weather");
+    json_write_key_double(&writer, "temperature", 12.3);
+    json_write_key_str(&writer, "temperature_unit", "°C");
+    json_write_key_double(&writer, "windspeed", 14.2);
+    json_write_key_str(&writer, "windspeed_unit", "km/h");
+    json_write_key_int(&writer, "wind_direction_10m", 240);
+    json_write_key_str(&writer, "wind_direction_name", "Southwest");
+    json_write_key_int(&writer, "weather_code", 3);
+    json_write_key_str(&writer, "weather_description", "Overcast");
+    json_write_key_int(&writer, "is_day", 1);
+    json_write_key_double(&writer, "precipitation", 0.0);
+    json_write_key_str(&writer, "precipitation_unit", "mm");
+    json_write_key_double(&writer, "humidity", 71.0);
+    json_write_key_double(&writer, "pressure", 1012.4);
+    json_write_key_str(&writer, "time", "2024-12-31T12:00");
+    json_write_end_object(&writer);
+    json_write_key_object(&writer, "location");
+    json_write_key_double(&writer, "latitude", 59.33);
+    json_write_key_double(&writer, "longitude", 18.07);
+    json_write_end_object(&writer);
+    json_write_end_object(&writer);
+    json_write_end_object(&writer);
+
+    return json_writer_finish(&writer, NULL);
+}
+
+/* The equivalent jansson tree, as the handlers built it before */
+static char* render_jansson(void) {
+    json_t* current = json_object();
+    json_object_set_new(current, "temperature", json_real(12.3));
+    json_object_set_new(current, "temperature_unit", json_string("°C"));
+    json_object_set_new(current, "windspeed", json_real(14.2));
+    json_object_set_new(current, "windspeed_unit", json_string("km/h"));
+    json_object_set_new(current, "wind_direction_10m", json_integer(240));
+    json_object_set_new(current, "wind_direction_name",
+                        json_string("Southwest"));
+    json_object_set_new(current, "weather_code", json_integer(3));
+    json_object_set_new(current, "weather_description",
+                        json_string("Overcast"));
+    json_object_set_new(current, "is_day", json_integer(1));
+    json_object_set_new(current, "precipitation", json_real(0.0));
+    json_object_set_new(current, "precipitation_unit", json_string("mm"));
+    json_object_set_new(current, "humidity", json_real(71.0));
+    json_object_set_new(current, "pressure", json_real(1012.4));
+    json_object_set_new(current, "time", json_string("2024-12-31T12:00"));
+
+    json_t* location = json_object();
+    json_object_set_new(location, "latitude", json_real(59.33));
+    json_object_set_new(location, "longitude", json_real(18.07));
+
+    json_t* data = json_object();
+    json_object_set_new(data, "current_weather", current);
+    json_object_set_new(data, "location", location);
+
+    json_t* root = json_object();
+    json_object_set_new(root, "success", json_true());
+    json_object_set_new(root, "data", data);
+
+    char* body = json_dumps(root, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+    json_decref(root);
+    return body;
+}
+
+static void bench_json(void) {
+    bench_section("JSON responses (/v1/current shape)");
+
+    RequestArena arena;
+    request_arena_initiate(&arena);
+
+    size_t   n     = 500000 * g_scale;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        char* body = render_writer(&arena);
+        BENCH_KEEP(body);
+        request_arena_reset(&arena);
+    }
+    bench_report("json_writer (request arena)", n, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        char* body = render_writer(NULL);
+        BENCH_KEEP(body);
+        free(body);
+    }
+    bench_report("json_writer (heap)", n, bench_now_ns() - start);
+
+    n     = 100000 * g_scale;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        char* body = render_jansson();
+        BENCH_KEEP(body);
+        free(body);
+    }
+    bench_report("jansson tree + json_dumps", n, bench_now_ns() - start);
+
+    /* Serving the rendered body from the response cache instead */
+    char*          body  = render_writer(NULL);
+    ResponseCache* cache = response_cache_create(4 * 1048576);
+    if (body && cache) {
+        bench_quiet(true);
+        response_cache_put(cache, "weather|stockholm||", "bench", body,
+                           strlen(body), time(NULL), time(NULL) + 3600);
+        bench_quiet(false);
+
+        n     = 5000000 * g_scale;
+        start = bench_now_ns();
+        for (size_t i = 0; i < n; i++) {
+            ResponseCacheHit hit;
+            bool found = response_cache_get(cache, "weather|stockholm||", &hit);
+            BENCH_KEEP(found);
+        }
+        bench_report("response_cache_get (hit)", n, bench_now_ns() - start);
+    }
+    response_cache_destroy(cache);
+    free(body);
+
+    request_arena_dispose(&arena);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && atoi(argv[1]) > 0) {
+        g_scale = (size_t)atoi(argv[1]);
+    }
+
+    bench_init();
+    bench_printf("just-weather microbenchmarks (scale %zu)\n", g_scale);
+
+    bench_hash_md5();
+    bench_file_cache();
+    bench_city_search();
+    bench_routes();
+    bench_json();
+
+    return 0;
+}
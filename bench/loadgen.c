@@ -0,0 +1,440 @@
+/**
+ * loadgen.c - Closed-loop HTTP load generator for the weather server
+ *
+ * Keeps N keep-alive connections busy for a fixed duration. Each connection
+ * sends one request at a time and cycles through the given paths, so every
+ * endpoint gets the same share of the load. A path given as
+ * "POST <path> <body>" is sent as a POST with that body (reported as
+ * "POST <path>"). Latency is measured from the
+ * first byte written to the last byte of the response; the report lists
+ * req/s and p50/p99/p999 per path (query string included) and in total.
+ * Requests finished during the warmup are not counted.
+ *
+ * Usage:
+ *   loadgen [-h host] [-p port] [-c connections] [-d seconds]
+ *           [-w warmup seconds] path...
+ */
+
+#define _GNU_SOURCE /* memmem */
+
+#include "bench.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define LOADGEN_MAX_PATHS 32
+#define LOADGEN_MAX_CONNECTIONS 1024
+#define LOADGEN_BUFFER_SIZE (1024 * 1024)
+
+/* ============= Internal Structures ============= */
+
+typedef struct {
+    const char* path;
+    char*       request;
+    size_t      request_length;
+    uint64_t*   samples; /* Latencies in ns */
+    size_t      count;
+    size_t      capacity;
+    size_t      errors;
+} Endpoint;
+
+typedef enum { CLIENT_CONNECTING, CLIENT_SENDING, CLIENT_RECEIVING } State;
+
+typedef struct {
+    int      fd;
+    State    state;
+    size_t   endpoint;
+    size_t   sent;
+    uint64_t started_ns;
+    char*    buffer;
+    size_t   length;
+    size_t   expected; /* Header plus body length, 0 until known */
+    bool     close_after;
+} Client;
+
+/* ============= Global State ============= */
+
+static Endpoint           g_endpoints[LOADGEN_MAX_PATHS];
+static size_t             g_endpoint_count = 0;
+static struct sockaddr_in g_address;
+static size_t             g_reconnects = 0;
+
+/* ============= Helpers ============= */
+
+static void record(Endpoint* endpoint, uint64_t latency_ns) {
+    if (endpoint->count == endpoint->capacity) {
+        size_t    capacity = endpoint->capacity ? endpoint->capacity * 2 : 4096;
+        uint64_t* grown =
+            realloc(endpoint->samples, capacity * sizeof(uint64_t));
+        if (!grown) {
+            return;
+        }
+        endpoint->samples  = grown;
+        endpoint->capacity = capacity;
+    }
+    endpoint->samples[endpoint->count++] = latency_ns;
+}
+
+static int client_connect(Client* client) {
+    client->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (client->fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(client->fd, (struct sockaddr*)&g_address, sizeof(g_address)) <
+            0 &&
+        errno != EINPROGRESS) {
+        close(client->fd);
+        client->fd = -1;
+        return -1;
+    }
+
+    client->state = CLIENT_CONNECTING;
+    return 0;
+}
+
+static void client_next(Client* client, uint64_t now) {
+    client->endpoint   = (client->endpoint + 1) % g_endpoint_count;
+    client->state      = CLIENT_SENDING;
+    client->sent       = 0;
+    client->length     = 0;
+    client->expected   = 0;
+    client->started_ns = now;
+}
+
+static void client_reconnect(Client* client) {
+    if (client->fd >= 0) {
+        close(client->fd);
+    }
+    g_reconnects++;
+    client_connect(client);
+    client->sent     = 0;
+    client->length   = 0;
+    client->expected = 0;
+}
+
+/**
+ * Work out the full response length once the head is in; 0 if unknown yet
+ */
+static size_t response_length(Client* client) {
+    const char* end = memmem(client->buffer, client->length, "\r\n\r\n", 4);
+    if (!end) {
+        return 0;
+    }
+
+    size_t      head    = (size_t)(end - client->buffer) + 4;
+    long        content = -1;
+    const char* line    = client->buffer;
+    client->close_after = false;
+
+    while (line && line < end) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content = strtol(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection: close", 17) == 0) {
+            client->close_after = true;
+        }
+        line = memmem(line, (size_t)(end - line) + 2, "\r\n", 2);
+        line = line ? line + 2 : NULL;
+    }
+
+    if (content < 0) {
+        client->close_after = true;
+        return SIZE_MAX; /* Until the server closes */
+    }
+    return head + (size_t)content;
+}
+
+/**
+ * Account a finished response and start the next request
+ */
+static void client_done(Client* client, uint64_t now, uint64_t measure_from) {
+    Endpoint* endpoint = &g_endpoints[client->endpoint];
+    int       status   = 0;
+    sscanf(client->buffer, "HTTP/1.%*d %d", &status);
+
+    if (client->started_ns >= measure_from) {
+        if (status >= 200 && status < 400) {
+            record(endpoint, now - client->started_ns);
+        } else {
+            endpoint->errors++;
+        }
+    }
+
+    bool reconnect = client->close_after;
+    client_next(client, now);
+    if (reconnect) {
+        client_reconnect(client);
+    }
+}
+
+static void client_step(Client* client, short revents, uint64_t now,
+                        uint64_t measure_from) {
+    if (client->state == CLIENT_CONNECTING) {
+        int       error  = 0;
+        socklen_t length = sizeof(error);
+        if (!(revents & (POLLOUT | POLLERR | POLLHUP))) {
+            return;
+        }
+        if (getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &length) <
+                0 ||
+            error != 0) {
+            g_endpoints[client->endpoint].errors++;
+            client_reconnect(client);
+            return;
+        }
+        client->state      = CLIENT_SENDING;
+        client->started_ns = now;
+    }
+
+    if (client->state == CLIENT_SENDING) {
+        Endpoint* endpoint = &g_endpoints[client->endpoint];
+        while (client->sent < endpoint->request_length) {
+            ssize_t n = send(client->fd, endpoint->request + client->sent,
+                             endpoint->request_length - client->sent,
+                             MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    endpoint->errors++;
+                    client_reconnect(client);
+                }
+                return;
+            }
+            client->sent += (size_t)n;
+        }
+        client->state = CLIENT_RECEIVING;
+    }
+
+    if (client->state == CLIENT_RECEIVING) {
+        for (;;) {
+            if (client->length == LOADGEN_BUFFER_SIZE) {
+                g_endpoints[client->endpoint].errors++; /* Body too large */
+                client_reconnect(client);
+                return;
+            }
+
+            ssize_t n = recv(client->fd, client->buffer + client->length,
+                             LOADGEN_BUFFER_SIZE - client->length, 0);
+            if (n < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    g_endpoints[client->endpoint].errors++;
+                    client_reconnect(client);
+                }
+                return;
+            }
+
+            if (n == 0) {
+                if (client->expected == SIZE_MAX) {
+                    client_done(client, now, measure_from);
+                } else {
+                    g_endpoints[client->endpoint].errors++;
+                    client_reconnect(client);
+                }
+                return;
+            }
+
+            client->length += (size_t)n;
+            if (client->expected == 0) {
+                client->expected = response_length(client);
+            }
+            if (client->expected != 0 && client->length >= client->expected) {
+                client_done(client, now, measure_from);
+                return;
+            }
+        }
+    }
+}
+
+static void print_endpoint(const char* name, uint64_t* samples, size_t count,
+                           size_t errors, double seconds) {
+    double p50  = bench_percentile(samples, count, 50.0) / 1e6;
+    double p99  = bench_percentile(samples, count, 99.0) / 1e6;
+    double p999 = bench_percentile(samples, count, 99.9) / 1e6;
+    bench_printf("%-44s %9zu %7zu %10.0f %9.3f %9.3f %9.3f\n", name, count,
+                 errors, count / seconds, p50, p99, p999);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [-h host] [-p port] [-c connections] [-d seconds] "
+            "[-w warmup] path...\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    const char* host        = "127.0.0.1";
+    int         port        = 10680;
+    int         connections = 32;
+    int         duration    = 10;
+    int         warmup      = 2;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:c:d:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            host = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'c':
+            connections = atoi(optarg);
+            break;
+        case 'd':
+            duration = atoi(optarg);
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc || connections <= 0 ||
+        connections > LOADGEN_MAX_CONNECTIONS || duration <= 0 ||
+        warmup < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    g_address.sin_family = AF_INET;
+    g_address.sin_port   = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &g_address.sin_addr) != 1) {
+        fprintf(stderr, "Invalid IPv4 address: %s\n", host);
+        return 1;
+    }
+
+    for (int i = optind; i < argc && g_endpoint_count < LOADGEN_MAX_PATHS;
+         i++) {
+        Endpoint* endpoint = &g_endpoints[g_endpoint_count++];
+        endpoint->path     = argv[i];
+
+        /* "POST <path> <body>": the name stops before the body */
+        const char* body = NULL;
+        if (strncmp(argv[i], "POST ", 5) == 0) {
+            body = strchr(argv[i] + 5, ' ');
+            if (body) {
+                endpoint->path = strndup(argv[i], (size_t)(body - argv[i]));
+                body++;
+            }
+        }
+
+        char body_headers[96] = "";
+        if (body) {
+            snprintf(body_headers, sizeof(body_headers),
+                     "Content-Type: application/json\r\n"
+                     "Content-Length: %zu\r\n",
+                     strlen(body));
+        }
+
+        /* The name of a POST endpoint already starts with the method */
+        const char* method = body ? "" : "GET ";
+        int         length = snprintf(NULL, 0,
+                                      "%s%s HTTP/1.1\r\nHost: %s:%d\r\n"
+                                      "Accept-Encoding: gzip\r\n%s\r\n%s",
+                                      method, endpoint->path, host, port,
+                                      body_headers, body ? body : "");
+        endpoint->request        = malloc((size_t)length + 1);
+        endpoint->request_length = (size_t)length;
+        snprintf(endpoint->request, (size_t)length + 1,
+                 "%s%s HTTP/1.1\r\nHost: %s:%d\r\n"
+                 "Accept-Encoding: gzip\r\n%s\r\n%s",
+                 method, endpoint->path, host, port, body_headers,
+                 body ? body : "");
+    }
+
+    bench_init();
+
+    Client*        clients = calloc((size_t)connections, sizeof(Client));
+    struct pollfd* fds     = calloc((size_t)connections, sizeof(struct pollfd));
+    for (int i = 0; i < connections; i++) {
+        clients[i].endpoint = (size_t)i % g_endpoint_count;
+        clients[i].buffer   = malloc(LOADGEN_BUFFER_SIZE);
+        if (!clients[i].buffer || client_connect(&clients[i]) != 0) {
+            fprintf(stderr, "Cannot connect to %s:%d\n", host, port);
+            return 1;
+        }
+    }
+
+    uint64_t begin        = bench_now_ns();
+    uint64_t measure_from = begin + (uint64_t)warmup * 1000000000ull;
+    uint64_t end          = measure_from + (uint64_t)duration * 1000000000ull;
+
+    for (uint64_t now = begin; now < end; now = bench_now_ns()) {
+        for (int i = 0; i < connections; i++) {
+            if (clients[i].fd < 0) {
+                client_connect(&clients[i]); /* Retried every round */
+            }
+            fds[i].fd     = clients[i].fd;
+            fds[i].events = clients[i].state == CLIENT_RECEIVING ? POLLIN
+                                                                 : POLLOUT;
+        }
+
+        if (poll(fds, (nfds_t)connections, 100) < 0 && errno != EINTR) {
+            perror("poll");
+            return 1;
+        }
+
+        now = bench_now_ns();
+        for (int i = 0; i < connections; i++) {
+            if (fds[i].revents) {
+                client_step(&clients[i], fds[i].revents, now, measure_from);
+            }
+        }
+    }
+
+    bench_printf("\n%d connections, %d s (after %d s warmup), %s:%d\n",
+                 connections, duration, warmup, host, port);
+    bench_printf("%-44s %9s %7s %10s %9s %9s %9s\n", "endpoint", "requests",
+                 "errors", "req/s", "p50 ms", "p99 ms", "p999 ms");
+
+    size_t total_count = 0, total_errors = 0;
+    for (size_t i = 0; i < g_endpoint_count; i++) {
+        total_count  += g_endpoints[i].count;
+        total_errors += g_endpoints[i].errors;
+    }
+
+    uint64_t* all = malloc((total_count + 1) * sizeof(uint64_t));
+    size_t    pos = 0;
+    for (size_t i = 0; i < g_endpoint_count; i++) {
+        Endpoint* endpoint = &g_endpoints[i];
+        if (all) {
+            memcpy(all + pos, endpoint->samples,
+                   endpoint->count * sizeof(uint64_t));
+            pos += endpoint->count;
+        }
+        print_endpoint(endpoint->path, endpoint->samples, endpoint->count,
+                       endpoint->errors, duration);
+    }
+    if (all) {
+        print_endpoint("total", all, total_count, total_errors, duration);
+    }
+    bench_printf("reconnects: %zu\n", g_reconnects);
+
+    free(all);
+    for (int i = 0; i < connections; i++) {
+        close(clients[i].fd);
+        free(clients[i].buffer);
+    }
+    for (size_t i = 0; i < g_endpoint_count; i++) {
+        free(g_endpoints[i].request);
+        free(g_endpoints[i].samples);
+    }
+    free(clients);
+    free(fds);
+    return total_count > 0 ? 0 : 1;
+}
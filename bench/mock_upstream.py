@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Mock upstream for load tests: answers the Open-Meteo forecast, Open-Meteo
+geocoding and elprisetjustnu.se price endpoints with deterministic
+responses, so benchmark runs do not depend on the network or on rate
+limits of the real services.
+
+Point the server at it with the JWS_*_URL variables (see bench/README.md):
+
+    JWS_OPEN_METEO_URL=http://127.0.0.1:18090/v1/forecast
+    JWS_GEOCODING_URL=http://127.0.0.1:18090/v1/search
+    JWS_ELPRIS_URL=http://127.0.0.1:18090/api/v1/prices/
+
+Usage: mock_upstream.py [--port 18090] [--latency-ms 0]
+"""
+
+import argparse
+import json
+import re
+import time
+from datetime import datetime, timedelta, timezone
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+PRICE_PATH = re.compile(
+    r"^/api/v1/prices/(\d{4})/(\d{2})-(\d{2})_(SE[1-4])\.json$"
+)
+
+
+def forecast(query):
+    """Like the real API, a list of coordinates gets a list of answers."""
+    if "hourly" in query:
+        return hourly(query)
+    lats = query.get("latitude", ["0"])[0].split(",")
+    lons = query.get("longitude", ["0"])[0].split(",")
+    points = [forecast_point(float(a), float(b)) for a, b in zip(lats, lons)]
+    return points if len(points) > 1 else points[0]
+
+
+def forecast_point(lat, lon):
+    return {
+        "latitude": lat,
+        "longitude": lon,
+        "current_units": {"temperature_2m": "°C", "wind_speed_10m": "km/h"},
+        "current": {
+            "temperature_2m": round(10.0 + lat / 10.0, 1),
+            "relative_humidity_2m": 71.0,
+            "apparent_temperature": 8.5,
+            "is_day": 1,
+            "precipitation": 0.0,
+            "weather_code": 3,
+            "surface_pressure": 1012.4,
+            "wind_speed_10m": 14.2,
+            "wind_direction_10m": 240,
+        },
+    }
+
+
+def hourly(query):
+    """Yesterday through tomorrow in unixtime, a clear sky every day."""
+    today = datetime.now(timezone.utc).replace(
+        hour=0, minute=0, second=0, microsecond=0
+    )
+    start = int((today - timedelta(days=1)).timestamp())
+    times = [start + 3600 * hour for hour in range(72)]
+    radiation = [
+        max(0.0, 700.0 - 100.0 * abs(t // 3600 % 24 - 11)) for t in times
+    ]
+    return {
+        "latitude": float(query.get("latitude", ["0"])[0]),
+        "longitude": float(query.get("longitude", ["0"])[0]),
+        "hourly": {
+            "time": times,
+            "shortwave_radiation": radiation,
+            "cloud_cover": [20.0] * len(times),
+            "temperature_2m": [15.0] * len(times),
+        },
+    }
+
+
+def search(query):
+    name = query.get("name", ["Stockholm"])[0]
+    return {
+        "results": [
+            {
+                "id": 2673730,
+                "name": name,
+                "latitude": 59.32938,
+                "longitude": 18.06871,
+                "country": "Sweden",
+                "country_code": "SE",
+                "admin1": "Stockholm",
+                "population": 1515017,
+                "timezone": "Europe/Stockholm",
+            }
+        ]
+    }
+
+
+def prices(year, month, day, area):
+    tz = timezone(timedelta(hours=1))
+    start = datetime(year, month, day, tzinfo=tz)
+    base = 0.4 + int(area[2]) / 10.0
+    result = []
+    for quarter in range(96):
+        t0 = start + timedelta(minutes=15 * quarter)
+        t1 = t0 + timedelta(minutes=15)
+        sek = round(base + 0.3 * ((quarter // 4) % 12) / 12.0, 5)
+        result.append(
+            {
+                "SEK_per_kWh": sek,
+                "EUR_per_kWh": round(sek / 11.5, 5),
+                "EXR": 11.5,
+                "time_start": t0.isoformat(),
+                "time_end": t1.isoformat(),
+            }
+        )
+    return result
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    disable_nagle_algorithm = True  # Head and body go out as separate writes
+    latency = 0.0
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        query = parse_qs(url.query)
+        match = PRICE_PATH.match(url.path)
+
+        if url.path == "/v1/forecast":
+            body = forecast(query)
+        elif url.path == "/v1/search":
+            body = search(query)
+        elif match:
+            body = prices(int(match[1]), int(match[2]), int(match[3]), match[4])
+        else:
+            self.send_error(404)
+            return
+
+        if self.latency:
+            time.sleep(self.latency)
+
+        data = json.dumps(body).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+class Server(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def handle_error(self, request, client_address):
+        pass  # Clients drop keep-alive connections when a run ends
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--port", type=int, default=18090)
+    parser.add_argument("--latency-ms", type=float, default=0.0)
+    args = parser.parse_args()
+
+    Handler.latency = args.latency_ms / 1000.0
+    server = Server(("127.0.0.1", args.port), Handler)
+    print(f"[MOCK] Upstream listening on 127.0.0.1:{args.port}", flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
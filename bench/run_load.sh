@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+# End-to-end load test: the server against bench/mock_upstream.py.
+#
+# The server runs from a scratch directory (data/ and public/ linked in),
+# so its caches start empty and the repository's cache/ is left alone.
+# Every endpoint is hit from the same connections; misses of the first
+# seconds fall inside the loadgen warmup.
+#
+# Usage: run_load.sh <server binary> <loadgen binary>
+# Environment: BENCH_CONNECTIONS (32), BENCH_DURATION (10), BENCH_WARMUP (2),
+#              BENCH_MOCK_PORT (18090), BENCH_MOCK_LATENCY_MS (20)
+
+set -euo pipefail
+
+SERVER=$(realpath "$1")
+LOADGEN=$(realpath "$2")
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+CONNECTIONS=${BENCH_CONNECTIONS:-32}
+DURATION=${BENCH_DURATION:-10}
+WARMUP=${BENCH_WARMUP:-2}
+MOCK_PORT=${BENCH_MOCK_PORT:-18090}
+MOCK_LATENCY_MS=${BENCH_MOCK_LATENCY_MS:-20}
+SERVER_PORT=10680
+
+WORK_DIR=$(mktemp -d /tmp/jws-load-XXXXXX)
+MOCK_PID=""
+SERVER_PID=""
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    [ -n "$MOCK_PID" ] && kill "$MOCK_PID" 2>/dev/null || true
+    wait 2>/dev/null || true
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+wait_for_port() {
+    for _ in $(seq 1 50); do
+        if (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "Nothing listening on port $1" >&2
+    return 1
+}
+
+if (exec 3<>"/dev/tcp/127.0.0.1/$SERVER_PORT") 2>/dev/null; then
+    echo "Port $SERVER_PORT is in use; stop the running server first" >&2
+    exit 1
+fi
+
+ln -s "$ROOT/data" "$WORK_DIR/data"
+[ -d "$ROOT/public" ] && ln -s "$ROOT/public" "$WORK_DIR/public"
+
+python3 "$ROOT/bench/mock_upstream.py" --port "$MOCK_PORT" \
+    --latency-ms "$MOCK_LATENCY_MS" &
+MOCK_PID=$!
+wait_for_port "$MOCK_PORT"
+
+UPSTREAM="http://127.0.0.1:$MOCK_PORT"
+(
+    cd "$WORK_DIR"
+    export JWS_OPEN_METEO_URL="$UPSTREAM/v1/forecast"
+    export JWS_GEOCODING_URL="$UPSTREAM/v1/search"
+    export JWS_ELPRIS_URL="$UPSTREAM/api/v1/prices/"
+    exec "$SERVER" >"$WORK_DIR/server.log" 2>&1
+) &
+SERVER_PID=$!
+wait_for_port "$SERVER_PORT"
+
+TODAY=$(date +%Y-%m-%d)
+"$LOADGEN" -c "$CONNECTIONS" -d "$DURATION" -w "$WARMUP" \
+    "/" \
+    "/v1/current?lat=59.33&lon=18.07" \
+    "/v1/current?lat=57.71&lon=11.97" \
+    "/v1/weather?city=Stockholm" \
+    "/v1/weather?city=Gothenburg&country=SE" \
+    "/v1/weather/batch?city=Stockholm&city=Oslo,NO&coords=57.71,11.97" \
+    'POST /v1/weather/batch [{"city":"Stockholm"},{"city":"Oslo","country":"NO"},{"lat":57.71,"lon":11.97}]' \
+    "/v1/cities?query=sto" \
+    "/v1/cities?query=malm" \
+    "/v1/elpris?date=$TODAY&price=SE3" \
+    "/v1/energyplan?lat=59.33&lon=18.07&price=SE3"
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+Build the binary city index (data/cities.idx) from the city datasets.
+
+The server mmaps this file read-only instead of parsing all_cities.json at
+startup. Names are normalized with the same rules as
+generate_city_datasets.py so prefix search matches the C normalizer.
+
+File layout (little-endian, every section 8-byte aligned):
+
+    header      64 bytes, see HEADER_FORMAT
+    norm_name   u32[count]  pool offset of the normalized name (sort key)
+    name        u32[count]  pool offset of the display name
+    country     u32[count]  pool offset of the country name
+    code        u32[count]  pool offset of the ISO country code
+    lat         f32[count]
+    lon         f32[count]
+    population  u32[count]
+    flags       u8[count]   CITY_FLAG_HOT for entries of hot_cities.json
+    pool        NUL-terminated UTF-8 strings, deduplicated
+    prefix      u32[prefix_count]  pool offset of a normalized prefix, sorted
+    prefix_top  u32[prefix_count][TOP_K]  best ids for that prefix, padded
+                with NO_ENTRY
+
+The prefix table covers every prefix matching more than SCAN_LIMIT names,
+so the server answers any query with one table lookup or a scan of at most
+SCAN_LIMIT entries. Ranking is hot cities first, then population, then id.
+
+Usage: build_city_index.py <all_cities.json> <hot_cities.json> <output>
+"""
+
+import json
+import os
+import struct
+import sys
+
+from generate_city_datasets import normalize_city_name
+
+INDEX_MAGIC = b"JWCI"
+INDEX_VERSION = 2
+
+CITY_FLAG_HOT = 0x01
+
+TOP_K = 10  # Must match CITY_INDEX_TOP_K in src/cities/city_index.h
+SCAN_LIMIT = 32
+NO_ENTRY = 0xFFFFFFFF
+
+# magic, version, count, pool_size, prefix_count, 11 section offsets
+HEADER_FORMAT = "<4sIIII11I"
+
+
+def align(buffer, boundary=8):
+    """Pad buffer with zero bytes up to the next boundary"""
+    while len(buffer) % boundary:
+        buffer.append(0)
+
+
+def city_key(city):
+    return (city["name"], city["country_code"])
+
+
+def rank_key(entry_id, populations, flags):
+    return (not flags[entry_id] & CITY_FLAG_HOT, -populations[entry_id],
+            entry_id)
+
+
+def build_prefix_table(norm_texts, populations, flags):
+    """Top-K ids for every prefix whose match range exceeds SCAN_LIMIT"""
+    ranges = {}
+    for entry_id, text in enumerate(norm_texts):
+        for length in range(1, len(text) + 1):
+            ranges.setdefault(text[:length], []).append(entry_id)
+
+    table = []
+    for prefix in sorted(ranges, key=lambda p: p.encode("utf-8")):
+        ids = ranges[prefix]
+        if len(ids) <= SCAN_LIMIT:
+            continue
+        best = sorted(ids, key=lambda i: rank_key(i, populations, flags))
+        table.append((prefix, best[:TOP_K]))
+    return table
+
+
+def main():
+    if len(sys.argv) != 4:
+        print(__doc__.strip().splitlines()[-1])
+        return 1
+
+    all_path, hot_path, output_path = sys.argv[1:4]
+
+    with open(all_path, "r", encoding="utf-8") as f:
+        cities = json.load(f)["cities"]
+
+    with open(hot_path, "r", encoding="utf-8") as f:
+        hot = {city_key(c) for c in json.load(f)["cities"]}
+
+    entries = []
+    for city in cities:
+        normalized = normalize_city_name(city["name"])
+        if not normalized:
+            continue  # Nothing searchable survives normalization
+        entries.append((normalized, city))
+
+    # Byte order of the normalized names is what the C binary search uses
+    entries.sort(key=lambda e: (e[0].encode("utf-8"), -e[1]["population"]))
+
+    pool = bytearray()
+    pool_offsets = {}
+
+    def intern(text):
+        if text not in pool_offsets:
+            pool_offsets[text] = len(pool)
+            pool.extend(text.encode("utf-8") + b"\0")
+        return pool_offsets[text]
+
+    count = len(entries)
+    norm_names, names, countries, codes = [], [], [], []
+    lats, lons, populations, flags = [], [], [], []
+
+    for normalized, city in entries:
+        norm_names.append(intern(normalized))
+        names.append(intern(city["name"]))
+        countries.append(intern(city["country"]))
+        codes.append(intern(city["country_code"]))
+        lats.append(float(city["lat"]))
+        lons.append(float(city["lon"]))
+        populations.append(max(0, int(city["population"])))
+        flags.append(CITY_FLAG_HOT if city_key(city) in hot else 0)
+
+    prefix_table = build_prefix_table([e[0] for e in entries], populations,
+                                      flags)
+    prefix_offsets, prefix_top = [], []
+    for prefix, ids in prefix_table:
+        prefix_offsets.append(intern(prefix))
+        prefix_top.extend(ids + [NO_ENTRY] * (TOP_K - len(ids)))
+
+    sections = [
+        struct.pack(f"<{count}I", *norm_names),
+        struct.pack(f"<{count}I", *names),
+        struct.pack(f"<{count}I", *countries),
+        struct.pack(f"<{count}I", *codes),
+        struct.pack(f"<{count}f", *lats),
+        struct.pack(f"<{count}f", *lons),
+        struct.pack(f"<{count}I", *populations),
+        bytes(flags),
+        bytes(pool),
+        struct.pack(f"<{len(prefix_offsets)}I", *prefix_offsets),
+        struct.pack(f"<{len(prefix_top)}I", *prefix_top),
+    ]
+
+    body = bytearray()
+    offsets = []
+    header_size = struct.calcsize(HEADER_FORMAT)
+    for section in sections:
+        align(body)
+        offsets.append(header_size + len(body))
+        body.extend(section)
+
+    header = struct.pack(HEADER_FORMAT, INDEX_MAGIC, INDEX_VERSION, count,
+                         len(pool), len(prefix_offsets), *offsets)
+
+    # Write atomically so a running server never maps a partial file
+    tmp_path = output_path + ".tmp"
+    with open(tmp_path, "wb") as f:
+        f.write(header)
+        f.write(body)
+    os.replace(tmp_path, output_path)
+
+    hot_count = sum(1 for flag in flags if flag & CITY_FLAG_HOT)
+    print(f"Created {output_path}: {count} cities ({hot_count} hot), "
+          f"{len(prefix_offsets)} prefixes, {header_size + len(body)} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,6 +1,7 @@
 #include "elpris_api.h"
 
-#include <http_client.h>
+#include "http_pool.h"
+#include "logger.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,16 +25,16 @@ static void client_callback(const char* event, const char* response,
             if (response[0] == '[' || response[0] == '{') {
                 ctx->user_callback((char*)response, ctx->context);
             } else {
-                printf("Invalid response format: %s\n", response);
+                LOGGER_ERROR("Invalid response format: %s", response);
                 ctx->user_callback(NULL, ctx->context);
             }
         } else {
-            printf("Error event: %s - %s\n", event,
-                   response ? response : "No response");
+            LOGGER_ERROR("Error event: %s - %s", event,
+                         response ? response : "No response");
             ctx->user_callback(NULL, ctx->context);
         }
     } else {
-        printf("No callback registered\n");
+        LOGGER_ERROR("No callback registered");
     }
 
     free(ctx);
@@ -55,18 +56,29 @@ int elpris_api_fetch_async(unsigned int year, unsigned int month,
     ctx->user_callback = callback;
     ctx->context       = context;
 
-    char url[128];
-    snprintf(url, sizeof(url), BASE_URL "%04u/%02u-%02u_%s.json", year, month,
-             day, price_group);
+    const char* base_url = getenv(ELPRIS_URL_ENV);
+    if (!base_url || !base_url[0]) {
+        base_url = BASE_URL;
+    }
+
+    char url[256];
+    snprintf(url, sizeof(url), "%s%04u/%02u-%02u_%s.json", base_url, year,
+             month, day, price_group);
+
+    LOGGER_DEBUG("Fetching URL: %s", url);
 
-    printf("Fetching URL: %s\n", url); // Debug logging
+    int result = http_pool_get(url, NULL, 30000, client_callback, ctx);
+    if (result < 0) {
+        free(ctx); /* The client never calls back for a request it refused */
+    }
 
-    return http_client_get(url, NULL, 30000, client_callback, ctx);
+    return result;
 }
 
-int elpris_api_fetch_query_async(const char*         query,
-                                 ElprisApiOnResponse callback, void* context) {
-    if (!query || !callback) {
+int elpris_api_parse_query(const char* query, unsigned int* out_year,
+                           unsigned int* out_month, unsigned int* out_day,
+                           char out_price_group[4]) {
+    if (!query || !out_year || !out_month || !out_day || !out_price_group) {
         return -1;
     }
 
@@ -81,7 +93,6 @@ int elpris_api_fetch_query_async(const char*         query,
 
     char* query_copy = strdup(query_start);
     if (!query_copy) {
-        callback(NULL, context);
         return -1;
     }
 
@@ -121,6 +132,26 @@ int elpris_api_fetch_query_async(const char*         query,
 
     if (parse_error || year == 0 || month == 0 || month > 12 || day == 0 ||
         day > 31 || !price_group_found) {
+        return -1;
+    }
+
+    *out_year  = year;
+    *out_month = month;
+    *out_day   = day;
+    memcpy(out_price_group, price_group, sizeof(price_group));
+    return 0;
+}
+
+int elpris_api_fetch_query_async(const char*         query,
+                                 ElprisApiOnResponse callback, void* context) {
+    if (!query || !callback) {
+        return -1;
+    }
+
+    unsigned int year = 0, month = 0, day = 0;
+    char         price_group[4] = {0};
+
+    if (elpris_api_parse_query(query, &year, &month, &day, price_group) != 0) {
         callback(NULL, context);
         return -1;
     }
@@ -3,6 +3,9 @@
 
 #include <http_client.h>
 
+/* Overrides the prices base URL (e.g. a mock upstream for benchmarks) */
+#define ELPRIS_URL_ENV "JWS_ELPRIS_URL"
+
 /**
  * @brief Callback type invoked when an Elpris API request completes.
  *
@@ -66,6 +69,25 @@ int elpris_api_fetch_async(unsigned int year, unsigned int month,
                            unsigned int day, char price_group[3],
                            ElprisApiOnResponse callback, void* context);
 
+/**
+ * @brief Parse a "date=YYYY-MM-DD&price=XXX" query string.
+ *
+ * @param query
+ *        Query string, optionally starting with '?'. Must not be NULL.
+ *
+ * @param out_year, out_month, out_day
+ *        Parsed date.
+ *
+ * @param out_price_group
+ *        Parsed price area code, NUL-terminated (2-3 characters).
+ *
+ * @return
+ *        0 on success, -1 if the query is malformed or incomplete.
+ */
+int elpris_api_parse_query(const char* query, unsigned int* out_year,
+                           unsigned int* out_month, unsigned int* out_day,
+                           char out_price_group[4]);
+
 /**
  * @brief Fetch electricity prices using a query string format.
  *
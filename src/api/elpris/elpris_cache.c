@@ -0,0 +1,507 @@
+#include "elpris_cache.h"
+
+#include "elpris_api.h"
+#include "file_cache.h"
+#include "http_gzip.h"
+#include "logger.h"
+#include "response_cache.h"
+#include "single_flight.h"
+
+#include <jansson.h>
+#include <smw.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Published days never change; the files only go when the cache is cleared */
+#define ELPRIS_CACHE_TTL (30 * 24 * 3600)
+
+/* Check for missing days this often */
+#define ELPRIS_PREFETCH_INTERVAL_MS (10 * 60 * 1000)
+
+/* Day-ahead prices for tomorrow are out shortly before this hour (Swedish
+ * local time) */
+#define ELPRIS_PUBLISH_HOUR 13
+
+/* ============= Internal Structures ============= */
+
+/* One cached day; the ElprisDay handed out points into it */
+typedef struct {
+    ElprisDay day;
+    uint64_t  last_used;
+    char      etag[RESPONSE_CACHE_ETAG_LENGTH];
+} CachedDay;
+
+/* Per-fetch state carried through elpris_api_fetch_async */
+typedef struct {
+    char key[sizeof(((ElprisDay*)0)->key)];
+} FetchContext;
+
+/* ============= Global State ============= */
+
+static bool               g_initialized = false;
+static FileCacheInstance* g_file_cache  = NULL;
+static SingleFlightTable* g_flights     = NULL;
+static SmwTask*           g_prefetch    = NULL;
+
+/* In-memory days, least recently used evicted first */
+static CachedDay* g_slots[ELPRIS_CACHE_SLOTS];
+static uint64_t   g_use_counter = 0;
+
+static uint64_t g_next_prefetch_ms = 0;
+
+static const char* const g_price_groups[] = {"SE1", "SE2", "SE3", "SE4"};
+
+/* ============= Parsing ============= */
+
+/**
+ * Parse "2024-12-31T00:00:00+01:00" into UTC seconds, or -1
+ */
+static time_t parse_timestamp(const char* text) {
+    int  year, month, day, hour, minute, second;
+    int  offset_hours = 0, offset_minutes = 0;
+    char sign         = 'Z';
+
+    if (!text || sscanf(text, "%d-%d-%dT%d:%d:%d%c%d:%d", &year, &month, &day,
+                        &hour, &minute, &second, &sign, &offset_hours,
+                        &offset_minutes) < 6) {
+        return -1;
+    }
+
+    struct tm tm = {.tm_year = year - 1900,
+                    .tm_mon  = month - 1,
+                    .tm_mday = day,
+                    .tm_hour = hour,
+                    .tm_min  = minute,
+                    .tm_sec  = second};
+
+    time_t offset = offset_hours * 3600 + offset_minutes * 60;
+    if (sign == '-') {
+        offset = -offset;
+    } else if (sign != '+') {
+        offset = 0;
+    }
+
+    return timegm(&tm) - offset;
+}
+
+/**
+ * Parse an upstream price array; returns the number of intervals, or -1
+ */
+static int parse_prices(const char* json, size_t length, ElprisPrice* out) {
+    json_error_t error;
+    json_t*      root = json_loadb(json, length, 0, &error);
+    if (!root) {
+        return -1;
+    }
+
+    if (!json_is_array(root) || json_array_size(root) == 0 ||
+        json_array_size(root) > ELPRIS_CACHE_MAX_PRICES) {
+        json_decref(root);
+        return -1;
+    }
+
+    size_t  index;
+    json_t* item;
+    json_array_foreach(root, index, item) {
+        ElprisPrice* price = &out[index];
+        price->sek_per_kwh =
+            (float)json_number_value(json_object_get(item, "SEK_per_kWh"));
+        price->eur_per_kwh =
+            (float)json_number_value(json_object_get(item, "EUR_per_kWh"));
+        price->start = parse_timestamp(
+            json_string_value(json_object_get(item, "time_start")));
+        price->end = parse_timestamp(
+            json_string_value(json_object_get(item, "time_end")));
+
+        if (price->start < 0 || price->end <= price->start) {
+            json_decref(root);
+            return -1;
+        }
+    }
+
+    int count = (int)json_array_size(root);
+    json_decref(root);
+    return count;
+}
+
+/* ============= Memory Table ============= */
+
+static void cached_day_free(CachedDay* cached) {
+    if (!cached) {
+        return;
+    }
+
+    free((char*)cached->day.json);
+    free((char*)cached->day.gzip_json);
+    free(cached->day.prices);
+    free(cached);
+}
+
+/**
+ * Build a cached day from an upstream response; NULL if it does not parse
+ */
+static CachedDay* cached_day_create(const char* key, const char* json,
+                                    size_t length, time_t fetched_at) {
+    ElprisPrice prices[ELPRIS_CACHE_MAX_PRICES];
+    int         count = parse_prices(json, length, prices);
+    if (count <= 0) {
+        return NULL;
+    }
+
+    CachedDay*   cached = calloc(1, sizeof(CachedDay));
+    char*        copy   = malloc(length + 1);
+    ElprisPrice* array  = malloc((size_t)count * sizeof(ElprisPrice));
+    if (!cached || !copy || !array) {
+        free(cached);
+        free(copy);
+        free(array);
+        return NULL;
+    }
+
+    memcpy(copy, json, length);
+    copy[length] = '\0';
+    memcpy(array, prices, (size_t)count * sizeof(ElprisPrice));
+
+    char*  gzip        = NULL;
+    size_t gzip_length = 0;
+    http_gzip_compress(copy, length, &gzip, &gzip_length);
+    response_cache_etag(copy, length, cached->etag);
+
+    snprintf(cached->day.key, sizeof(cached->day.key), "%s", key);
+    cached->day.json        = copy;
+    cached->day.json_length = length;
+    cached->day.gzip_json   = gzip;
+    cached->day.gzip_length = gzip_length;
+    cached->day.etag        = cached->etag;
+    cached->day.fetched_at  = fetched_at;
+    cached->day.prices      = array;
+    cached->day.count       = (size_t)count;
+    return cached;
+}
+
+static CachedDay* memory_find(const char* key) {
+    for (size_t i = 0; i < ELPRIS_CACHE_SLOTS; i++) {
+        if (g_slots[i] && strcmp(g_slots[i]->day.key, key) == 0) {
+            g_slots[i]->last_used = ++g_use_counter;
+            return g_slots[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Store a day, replacing the same key or the least recently used slot
+ */
+static void memory_insert(CachedDay* cached) {
+    size_t victim = 0;
+    for (size_t i = 0; i < ELPRIS_CACHE_SLOTS; i++) {
+        if (!g_slots[i] || strcmp(g_slots[i]->day.key, cached->day.key) == 0) {
+            victim = i;
+            break;
+        }
+        if (g_slots[i]->last_used < g_slots[victim]->last_used) {
+            victim = i;
+        }
+    }
+
+    cached_day_free(g_slots[victim]);
+    cached->last_used = ++g_use_counter;
+    g_slots[victim]   = cached;
+}
+
+/* ============= File Cache ============= */
+
+static int file_key(const char* key, char* out, size_t out_size) {
+    char input[64];
+    snprintf(input, sizeof(input), "elpris_%s", key);
+    return file_cache_generate_key(g_file_cache, input, out, out_size) ==
+                   FILE_CACHE_OK
+               ? 0
+               : -1;
+}
+
+/**
+ * Load a day saved by an earlier process into the memory table
+ */
+static CachedDay* file_load(const char* key) {
+    char cache_key[FILE_CACHE_KEY_LENGTH];
+    if (!g_file_cache || file_key(key, cache_key, sizeof(cache_key)) != 0) {
+        return NULL;
+    }
+
+    char*  json       = NULL;
+    size_t length     = 0;
+    time_t expires_at = 0;
+    if (file_cache_get_expiry(g_file_cache, cache_key, &expires_at) !=
+            FILE_CACHE_OK ||
+        file_cache_load(g_file_cache, cache_key, &json, &length) !=
+            FILE_CACHE_OK) {
+        return NULL;
+    }
+
+    CachedDay* cached =
+        cached_day_create(key, json, length, expires_at - ELPRIS_CACHE_TTL);
+    free(json);
+
+    if (cached) {
+        memory_insert(cached);
+    }
+    return cached;
+}
+
+static void file_save(const char* key, const char* json, size_t length) {
+    char cache_key[FILE_CACHE_KEY_LENGTH];
+    if (!g_file_cache || file_key(key, cache_key, sizeof(cache_key)) != 0 ||
+        file_cache_save(g_file_cache, cache_key, json, length) !=
+            FILE_CACHE_OK) {
+        LOGGER_ERROR("[ELPRIS] Failed to save %s to cache", key);
+    }
+}
+
+/* ============= Upstream Fetch ============= */
+
+static void deliver_day(SingleFlightCallback callback, void* context,
+                        int result, const void* value) {
+    ElprisCacheOnDay on_day = (ElprisCacheOnDay)callback;
+    on_day(result, (const ElprisDay*)value, context);
+}
+
+static int on_upstream_response(char* json_data, void* context) {
+    FetchContext* ctx    = (FetchContext*)context;
+    CachedDay*    cached = NULL;
+
+    if (!g_initialized) {
+        free(ctx); /* Finished after elpris_cache_cleanup */
+        return 0;
+    }
+
+    if (json_data) {
+        size_t length = strlen(json_data);
+        cached = cached_day_create(ctx->key, json_data, length, time(NULL));
+        if (cached) {
+            file_save(ctx->key, json_data, length);
+            memory_insert(cached);
+        } else {
+            LOGGER_ERROR("[ELPRIS] Unexpected response for %s", ctx->key);
+        }
+    }
+
+    if (cached) {
+        LOGGER_DEBUG("[ELPRIS] Cached %s (%zu prices)", ctx->key,
+                     cached->day.count);
+        single_flight_complete(g_flights, ctx->key, 0, &cached->day);
+    } else {
+        single_flight_complete(g_flights, ctx->key, -2, NULL);
+    }
+
+    free(ctx);
+    return 0;
+}
+
+/* ============= Prefetch Task ============= */
+
+/**
+ * 01:00 UTC on the last Sunday of a month, when EU clocks change
+ */
+static time_t last_sunday_utc(int year, int month) {
+    /* Day 0 of the following month is the last day of this one */
+    struct tm tm = {.tm_year = year - 1900, .tm_mon = month, .tm_hour = 1};
+    time_t    t  = timegm(&tm);
+
+    struct tm last;
+    gmtime_r(&t, &last);
+    return t - (time_t)last.tm_wday * 24 * 3600;
+}
+
+/**
+ * UTC offset of Swedish local time (CET or CEST) at a moment
+ */
+static time_t stockholm_utc_offset(time_t now) {
+    struct tm utc;
+    gmtime_r(&now, &utc);
+
+    int year = utc.tm_year + 1900;
+    return now >= last_sunday_utc(year, 3) && now < last_sunday_utc(year, 10)
+               ? 2 * 3600
+               : 3600;
+}
+
+static void on_prefetched(int result, const ElprisDay* day, void* context) {
+    (void)day;
+    if (result != 0) {
+        LOGGER_ERROR("[ELPRIS] Prefetch of %s failed (%d)",
+                     (const char*)context, result);
+    }
+}
+
+/**
+ * Start fetches for every price area missing for the local date at local
+ */
+static void prefetch_day(time_t local) {
+    struct tm date;
+    gmtime_r(&local, &date);
+
+    for (size_t i = 0; i < sizeof(g_price_groups) / sizeof(g_price_groups[0]);
+         i++) {
+        char key[sizeof(((ElprisDay*)0)->key)];
+        snprintf(key, sizeof(key), "%04d-%02d-%02d_%s", date.tm_year + 1900,
+                 date.tm_mon + 1, date.tm_mday, g_price_groups[i]);
+
+        if (memory_find(key) || single_flight_waiters(g_flights, key) > 0) {
+            continue;
+        }
+
+        elpris_cache_get_async(date.tm_year + 1900, date.tm_mon + 1,
+                               date.tm_mday, g_price_groups[i], on_prefetched,
+                               (void*)g_price_groups[i]);
+    }
+}
+
+static void prefetch_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+    if (mon_time < g_next_prefetch_ms) {
+        return;
+    }
+    g_next_prefetch_ms = mon_time + ELPRIS_PREFETCH_INTERVAL_MS;
+
+    /* Shifted so gmtime_r yields the Swedish calendar date and hour */
+    time_t    now   = time(NULL);
+    time_t    local = now + stockholm_utc_offset(now);
+    struct tm clock;
+    gmtime_r(&local, &clock);
+
+    prefetch_day(local);
+    if (clock.tm_hour >= ELPRIS_PUBLISH_HOUR) {
+        prefetch_day(local + 24 * 3600);
+    }
+}
+
+/* ============= Public API ============= */
+
+int elpris_cache_init(void) {
+    if (g_initialized) {
+        return 0;
+    }
+
+    FileCacheConfig cache_cfg = {.cache_dir    = ELPRIS_CACHE_DIR,
+                                 .ttl_seconds  = ELPRIS_CACHE_TTL,
+                                 .enabled      = true,
+                                 .memory_bytes = 0, /* Own table above */
+                                 .extension    = ".json",
+                                 .write_behind = true};
+
+    g_file_cache = file_cache_create(&cache_cfg);
+    if (!g_file_cache) {
+        LOGGER_WARN("[ELPRIS] Warning: Failed to initialize file cache");
+    }
+
+    g_flights = single_flight_create(deliver_day);
+    if (!g_flights) {
+        LOGGER_ERROR("[ELPRIS] Failed to create fetch table");
+        file_cache_destroy(g_file_cache);
+        g_file_cache = NULL;
+        return -1;
+    }
+
+    g_next_prefetch_ms = 0; /* First check on the next scheduler pass */
+    g_prefetch         = smw_create_task(NULL, prefetch_task_work);
+    if (!g_prefetch) {
+        LOGGER_WARN("[ELPRIS] Warning: Failed to start prefetch task");
+    }
+
+    g_initialized = true;
+    LOGGER_INFO("[ELPRIS] Cache initialized (%s)", ELPRIS_CACHE_DIR);
+    return 0;
+}
+
+void elpris_cache_cleanup(void) {
+    if (!g_initialized) {
+        return;
+    }
+
+    if (g_prefetch) {
+        smw_destroy_task(g_prefetch);
+        g_prefetch = NULL;
+    }
+
+    for (size_t i = 0; i < ELPRIS_CACHE_SLOTS; i++) {
+        cached_day_free(g_slots[i]);
+        g_slots[i] = NULL;
+    }
+
+    /* Fetches still in flight complete into a NULL table and are dropped */
+    single_flight_destroy(g_flights);
+    g_flights = NULL;
+    file_cache_destroy(g_file_cache);
+    g_file_cache = NULL;
+
+    g_initialized = false;
+}
+
+int elpris_cache_get_async(unsigned int year, unsigned int month,
+                           unsigned int day, const char* price_group,
+                           ElprisCacheOnDay callback, void* context) {
+    if (!callback) {
+        return -1;
+    }
+
+    if (!price_group || !g_initialized) {
+        callback(-1, NULL, context);
+        return -1;
+    }
+
+    char key[sizeof(((ElprisDay*)0)->key)];
+    snprintf(key, sizeof(key), "%04u-%02u-%02u_%s", year, month, day,
+             price_group);
+
+    CachedDay* cached = memory_find(key);
+    if (!cached) {
+        cached = file_load(key);
+    }
+    if (cached) {
+        callback(0, &cached->day, context);
+        return 0;
+    }
+
+    int role = single_flight_join(g_flights, key,
+                                  (SingleFlightCallback)callback, context);
+    if (role == SINGLE_FLIGHT_ERROR) {
+        callback(-1, NULL, context);
+        return -1;
+    }
+    if (role == SINGLE_FLIGHT_WAITER) {
+        return 0;
+    }
+
+    FetchContext* ctx = malloc(sizeof(FetchContext));
+    if (!ctx) {
+        single_flight_complete(g_flights, key, -1, NULL);
+        return -1;
+    }
+    snprintf(ctx->key, sizeof(ctx->key), "%s", key);
+
+    char group[4];
+    snprintf(group, sizeof(group), "%s", price_group);
+
+    if (elpris_api_fetch_async(year, month, day, group, on_upstream_response,
+                               ctx) < 0) {
+        free(ctx);
+        single_flight_complete(g_flights, key, -2, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+void elpris_cache_local_date(time_t when, unsigned int* out_year,
+                             unsigned int* out_month, unsigned int* out_day) {
+    time_t    local = when + stockholm_utc_offset(when);
+    struct tm date;
+    gmtime_r(&local, &date);
+
+    *out_year  = (unsigned int)date.tm_year + 1900;
+    *out_month = (unsigned int)date.tm_mon + 1;
+    *out_day   = (unsigned int)date.tm_mday;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file elpris_cache.h
+ * @brief Cache and prefetcher for day-ahead electricity prices.
+ *
+ * Prices are published once a day per price area and never change
+ * afterwards, so every (date, price area) pair is fetched from
+ * elprisetjustnu.se at most once. Responses are kept in a small in-memory
+ * table, parsed into a compact price array, and written to a
+ * FileCacheInstance so a restarted server does not refetch them.
+ * Concurrent misses for the same day share one upstream request.
+ *
+ * A scheduler task prefetches today's prices at startup and tomorrow's
+ * once they are published (13:00 Swedish time), for SE1-SE4, so user
+ * requests are answered from memory.
+ */
+
+#ifndef ELPRIS_CACHE_H
+#define ELPRIS_CACHE_H
+
+#include <stddef.h>
+#include <time.h>
+
+/** @brief Cache directory for raw upstream responses. */
+#define ELPRIS_CACHE_DIR "./cache/elpris_cache"
+
+/** @brief Number of days kept in memory. */
+#define ELPRIS_CACHE_SLOTS 32
+
+/** @brief Maximum number of price intervals in one day (15 minute
+ *         resolution on a 25 hour DST day). */
+#define ELPRIS_CACHE_MAX_PRICES 100
+
+/**
+ * @brief One price interval.
+ */
+typedef struct {
+    time_t start; /* Interval start (UTC) */
+    time_t end;   /* Interval end (UTC) */
+    float  sek_per_kwh;
+    float  eur_per_kwh;
+} ElprisPrice;
+
+/**
+ * @brief Prices of one day in one price area.
+ *
+ * Owned by the cache and only valid for the duration of the callback it
+ * is passed to.
+ */
+typedef struct {
+    char         key[24];   /* "YYYY-MM-DD_SE3" */
+    const char*  json;      /* Upstream response, as received */
+    size_t       json_length;
+    const char*  gzip_json; /* gzip copy of json, or NULL */
+    size_t       gzip_length;
+    const char*  etag;      /* Quoted strong ETag of json */
+    time_t       fetched_at;
+    ElprisPrice* prices;    /* Intervals in upstream order */
+    size_t       count;
+} ElprisDay;
+
+/**
+ * @brief Callback invoked when a price lookup completes.
+ *
+ * @param result
+ *        0 on success, negative on error (day is NULL then).
+ *
+ * @param day
+ *        Prices of the requested day, borrowed from the cache.
+ *
+ * @param context
+ *        User-defined context pointer passed to the lookup.
+ */
+typedef void (*ElprisCacheOnDay)(int result, const ElprisDay* day,
+                                 void* context);
+
+/**
+ * @brief Create the caches and start the prefetch task.
+ *
+ * Must be called after smw_init(). Safe to call more than once.
+ *
+ * @return
+ *        0 on success, -1 on failure.
+ */
+int elpris_cache_init(void);
+
+/**
+ * @brief Stop the prefetch task and free all cached days.
+ */
+void elpris_cache_cleanup(void);
+
+/**
+ * @brief Look up the prices of one day without blocking the event loop.
+ *
+ * Memory and file cache hits invoke the callback before returning; misses
+ * invoke it from the upstream response callback.
+ *
+ * @param year, month, day
+ *        Delivery date.
+ *
+ * @param price_group
+ *        Price area code, e.g. "SE3".
+ *
+ * @param callback
+ *        Completion callback. Must not be NULL.
+ *
+ * @param context
+ *        Optional user-defined pointer passed through to the callback.
+ *
+ * @return
+ *        0 if the lookup was answered or started, -1 on error (the
+ *        callback has received the error).
+ */
+int elpris_cache_get_async(unsigned int year, unsigned int month,
+                           unsigned int day, const char* price_group,
+                           ElprisCacheOnDay callback, void* context);
+
+/**
+ * @brief Swedish calendar date (CET/CEST) at a moment, the date prices
+ *        are published by.
+ *
+ * @param when
+ *        Moment to convert, e.g. time(NULL).
+ *
+ * @param out_year, out_month, out_day
+ *        Local date.
+ */
+void elpris_cache_local_date(time_t when, unsigned int* out_year,
+                             unsigned int* out_month, unsigned int* out_day);
+
+#endif // ELPRIS_CACHE_H
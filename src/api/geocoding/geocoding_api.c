@@ -6,11 +6,15 @@
  */
 
 #include <cache_utils/file_cache.h>
+#include <cache_utils/single_flight.h>
+#include <city_index.h>
 #include <ctype.h>
 #include <errno.h>
 #include <geocoding_api.h>
-#include <http_client.h>
+#include <http_pool.h>
 #include <jansson.h>
+#include <logger.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +27,13 @@
 #define DEFAULT_CACHE_TTL 604800 /* 7 days */
 #define DEFAULT_MAX_RESULTS 10
 #define DEFAULT_LANGUAGE "eng"
+#define CACHE_FILE_EXTENSION ".bin"
+#define CACHE_DISK_BYTES (64 * 1024 * 1024) /* Janitor budget for the files */
+#define RESOLVE_CANDIDATES 32 /* Index hits checked for an exact name */
+
+/* Binary cache record: header followed by count raw GeocodingResult structs */
+#define GEOCODING_RECORD_MAGIC 0x4753574Au /* "JWSG" */
+#define GEOCODING_RECORD_VERSION 1
 
 /* ============= Global State ============= */
 
@@ -32,30 +43,58 @@ static GeocodingConfig g_config = {.cache_dir   = DEFAULT_CACHE_DIR,
                                    .max_results = DEFAULT_MAX_RESULTS,
                                    .language    = DEFAULT_LANGUAGE};
 
-/* Popular cities database pointer (set by weather_location_handler) */
+/* Binary city index (set by weather_location_handler) */
+CityIndex* g_city_index = NULL;
+
+/* Popular cities database pointer, used when the city index is missing
+ * (set by weather_location_handler) */
 void* g_popular_cities_db = NULL;
 
 /* Cache instance */
 static FileCacheInstance* g_geo_cache = NULL;
 
+/* In-flight upstream searches, keyed by request URL */
+static SingleFlightTable* g_geo_flights = NULL;
+
 /* ============= Internal Structures ============= */
 
+/* Per-fetch state carried through http_pool_get; callers wait on the
+ * single-flight entry for flight_key */
 typedef struct {
-    char*        response_data;
-    size_t       response_size;
-    int          http_status;
-    volatile int completed;
-    volatile int error;
-} HttpFetchContext;
+    bool save_to_cache;
+    char cache_key[FILE_CACHE_KEY_LENGTH];
+    char flight_key[FILE_CACHE_KEY_LENGTH];
+} GeocodingRequestContext;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t result_size; /* sizeof(GeocodingResult) of the writer */
+    uint32_t count;
+} GeocodingRecordHeader;
+
+/* State for a region-filtered search wrapping geocoding_api_search_async */
+typedef struct {
+    GeocodingOnResponse callback;
+    void*               context;
+    char                region[128];
+} DetailedSearchContext;
 
 /* ============= Internal Functions ============= */
 
-static void  http_fetch_callback(const char* event, const char* response,
-                                 void* context);
-static int   fetch_url_sync(const char* url, char** response_data,
-                            int* http_status);
-static int   fetch_from_api(const char* city_name, const char* country,
-                            GeocodingResponse** response);
+static void  geocoding_fetch_callback(const char* event, const char* response,
+                                      void* context);
+static int   fetch_from_api_async(const char* city_name, const char* country,
+                                  const char*         save_key,
+                                  GeocodingOnResponse callback, void* context);
+static void  deliver_geocoding(SingleFlightCallback callback, void* context,
+                               int result, const void* value);
+static int   make_cache_key(const char* city_name, char* cache_key,
+                            size_t key_size);
+static int   load_from_cache(const char*         cache_key,
+                             GeocodingResponse** response);
+static void  save_to_cache(const char*              cache_key,
+                           const GeocodingResponse* response);
 static char* build_api_url(const char* city_name, const char* country,
                            int max_results, const char* language);
 static int   parse_geocoding_json(const char*         json_str,
@@ -70,30 +109,44 @@ int geocoding_api_init(GeocodingConfig* config) {
     }
 
     /* Initialize cache */
-    FileCacheConfig cache_cfg = {.cache_dir   = g_config.cache_dir,
-                                 .ttl_seconds = g_config.cache_ttl,
-                                 .enabled     = g_config.use_cache};
+    FileCacheConfig cache_cfg = {.cache_dir    = g_config.cache_dir,
+                                 .ttl_seconds  = g_config.cache_ttl,
+                                 .enabled      = g_config.use_cache,
+                                 .memory_bytes = g_config.memory_cache_bytes,
+                                 .extension    = CACHE_FILE_EXTENSION,
+                                 .write_behind = true,
+                                 .disk_bytes   = CACHE_DISK_BYTES};
 
     g_geo_cache = file_cache_create(&cache_cfg);
     if (!g_geo_cache) {
-        fprintf(stderr, "[GEOCODING] Warning: Failed to initialize cache\n");
+        LOGGER_WARN("[GEOCODING] Warning: Failed to initialize cache");
+    }
+
+    if (!g_geo_flights) {
+        g_geo_flights = single_flight_create(deliver_geocoding);
+        if (!g_geo_flights) {
+            LOGGER_ERROR("[GEOCODING] Failed to create fetch table");
+            return -1;
+        }
     }
 
-    printf("[GEOCODING] API initialized (http_client mode)\n");
-    printf("[GEOCODING] Cache dir: %s\n", g_config.cache_dir);
-    printf("[GEOCODING] Cache TTL: %d seconds (%d days)\n", g_config.cache_ttl,
-           g_config.cache_ttl / 86400);
-    printf("[GEOCODING] Cache enabled: %s\n",
-           g_config.use_cache ? "yes" : "no");
-    printf("[GEOCODING] Language: %s\n", g_config.language);
+    LOGGER_INFO("[GEOCODING] API initialized (upstream via http_pool)");
+    LOGGER_INFO("[GEOCODING] Cache dir: %s", g_config.cache_dir);
+    LOGGER_INFO("[GEOCODING] Cache TTL: %d seconds (%d days)",
+                g_config.cache_ttl, g_config.cache_ttl / 86400);
+    LOGGER_INFO("[GEOCODING] Cache enabled: %s",
+                g_config.use_cache ? "yes" : "no");
+    LOGGER_INFO("[GEOCODING] Language: %s", g_config.language);
+    LOGGER_INFO("[GEOCODING] Memory tier: %zu bytes",
+                g_config.memory_cache_bytes);
 
     return 0;
 }
 
-int geocoding_api_search(const char* city_name, const char* country,
-                         GeocodingResponse** response) {
-    if (!city_name || !response) {
-        fprintf(stderr, "[GEOCODING] Invalid parameters\n");
+int geocoding_api_search_async(const char* city_name, const char* country,
+                               GeocodingOnResponse callback, void* context) {
+    if (!city_name || !callback) {
+        LOGGER_ERROR("[GEOCODING] Invalid parameters");
         return -1;
     }
 
@@ -101,158 +154,86 @@ int geocoding_api_search(const char* city_name, const char* country,
      * This makes cache files shared by city regardless of country/language
      * or small input variations (case/whitespace).
      */
-    char normalized[256];
-    file_cache_normalize_string(city_name, normalized, sizeof(normalized));
-
     char cache_key[FILE_CACHE_KEY_LENGTH];
-    if (file_cache_generate_key(g_geo_cache, normalized, cache_key,
-                                sizeof(cache_key)) != FILE_CACHE_OK) {
-        fprintf(stderr, "[GEOCODING] Failed to generate cache key\n");
+    if (make_cache_key(city_name, cache_key, sizeof(cache_key)) != 0) {
+        LOGGER_ERROR("[GEOCODING] Failed to generate cache key");
+        callback(-2, NULL, context);
         return -2;
     }
 
-    printf("[GEOCODING] Searching for: %s%s%s\n", city_name,
-           country ? " in " : "", country ? country : "");
+    LOGGER_DEBUG("[GEOCODING] Searching for: %s%s%s", city_name,
+                 country ? " in " : "", country ? country : "");
 
-    /* Check cache */
+    /* Check cache - a hit completes synchronously */
     if (g_config.use_cache && file_cache_is_valid(g_geo_cache, cache_key)) {
-        printf("[GEOCODING] Cache HIT - loading from file\n");
-
-        json_t* cached_json = NULL;
-        if (file_cache_load_json(g_geo_cache, cache_key,
-                                 (void**)&cached_json) == FILE_CACHE_OK) {
-            char* json_str = json_dumps(cached_json, 0);
-            json_decref(cached_json);
-
-            if (json_str) {
-                int result = parse_geocoding_json(json_str, response);
-                free(json_str);
-                if (result == 0) {
-                    return 0; /* Successfully loaded from cache */
-                }
-            }
+        LOGGER_DEBUG("[GEOCODING] Cache HIT - loading from file");
+
+        GeocodingResponse* response = NULL;
+        if (load_from_cache(cache_key, &response) == 0) {
+            callback(0, response, context);
+            geocoding_api_free_response(response);
+            return 0;
         }
 
-        fprintf(stderr, "[GEOCODING] Cache load failed, fetching from API\n");
+        LOGGER_WARN("[GEOCODING] Cache load failed, fetching from API");
     } else {
         if (g_config.use_cache) {
-            printf("[GEOCODING] Cache MISS - fetching from API\n");
-        } else {
-            printf("[GEOCODING] Cache disabled - fetching from API\n");
-        }
-    }
-
-    /* Fetch from API */
-    int result = fetch_from_api(city_name, country, response);
-
-    if (result != 0) {
-        fprintf(stderr, "[GEOCODING] API fetch failed\n");
-        return -3;
-    }
-
-    /* Save to cache */
-    if (g_config.use_cache && *response) {
-        /* Convert response back to JSON for saving */
-        json_t* root          = json_object();
-        json_t* results_array = json_array();
-
-        for (int i = 0; i < (*response)->count; i++) {
-            GeocodingResult* r    = &(*response)->results[i];
-            json_t*          item = json_object();
-
-            json_object_set_new(item, "id", json_integer(r->id));
-            json_object_set_new(item, "name", json_string(r->name));
-            json_object_set_new(item, "latitude", json_real(r->latitude));
-            json_object_set_new(item, "longitude", json_real(r->longitude));
-            json_object_set_new(item, "country", json_string(r->country));
-            json_object_set_new(item, "country_code",
-                                json_string(r->country_code));
-            if (r->admin1[0]) {
-                json_object_set_new(item, "admin1", json_string(r->admin1));
-            }
-            if (r->admin2[0]) {
-                json_object_set_new(item, "admin2", json_string(r->admin2));
-            }
-            if (r->population > 0) {
-                json_object_set_new(item, "population",
-                                    json_integer(r->population));
-            }
-            if (r->timezone[0]) {
-                json_object_set_new(item, "timezone", json_string(r->timezone));
-            }
-
-            json_array_append_new(results_array, item);
-        }
-
-        json_object_set_new(root, "results", results_array);
-
-        if (file_cache_save_json(g_geo_cache, cache_key, root) ==
-            FILE_CACHE_OK) {
-            printf("[GEOCODING] Saved to cache\n");
+            LOGGER_DEBUG("[GEOCODING] Cache MISS - fetching from API");
         } else {
-            fprintf(stderr, "[GEOCODING] Failed to save cache\n");
+            LOGGER_DEBUG("[GEOCODING] Cache disabled - fetching from API");
         }
-        json_decref(root);
     }
 
-    return 0;
+    /* Fetch from API, result is saved to cache on completion */
+    return fetch_from_api_async(city_name, country,
+                                g_config.use_cache ? cache_key : NULL, callback,
+                                context);
 }
 
-/* Same as geocoding_api_search but do not read or write cache. This is
+/* Same as geocoding_api_search_async but do not read or write cache. This is
  * useful for the autocomplete `/v1/cities` endpoint which shouldn't
  * create/update the city cache. */
-int geocoding_api_search_no_cache(const char* city_name, const char* country,
-                                  GeocodingResponse** response) {
-    if (!city_name || !response) {
+int geocoding_api_search_no_cache_async(const char*         city_name,
+                                        const char*         country,
+                                        GeocodingOnResponse callback,
+                                        void*               context) {
+    if (!city_name || !callback) {
         return -1;
     }
 
     /* Directly fetch from API and return parsed results without saving */
-    int r = fetch_from_api(city_name, country, response);
-    if (r != 0) {
-        return r;
-    }
-
-    return 0;
+    return fetch_from_api_async(city_name, country, NULL, callback, context);
 }
 
 /* Read-only cache search: try to load from cache, otherwise fetch but do
  * not save to cache. This prevents endpoints like `/v1/cities` from creating
  * new cache files while still benefiting from existing cache entries. */
-int geocoding_api_search_readonly_cache(const char*         city_name,
-                                        const char*         country,
-                                        GeocodingResponse** response) {
-    if (!city_name || !response) {
+int geocoding_api_search_readonly_cache_async(const char*         city_name,
+                                              const char*         country,
+                                              GeocodingOnResponse callback,
+                                              void*               context) {
+    if (!city_name || !callback) {
         return -1;
     }
 
-    char normalized[256];
-    file_cache_normalize_string(city_name, normalized, sizeof(normalized));
-
     char cache_key[FILE_CACHE_KEY_LENGTH];
-    if (file_cache_generate_key(g_geo_cache, normalized, cache_key,
-                                sizeof(cache_key)) != FILE_CACHE_OK) {
+    if (make_cache_key(city_name, cache_key, sizeof(cache_key)) != 0) {
+        callback(-2, NULL, context);
         return -2;
     }
 
     /* Try load from cache if valid */
     if (g_config.use_cache && file_cache_is_valid(g_geo_cache, cache_key)) {
-        json_t* cached_json = NULL;
-        if (file_cache_load_json(g_geo_cache, cache_key,
-                                 (void**)&cached_json) == FILE_CACHE_OK) {
-            char* json_str = json_dumps(cached_json, 0);
-            json_decref(cached_json);
-
-            if (json_str) {
-                int result = parse_geocoding_json(json_str, response);
-                free(json_str);
-                return result;
-            }
+        GeocodingResponse* response = NULL;
+        if (load_from_cache(cache_key, &response) == 0) {
+            callback(0, response, context);
+            geocoding_api_free_response(response);
+            return 0;
         }
     }
 
     /* Cache miss: fetch from API but DO NOT save into cache */
-    return fetch_from_api(city_name, country, response);
+    return fetch_from_api_async(city_name, country, NULL, callback, context);
 }
 
 /* ============= Smart Search with 3-Tier Strategy ============= */
@@ -311,21 +292,81 @@ static GeocodingResponse* convert_popular_to_geocoding(PopularCity** cities,
     return resp;
 }
 
-int geocoding_api_search_smart(const char*         query,
-                               GeocodingResponse** response) {
-    if (!query || !response) {
-        fprintf(stderr, "[GEOCODING] Invalid parameters\n");
+/* Helper: Copy a city index entry into a geocoding result */
+static void copy_index_entry(const CityIndexEntry* entry,
+                             GeocodingResult*      gr) {
+    strncpy(gr->name, entry->name, sizeof(gr->name) - 1);
+    strncpy(gr->country, entry->country, sizeof(gr->country) - 1);
+    strncpy(gr->country_code, entry->country_code,
+            sizeof(gr->country_code) - 1);
+    gr->latitude   = entry->latitude;
+    gr->longitude  = entry->longitude;
+    gr->population = (int)entry->population;
+}
+
+/* Helper: Convert city index entries to GeocodingResponse */
+static GeocodingResponse* convert_index_to_geocoding(const uint32_t* ids,
+                                                     size_t          count) {
+    GeocodingResponse* resp = calloc(1, sizeof(GeocodingResponse));
+    if (!resp) {
+        return NULL;
+    }
+
+    resp->results = calloc(count, sizeof(GeocodingResult));
+    if (!resp->results) {
+        free(resp);
+        return NULL;
+    }
+
+    resp->count = count;
+
+    for (size_t i = 0; i < count; i++) {
+        CityIndexEntry   entry;
+        GeocodingResult* gr = &resp->results[i];
+
+        if (city_index_get(g_city_index, ids[i], &entry) != CITY_INDEX_OK) {
+            continue;
+        }
+
+        copy_index_entry(&entry, gr);
+    }
+
+    return resp;
+}
+
+int geocoding_api_search_smart_async(const char*         query,
+                                     GeocodingOnResponse callback,
+                                     void*               context) {
+    if (!query || !callback) {
+        LOGGER_ERROR("[GEOCODING] Invalid parameters");
         return -1;
     }
 
     /* Validate minimum query length */
     if (strlen(query) < 2) {
-        fprintf(stderr, "[GEOCODING] Query too short (min 2 characters)\n");
+        LOGGER_DEBUG("[GEOCODING] Query too short (min 2 characters)");
+        callback(-1, NULL, context);
         return -1;
     }
 
-    /* Tier 1: Search in Popular Cities DB */
-    if (g_popular_cities_db) {
+    /* Tier 1: Search in the local city index (or the JSON-loaded DB) */
+    if (g_city_index) {
+        uint32_t ids[10];
+        size_t   count = city_index_search(g_city_index, query, ids, 10);
+
+        if (count > 0) {
+            LOGGER_DEBUG("[GEOCODING] Found %zu results in city index", count);
+
+            GeocodingResponse* response =
+                convert_index_to_geocoding(ids, count);
+
+            if (response) {
+                callback(0, response, context);
+                geocoding_api_free_response(response);
+                return 0; /* SUCCESS - found in local index */
+            }
+        }
+    } else if (g_popular_cities_db) {
         PopularCity* popular_results[10];
         size_t       popular_count = 0;
 
@@ -333,111 +374,163 @@ int geocoding_api_search_smart(const char*         query,
                                         popular_results, &popular_count, 10);
 
         if (ret == 0 && popular_count > 0) {
-            printf("[GEOCODING] Found %zu results in popular cities DB\n",
-                   popular_count);
+            LOGGER_DEBUG("[GEOCODING] Found %zu results in popular cities DB",
+                         popular_count);
 
-            *response =
+            GeocodingResponse* response =
                 convert_popular_to_geocoding(popular_results, popular_count);
 
-            if (*response) {
+            if (response) {
+                callback(0, response, context);
+                geocoding_api_free_response(response);
                 return 0; /* SUCCESS - found in local DB */
             }
         }
     }
 
     /* Tier 2: Search in exact cache match */
-    if (geocoding_api_search_readonly_cache(query, NULL, response) == 0) {
-        if (response && *response && (*response)->count > 0) {
-            printf("[GEOCODING] Found %d results in cache\n",
-                   (*response)->count);
-            return 0; /* SUCCESS - found in cache */
+    char cache_key[FILE_CACHE_KEY_LENGTH];
+    if (g_config.use_cache &&
+        make_cache_key(query, cache_key, sizeof(cache_key)) == 0 &&
+        file_cache_is_valid(g_geo_cache, cache_key)) {
+        GeocodingResponse* response = NULL;
+        if (load_from_cache(cache_key, &response) == 0) {
+            if (response->count > 0) {
+                LOGGER_DEBUG("[GEOCODING] Found %d results in cache",
+                             response->count);
+                callback(0, response, context);
+                geocoding_api_free_response(response);
+                return 0; /* SUCCESS - found in cache */
+            }
+            geocoding_api_free_response(response);
         }
     }
 
-    /* Tier 3: Fallback to API */
-    printf("[GEOCODING] Cache miss, fetching from API for query: %s\n", query);
+    /* Tier 3: Fallback to API (results are not written to the cache) */
+    LOGGER_DEBUG("[GEOCODING] Cache miss, fetching from API for query: %s",
+                 query);
+
+    return fetch_from_api_async(query, NULL, NULL, callback, context);
+}
+
+int geocoding_api_resolve_local(const char* city_name, const char* country,
+                                GeocodingResult* out) {
+    if (!g_city_index || !city_name || !out) {
+        return -1;
+    }
+
+    char wanted[128];
+    if (city_index_normalize(city_name, wanted, sizeof(wanted)) == 0) {
+        return -1;
+    }
+
+    /* Ranked best first, so the first exact name that fits the country
+     * is the one the upstream search would most likely pick too */
+    uint32_t ids[RESOLVE_CANDIDATES];
+    size_t   count = city_index_search(g_city_index, city_name, ids,
+                                       RESOLVE_CANDIDATES);
+
+    for (size_t i = 0; i < count; i++) {
+        CityIndexEntry entry;
+        char           name[128];
+        if (city_index_get(g_city_index, ids[i], &entry) != CITY_INDEX_OK) {
+            continue;
+        }
 
-    int api_result = fetch_from_api(query, NULL, response);
+        city_index_normalize(entry.name, name, sizeof(name));
+        if (strcmp(name, wanted) != 0) {
+            continue;
+        }
+        if (country && country[0] != '\0' &&
+            strcasecmp(entry.country_code, country) != 0 &&
+            strcasecmp(entry.country, country) != 0) {
+            continue;
+        }
 
-    if (api_result == 0 && *response) {
-        /* Save to cache for future requests */
-        /* Note: fetch_from_api already handles caching internally */
-        printf("[GEOCODING] API returned %d results\n", (*response)->count);
+        memset(out, 0, sizeof(*out));
+        copy_index_entry(&entry, out);
+        return 0;
     }
 
-    return api_result;
+    return -1;
 }
 
-int geocoding_api_search_detailed(const char* city_name, const char* region,
-                                  const char*         country,
-                                  GeocodingResponse** response) {
-    /* First, perform a normal search */
-    int result = geocoding_api_search(city_name, country, response);
+/* Region filter applied once the underlying search completes */
+static void detailed_search_callback(int result, GeocodingResponse* response,
+                                     void* context) {
+    DetailedSearchContext* ctx = (DetailedSearchContext*)context;
 
-    if (result != 0 || !response || !*response) {
-        return result;
+    if (result != 0 || !response || ctx->region[0] == '\0') {
+        ctx->callback(result, response, ctx->context);
+        free(ctx);
+        return;
     }
 
-    /* If a region is specified, filter the results */
-    if (region && region[0] != '\0') {
-        /* Normalize region token: convert underscores/+ to spaces so
-         * inputs like "South_Dakota" or "South+Dakota" match "South Dakota".
-         */
-        char region_norm[128];
-        strncpy(region_norm, region, sizeof(region_norm) - 1);
-        region_norm[sizeof(region_norm) - 1] = '\0';
-        for (size_t k = 0; region_norm[k]; ++k) {
-            if (region_norm[k] == '_' || region_norm[k] == '+') {
-                region_norm[k] = ' ';
-            }
-        }
+    GeocodingResponse filtered = {0};
+    filtered.results = malloc(sizeof(GeocodingResult) * (response->count + 1));
+    if (!filtered.results) {
+        ctx->callback(-1, NULL, ctx->context);
+        free(ctx);
+        return;
+    }
 
-        GeocodingResponse* filtered = malloc(sizeof(GeocodingResponse));
-        if (!filtered) {
-            return -1;
+    /* Filter by region */
+    for (int i = 0; i < response->count; i++) {
+        GeocodingResult* r = &response->results[i];
+        if ((r->admin1[0] && strcasestr(r->admin1, ctx->region) != NULL) ||
+            (r->admin2[0] && strcasestr(r->admin2, ctx->region) != NULL)) {
+            filtered.results[filtered.count] = *r;
+            filtered.count++;
         }
+    }
 
-        filtered->results =
-            malloc(sizeof(GeocodingResult) * (*response)->count);
-        if (!filtered->results) {
-            free(filtered);
-            return -1;
-        }
+    if (filtered.count > 0) {
+        ctx->callback(0, &filtered, ctx->context);
+    } else {
+        /* If nothing is found after filtering, keep the original results */
+        LOGGER_DEBUG("[GEOCODING] No results match region '%s', returning all "
+                     "results",
+                     ctx->region);
+        ctx->callback(0, response, ctx->context);
+    }
 
-        filtered->count = 0;
+    free(filtered.results);
+    free(ctx);
+}
 
-        /* Filter by region */
-        for (int i = 0; i < (*response)->count; i++) {
-            GeocodingResult* r = &(*response)->results[i];
-            if ((r->admin1[0] && strcasestr(r->admin1, region_norm) != NULL) ||
-                (r->admin2[0] && strcasestr(r->admin2, region_norm) != NULL)) {
-                filtered->results[filtered->count] = *r;
-                filtered->count++;
-            }
-        }
+int geocoding_api_search_detailed_async(const char* city_name,
+                                        const char* region, const char* country,
+                                        GeocodingOnResponse callback,
+                                        void*               context) {
+    if (!city_name || !callback) {
+        return -1;
+    }
 
-        /* If filtered results are found, replace the original response */
-        if (filtered->count > 0) {
-            /* Reallocate memory to the exact count */
-            GeocodingResult* temp = realloc(
-                filtered->results, sizeof(GeocodingResult) * filtered->count);
-            if (temp) {
-                filtered->results = temp;
-            }
+    DetailedSearchContext* ctx = calloc(1, sizeof(DetailedSearchContext));
+    if (!ctx) {
+        callback(-1, NULL, context);
+        return -1;
+    }
 
-            geocoding_api_free_response(*response);
-            *response = filtered;
-        } else {
-            /* If nothing is found after filtering, keep the original results */
-            free(filtered->results);
-            free(filtered);
-            printf("[GEOCODING] No results match region '%s', returning all "
-                   "results\n",
-                   region);
+    ctx->callback = callback;
+    ctx->context  = context;
+
+    /* If a region is specified, filter the results */
+    if (region && region[0] != '\0') {
+        /* Normalize region token: convert underscores/+ to spaces so
+         * inputs like "South_Dakota" or "South+Dakota" match "South Dakota".
+         */
+        strncpy(ctx->region, region, sizeof(ctx->region) - 1);
+        for (size_t k = 0; ctx->region[k]; ++k) {
+            if (ctx->region[k] == '_' || ctx->region[k] == '+') {
+                ctx->region[k] = ' ';
+            }
         }
     }
 
-    return 0;
+    /* First, perform a normal search */
+    return geocoding_api_search_async(city_name, country,
+                                      detailed_search_callback, ctx);
 }
 
 GeocodingResult* geocoding_api_get_best_result(GeocodingResponse* response,
@@ -512,11 +605,11 @@ void geocoding_api_free_response(GeocodingResponse* response) {
 
 int geocoding_api_clear_cache(void) {
     if (file_cache_clear(g_geo_cache) == FILE_CACHE_OK) {
-        printf("[GEOCODING] Cache cleared\n");
+        LOGGER_INFO("[GEOCODING] Cache cleared");
         return 0;
     }
 
-    fprintf(stderr, "[GEOCODING] Failed to clear cache\n");
+    LOGGER_ERROR("[GEOCODING] Failed to clear cache");
     return -1;
 }
 
@@ -525,7 +618,11 @@ void geocoding_api_cleanup(void) {
         file_cache_destroy(g_geo_cache);
         g_geo_cache = NULL;
     }
-    printf("[GEOCODING] API cleaned up\n");
+    if (g_geo_flights) {
+        single_flight_destroy(g_geo_flights);
+        g_geo_flights = NULL;
+    }
+    LOGGER_INFO("[GEOCODING] API cleaned up");
 }
 
 int geocoding_api_format_result(GeocodingResult* result, char* buffer,
@@ -556,61 +653,107 @@ int geocoding_api_format_result(GeocodingResult* result, char* buffer,
 
 /* ============= Internal Functions Implementation ============= */
 
-/* ============= HTTP Client Integration ============= */
+/* ============= Cache Helpers ============= */
 
-static HttpFetchContext* g_fetch_context = NULL;
+static int make_cache_key(const char* city_name, char* cache_key,
+                          size_t key_size) {
+    char normalized[256];
+    file_cache_normalize_string(city_name, normalized, sizeof(normalized));
 
-static void http_fetch_callback(const char* event, const char* response,
-                                void* context) {
-    if (!g_fetch_context) {
-        return;
+    if (file_cache_generate_key(g_geo_cache, normalized, cache_key,
+                                key_size) != FILE_CACHE_OK) {
+        return -1;
     }
 
-    if (strcmp(event, "RESPONSE") == 0) {
-        g_fetch_context->response_data = strdup(response);
-        g_fetch_context->response_size = strlen(response);
-        g_fetch_context->http_status   = 200;
-        g_fetch_context->completed     = 1;
-    } else if (strcmp(event, "ERROR") == 0 || strcmp(event, "TIMEOUT") == 0) {
-        g_fetch_context->error     = 1;
-        g_fetch_context->completed = 1;
-    }
+    return 0;
 }
 
-static int fetch_url_sync(const char* url, char** response_data,
-                          int* http_status) {
-    HttpFetchContext context = {0};
-    g_fetch_context          = &context;
+/**
+ * Decode a binary cache record into a newly allocated response. Records
+ * written by another build (different magic, version or struct size) are
+ * rejected and reported as a miss.
+ */
+static int load_from_cache(const char*         cache_key,
+                           GeocodingResponse** response) {
+    char*  buffer = NULL;
+    size_t size   = 0;
 
-    http_client_get(url, NULL, 30000, http_fetch_callback, NULL);
+    if (file_cache_load(g_geo_cache, cache_key, &buffer, &size) !=
+        FILE_CACHE_OK) {
+        return -1;
+    }
 
-    /* Poll event loop - fast iterations, no sleep! */
-    time_t start_time      = time(NULL);
-    time_t timeout_seconds = 30;
+    const GeocodingRecordHeader* header = (const GeocodingRecordHeader*)buffer;
+    if (size < sizeof(GeocodingRecordHeader) ||
+        header->magic != GEOCODING_RECORD_MAGIC ||
+        header->version != GEOCODING_RECORD_VERSION ||
+        header->result_size != sizeof(GeocodingResult) ||
+        header->count > GEOCODING_MAX_RESULTS ||
+        size != sizeof(GeocodingRecordHeader) +
+                    header->count * sizeof(GeocodingResult)) {
+        free(buffer);
+        return -2;
+    }
 
-    while (!context.completed) {
-        smw_work(0); /* Pass 0 if monotonic time unavailable */
+    GeocodingResponse* parsed = calloc(1, sizeof(GeocodingResponse));
+    if (!parsed) {
+        free(buffer);
+        return -3;
+    }
 
-        /* Check timeout (1 second granularity) */
-        if (time(NULL) - start_time > timeout_seconds) {
-            fprintf(stderr, "[GEOCODING] Timeout waiting for response\n");
-            break;
+    if (header->count > 0) {
+        parsed->results = malloc(header->count * sizeof(GeocodingResult));
+        if (!parsed->results) {
+            free(parsed);
+            free(buffer);
+            return -3;
         }
+        memcpy(parsed->results, buffer + sizeof(GeocodingRecordHeader),
+               header->count * sizeof(GeocodingResult));
     }
 
-    g_fetch_context = NULL;
+    parsed->count = (int)header->count;
+    free(buffer);
 
-    if (context.error || !context.completed) {
-        if (context.response_data) {
-            free(context.response_data);
-        }
-        return -1;
+    *response = parsed;
+    return 0;
+}
+
+/**
+ * Encode a response as a binary cache record and save it
+ */
+static void save_to_cache(const char*              cache_key,
+                          const GeocodingResponse* response) {
+    size_t count = response->count > GEOCODING_MAX_RESULTS
+                       ? GEOCODING_MAX_RESULTS
+                       : (size_t)response->count;
+    size_t size =
+        sizeof(GeocodingRecordHeader) + count * sizeof(GeocodingResult);
+
+    char* buffer = calloc(1, size);
+    if (!buffer) {
+        LOGGER_ERROR("[GEOCODING] Failed to save cache");
+        return;
     }
 
-    *response_data = context.response_data;
-    *http_status   = context.http_status;
+    GeocodingRecordHeader* header = (GeocodingRecordHeader*)buffer;
+    header->magic                 = GEOCODING_RECORD_MAGIC;
+    header->version               = GEOCODING_RECORD_VERSION;
+    header->result_size           = sizeof(GeocodingResult);
+    header->count                 = (uint32_t)count;
 
-    return 0;
+    if (count > 0) {
+        memcpy(buffer + sizeof(GeocodingRecordHeader), response->results,
+               count * sizeof(GeocodingResult));
+    }
+
+    if (file_cache_save(g_geo_cache, cache_key, buffer, size) ==
+        FILE_CACHE_OK) {
+        LOGGER_DEBUG("[GEOCODING] Saved to cache");
+    } else {
+        LOGGER_ERROR("[GEOCODING] Failed to save cache");
+    }
+    free(buffer);
 }
 
 /* Helper function: simple URL encoding */
@@ -636,6 +779,11 @@ static int url_encode_char(const char* src, int src_len, char* dst,
     return dst_pos;
 }
 
+static const char* api_base_url(void) {
+    const char* url = getenv(GEOCODING_URL_ENV);
+    return url && url[0] ? url : GEOCODING_API_URL;
+}
+
 /**
  * Build URL for API request
  */
@@ -653,7 +801,7 @@ static char* build_api_url(const char* city_name, const char* country,
 
     int written =
         snprintf(url, 2048, "%s?name=%s&count=%d&language=%s&format=json",
-                 GEOCODING_API_URL, encoded_city, max_results, language);
+                 api_base_url(), encoded_city, max_results, language);
 
     if (country) {
         /* Encode country if present */
@@ -676,7 +824,7 @@ static int parse_geocoding_json(const char*         json_str,
     json_t*      root = json_loadb(json_str, strlen(json_str), 0, &error);
 
     if (!root) {
-        fprintf(stderr, "[GEOCODING] JSON parse error: %s\n", error.text);
+        LOGGER_ERROR("[GEOCODING] JSON parse error: %s", error.text);
         return -1;
     }
 
@@ -691,7 +839,7 @@ static int parse_geocoding_json(const char*         json_str,
     }
 
     if (!json_is_array(results_array)) {
-        fprintf(stderr, "[GEOCODING] Invalid results format\n");
+        LOGGER_ERROR("[GEOCODING] Invalid results format");
         json_decref(root);
         return -2;
     }
@@ -783,39 +931,122 @@ static int parse_geocoding_json(const char*         json_str,
     return 0;
 }
 
+/* ============= HTTP Client Integration ============= */
+
+static void geocoding_fetch_callback(const char* event, const char* response,
+                                     void* context) {
+    GeocodingRequestContext* ctx = (GeocodingRequestContext*)context;
+    if (!ctx) {
+        return;
+    }
+
+    if (strcmp(event, "RESPONSE") == 0 && response) {
+        GeocodingResponse* parsed = NULL;
+        if (parse_geocoding_json(response, &parsed) != 0 || !parsed) {
+            single_flight_complete(g_geo_flights, ctx->flight_key, -3, NULL);
+            free(ctx);
+            return;
+        }
+
+        LOGGER_DEBUG("[GEOCODING] Found %d result(s)", parsed->count);
+
+        if (ctx->save_to_cache) {
+            save_to_cache(ctx->cache_key, parsed);
+        }
+
+        size_t notified =
+            single_flight_complete(g_geo_flights, ctx->flight_key, 0, parsed);
+        if (notified > 1) {
+            LOGGER_DEBUG("[GEOCODING] Shared fetch result with %zu requests",
+                         notified);
+        }
+        geocoding_api_free_response(parsed);
+    } else if (strcmp(event, "ERROR") == 0 || strcmp(event, "TIMEOUT") == 0) {
+        LOGGER_ERROR("[GEOCODING] API fetch failed: %s", event);
+        single_flight_complete(g_geo_flights, ctx->flight_key, -2, NULL);
+    } else {
+        return; /* Intermediate event, request still in flight */
+    }
+
+    free(ctx);
+}
+
+static void deliver_geocoding(SingleFlightCallback callback, void* context,
+                              int result, const void* value) {
+    GeocodingOnResponse on_response = (GeocodingOnResponse)callback;
+    on_response(result, (GeocodingResponse*)value, context);
+}
+
 /**
- * Fetch data from API
+ * Start an asynchronous fetch from the API. save_key, when non-NULL, is the
+ * cache key the parsed response is written to before the callback runs.
+ *
+ * Identical requests share one upstream fetch: the flight key covers the
+ * request URL and whether the result is saved, so a read-only search never
+ * suppresses a cache write.
  */
-static int fetch_from_api(const char* city_name, const char* country,
-                          GeocodingResponse** response) {
+static int fetch_from_api_async(const char* city_name, const char* country,
+                                const char*         save_key,
+                                GeocodingOnResponse callback, void* context) {
     /* Build URL */
     char* url = build_api_url(city_name, country, g_config.max_results,
                               g_config.language);
     if (!url) {
+        callback(-1, NULL, context);
         return -1;
     }
 
-    printf("[GEOCODING] Fetching: %s\n", url);
+    char key_input[2048 + 8];
+    snprintf(key_input, sizeof(key_input), "%s|%s", save_key ? "save" : "get",
+             url);
 
-    char* response_data = NULL;
-    int   http_status   = 0;
+    char flight_key[FILE_CACHE_KEY_LENGTH];
+    if (file_cache_generate_key(g_geo_cache, key_input, flight_key,
+                                sizeof(flight_key)) != FILE_CACHE_OK) {
+        free(url);
+        callback(-2, NULL, context);
+        return -2;
+    }
 
-    int result = fetch_url_sync(url, &response_data, &http_status);
-    free(url);
+    int role = single_flight_join(g_geo_flights, flight_key,
+                                  (SingleFlightCallback)callback, context);
+    if (role == SINGLE_FLIGHT_ERROR) {
+        free(url);
+        callback(-1, NULL, context);
+        return -1;
+    }
 
-    if (result != 0 || !response_data) {
-        return -2;
+    if (role == SINGLE_FLIGHT_WAITER) {
+        LOGGER_DEBUG("[GEOCODING] Joined in-flight fetch (%zu waiting)",
+                     single_flight_waiters(g_geo_flights, flight_key));
+        free(url);
+        return 0;
+    }
+
+    /* Leader: every outcome from here on completes the flight */
+    GeocodingRequestContext* ctx = calloc(1, sizeof(GeocodingRequestContext));
+    if (!ctx) {
+        free(url);
+        single_flight_complete(g_geo_flights, flight_key, -1, NULL);
+        return -1;
     }
 
-    /* Parse JSON */
-    int parse_result = parse_geocoding_json(response_data, response);
+    strcpy(ctx->flight_key, flight_key);
+    if (save_key) {
+        ctx->save_to_cache = true;
+        strncpy(ctx->cache_key, save_key, sizeof(ctx->cache_key) - 1);
+    }
 
-    free(response_data);
+    LOGGER_DEBUG("[GEOCODING] Fetching: %s", url);
 
-    if (parse_result != 0) {
-        return -3;
+    int result = http_pool_get(url, NULL, 30000, geocoding_fetch_callback, ctx);
+    free(url);
+
+    if (result < 0) {
+        single_flight_complete(g_geo_flights, flight_key, -2, NULL);
+        free(ctx);
+        return -2;
     }
 
-    printf("[GEOCODING] Found %d result(s)\n", (*response)->count);
     return 0;
 }
@@ -16,6 +16,9 @@
 /* Maximum number of search results */
 #define GEOCODING_MAX_RESULTS 10
 
+/* Overrides the search endpoint URL (e.g. a mock upstream for benchmarks) */
+#define GEOCODING_URL_ENV "JWS_GEOCODING_URL"
+
 /* Structure with city information */
 typedef struct {
     float latitude;
@@ -38,11 +41,12 @@ typedef struct {
 
 /* Configuration for the geocoding module */
 typedef struct {
-    const char* cache_dir;   /* Directory for cache files */
-    int         cache_ttl;   /* Cache TTL in seconds (default: 7 days) */
-    bool        use_cache;   /* Use cache */
-    int         max_results; /* Maximum number of results */
-    const char* language;    /* Result language (uk, en, ru, etc.) */
+    const char* cache_dir;          /* Directory for cache files */
+    int         cache_ttl;          /* Cache TTL in seconds (default: 7 days) */
+    bool        use_cache;          /* Use cache */
+    int         max_results;        /* Maximum number of results */
+    const char* language;           /* Result language (uk, en, ru, etc.) */
+    size_t      memory_cache_bytes; /* In-memory tier budget (0 = off) */
 } GeocodingConfig;
 
 /**
@@ -54,34 +58,53 @@ typedef struct {
 int geocoding_api_init(GeocodingConfig* config);
 
 /**
- * Search for a city by name
+ * Callback invoked when an asynchronous search completes
+ *
+ * @param result 0 on success, < 0 on error (response is NULL then)
+ * @param response Search results. Owned by the geocoding module and only
+ *                 valid for the duration of the callback; copy what you need.
+ * @param context User context passed to the search function
+ */
+typedef void (*GeocodingOnResponse)(int result, GeocodingResponse* response,
+                                    void* context);
+
+/**
+ * Search for a city by name without blocking the event loop
+ *
+ * Cache hits and early failures invoke the callback before returning.
+ * Cache misses invoke it from the http_client response callback, after the
+ * results have been written to the cache.
  *
  * @param city_name City name to search for (required)
  * @param country Country code to filter results (optional, may be NULL)
- * @param response Pointer to the search result (caller must free)
- * @return 0 on success, < 0 on error
+ * @param callback Completion callback (required)
+ * @param context User context passed to the callback
+ * @return 0 if the search was started or answered, < 0 on error
  *
  * Usage examples:
- *   geocoding_api_search("Kyiv", "UA", &response);
- *   geocoding_api_search("Stockholm", NULL, &response);
- *   geocoding_api_search("London", "GB", &response);
+ *   geocoding_api_search_async("Kyiv", "UA", on_done, ctx);
+ *   geocoding_api_search_async("Stockholm", NULL, on_done, ctx);
+ *   geocoding_api_search_async("London", "GB", on_done, ctx);
  */
-int geocoding_api_search(const char* city_name, const char* country,
-                         GeocodingResponse** response);
+int geocoding_api_search_async(const char* city_name, const char* country,
+                               GeocodingOnResponse callback, void* context);
 
 /*
  * Search without writing to cache. Useful for endpoints that should not
  * create or update the shared city cache (e.g. autocomplete /cities).
  */
-int geocoding_api_search_no_cache(const char* city_name, const char* country,
-                                  GeocodingResponse** response);
+int geocoding_api_search_no_cache_async(const char*         city_name,
+                                        const char*         country,
+                                        GeocodingOnResponse callback,
+                                        void*               context);
 
 /* Try to load results from cache first (read-only). If cache is missing or
- * expired, fetch from API but do NOT save results to cache. Returns 0 on
- * success and fills `response` (caller must free). */
-int geocoding_api_search_readonly_cache(const char*         city_name,
-                                        const char*         country,
-                                        GeocodingResponse** response);
+ * expired, fetch from API but do NOT save results to cache. The callback
+ * receives the results (see GeocodingOnResponse for ownership). */
+int geocoding_api_search_readonly_cache_async(const char*         city_name,
+                                              const char*         country,
+                                              GeocodingOnResponse callback,
+                                              void*               context);
 
 /**
  * Smart search with 3-tier fallback strategy
@@ -92,13 +115,30 @@ int geocoding_api_search_readonly_cache(const char*         city_name,
  * 3. Open-Meteo API (slow, uses quota)
  *
  * @param query Search query (min 2 characters)
- * @param response Pointer to search result (caller must free)
- * @return 0 on success, < 0 on error
+ * @param callback Completion callback (required)
+ * @param context User context passed to the callback
+ * @return 0 if the search was started or answered, < 0 on error
  *
  * This function minimizes API calls for autocomplete by checking
- * local databases first.
+ * local databases first. Tiers 1 and 2 complete synchronously.
+ */
+int geocoding_api_search_smart_async(const char*         query,
+                                     GeocodingOnResponse callback,
+                                     void*               context);
+
+/**
+ * Resolve a city name against the local city index only
+ *
+ * @param city_name City name; matched exactly after normalization
+ * @param country Country code or name (optional)
+ * @param out Receives the best-ranked match
+ * @return 0 if found, -1 if there is no index or no exact match
+ *
+ * Never blocks, so many names can be resolved in one pass before any
+ * of them has to go to the API.
  */
-int geocoding_api_search_smart(const char* query, GeocodingResponse** response);
+int geocoding_api_resolve_local(const char* city_name, const char* country,
+                                GeocodingResult* out);
 
 /**
  * Search for a city by name with an additional region filter
@@ -106,15 +146,18 @@ int geocoding_api_search_smart(const char* query, GeocodingResponse** response);
  * @param city_name City name
  * @param region Region / province (optional)
  * @param country Country code (optional)
- * @param response Pointer to the search result
- * @return 0 on success, < 0 on error
+ * @param callback Completion callback (required)
+ * @param context User context passed to the callback
+ * @return 0 if the search was started or answered, < 0 on error
  *
  * Example:
- *   geocoding_api_search_detailed("Lviv", "Lviv Oblast", "UA", &response);
+ *   geocoding_api_search_detailed_async("Lviv", "Lviv Oblast", "UA", on_done,
+ *                                       ctx);
  */
-int geocoding_api_search_detailed(const char* city_name, const char* region,
-                                  const char*         country,
-                                  GeocodingResponse** response);
+int geocoding_api_search_detailed_async(const char* city_name,
+                                        const char* region, const char* country,
+                                        GeocodingOnResponse callback,
+                                        void*               context);
 
 /**
  * Get the best result (the one with the largest population)
@@ -0,0 +1,118 @@
+/**
+ * http_gzip.c - gzip content coding for HTTP response bodies
+ */
+
+#include "http_gzip.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+/* windowBits 15 plus 16 selects the gzip wrapper */
+#define GZIP_WINDOW_BITS (15 + 16)
+#define GZIP_MEMORY_LEVEL 8
+
+/* ============= Internal Helpers ============= */
+
+/**
+ * Parse the q parameter of one Accept-Encoding element; 1.0 if absent
+ */
+static double parse_quality(const char* params, const char* end) {
+    while (params < end) {
+        while (params < end && (*params == ';' || *params == ' ')) {
+            params++;
+        }
+        if (end - params >= 2 && (params[0] == 'q' || params[0] == 'Q') &&
+            params[1] == '=') {
+            char   value[8] = {0};
+            size_t length   = (size_t)(end - params - 2);
+            memcpy(value, params + 2,
+                   length < sizeof(value) - 1 ? length : sizeof(value) - 1);
+            return atof(value);
+        }
+        while (params < end && *params != ';') {
+            params++;
+        }
+    }
+    return 1.0;
+}
+
+/* ============= Public API ============= */
+
+int http_gzip_compress(const char* data, size_t length, char** out_data,
+                       size_t* out_length) {
+    if (!data || !out_data || !out_length || length < HTTP_GZIP_MIN_LENGTH) {
+        return -1;
+    }
+
+    z_stream stream = {0};
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS,
+                     GZIP_MEMORY_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+
+    uLong bound  = deflateBound(&stream, (uLong)length);
+    char* buffer = malloc(bound);
+    if (!buffer) {
+        deflateEnd(&stream);
+        return -1;
+    }
+
+    stream.next_in   = (Bytef*)data;
+    stream.avail_in  = (uInt)length;
+    stream.next_out  = (Bytef*)buffer;
+    stream.avail_out = (uInt)bound;
+
+    int    result     = deflate(&stream, Z_FINISH);
+    size_t compressed = stream.total_out;
+    deflateEnd(&stream);
+
+    /* Incompressible bodies are cheaper to send as they are */
+    if (result != Z_STREAM_END || compressed >= length) {
+        free(buffer);
+        return -1;
+    }
+
+    *out_data   = buffer;
+    *out_length = compressed;
+    return 0;
+}
+
+bool http_gzip_accepted(const char* value, size_t length) {
+    if (!value) {
+        return false;
+    }
+
+    const char* end      = value + length;
+    bool        wildcard = false;
+
+    while (value < end) {
+        while (value < end && (*value == ' ' || *value == ',')) {
+            value++;
+        }
+
+        const char* element = value;
+        while (value < end && *value != ',') {
+            value++;
+        }
+
+        const char* name_end = element;
+        while (name_end < value && *name_end != ';' && *name_end != ' ') {
+            name_end++;
+        }
+
+        size_t name_length = (size_t)(name_end - element);
+        double quality     = parse_quality(name_end, value);
+
+        if ((name_length == 4 && strncasecmp(element, "gzip", 4) == 0) ||
+            (name_length == 6 && strncasecmp(element, "x-gzip", 6) == 0)) {
+            return quality > 0; /* An explicit entry beats the wildcard */
+        }
+        if (name_length == 1 && *element == '*') {
+            wildcard = quality > 0;
+        }
+    }
+
+    return wildcard;
+}
@@ -0,0 +1,50 @@
+/**
+ * http_gzip.h - gzip content coding for HTTP response bodies
+ *
+ * One-shot compression of a complete body into the gzip format (RFC 1952)
+ * with zlib, plus the Accept-Encoding check that decides whether a client
+ * may receive it. Bodies below HTTP_GZIP_MIN_LENGTH are not worth the
+ * header overhead and are always sent as they are.
+ *
+ * Usage:
+ *   char*  gz     = NULL;
+ *   size_t gz_len = 0;
+ *   if (http_gzip_compress(body, length, &gz, &gz_len) == 0) {
+ *       ... send gz with "Content-Encoding: gzip" ...
+ *       free(gz);
+ *   }
+ */
+
+#ifndef HTTP_GZIP_H
+#define HTTP_GZIP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Smallest body that gets compressed */
+#define HTTP_GZIP_MIN_LENGTH 256
+
+/**
+ * Compress a body into a new gzip buffer.
+ *
+ * @param data        Input bytes
+ * @param length      Input length
+ * @param out_data    Output buffer (caller must free)
+ * @param out_length  Output length
+ * @return            0 on success, -1 if too small, not smaller than the
+ *                    input, or on error
+ */
+int http_gzip_compress(const char* data, size_t length, char** out_data,
+                       size_t* out_length);
+
+/**
+ * Check whether an Accept-Encoding value allows gzip (q > 0 for "gzip",
+ * "x-gzip" or "*").
+ *
+ * @param value   Header value (not NUL-terminated)
+ * @param length  Value length
+ * @return        true if a gzip body may be sent
+ */
+bool http_gzip_accepted(const char* value, size_t length);
+
+#endif /* HTTP_GZIP_H */
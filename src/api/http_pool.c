@@ -0,0 +1,1145 @@
+/**
+ * http_pool.c - Keep-alive connection pool for outbound HTTP requests
+ */
+
+#define _GNU_SOURCE /* memmem, getaddrinfo_a */
+
+#include "http_pool.h"
+
+#include "event_loop.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <smw.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utils.h>
+
+#define POOL_USER_AGENT "just-weather/1.0"
+#define POOL_MAX_HOST_NAME 256
+#define POOL_MAX_HEADER 16384 /* Largest accepted response head */
+#define POOL_READ_CHUNK 16384
+
+/* System trust store, tried in order */
+#define POOL_CA_FILE "/etc/ssl/certs/ca-certificates.crt"
+#define POOL_CA_PATH "/etc/ssl/certs"
+
+/* ============= Internal Structures ============= */
+
+typedef enum {
+    CONN_CONNECTING, /* Non-blocking connect() in progress */
+    CONN_HANDSHAKE,  /* TLS handshake in progress */
+    CONN_SENDING,    /* Writing the request head */
+    CONN_RECEIVING,  /* Reading the response */
+    CONN_IDLE        /* Kept alive, no request */
+} ConnState;
+
+/* One queued or running request */
+typedef struct PoolHost PoolHost;
+
+typedef struct PoolRequest {
+    struct PoolRequest* next;
+    PoolHost*           host;
+    char*               head; /* Serialized request */
+    size_t              head_length;
+    HttpClientCallback  callback;
+    void*               context;
+    uint64_t            started_us;
+    uint64_t            deadline_ms;
+    bool                retried; /* Already resent after a stale socket */
+} PoolRequest;
+
+/* One upstream socket */
+typedef struct PoolConn {
+    struct PoolConn*    next;
+    PoolHost*           host;
+    int                 fd;
+    ConnState           state;
+    bool                tls;
+    mbedtls_ssl_context ssl;
+
+    PoolRequest* request;
+    size_t       sent;
+    bool         reused; /* request was sent on a kept-alive socket */
+    uint64_t     idle_since_ms;
+
+    /* Response being read; buffer is always NUL-terminated */
+    char*  buffer;
+    size_t length;
+    size_t capacity;
+    size_t header_length; /* 0 until the head is complete */
+    int    status;
+    long   content_length; /* -1 if absent */
+    bool   chunked;
+    bool   keep_alive;
+} PoolConn;
+
+/* Connections and waiting requests for one scheme, host and port */
+struct PoolHost {
+    char name[POOL_MAX_HOST_NAME];
+    char port[8];
+    bool tls;
+
+    struct sockaddr_storage addr;
+    socklen_t               addr_length;
+    uint64_t                resolved_ms;
+
+    /* getaddrinfo_a() lookup, running in a resolver thread if resolving */
+    struct gaicb    resolve;
+    struct addrinfo resolve_hints;
+    bool            resolving;
+
+    mbedtls_ssl_session session; /* Last negotiated, offered on connect */
+    bool                has_session;
+
+    PoolConn*    conns;
+    size_t       conn_count;
+    PoolRequest* queue_head;
+    PoolRequest* queue_tail;
+
+    /* Completed requests, by callback event */
+    MetricsHistogram latency;
+    MetricsCounter   responses;
+    MetricsCounter   errors;
+    MetricsCounter   timeouts;
+};
+
+/* ============= Global State ============= */
+
+static PoolHost      g_hosts[HTTP_POOL_MAX_HOSTS];
+static size_t        g_host_count = 0;
+static SmwTask*      g_task       = NULL;
+static HttpPoolStats g_stats;
+
+/* Shared TLS client configuration */
+static bool                     g_tls_ready = false;
+static mbedtls_entropy_context  g_entropy;
+static mbedtls_ctr_drbg_context g_drbg;
+static mbedtls_x509_crt         g_ca;
+static mbedtls_ssl_config       g_tls_config;
+
+static void host_dispatch(PoolHost* host);
+
+/* ============= TLS ============= */
+
+static int tls_init(void) {
+    if (g_tls_ready) {
+        return 0;
+    }
+
+    mbedtls_entropy_init(&g_entropy);
+    mbedtls_ctr_drbg_init(&g_drbg);
+    mbedtls_x509_crt_init(&g_ca);
+    mbedtls_ssl_config_init(&g_tls_config);
+
+    const char* personalization = "http_pool";
+    if (mbedtls_ctr_drbg_seed(&g_drbg, mbedtls_entropy_func, &g_entropy,
+                              (const unsigned char*)personalization,
+                              strlen(personalization)) != 0 ||
+        (mbedtls_x509_crt_parse_file(&g_ca, POOL_CA_FILE) < 0 &&
+         mbedtls_x509_crt_parse_path(&g_ca, POOL_CA_PATH) < 0) ||
+        mbedtls_ssl_config_defaults(&g_tls_config, MBEDTLS_SSL_IS_CLIENT,
+                                    MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+        LOGGER_ERROR("[POOL] TLS setup failed (no trust store?)");
+        mbedtls_ssl_config_free(&g_tls_config);
+        mbedtls_x509_crt_free(&g_ca);
+        mbedtls_ctr_drbg_free(&g_drbg);
+        mbedtls_entropy_free(&g_entropy);
+        return -1;
+    }
+
+    mbedtls_ssl_conf_authmode(&g_tls_config, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&g_tls_config, &g_ca, NULL);
+    mbedtls_ssl_conf_rng(&g_tls_config, mbedtls_ctr_drbg_random, &g_drbg);
+
+    g_tls_ready = true;
+    return 0;
+}
+
+static int tls_send(void* context, const unsigned char* data, size_t length) {
+    ssize_t n = send(*(int*)context, data, length, MSG_NOSIGNAL);
+    if (n >= 0) {
+        return (int)n;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    return MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+static int tls_recv(void* context, unsigned char* data, size_t length) {
+    ssize_t n = recv(*(int*)context, data, length, 0);
+    if (n >= 0) {
+        return (int)n;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    return MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+/**
+ * Keep the session of a finished handshake for the next connection
+ */
+static void tls_save_session(PoolConn* conn) {
+    PoolHost* host = conn->host;
+    if (host->has_session) {
+        mbedtls_ssl_session_free(&host->session);
+    }
+
+    mbedtls_ssl_session_init(&host->session);
+    host->has_session =
+        mbedtls_ssl_get_session(&conn->ssl, &host->session) == 0;
+    if (!host->has_session) {
+        mbedtls_ssl_session_free(&host->session);
+    }
+}
+
+/* ============= Socket I/O ============= */
+
+/* I/O results besides a byte count */
+#define IO_AGAIN 0
+#define IO_ERROR -1
+#define IO_EOF -2
+
+static int conn_write(PoolConn* conn, const char* data, size_t length) {
+    if (conn->tls) {
+        int n = mbedtls_ssl_write(&conn->ssl, (const unsigned char*)data,
+                                  length);
+        if (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            return IO_AGAIN;
+        }
+        return n > 0 ? n : IO_ERROR;
+    }
+
+    ssize_t n = send(conn->fd, data, length, MSG_NOSIGNAL);
+    if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? IO_AGAIN : IO_ERROR;
+    }
+    return (int)n;
+}
+
+static int conn_read(PoolConn* conn, char* data, size_t length) {
+    if (conn->tls) {
+        for (;;) {
+            int n = mbedtls_ssl_read(&conn->ssl, (unsigned char*)data, length);
+            if (n > 0) {
+                return n;
+            }
+            if (n == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
+                tls_save_session(conn); /* TLS 1.3 tickets come late */
+                continue;
+            }
+            if (n == MBEDTLS_ERR_SSL_WANT_READ ||
+                n == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                return IO_AGAIN;
+            }
+            return n == 0 || n == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY
+                       ? IO_EOF
+                       : IO_ERROR;
+        }
+    }
+
+    ssize_t n = recv(conn->fd, data, length, 0);
+    if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? IO_AGAIN : IO_ERROR;
+    }
+    return n == 0 ? IO_EOF : (int)n;
+}
+
+/* ============= Hosts ============= */
+
+static PoolHost* host_find(const char* name, const char* port, bool tls) {
+    for (size_t i = 0; i < g_host_count; i++) {
+        PoolHost* host = &g_hosts[i];
+        if (host->tls == tls && strcmp(host->name, name) == 0 &&
+            strcmp(host->port, port) == 0) {
+            return host;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find or add a host slot, reusing one without connections when full
+ */
+static PoolHost* host_get(const char* name, const char* port, bool tls) {
+    PoolHost* host = host_find(name, port, tls);
+    if (host) {
+        return host;
+    }
+
+    if (g_host_count < HTTP_POOL_MAX_HOSTS) {
+        host = &g_hosts[g_host_count++];
+    } else {
+        for (size_t i = 0; i < g_host_count && !host; i++) {
+            if (!g_hosts[i].conns && !g_hosts[i].queue_head &&
+                !g_hosts[i].resolving) {
+                host = &g_hosts[i];
+            }
+        }
+        if (!host) {
+            return NULL;
+        }
+        if (host->has_session) {
+            mbedtls_ssl_session_free(&host->session);
+        }
+    }
+
+    memset(host, 0, sizeof(PoolHost));
+    snprintf(host->name, sizeof(host->name), "%s", name);
+    snprintf(host->port, sizeof(host->port), "%s", port);
+    host->tls = tls;
+    return host;
+}
+
+/**
+ * Resolver thread: a lookup finished, let the scheduler task pick it up
+ */
+static void host_on_resolved(union sigval value) {
+    (void)value;
+    event_loop_wake();
+}
+
+/**
+ * Start resolving the host if it never was or the address is older than
+ * the TTL. The lookup runs in a resolver thread, so a slow or dead DNS
+ * server never blocks the event loop; requests keep using the previous
+ * address meanwhile, and wait in the queue if there is none.
+ *
+ * Returns -1 only if a host without an address cannot start a lookup.
+ */
+static int host_resolve(PoolHost* host, uint64_t now) {
+    if (host->resolving ||
+        (host->addr_length > 0 &&
+         now - host->resolved_ms < HTTP_POOL_DNS_TTL_MS)) {
+        return 0;
+    }
+
+    memset(&host->resolve, 0, sizeof(host->resolve));
+    memset(&host->resolve_hints, 0, sizeof(host->resolve_hints));
+    host->resolve_hints.ai_family   = AF_UNSPEC;
+    host->resolve_hints.ai_socktype = SOCK_STREAM;
+    host->resolve.ar_name           = host->name;
+    host->resolve.ar_service        = host->port;
+    host->resolve.ar_request        = &host->resolve_hints;
+
+    struct sigevent notify;
+    memset(&notify, 0, sizeof(notify));
+    notify.sigev_notify          = SIGEV_THREAD;
+    notify.sigev_notify_function = host_on_resolved;
+
+    struct gaicb* list[1] = {&host->resolve};
+    if (getaddrinfo_a(GAI_NOWAIT, list, 1, &notify) != 0) {
+        LOGGER_ERROR("[POOL] Cannot resolve %s", host->name);
+        return host->addr_length > 0 ? 0 : -1;
+    }
+
+    host->resolving = true;
+    return 0;
+}
+
+static void queue_push(PoolHost* host, PoolRequest* request, bool front) {
+    if (front) {
+        request->next    = host->queue_head;
+        host->queue_head = request;
+        if (!host->queue_tail) {
+            host->queue_tail = request;
+        }
+    } else {
+        request->next = NULL;
+        if (host->queue_tail) {
+            host->queue_tail->next = request;
+        } else {
+            host->queue_head = request;
+        }
+        host->queue_tail = request;
+    }
+    g_stats.queued++;
+}
+
+static PoolRequest* queue_pop(PoolHost* host) {
+    PoolRequest* request = host->queue_head;
+    if (request) {
+        host->queue_head = request->next;
+        if (!host->queue_head) {
+            host->queue_tail = NULL;
+        }
+        request->next = NULL;
+        g_stats.queued--;
+    }
+    return request;
+}
+
+/* ============= Requests ============= */
+
+static void request_complete(PoolRequest* request, const char* event,
+                             const char* response) {
+    PoolHost* host = request->host;
+    metrics_histogram_observe(&host->latency,
+                              metrics_now_us() - request->started_us);
+    if (strcmp(event, "RESPONSE") == 0) {
+        metrics_counter_add(&host->responses, 1);
+    } else if (strcmp(event, "TIMEOUT") == 0) {
+        metrics_counter_add(&host->timeouts, 1);
+    } else {
+        metrics_counter_add(&host->errors, 1);
+    }
+
+    request->callback(event, response, request->context);
+    free(request->head);
+    free(request);
+}
+
+/**
+ * Take the result of a finished lookup. A failed refresh keeps the
+ * previous address (the next request tries again); without one, the
+ * requests waiting for it fail.
+ */
+static void host_check_resolved(PoolHost* host, uint64_t now) {
+    if (!host->resolving) {
+        return;
+    }
+
+    int result = gai_error(&host->resolve);
+    if (result == EAI_INPROGRESS) {
+        return;
+    }
+    host->resolving = false;
+
+    struct addrinfo* found = host->resolve.ar_result;
+    if (result == 0 && found) {
+        memcpy(&host->addr, found->ai_addr, found->ai_addrlen);
+        host->addr_length = found->ai_addrlen;
+        host->resolved_ms = now;
+    } else {
+        LOGGER_ERROR("[POOL] Cannot resolve %s", host->name);
+    }
+    if (found) {
+        freeaddrinfo(found);
+        host->resolve.ar_result = NULL;
+    }
+
+    /* A callback may ask again, which starts a new lookup */
+    PoolRequest* request;
+    while (host->addr_length == 0 && !host->resolving &&
+           (request = queue_pop(host)) != NULL) {
+        request_complete(request, "ERROR", "cannot resolve host");
+    }
+}
+
+/* ============= Connections ============= */
+
+static void conn_reset_response(PoolConn* conn) {
+    conn->buffer         = NULL;
+    conn->length         = 0;
+    conn->capacity       = 0;
+    conn->header_length  = 0;
+    conn->status         = 0;
+    conn->content_length = -1;
+    conn->chunked        = false;
+    conn->keep_alive     = true;
+}
+
+static void conn_close(PoolConn* conn) {
+    PoolHost*  host = conn->host;
+    PoolConn** link = &host->conns;
+    while (*link && *link != conn) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = conn->next;
+    }
+
+    if (conn->tls) {
+        if (conn->state == CONN_IDLE) {
+            mbedtls_ssl_close_notify(&conn->ssl);
+        }
+        mbedtls_ssl_free(&conn->ssl);
+    }
+    close(conn->fd);
+
+    free(conn->buffer);
+    free(conn);
+    host->conn_count--;
+    g_stats.open--;
+}
+
+/**
+ * Open a non-blocking socket to the host; NULL if that fails at once
+ */
+static PoolConn* conn_open(PoolHost* host) {
+    int fd = socket(host->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (connect(fd, (struct sockaddr*)&host->addr, host->addr_length) < 0 &&
+        errno != EINPROGRESS) {
+        close(fd);
+        return NULL;
+    }
+
+    PoolConn* conn = calloc(1, sizeof(PoolConn));
+    if (!conn) {
+        close(fd);
+        return NULL;
+    }
+
+    conn->host  = host;
+    conn->fd    = fd;
+    conn->state = CONN_CONNECTING;
+    conn_reset_response(conn);
+    event_loop_watch(fd, EVENT_LOOP_READ | EVENT_LOOP_WRITE);
+
+    conn->next  = host->conns;
+    host->conns = conn;
+    host->conn_count++;
+    g_stats.connections++;
+    g_stats.open++;
+    return conn;
+}
+
+/**
+ * Drop a connection that failed. A request that went out on a reused
+ * socket and got no answer at all is resent once on a fresh connection,
+ * since the server may have closed the idle socket just before.
+ */
+static void conn_fail(PoolConn* conn, const char* event, const char* reason) {
+    PoolHost*    host    = conn->host;
+    PoolRequest* request = conn->request;
+    bool retry = request && conn->reused && !request->retried &&
+                 conn->length == 0 && strcmp(event, "ERROR") == 0;
+
+    conn->request = NULL;
+    conn_close(conn);
+
+    if (retry) {
+        request->retried = true;
+        queue_push(host, request, true);
+        host_dispatch(host);
+    } else if (request) {
+        LOGGER_ERROR("[POOL] %s:%s %s: %s", host->name, host->port, event,
+                     reason);
+        request_complete(request, event, reason);
+    }
+}
+
+static int conn_start_tls(PoolConn* conn) {
+    PoolHost* host = conn->host;
+
+    mbedtls_ssl_init(&conn->ssl);
+    conn->tls = true;
+    if (mbedtls_ssl_setup(&conn->ssl, &g_tls_config) != 0 ||
+        mbedtls_ssl_set_hostname(&conn->ssl, host->name) != 0) {
+        return -1;
+    }
+
+    if (host->has_session &&
+        mbedtls_ssl_set_session(&conn->ssl, &host->session) == 0) {
+        g_stats.tls_resumed++;
+    }
+
+    mbedtls_ssl_set_bio(&conn->ssl, &conn->fd, tls_send, tls_recv, NULL);
+    conn->state = CONN_HANDSHAKE;
+    return 0;
+}
+
+/**
+ * Parse the status line and the headers that frame the body
+ */
+static int parse_head(PoolConn* conn) {
+    const char* end = memmem(conn->buffer, conn->length, "\r\n\r\n", 4);
+    if (!end) {
+        return conn->length > POOL_MAX_HEADER ? -1 : 0;
+    }
+
+    int minor = 0;
+    if (sscanf(conn->buffer, "HTTP/1.%d %d", &minor, &conn->status) != 2) {
+        return -1;
+    }
+    conn->keep_alive    = minor >= 1;
+    conn->header_length = (size_t)(end - conn->buffer) + 4;
+
+    const char* line = strstr(conn->buffer, "\r\n") + 2;
+    while (line < end) {
+        const char* next = memmem(line, (size_t)(end + 2 - line), "\r\n", 2);
+        if (!next) {
+            break;
+        }
+
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            conn->content_length = strtol(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            const char* chunked = strcasestr(line + 18, "chunked");
+            conn->chunked       = chunked && chunked < next;
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char* close_token = strcasestr(line + 11, "close");
+            const char* keep_token  = strcasestr(line + 11, "keep-alive");
+            if (close_token && close_token < next) {
+                conn->keep_alive = false;
+            } else if (keep_token && keep_token < next) {
+                conn->keep_alive = true;
+            }
+        }
+        line = next + 2;
+    }
+
+    if (conn->status == 204 || conn->status == 304) {
+        conn->content_length = 0;
+        conn->chunked        = false;
+    }
+    return 1;
+}
+
+/**
+ * Find the end of a chunked body: its length including the trailer when
+ * complete, 0 if more data is needed, -1 if malformed
+ */
+static long chunked_end(const char* body, size_t length) {
+    size_t pos = 0;
+    for (;;) {
+        const char* line = memmem(body + pos, length - pos, "\r\n", 2);
+        if (!line) {
+            return 0;
+        }
+
+        char*         digits_end;
+        unsigned long size = strtoul(body + pos, &digits_end, 16);
+        if (digits_end == body + pos) {
+            return -1;
+        }
+        pos = (size_t)(line - body) + 2;
+
+        if (size == 0) {
+            /* Trailer fields up to an empty line */
+            for (;;) {
+                line = memmem(body + pos, length - pos, "\r\n", 2);
+                if (!line) {
+                    return 0;
+                }
+                size_t line_length = (size_t)(line - (body + pos));
+                pos += line_length + 2;
+                if (line_length == 0) {
+                    return (long)pos;
+                }
+            }
+        }
+
+        if (size > HTTP_POOL_MAX_RESPONSE) {
+            return -1;
+        }
+        if (length - pos < size + 2) {
+            return 0;
+        }
+        pos += size + 2;
+    }
+}
+
+/**
+ * Strip the chunk framing of a complete body in place; returns its
+ * decoded length
+ */
+static size_t chunked_decode(char* body) {
+    size_t read = 0, write = 0;
+    for (;;) {
+        unsigned long size = strtoul(body + read, NULL, 16);
+        read = (size_t)(strstr(body + read, "\r\n") - body) + 2;
+        if (size == 0) {
+            return write;
+        }
+        memmove(body + write, body + read, size);
+        write += size;
+        read  += size + 2;
+    }
+}
+
+/**
+ * Hand the response to the caller and either park the connection for
+ * reuse or close it. The body changes owner before the callback, which
+ * may start new requests on this very connection.
+ */
+static void conn_finish(PoolConn* conn, size_t body_end, uint64_t now) {
+    PoolHost*    host    = conn->host;
+    PoolRequest* request = conn->request;
+    char*        buffer  = conn->buffer;
+    char*        body    = buffer + conn->header_length;
+    int          status  = conn->status;
+
+    size_t body_length = body_end - conn->header_length;
+    if (conn->chunked) {
+        body_length = chunked_decode(body);
+    }
+    body[body_length] = '\0';
+
+    bool reusable  = conn->keep_alive && body_end == conn->length;
+    conn->request  = NULL;
+    conn_reset_response(conn);
+
+    if (reusable) {
+        conn->state         = CONN_IDLE;
+        conn->idle_since_ms = now;
+    } else {
+        conn_close(conn);
+    }
+
+    if (status >= 200 && status < 300) {
+        request_complete(request, "RESPONSE", body);
+    } else {
+        char reason[32];
+        snprintf(reason, sizeof(reason), "HTTP status %d", status);
+        LOGGER_ERROR("[POOL] %s:%s answered %d", host->name, host->port,
+                     status);
+        request_complete(request, "ERROR", reason);
+    }
+    free(buffer);
+
+    host_dispatch(host);
+}
+
+/**
+ * Read what is available and finish the request once the body is complete
+ */
+static void conn_receive(PoolConn* conn, uint64_t now) {
+    for (;;) {
+        if (conn->capacity - conn->length < POOL_READ_CHUNK) {
+            size_t capacity = conn->capacity * 2 + POOL_READ_CHUNK;
+            char*  grown    = realloc(conn->buffer, capacity + 1);
+            if (!grown) {
+                conn_fail(conn, "ERROR", "out of memory");
+                return;
+            }
+            conn->buffer   = grown;
+            conn->capacity = capacity;
+        }
+
+        int n = conn_read(conn, conn->buffer + conn->length,
+                          conn->capacity - conn->length);
+        if (n == IO_AGAIN) {
+            return;
+        }
+        if (n == IO_ERROR) {
+            conn_fail(conn, "ERROR", "connection reset");
+            return;
+        }
+
+        bool eof = n == IO_EOF;
+        if (!eof) {
+            conn->length               += (size_t)n;
+            conn->buffer[conn->length]  = '\0';
+        }
+
+        if (conn->header_length == 0) {
+            int parsed = conn->length > 0 ? parse_head(conn) : 0;
+            if (parsed < 0) {
+                conn_fail(conn, "ERROR", "malformed response");
+                return;
+            }
+            if (parsed == 0) {
+                if (eof) {
+                    conn_fail(conn, "ERROR", "connection closed");
+                    return;
+                }
+                continue;
+            }
+        }
+
+        size_t received = conn->length - conn->header_length;
+        if (conn->chunked) {
+            long end = chunked_end(conn->buffer + conn->header_length,
+                                   received);
+            if (end < 0) {
+                conn_fail(conn, "ERROR", "malformed chunked body");
+                return;
+            }
+            if (end > 0) {
+                conn_finish(conn, conn->header_length + (size_t)end, now);
+                return;
+            }
+        } else if (conn->content_length >= 0) {
+            if (received >= (size_t)conn->content_length) {
+                conn_finish(conn,
+                            conn->header_length +
+                                (size_t)conn->content_length,
+                            now);
+                return;
+            }
+        } else if (eof) {
+            /* Body delimited by the end of the connection */
+            conn->keep_alive = false;
+            conn_finish(conn, conn->length, now);
+            return;
+        }
+
+        if (eof) {
+            conn_fail(conn, "ERROR", "truncated response");
+            return;
+        }
+        if (received > HTTP_POOL_MAX_RESPONSE) {
+            conn_fail(conn, "ERROR", "response too large");
+            return;
+        }
+    }
+}
+
+/**
+ * Advance one connection as far as its socket allows
+ */
+static void conn_step(PoolConn* conn, uint64_t now) {
+    if (conn->request && now >= conn->request->deadline_ms) {
+        conn_fail(conn, "TIMEOUT", "request timed out");
+        return;
+    }
+
+    if (conn->state == CONN_IDLE) {
+        /* Idle sockets must stay silent; data or EOF means the server is
+         * done with it */
+        char peek;
+        if (now - conn->idle_since_ms >= HTTP_POOL_IDLE_MS ||
+            recv(conn->fd, &peek, 1, MSG_PEEK | MSG_DONTWAIT) >= 0 ||
+            (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            conn_close(conn);
+        }
+        return;
+    }
+
+    if (conn->state == CONN_CONNECTING) {
+        struct pollfd pfd = {.fd = conn->fd, .events = POLLOUT};
+        if (poll(&pfd, 1, 0) <= 0) {
+            return;
+        }
+
+        int       error  = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 ||
+            error != 0) {
+            conn_fail(conn, "ERROR", "connect failed");
+            return;
+        }
+
+        if (!conn->host->tls) {
+            conn->state = CONN_SENDING;
+        } else if (conn_start_tls(conn) != 0) {
+            conn_fail(conn, "ERROR", "TLS setup failed");
+            return;
+        } else {
+            event_loop_watch(conn->fd, EVENT_LOOP_READ);
+        }
+    }
+
+    if (conn->state == CONN_HANDSHAKE) {
+        int result = mbedtls_ssl_handshake(&conn->ssl);
+        if (result == MBEDTLS_ERR_SSL_WANT_READ ||
+            result == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            return;
+        }
+        if (result != 0) {
+            conn_fail(conn, "ERROR", "TLS handshake failed");
+            return;
+        }
+        tls_save_session(conn);
+        conn->state = CONN_SENDING;
+    }
+
+    if (conn->state == CONN_SENDING) {
+        PoolRequest* request = conn->request;
+        while (conn->sent < request->head_length) {
+            int n = conn_write(conn, request->head + conn->sent,
+                               request->head_length - conn->sent);
+            if (n == IO_AGAIN) {
+                return;
+            }
+            if (n < 0) {
+                conn_fail(conn, "ERROR", "send failed");
+                return;
+            }
+            conn->sent += (size_t)n;
+        }
+        conn->state = CONN_RECEIVING;
+        event_loop_watch(conn->fd, EVENT_LOOP_READ);
+    }
+
+    if (conn->state == CONN_RECEIVING) {
+        conn_receive(conn, now);
+    }
+}
+
+/**
+ * Move queued requests onto idle or newly opened connections. They only
+ * advance from the scheduler task, so no callback runs from here except
+ * for a socket that cannot be created at all.
+ */
+static void host_dispatch(PoolHost* host) {
+    if (host->addr_length == 0) {
+        return; /* Still resolving */
+    }
+
+    while (host->queue_head) {
+        PoolConn* conn = host->conns;
+        while (conn && conn->state != CONN_IDLE) {
+            conn = conn->next;
+        }
+
+        bool reused = conn != NULL;
+        if (!conn) {
+            if (host->conn_count >= HTTP_POOL_MAX_PER_HOST) {
+                return;
+            }
+            conn = conn_open(host);
+            if (!conn) {
+                PoolRequest* request = queue_pop(host);
+                LOGGER_ERROR("[POOL] Cannot connect to %s:%s", host->name,
+                             host->port);
+                request_complete(request, "ERROR", "connect failed");
+                continue;
+            }
+        }
+
+        conn->request = queue_pop(host);
+        conn->sent    = 0;
+        conn->reused  = reused;
+        if (reused) {
+            conn->state = CONN_SENDING;
+            event_loop_watch(conn->fd, EVENT_LOOP_READ | EVENT_LOOP_WRITE);
+            g_stats.reused++;
+        }
+    }
+}
+
+/* ============= Scheduler Task ============= */
+
+static void pool_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+
+    for (size_t i = 0; i < g_host_count; i++) {
+        PoolHost* host = &g_hosts[i];
+        host_check_resolved(host, mon_time);
+
+        PoolConn* conn = host->conns;
+        while (conn) {
+            PoolConn* next = conn->next;
+            conn_step(conn, mon_time);
+            conn = next;
+        }
+
+        /* Requests that never got a connection */
+        PoolRequest** link = &host->queue_head;
+        while (*link) {
+            PoolRequest* request = *link;
+            if (mon_time < request->deadline_ms) {
+                link = &request->next;
+                continue;
+            }
+
+            *link = request->next;
+            if (host->queue_tail == request) {
+                host->queue_tail = NULL;
+                for (PoolRequest* r = host->queue_head; r; r = r->next) {
+                    host->queue_tail = r;
+                }
+            }
+            g_stats.queued--;
+            request_complete(request, "TIMEOUT", "no connection available");
+            link = &host->queue_head; /* Callback may have queued more */
+        }
+
+        host_dispatch(host);
+    }
+}
+
+/* ============= Public API ============= */
+
+int http_pool_get(const char* url, const char* headers, int timeout_ms,
+                  HttpClientCallback callback, void* context) {
+    if (!url || !callback) {
+        return -1;
+    }
+
+    bool tls;
+    if (strncmp(url, "https://", 8) == 0) {
+        tls = true;
+        url += 8;
+    } else if (strncmp(url, "http://", 7) == 0) {
+        tls = false;
+        url += 7;
+    } else {
+        return -1;
+    }
+
+    /* authority[:port] up to the path */
+    const char* path      = strchr(url, '/');
+    size_t      authority = path ? (size_t)(path - url) : strlen(url);
+    if (authority == 0 || authority >= POOL_MAX_HOST_NAME) {
+        return -1;
+    }
+
+    char name[POOL_MAX_HOST_NAME];
+    memcpy(name, url, authority);
+    name[authority] = '\0';
+
+    const char* port  = tls ? "443" : "80";
+    char*       colon = strchr(name, ':');
+    if (colon) {
+        *colon = '\0';
+        port   = colon + 1;
+        if (*port == '\0' || strlen(port) >= sizeof(((PoolHost*)0)->port)) {
+            return -1;
+        }
+    }
+
+    if (tls && tls_init() != 0) {
+        return -1;
+    }
+
+    uint64_t  now  = system_monotonic_ms();
+    PoolHost* host = host_get(name, port, tls);
+    if (!host || host_resolve(host, now) != 0) {
+        return -1;
+    }
+
+    if (!g_task) {
+        g_task = smw_create_task(NULL, pool_task_work);
+        if (!g_task) {
+            return -1;
+        }
+    }
+
+    PoolRequest* request = calloc(1, sizeof(PoolRequest));
+    if (!request) {
+        return -1;
+    }
+
+    /* Host header as given in the URL, port included */
+    char authority_value[POOL_MAX_HOST_NAME];
+    memcpy(authority_value, url, authority);
+    authority_value[authority] = '\0';
+
+    const char* fmt = "GET %s HTTP/1.1\r\n"
+                      "Host: %s\r\n"
+                      "User-Agent: " POOL_USER_AGENT "\r\n"
+                      "Accept: */*\r\n"
+                      "Connection: keep-alive\r\n"
+                      "%s\r\n";
+    const char* target = path ? path : "/";
+    const char* extra  = headers ? headers : "";
+
+    int length = snprintf(NULL, 0, fmt, target, authority_value, extra);
+    request->head = length > 0 ? malloc((size_t)length + 1) : NULL;
+    if (!request->head) {
+        free(request);
+        return -1;
+    }
+    snprintf(request->head, (size_t)length + 1, fmt, target, authority_value,
+             extra);
+
+    request->host        = host;
+    request->head_length = (size_t)length;
+    request->callback    = callback;
+    request->context     = context;
+    request->started_us  = metrics_now_us();
+    request->deadline_ms = now + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+
+    queue_push(host, request, false);
+    g_stats.requests++;
+    host_dispatch(host);
+    return 0;
+}
+
+void http_pool_stats(HttpPoolStats* out) {
+    if (out) {
+        *out = g_stats;
+    }
+}
+
+size_t http_pool_host_count(void) {
+    return g_host_count;
+}
+
+bool http_pool_host_stats(size_t index, HttpPoolHostStats* out) {
+    if (index >= g_host_count || !out) {
+        return false;
+    }
+
+    const PoolHost* host = &g_hosts[index];
+    out->name            = host->name;
+    out->port            = host->port;
+    out->tls             = host->tls;
+    out->open            = host->conn_count;
+    out->responses       = metrics_counter_get(&host->responses);
+    out->errors          = metrics_counter_get(&host->errors);
+    out->timeouts        = metrics_counter_get(&host->timeouts);
+    out->latency         = &host->latency;
+    return true;
+}
+
+void http_pool_dispose(void) {
+    if (g_task) {
+        smw_destroy_task(g_task);
+        g_task = NULL;
+    }
+
+    for (size_t i = 0; i < g_host_count; i++) {
+        PoolHost* host = &g_hosts[i];
+        while (host->conns) {
+            PoolRequest* request = host->conns->request;
+            if (request) {
+                free(request->head);
+                free(request);
+                host->conns->request = NULL;
+            }
+            conn_close(host->conns);
+        }
+
+        PoolRequest* request;
+        while ((request = queue_pop(host)) != NULL) {
+            free(request->head);
+            free(request);
+        }
+
+        if (host->has_session) {
+            mbedtls_ssl_session_free(&host->session);
+        }
+
+        /* A lookup that cannot be cancelled gets a moment to finish */
+        if (host->resolving &&
+            gai_cancel(&host->resolve) == EAI_NOTCANCELED) {
+            const struct gaicb*   list[1] = {&host->resolve};
+            const struct timespec wait    = {.tv_sec = 1};
+            gai_suspend(list, 1, &wait);
+        }
+        if (host->resolving && gai_error(&host->resolve) != EAI_INPROGRESS) {
+            if (host->resolve.ar_result) {
+                freeaddrinfo(host->resolve.ar_result);
+            }
+            host->resolving = false;
+        }
+    }
+    g_host_count = 0;
+
+    if (g_tls_ready) {
+        mbedtls_ssl_config_free(&g_tls_config);
+        mbedtls_x509_crt_free(&g_ca);
+        mbedtls_ctr_drbg_free(&g_drbg);
+        mbedtls_entropy_free(&g_entropy);
+        g_tls_ready = false;
+    }
+
+    memset(&g_stats, 0, sizeof(g_stats));
+}
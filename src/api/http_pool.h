@@ -0,0 +1,107 @@
+/**
+ * http_pool.h - Keep-alive connection pool for outbound HTTP requests
+ *
+ * Drop-in replacement for http_client_get() that keeps upstream sockets
+ * open between requests. Connections are HTTP/1.1 keep-alive and grouped
+ * per scheme, host and port; a request reuses an idle connection when one
+ * exists, opens a new one while the host is below HTTP_POOL_MAX_PER_HOST,
+ * and otherwise waits in a per-host queue. HTTPS connections are made with
+ * mbedtls and resume the last TLS session of their host, so a reconnect
+ * after the idle timeout skips the full handshake.
+ *
+ * Everything runs from one scheduler task with non-blocking sockets; the
+ * callback receives the same events as with http_client_get: "RESPONSE"
+ * with the body of a 2xx response, or "ERROR" / "TIMEOUT" with a short
+ * reason. Host names are resolved with getaddrinfo_a in a resolver thread,
+ * never on the event loop, and the address is kept for
+ * HTTP_POOL_DNS_TTL_MS. Requests to a host wait in its queue for the first
+ * lookup and use the previous address while it is refreshed.
+ *
+ * Each host counts its completed requests by event and keeps a latency
+ * histogram from http_pool_get() to the callback (http_pool_host_stats).
+ *
+ * Usage:
+ *   http_pool_get("https://example.com/a.json", NULL, 30000, on_done, ctx);
+ *   ...
+ *   http_pool_dispose(); // At shutdown
+ */
+
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include "metrics.h"
+
+#include <http_client.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_POOL_MAX_PER_HOST 4             /* Open connections per host */
+#define HTTP_POOL_MAX_HOSTS 16               /* Distinct upstream hosts */
+#define HTTP_POOL_IDLE_MS 30000              /* Close idle sockets after */
+#define HTTP_POOL_DNS_TTL_MS 300000          /* Re-resolve hosts after */
+#define HTTP_POOL_MAX_RESPONSE (8 * 1048576) /* Largest accepted body */
+
+/* Pool counters, for logging and metrics */
+typedef struct {
+    size_t requests;    /* Requests started */
+    size_t connections; /* Connections opened */
+    size_t reused;      /* Requests sent on an idle connection */
+    size_t tls_resumed; /* Handshakes that offered a saved session */
+    size_t open;        /* Connections currently open */
+    size_t queued;      /* Requests waiting for a connection */
+} HttpPoolStats;
+
+/* Counters of one upstream host; pointers are owned by the pool */
+typedef struct {
+    const char*             name;
+    const char*             port;
+    bool                    tls;
+    size_t                  open;      /* Connections currently open */
+    uint64_t                responses; /* "RESPONSE" callbacks */
+    uint64_t                errors;    /* "ERROR" callbacks */
+    uint64_t                timeouts;  /* "TIMEOUT" callbacks */
+    const MetricsHistogram* latency;   /* Request to callback, all events */
+} HttpPoolHostStats;
+
+/**
+ * Start an asynchronous GET request.
+ *
+ * @param url         "http://" or "https://" URL
+ * @param headers     Extra request header lines ("Name: value\r\n"...),
+ *                    or NULL
+ * @param timeout_ms  Time limit for the whole request
+ * @param callback    Completion callback, called exactly once unless the
+ *                    request is refused
+ * @param context     Passed through to the callback
+ * @return            0 if the request was queued, -1 if it was refused
+ *                    (bad URL, unknown host, out of memory); the callback
+ *                    is not called then
+ */
+int http_pool_get(const char* url, const char* headers, int timeout_ms,
+                  HttpClientCallback callback, void* context);
+
+/**
+ * Copy the current counters.
+ */
+void http_pool_stats(HttpPoolStats* out);
+
+/**
+ * Number of hosts the pool has seen, for http_pool_host_stats().
+ */
+size_t http_pool_host_count(void);
+
+/**
+ * Copy the counters of one host.
+ *
+ * @return  false if index is out of range
+ */
+bool http_pool_host_stats(size_t index, HttpPoolHostStats* out);
+
+/**
+ * Close every connection and free the pool. Requests still in flight are
+ * dropped without a callback.
+ */
+void http_pool_dispose(void);
+
+#endif /* HTTP_POOL_H */
@@ -0,0 +1,329 @@
+/**
+ * json_writer.c - Streaming JSON writer implementation
+ *
+ * Formatting rules follow jansson's dump.c (do_dump, dump_indent,
+ * dump_string and jsonp_dtostr) so responses are unchanged.
+ */
+
+#include "json_writer.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ============= Buffer ============= */
+
+static bool reserve(JsonWriter* writer, size_t extra) {
+    if (writer->failed) {
+        return false;
+    }
+
+    size_t needed = writer->length + extra + 1; /* Room for the NUL */
+    if (needed <= writer->capacity) {
+        return true;
+    }
+
+    size_t capacity = writer->capacity ? writer->capacity
+                                       : JSON_WRITER_INITIAL_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    char* data =
+        writer->arena
+            ? request_arena_realloc(writer->arena, writer->data,
+                                    writer->capacity, capacity)
+            : realloc(writer->data, capacity);
+    if (!data) {
+        writer->failed = true;
+        return false;
+    }
+
+    writer->data     = data;
+    writer->capacity = capacity;
+    return true;
+}
+
+static void append(JsonWriter* writer, const char* text, size_t length) {
+    if (reserve(writer, length)) {
+        memcpy(writer->data + writer->length, text, length);
+        writer->length += length;
+    }
+}
+
+static void append_char(JsonWriter* writer, char c) {
+    if (reserve(writer, 1)) {
+        writer->data[writer->length++] = c;
+    }
+}
+
+/* Newline plus depth levels of indentation (jansson dump_indent) */
+static void append_indent(JsonWriter* writer, int depth) {
+    size_t spaces = (size_t)depth * JSON_WRITER_INDENT;
+    if (reserve(writer, spaces + 1)) {
+        writer->data[writer->length++] = '\n';
+        memset(writer->data + writer->length, ' ', spaces);
+        writer->length += spaces;
+    }
+}
+
+/* ============= Value Encoding ============= */
+
+/* json_string() refuses invalid UTF-8; mirror that so the key is skipped */
+static bool utf8_valid(const unsigned char* s) {
+    while (*s) {
+        unsigned char c = *s++;
+        int           extra;
+        uint32_t      cp;
+
+        if (c < 0x80) {
+            continue;
+        } else if ((c & 0xE0) == 0xC0) {
+            extra = 1;
+            cp    = c & 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            extra = 2;
+            cp    = c & 0x0F;
+        } else if ((c & 0xF8) == 0xF0) {
+            extra = 3;
+            cp    = c & 0x07;
+        } else {
+            return false;
+        }
+
+        for (int i = 0; i < extra; i++, s++) {
+            if ((*s & 0xC0) != 0x80) {
+                return false;
+            }
+            cp = (cp << 6) | (*s & 0x3F);
+        }
+
+        /* Overlong forms, surrogates and out-of-range code points */
+        if ((extra == 1 && cp < 0x80) || (extra == 2 && cp < 0x800) ||
+            (extra == 3 && cp < 0x10000) || cp > 0x10FFFF ||
+            (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void append_string(JsonWriter* writer, const char* text) {
+    append_char(writer, '"');
+
+    const char* run = text;
+    for (const char* p = text; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+
+        append(writer, run, (size_t)(p - run));
+        run = p + 1;
+
+        switch (c) {
+        case '"':
+            append(writer, "\\\"", 2);
+            break;
+        case '\\':
+            append(writer, "\\\\", 2);
+            break;
+        case '\b':
+            append(writer, "\\b", 2);
+            break;
+        case '\f':
+            append(writer, "\\f", 2);
+            break;
+        case '\n':
+            append(writer, "\\n", 2);
+            break;
+        case '\r':
+            append(writer, "\\r", 2);
+            break;
+        case '\t':
+            append(writer, "\\t", 2);
+            break;
+        default: {
+            char seq[8];
+            snprintf(seq, sizeof(seq), "\\u%04X", (unsigned int)c);
+            append(writer, seq, 6);
+            break;
+        }
+        }
+    }
+    append(writer, run, strlen(run));
+
+    append_char(writer, '"');
+}
+
+/* jsonp_dtostr with the default precision of 17 */
+static void append_double(JsonWriter* writer, double value) {
+    char buffer[32];
+    int  length = snprintf(buffer, sizeof(buffer), "%.17g", value);
+    if (length < 0 || (size_t)length >= sizeof(buffer) - 3) {
+        writer->failed = true;
+        return;
+    }
+
+    if (!strchr(buffer, '.') && !strchr(buffer, 'e')) {
+        buffer[length++] = '.';
+        buffer[length++] = '0';
+        buffer[length]   = '\0';
+    }
+
+    /* Drop '+' and leading zeros from the exponent: 1e+020 -> 1e20 */
+    char* start = strchr(buffer, 'e');
+    if (start) {
+        start++;
+        char* end = start + 1;
+        if (*start == '-') {
+            start++;
+        }
+        while (*end == '0') {
+            end++;
+        }
+        if (end != start) {
+            memmove(start, end, (size_t)length - (size_t)(end - buffer) + 1);
+            length -= (int)(end - start);
+        }
+    }
+
+    append(writer, buffer, (size_t)length);
+}
+
+/* ============= Structure ============= */
+
+/* Separator before the next member or element of the open container */
+static void begin_member(JsonWriter* writer) {
+    if (writer->depth == 0) {
+        return; /* Top-level value */
+    }
+
+    if (writer->empty[writer->depth - 1]) {
+        writer->empty[writer->depth - 1] = false;
+    } else {
+        append_char(writer, ',');
+    }
+    append_indent(writer, writer->depth);
+}
+
+static void write_key(JsonWriter* writer, const char* key) {
+    begin_member(writer);
+    append_string(writer, key);
+    append(writer, ": ", 2);
+}
+
+static void open_container(JsonWriter* writer, char bracket) {
+    if (writer->depth >= JSON_WRITER_MAX_DEPTH) {
+        writer->failed = true;
+        return;
+    }
+    append_char(writer, bracket);
+    writer->empty[writer->depth++] = true;
+}
+
+static void close_container(JsonWriter* writer, char bracket) {
+    if (writer->depth == 0) {
+        writer->failed = true;
+        return;
+    }
+    if (!writer->empty[--writer->depth]) {
+        append_indent(writer, writer->depth);
+    }
+    append_char(writer, bracket);
+}
+
+/* ============= Public API ============= */
+
+void json_writer_initiate(JsonWriter* writer, RequestArena* arena) {
+    memset(writer, 0, sizeof(JsonWriter));
+    writer->arena = arena;
+}
+
+char* json_writer_finish(JsonWriter* writer, size_t* out_length) {
+    if (writer->depth != 0 || !reserve(writer, 0)) {
+        json_writer_dispose(writer);
+        return NULL;
+    }
+
+    writer->data[writer->length] = '\0';
+    if (out_length) {
+        *out_length = writer->length;
+    }
+
+    char* data   = writer->data;
+    writer->data = NULL;
+    return data;
+}
+
+void json_writer_dispose(JsonWriter* writer) {
+    if (!writer->arena) {
+        free(writer->data);
+    }
+    writer->data     = NULL;
+    writer->length   = 0;
+    writer->capacity = 0;
+}
+
+void json_write_begin_object(JsonWriter* writer) {
+    begin_member(writer);
+    open_container(writer, '{');
+}
+
+void json_write_end_object(JsonWriter* writer) {
+    close_container(writer, '}');
+}
+
+void json_write_begin_array(JsonWriter* writer) {
+    begin_member(writer);
+    open_container(writer, '[');
+}
+
+void json_write_end_array(JsonWriter* writer) { close_container(writer, ']'); }
+
+void json_write_key_object(JsonWriter* writer, const char* key) {
+    write_key(writer, key);
+    open_container(writer, '{');
+}
+
+void json_write_key_array(JsonWriter* writer, const char* key) {
+    write_key(writer, key);
+    open_container(writer, '[');
+}
+
+void json_write_key_str(JsonWriter* writer, const char* key,
+                        const char* value) {
+    if (!value || !utf8_valid((const unsigned char*)value)) {
+        return;
+    }
+    write_key(writer, key);
+    append_string(writer, value);
+}
+
+void json_write_key_double(JsonWriter* writer, const char* key,
+                           double value) {
+    if (!isfinite(value)) {
+        return;
+    }
+    write_key(writer, key);
+    append_double(writer, value);
+}
+
+void json_write_key_int(JsonWriter* writer, const char* key, long long value) {
+    char buffer[24];
+    int  length = snprintf(buffer, sizeof(buffer), "%lld", value);
+
+    write_key(writer, key);
+    append(writer, buffer, (size_t)length);
+}
+
+void json_write_key_bool(JsonWriter* writer, const char* key, bool value) {
+    write_key(writer, key);
+    if (value) {
+        append(writer, "true", 4);
+    } else {
+        append(writer, "false", 5);
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * json_writer.h - Streaming JSON writer for fixed-shape responses
+ *
+ * Renders JSON straight into one output buffer instead of building a
+ * jansson tree and dumping it. The output is byte-for-byte what
+ * json_dumps(tree, JSON_INDENT(2) | JSON_PRESERVE_ORDER) produces for the
+ * equivalent tree: two-space indentation, "key": value separators, "{}" and
+ * "[]" for empty containers, reals printed with 17 significant digits and
+ * a ".0" suffix when they look like integers. Values jansson would refuse
+ * to create (non-finite reals, NULL or invalid UTF-8 strings) are skipped
+ * together with their key, as json_object_set_new would.
+ *
+ * The buffer comes from a RequestArena when one is given, otherwise from
+ * the heap. Errors are sticky: after an allocation failure every call is a
+ * no-op and json_writer_finish returns NULL.
+ *
+ * Usage:
+ *   JsonWriter w;
+ *   json_writer_initiate(&w, arena);
+ *   json_write_begin_object(&w);
+ *   json_write_key_str(&w, "name", "Stockholm");
+ *   json_write_key_double(&w, "latitude", 59.33);
+ *   json_write_end_object(&w);
+ *   char* body = json_writer_finish(&w, &length);
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "request_arena.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_WRITER_INDENT 2
+#define JSON_WRITER_MAX_DEPTH 16
+#define JSON_WRITER_INITIAL_CAPACITY 1024
+
+typedef struct {
+    char*         data;
+    size_t        length;
+    size_t        capacity;
+    RequestArena* arena; /* NULL: data is a heap buffer */
+    int           depth;
+    bool          empty[JSON_WRITER_MAX_DEPTH]; /* No member written yet */
+    bool          failed;
+} JsonWriter;
+
+/* Start an empty document */
+void json_writer_initiate(JsonWriter* writer, RequestArena* arena);
+
+/**
+ * Terminate the document and hand out the buffer.
+ *
+ * @param writer      Writer with all containers closed
+ * @param out_length  Optional output length (without the NUL)
+ * @return            NUL-terminated JSON (arena-owned, or heap to free),
+ *                    or NULL on failure
+ */
+char* json_writer_finish(JsonWriter* writer, size_t* out_length);
+
+/* Release the buffer of a writer that is not finished (error paths) */
+void json_writer_dispose(JsonWriter* writer);
+
+/* Containers as values (top level or array elements) */
+void json_write_begin_object(JsonWriter* writer);
+void json_write_end_object(JsonWriter* writer);
+void json_write_begin_array(JsonWriter* writer);
+void json_write_end_array(JsonWriter* writer);
+
+/* Containers as object members */
+void json_write_key_object(JsonWriter* writer, const char* key);
+void json_write_key_array(JsonWriter* writer, const char* key);
+
+/* Object members */
+void json_write_key_str(JsonWriter* writer, const char* key,
+                        const char* value);
+void json_write_key_double(JsonWriter* writer, const char* key, double value);
+void json_write_key_int(JsonWriter* writer, const char* key, long long value);
+void json_write_key_bool(JsonWriter* writer, const char* key, bool value);
+
+#endif /* JSON_WRITER_H */
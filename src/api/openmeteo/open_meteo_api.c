@@ -1,8 +1,13 @@
 #include <cache_utils/file_cache.h>
+#include <cache_utils/single_flight.h>
 #include <errno.h>
-#include <http_client.h>
+#include <http_pool.h>
 #include <jansson.h>
+#include <logger.h>
+#include <math.h>
 #include <open_meteo_api.h>
+#include <smw.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,8 +16,20 @@
 /* ============= Configuration ============= */
 
 #define API_BASE_URL "http://api.open-meteo.com/v1/forecast"
+#define API_CURRENT_PARAMS                                                     \
+    "&current=temperature_2m,relative_humidity_2m,"                            \
+    "apparent_temperature,is_day,precipitation,weather_code,"                  \
+    "surface_pressure,wind_speed_10m,wind_direction_10m"                       \
+    "&timezone=GMT"
 #define DEFAULT_CACHE_DIR "./cache/weather_cache"
 #define DEFAULT_CACHE_TTL 900 /* 15 minutes */
+#define CACHE_FILE_EXTENSION ".bin"
+#define CACHE_DISK_BYTES (64 * 1024 * 1024) /* Janitor budget for the files */
+#define REFRESH_QUEUE_SIZE 64 /* Stale entries awaiting a background fetch */
+
+/* Binary cache record: header followed by the raw WeatherData struct */
+#define WEATHER_RECORD_MAGIC 0x5257534Au /* "JSWR" */
+#define WEATHER_RECORD_VERSION 1
 
 /* ============= Global State ============= */
 
@@ -23,27 +40,81 @@ static WeatherConfig g_config = {.cache_dir = DEFAULT_CACHE_DIR,
 /* Cache instance */
 static FileCacheInstance* g_weather_cache = NULL;
 
+/* In-flight upstream fetches, keyed by cache key */
+static SingleFlightTable* g_weather_flights = NULL;
+
+/* Notified after a fetched record has been saved */
+static OpenMeteoOnRefresh g_refresh_hook = NULL;
+
+/* Stale entries that were served and still have to be refetched */
+typedef struct {
+    Location location;
+    char     cache_key[FILE_CACHE_KEY_LENGTH];
+} PendingRefresh;
+
+static PendingRefresh g_refresh_queue[REFRESH_QUEUE_SIZE];
+static size_t         g_refresh_count = 0;
+static SmwTask*       g_refresh_task  = NULL;
+
 /* ============= Internal Structures ============= */
 
+/* Per-fetch state carried through http_pool_get; callers wait on the
+ * single-flight entry for cache_key */
+typedef struct {
+    float latitude;
+    float longitude;
+    char  cache_key[FILE_CACHE_KEY_LENGTH];
+} WeatherRequestContext;
+
+/* One multi-location fetch; items are in the order of the URL lists */
 typedef struct {
-    char*        response_data;
-    size_t       response_size;
-    int          http_status;
-    volatile int completed;
-    volatile int error;
-} HttpFetchContext;
+    size_t                count;
+    WeatherRequestContext items[];
+} WeatherBatchContext;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size; /* sizeof(WeatherData) of the writer */
+} WeatherRecordHeader;
+
+typedef struct {
+    WeatherRecordHeader header;
+    WeatherData         data;
+} WeatherRecord;
 
 /* ============= Internal Functions ============= */
 
-static void  http_fetch_callback(const char* event, const char* response,
-                                 void* context);
-static int   fetch_url_sync(const char* url, char** response_data,
-                            int* http_status);
-static int   load_weather_from_json(json_t* root, WeatherData** data);
-static int   fetch_weather_from_api(Location* location, WeatherData** data);
+static void  weather_fetch_callback(const char* event, const char* response,
+                                    void* context);
+static void  weather_batch_callback(const char* event, const char* response,
+                                    void* context);
+static float snap_coordinate(float value);
+static int   save_weather_record(const char*        cache_key,
+                                 const WeatherData* data);
+static int   load_weather_record(const char* cache_key, WeatherData* data);
+static int   fetch_weather_from_api_async(const Location* location,
+                                          const char*     cache_key);
+static int   fetch_weather_batch_async(WeatherBatchContext* batch);
+static void  batch_add(WeatherBatchContext** batch, size_t remaining,
+                       const Location* location, const char* cache_key);
+static void  on_background_refresh(int result, const WeatherData* data,
+                                   void* context);
+static bool  answer_from_cache(const Location* location, const char* cache_key,
+                               OpenMeteoOnCurrent callback, void* context);
+static int   join_fetch(const char* cache_key, OpenMeteoOnCurrent callback,
+                        void* context);
+static void  deliver_weather(SingleFlightCallback callback, void* context,
+                             int result, const void* value);
+static void  schedule_refresh(const Location* location, const char* cache_key);
+static void  refresh_task_work(void* context, uint64_t mon_time);
 static char* build_api_url(float lat, float lon);
+static char* build_batch_api_url(const WeatherRequestContext* items,
+                                 size_t                       count);
 static int   parse_weather_json(const char* json_str, WeatherData* data,
                                 float lat, float lon);
+static int   parse_weather_object(const json_t* root, WeatherData* data,
+                                  float lat, float lon);
 
 /* ============= Weather Code Descriptions ============= */
 
@@ -119,166 +190,246 @@ const char* open_meteo_api_get_wind_direction(int degrees) {
     }
 }
 
-/* ============= HTTP Client Integration ============= */
-
-static HttpFetchContext* g_fetch_context = NULL;
-
-static void http_fetch_callback(const char* event, const char* response,
-                                void* context) {
-    if (!g_fetch_context) {
-        return;
-    }
+/* ============= Public API Implementation ============= */
 
-    if (strcmp(event, "RESPONSE") == 0) {
-        g_fetch_context->response_data = strdup(response);
-        g_fetch_context->response_size = strlen(response);
-        g_fetch_context->http_status   = 200;
-        g_fetch_context->completed     = 1;
-    } else if (strcmp(event, "ERROR") == 0 || strcmp(event, "TIMEOUT") == 0) {
-        g_fetch_context->error     = 1;
-        g_fetch_context->completed = 1;
+int open_meteo_api_init(WeatherConfig* config) {
+    if (!config) {
+        return -1;
     }
-}
 
-static int fetch_url_sync(const char* url, char** response_data,
-                          int* http_status) {
-    HttpFetchContext context = {0};
-    g_fetch_context          = &context;
-
-    http_client_get(url, NULL, 30000, http_fetch_callback, NULL);
+    g_config = *config;
 
-    // Poll event loop - fast iterations, no sleep!
-    time_t start_time      = time(NULL);
-    time_t timeout_seconds = 30;
+    /* Initialize cache */
+    FileCacheConfig cache_cfg = {
+        .cache_dir        = g_config.cache_dir,
+        .ttl_seconds      = g_config.cache_ttl,
+        .enabled          = g_config.use_cache,
+        .memory_bytes     = g_config.memory_cache_bytes,
+        .extension        = CACHE_FILE_EXTENSION,
+        .hard_ttl_seconds = g_config.cache_hard_ttl,
+        .write_behind     = true,
+        .disk_bytes       = CACHE_DISK_BYTES};
 
-    while (!context.completed) {
-        smw_work(0); // Pass 0 if monotonic time unavailable
+    g_weather_cache = file_cache_create(&cache_cfg);
+    if (!g_weather_cache) {
+        LOGGER_WARN("[METEO] Warning: Failed to initialize cache");
+    }
 
-        // Check timeout (1 second granularity)
-        if (time(NULL) - start_time > timeout_seconds) {
-            printf("[METEO] Timeout waiting for response\n");
-            break;
+    if (!g_weather_flights) {
+        g_weather_flights = single_flight_create(deliver_weather);
+        if (!g_weather_flights) {
+            LOGGER_ERROR("[METEO] Failed to create fetch table");
+            return -1;
         }
     }
 
-    g_fetch_context = NULL;
-
-    if (context.error || !context.completed) {
-        if (context.response_data) {
-            free(context.response_data);
+    if (g_config.cache_hard_ttl > g_config.cache_ttl && !g_refresh_task) {
+        g_refresh_task = smw_create_task(NULL, refresh_task_work);
+        if (!g_refresh_task) {
+            LOGGER_WARN("[METEO] Warning: No background refresh, stale entries "
+                        "are refetched on request");
         }
-        return -1;
     }
 
-    *response_data = context.response_data;
-    *http_status   = context.http_status;
+    LOGGER_INFO("[METEO] API initialized (upstream via http_pool)");
+    LOGGER_INFO("[METEO] Cache dir: %s", g_config.cache_dir);
+    LOGGER_INFO("[METEO] Cache TTL: %d seconds", g_config.cache_ttl);
+    if (g_refresh_task) {
+        LOGGER_INFO("[METEO] Stale entries served for: %d seconds",
+                    g_config.cache_hard_ttl);
+    }
+    LOGGER_INFO("[METEO] Cache enabled: %s", g_config.use_cache ? "yes" : "no");
+    LOGGER_INFO("[METEO] Memory tier: %zu bytes", g_config.memory_cache_bytes);
+    if (g_config.grid_resolution > 0) {
+        LOGGER_INFO("[METEO] Grid resolution: %.4f degrees",
+                    g_config.grid_resolution);
+    }
 
     return 0;
 }
 
-/* ============= Public API Implementation ============= */
-
-int open_meteo_api_init(WeatherConfig* config) {
-    if (!config) {
+int open_meteo_api_get_current_async(const Location*    location,
+                                     OpenMeteoOnCurrent callback,
+                                     void*              context) {
+    if (!location || !callback) {
+        LOGGER_ERROR("[METEO] Invalid parameters");
         return -1;
     }
 
-    g_config = *config;
+    /* Nearby coordinates share one grid point, entry and upstream fetch */
+    Location snapped  = *location;
+    snapped.latitude  = snap_coordinate(location->latitude);
+    snapped.longitude = snap_coordinate(location->longitude);
+    location          = &snapped;
 
-    /* Initialize cache */
-    FileCacheConfig cache_cfg = {.cache_dir   = g_config.cache_dir,
-                                 .ttl_seconds = g_config.cache_ttl,
-                                 .enabled     = g_config.use_cache};
+    char cache_key[FILE_CACHE_KEY_LENGTH];
+    if (open_meteo_api_cache_key(location->latitude, location->longitude,
+                                 cache_key, sizeof(cache_key)) != 0) {
+        LOGGER_ERROR("[METEO] Failed to generate cache key");
+        callback(-2, NULL, context);
+        return -2;
+    }
 
-    g_weather_cache = file_cache_create(&cache_cfg);
-    if (!g_weather_cache) {
-        fprintf(stderr, "[METEO] Warning: Failed to initialize cache\n");
+    /* Check cache - a hit completes synchronously */
+    if (answer_from_cache(location, cache_key, callback, context)) {
+        return 0;
     }
 
-    printf("[METEO] API initialized (http_client mode)\n");
-    printf("[METEO] Cache dir: %s\n", g_config.cache_dir);
-    printf("[METEO] Cache TTL: %d seconds\n", g_config.cache_ttl);
-    printf("[METEO] Cache enabled: %s\n", g_config.use_cache ? "yes" : "no");
+    int role = join_fetch(cache_key, callback, context);
+    if (role != SINGLE_FLIGHT_LEADER) {
+        return role == SINGLE_FLIGHT_ERROR ? -1 : 0;
+    }
 
-    return 0;
+    return fetch_weather_from_api_async(location, cache_key);
 }
 
-int open_meteo_api_get_current(Location* location, WeatherData** data) {
-    if (!location || !data) {
-        fprintf(stderr, "[METEO] Invalid parameters\n");
+int open_meteo_api_get_current_many_async(const Location*    locations,
+                                          size_t             count,
+                                          OpenMeteoOnCurrent callback,
+                                          void* const*       contexts) {
+    if (!locations || !callback || !contexts) {
+        LOGGER_ERROR("[METEO] Invalid parameters");
         return -1;
     }
 
-    /* Generate cache key from coordinates */
-    char key_input[256];
-    snprintf(key_input, sizeof(key_input), "weather_%.6f_%.6f",
-             location->latitude, location->longitude);
+    WeatherBatchContext* batch = NULL;
 
-    char cache_key[FILE_CACHE_KEY_LENGTH];
-    if (file_cache_generate_key(g_weather_cache, key_input, cache_key,
-                                sizeof(cache_key)) != FILE_CACHE_OK) {
-        fprintf(stderr, "[METEO] Failed to generate cache key\n");
-        return -2;
+    for (size_t i = 0; i < count; i++) {
+        Location snapped  = locations[i];
+        snapped.latitude  = snap_coordinate(locations[i].latitude);
+        snapped.longitude = snap_coordinate(locations[i].longitude);
+
+        char cache_key[FILE_CACHE_KEY_LENGTH];
+        if (open_meteo_api_cache_key(snapped.latitude, snapped.longitude,
+                                     cache_key, sizeof(cache_key)) != 0) {
+            LOGGER_ERROR("[METEO] Failed to generate cache key");
+            callback(-2, NULL, contexts[i]);
+            continue;
+        }
+
+        if (answer_from_cache(&snapped, cache_key, callback, contexts[i]) ||
+            join_fetch(cache_key, callback, contexts[i]) !=
+                SINGLE_FLIGHT_LEADER) {
+            continue;
+        }
+
+        /* Led by this call: add it to the next upstream request */
+        batch_add(&batch, count - i, &snapped, cache_key);
     }
 
-    /* Check cache */
-    if (g_config.use_cache && file_cache_is_valid(g_weather_cache, cache_key)) {
-        printf("[METEO] Cache HIT\n");
+    if (batch) {
+        fetch_weather_batch_async(batch);
+    }
 
-        json_t* cached_json = NULL;
-        if (file_cache_load_json(g_weather_cache, cache_key,
-                                 (void**)&cached_json) == FILE_CACHE_OK) {
-            int result = load_weather_from_json(cached_json, data);
-            json_decref(cached_json);
+    return 0;
+}
 
-            if (result == 0) {
-                return 0;
-            }
+size_t open_meteo_api_prefetch_many(const Location* locations, size_t count,
+                                    int lead_seconds) {
+    if (!locations || !g_config.use_cache || !g_weather_flights) {
+        return 0;
+    }
+
+    WeatherBatchContext* batch   = NULL;
+    size_t               started = 0;
+    time_t               now     = time(NULL);
+
+    for (size_t i = 0; i < count; i++) {
+        Location snapped  = locations[i];
+        snapped.latitude  = snap_coordinate(locations[i].latitude);
+        snapped.longitude = snap_coordinate(locations[i].longitude);
+
+        char cache_key[FILE_CACHE_KEY_LENGTH];
+        if (open_meteo_api_cache_key(snapped.latitude, snapped.longitude,
+                                     cache_key, sizeof(cache_key)) != 0) {
+            continue;
         }
 
-        fprintf(stderr, "[METEO] Cache load failed\n");
-    } else {
-        printf("[METEO] Cache MISS\n");
+        /* Stale and missing entries report an error and are fetched too */
+        time_t expires_at = 0;
+        if (file_cache_get_expiry(g_weather_cache, cache_key, &expires_at) ==
+                FILE_CACHE_OK &&
+            expires_at - now > lead_seconds) {
+            continue;
+        }
+
+        /* Requests that miss meanwhile join this flight */
+        if (single_flight_waiters(g_weather_flights, cache_key) > 0 ||
+            single_flight_join(g_weather_flights, cache_key,
+                               (SingleFlightCallback)on_background_refresh,
+                               NULL) != SINGLE_FLIGHT_LEADER) {
+            continue;
+        }
+
+        batch_add(&batch, count - i, &snapped, cache_key);
+        started++;
     }
 
-    int result = fetch_weather_from_api(location, data);
+    if (batch) {
+        fetch_weather_batch_async(batch);
+    }
 
-    if (result != 0) {
-        fprintf(stderr, "[METEO] API fetch failed\n");
-        return -3;
+    if (started > 0) {
+        LOGGER_DEBUG("[METEO] Prefetching %zu of %zu locations", started,
+                     count);
     }
+    return started;
+}
 
-    /* Save to cache */
-    if (g_config.use_cache && (*data)->_raw_json_cache) {
-        json_error_t error;
-        json_t*      json = json_loadb((*data)->_raw_json_cache,
-                                       strlen((*data)->_raw_json_cache), 0, &error);
-        if (json) {
-            file_cache_save_json(g_weather_cache, cache_key, json);
-            json_decref(json);
-        }
-        free((*data)->_raw_json_cache);
-        (*data)->_raw_json_cache = NULL;
+int open_meteo_api_cache_key(float latitude, float longitude, char* out,
+                             size_t out_size) {
+    if (!out) {
+        return -1;
+    }
+
+    /* snap_coordinate is idempotent, so snapped input keys the same */
+    char key_input[256];
+    snprintf(key_input, sizeof(key_input), "weather_%.6f_%.6f",
+             snap_coordinate(latitude), snap_coordinate(longitude));
+
+    if (file_cache_generate_key(g_weather_cache, key_input, out, out_size) !=
+        FILE_CACHE_OK) {
+        return -1;
     }
 
     return 0;
 }
 
-void open_meteo_api_free_current(WeatherData* data) {
-    if (data) {
-        if (data->_raw_json_cache) {
-            free(data->_raw_json_cache);
-        }
-        free(data);
+int open_meteo_api_cache_times(const char* cache_key, time_t* out_fetched_at,
+                               time_t* out_expires_at) {
+    time_t expires_at = 0;
+    if (!g_config.use_cache || !out_fetched_at || !out_expires_at ||
+        file_cache_get_expiry(g_weather_cache, cache_key, &expires_at) !=
+            FILE_CACHE_OK) {
+        return -1;
     }
+
+    /* Every entry lives exactly one TTL from the moment it was saved */
+    *out_fetched_at = expires_at - g_config.cache_ttl;
+    *out_expires_at = expires_at;
+    return 0;
+}
+
+void open_meteo_api_set_refresh_hook(OpenMeteoOnRefresh hook) {
+    g_refresh_hook = hook;
 }
 
 void open_meteo_api_cleanup(void) {
+    if (g_refresh_task) {
+        smw_destroy_task(g_refresh_task);
+        g_refresh_task = NULL;
+    }
+    g_refresh_count = 0;
+
     if (g_weather_cache) {
         file_cache_destroy(g_weather_cache);
         g_weather_cache = NULL;
     }
-    printf("[METEO] API cleaned up\n");
+    if (g_weather_flights) {
+        single_flight_destroy(g_weather_flights);
+        g_weather_flights = NULL;
+    }
+    LOGGER_INFO("[METEO] API cleaned up");
 }
 
 const char* open_meteo_api_get_description(int weather_code) {
@@ -328,110 +479,162 @@ int open_meteo_api_parse_query(const char* query, float* lat, float* lon) {
 /* ============= Internal Functions ============= */
 
 /**
- * Load weather data from parsed JSON object
+ * Round a coordinate to the configured grid (unchanged when disabled)
  */
-static int load_weather_from_json(json_t* root, WeatherData** data) {
-    if (!root) {
-        return -1;
+static float snap_coordinate(float value) {
+    double resolution = g_config.grid_resolution;
+    if (resolution <= 0) {
+        return value;
     }
+    return (float)(round(value / resolution) * resolution);
+}
 
-    *data = (WeatherData*)calloc(1, sizeof(WeatherData));
-    if (!*data) {
-        return -2;
+/**
+ * Answer a lookup from the cache. Stale entries are answered the same way
+ * while a background fetch replaces them.
+ *
+ * @return true if the callback was invoked
+ */
+static bool answer_from_cache(const Location* location, const char* cache_key,
+                              OpenMeteoOnCurrent callback, void* context) {
+    FileCacheFreshness freshness =
+        g_config.use_cache ? file_cache_freshness(g_weather_cache, cache_key)
+                           : FILE_CACHE_MISSING;
+    if (freshness == FILE_CACHE_STALE && !g_refresh_task) {
+        freshness = FILE_CACHE_MISSING; /* Nothing would refresh it */
     }
 
-    json_t* current       = json_object_get(root, "current");
-    json_t* current_units = json_object_get(root, "current_units");
-
-    if (!current || !current_units) {
-        free(*data);
-        return -3;
+    if (freshness == FILE_CACHE_MISSING) {
+        LOGGER_DEBUG("[METEO] Cache MISS");
+        return false;
     }
 
-    /* Parse all weather data fields */
-    json_t* temp = json_object_get(current, "temperature_2m");
-    if (temp) {
-        (*data)->temperature = json_real_value(temp);
-    }
+    LOGGER_DEBUG("[METEO] Cache %s",
+                 freshness == FILE_CACHE_STALE ? "STALE HIT" : "HIT");
 
-    json_t* windspeed = json_object_get(current, "wind_speed_10m");
-    if (windspeed) {
-        (*data)->windspeed = json_real_value(windspeed);
+    WeatherData data = {0};
+    if (load_weather_record(cache_key, &data) != 0) {
+        LOGGER_WARN("[METEO] Cache load failed");
+        return false;
     }
 
-    json_t* winddirection = json_object_get(current, "wind_direction_10m");
-    if (winddirection) {
-        (*data)->winddirection = json_integer_value(winddirection);
+    if (freshness == FILE_CACHE_STALE) {
+        schedule_refresh(location, cache_key);
     }
+    callback(0, &data, context);
+    return true;
+}
 
-    json_t* precipitation = json_object_get(current, "precipitation");
-    if (precipitation) {
-        (*data)->precipitation = json_real_value(precipitation);
-    }
+/**
+ * Coalesce with an identical fetch that is already in flight. A failure to
+ * register is reported to the callback.
+ *
+ * @return SINGLE_FLIGHT_LEADER if the caller has to start the fetch
+ */
+static int join_fetch(const char* cache_key, OpenMeteoOnCurrent callback,
+                      void* context) {
+    int role = single_flight_join(g_weather_flights, cache_key,
+                                  (SingleFlightCallback)callback, context);
+    if (role == SINGLE_FLIGHT_ERROR) {
+        LOGGER_ERROR("[METEO] Failed to register fetch");
+        callback(-1, NULL, context);
+    } else if (role == SINGLE_FLIGHT_WAITER) {
+        LOGGER_DEBUG("[METEO] Joined in-flight fetch (%zu waiting)",
+                     single_flight_waiters(g_weather_flights, cache_key));
+    }
+    return role;
+}
 
-    json_t* humidity = json_object_get(current, "relative_humidity_2m");
-    if (humidity) {
-        (*data)->humidity = json_real_value(humidity);
+/**
+ * Serialize weather data into a versioned binary cache record
+ */
+static int save_weather_record(const char*        cache_key,
+                               const WeatherData* data) {
+    WeatherRecord record;
+    memset(&record, 0, sizeof(record));
+
+    record.header.magic   = WEATHER_RECORD_MAGIC;
+    record.header.version = WEATHER_RECORD_VERSION;
+    record.header.size    = sizeof(WeatherData);
+    record.data           = *data;
+
+    if (file_cache_save(g_weather_cache, cache_key, (const char*)&record,
+                        sizeof(record)) != FILE_CACHE_OK) {
+        return -1;
     }
 
-    json_t* pressure = json_object_get(current, "surface_pressure");
-    if (pressure) {
-        (*data)->pressure = json_real_value(pressure);
-    }
+    return 0;
+}
 
-    json_t* weather_code = json_object_get(current, "weather_code");
-    if (weather_code) {
-        (*data)->weather_code = json_integer_value(weather_code);
-    }
+/**
+ * Load weather data from a binary cache record. Records written by another
+ * build (different magic, version or struct size) are rejected.
+ */
+static int load_weather_record(const char* cache_key, WeatherData* data) {
+    char*  buffer = NULL;
+    size_t size   = 0;
 
-    json_t* is_day = json_object_get(current, "is_day");
-    if (is_day) {
-        (*data)->is_day = json_integer_value(is_day);
+    if (file_cache_load(g_weather_cache, cache_key, &buffer, &size) !=
+        FILE_CACHE_OK) {
+        return -1;
     }
 
-    /* Parse units */
-    json_t* temp_unit = json_object_get(current_units, "temperature_2m");
-    if (temp_unit && json_is_string(temp_unit)) {
-        strncpy((*data)->temperature_unit, json_string_value(temp_unit),
-                sizeof((*data)->temperature_unit) - 1);
-    } else {
-        strcpy((*data)->temperature_unit, "°C");
+    const WeatherRecord* record = (const WeatherRecord*)buffer;
+    if (size != sizeof(WeatherRecord) ||
+        record->header.magic != WEATHER_RECORD_MAGIC ||
+        record->header.version != WEATHER_RECORD_VERSION ||
+        record->header.size != sizeof(WeatherData)) {
+        free(buffer);
+        return -2;
     }
 
-    json_t* wind_unit = json_object_get(current_units, "wind_speed_10m");
-    if (wind_unit && json_is_string(wind_unit)) {
-        strncpy((*data)->windspeed_unit, json_string_value(wind_unit),
-                sizeof((*data)->windspeed_unit) - 1);
-    } else {
-        strcpy((*data)->windspeed_unit, "km/h");
-    }
+    *data = record->data;
+    free(buffer);
+    return 0;
+}
 
-    json_t* latitude  = json_object_get(root, "latitude");
-    json_t* longitude = json_object_get(root, "longitude");
+static const char* api_base_url(void) {
+    const char* url = getenv(OPEN_METEO_URL_ENV);
+    return url && url[0] ? url : API_BASE_URL;
+}
 
-    if (latitude) {
-        (*data)->latitude = json_real_value(latitude);
-    }
-    if (longitude) {
-        (*data)->longitude = json_real_value(longitude);
+static char* build_api_url(float lat, float lon) {
+    char* url = malloc(1024);
+    if (!url) {
+        return NULL;
     }
 
-    return 0;
+    snprintf(url, 1024, "%s?latitude=%.6f&longitude=%.6f" API_CURRENT_PARAMS,
+             api_base_url(), lat, lon);
+
+    return url;
 }
 
-static char* build_api_url(float lat, float lon) {
-    char* url = malloc(1024);
+/**
+ * Forecast URL for several coordinates; the API takes comma-separated
+ * latitude and longitude lists and answers with an array in that order
+ */
+static char* build_batch_api_url(const WeatherRequestContext* items,
+                                 size_t                       count) {
+    /* "-180.000000," is 12 bytes, so 16 per coordinate always fits */
+    const char* base = api_base_url();
+    size_t size = strlen(base) + sizeof(API_CURRENT_PARAMS) + 32 + count * 32;
+    char*  url  = malloc(size);
     if (!url) {
         return NULL;
     }
 
-    snprintf(url, 1024,
-             "%s?latitude=%.6f&longitude=%.6f"
-             "&current=temperature_2m,relative_humidity_2m,"
-             "apparent_temperature,is_day,precipitation,weather_code,"
-             "surface_pressure,wind_speed_10m,wind_direction_10m"
-             "&timezone=GMT",
-             API_BASE_URL, lat, lon);
+    int length = snprintf(url, size, "%s?latitude=", base);
+    for (size_t i = 0; i < count; i++) {
+        length += snprintf(url + length, size - (size_t)length, "%s%.6f",
+                           i ? "," : "", items[i].latitude);
+    }
+    length += snprintf(url + length, size - (size_t)length, "&longitude=");
+    for (size_t i = 0; i < count; i++) {
+        length += snprintf(url + length, size - (size_t)length, "%s%.6f",
+                           i ? "," : "", items[i].longitude);
+    }
+    snprintf(url + length, size - (size_t)length, "%s", API_CURRENT_PARAMS);
 
     return url;
 }
@@ -445,11 +648,20 @@ static int parse_weather_json(const char* json_str, WeatherData* data,
         return -1;
     }
 
+    int result = parse_weather_object(root, data, lat, lon);
+    json_decref(root);
+    return result;
+}
+
+/**
+ * Read one location of a forecast response
+ */
+static int parse_weather_object(const json_t* root, WeatherData* data,
+                                float lat, float lon) {
     json_t* current       = json_object_get(root, "current");
     json_t* current_units = json_object_get(root, "current_units");
 
     if (!current) {
-        json_decref(root);
         return -2;
     }
 
@@ -519,48 +731,277 @@ static int parse_weather_json(const char* json_str, WeatherData* data,
     data->latitude  = lat;
     data->longitude = lon;
 
-    json_decref(root);
     return 0;
 }
 
-static int fetch_weather_from_api(Location* location, WeatherData** data) {
+/**
+ * Store a fetched result and hand it to every request waiting on the key
+ *
+ * @return  Number of requests notified
+ */
+static size_t complete_fetch(const char* cache_key, const WeatherData* data) {
+    /* Save the parsed struct; the response text is not kept */
+    if (g_config.use_cache) {
+        if (save_weather_record(cache_key, data) != 0) {
+            LOGGER_ERROR("[METEO] Failed to save cache record");
+        } else if (g_refresh_hook) {
+            g_refresh_hook(cache_key);
+        }
+    }
+
+    return single_flight_complete(g_weather_flights, cache_key, 0, data);
+}
+
+static void weather_fetch_callback(const char* event, const char* response,
+                                   void* context) {
+    WeatherRequestContext* ctx = (WeatherRequestContext*)context;
+    if (!ctx) {
+        return;
+    }
+
+    if (strcmp(event, "RESPONSE") == 0 && response) {
+        WeatherData data = {0};
+        if (parse_weather_json(response, &data, ctx->latitude,
+                               ctx->longitude) != 0) {
+            LOGGER_ERROR("[METEO] Failed to parse API response");
+            single_flight_complete(g_weather_flights, ctx->cache_key, -4,
+                                   NULL);
+            free(ctx);
+            return;
+        }
+
+        LOGGER_DEBUG("[METEO] Successfully fetched weather data");
+
+        size_t notified = complete_fetch(ctx->cache_key, &data);
+        if (notified > 1) {
+            LOGGER_DEBUG("[METEO] Shared fetch result with %zu requests",
+                         notified);
+        }
+    } else if (strcmp(event, "ERROR") == 0 || strcmp(event, "TIMEOUT") == 0) {
+        LOGGER_ERROR("[METEO] API fetch failed: %s", event);
+        single_flight_complete(g_weather_flights, ctx->cache_key, -3, NULL);
+    } else {
+        return; /* Intermediate event, request still in flight */
+    }
+
+    free(ctx);
+}
+
+static void weather_batch_callback(const char* event, const char* response,
+                                   void* context) {
+    WeatherBatchContext* batch = (WeatherBatchContext*)context;
+    if (!batch) {
+        return;
+    }
+
+    if (strcmp(event, "RESPONSE") == 0 && response) {
+        json_error_t error;
+        json_t* root = json_loadb(response, strlen(response), 0, &error);
+        size_t  parsed = 0;
+
+        for (size_t i = 0; i < batch->count; i++) {
+            WeatherRequestContext* item = &batch->items[i];
+
+            /* A single location is answered with a bare object */
+            const json_t* entry = json_is_array(root) ? json_array_get(root, i)
+                                                      : root;
+            WeatherData   data  = {0};
+            if (batch->count > 1 && !json_is_array(root)) {
+                entry = NULL;
+            }
+            if (!entry || parse_weather_object(entry, &data, item->latitude,
+                                               item->longitude) != 0) {
+                single_flight_complete(g_weather_flights, item->cache_key, -4,
+                                       NULL);
+                continue;
+            }
+
+            complete_fetch(item->cache_key, &data);
+            parsed++;
+        }
+
+        if (parsed < batch->count) {
+            LOGGER_WARN("[METEO] Failed to parse %zu of %zu locations",
+                        batch->count - parsed, batch->count);
+        }
+        LOGGER_DEBUG("[METEO] Fetched weather data for %zu locations", parsed);
+        json_decref(root);
+    } else if (strcmp(event, "ERROR") == 0 || strcmp(event, "TIMEOUT") == 0) {
+        LOGGER_ERROR("[METEO] Batch fetch failed: %s", event);
+        for (size_t i = 0; i < batch->count; i++) {
+            single_flight_complete(g_weather_flights, batch->items[i].cache_key,
+                                   -3, NULL);
+        }
+    } else {
+        return; /* Intermediate event, request still in flight */
+    }
+
+    free(batch);
+}
+
+static void deliver_weather(SingleFlightCallback callback, void* context,
+                            int result, const void* value) {
+    OpenMeteoOnCurrent on_current = (OpenMeteoOnCurrent)callback;
+    on_current(result, (const WeatherData*)value, context);
+}
+
+/**
+ * Start the upstream fetch for a flight led by the caller. Every outcome,
+ * including a failure to start, completes the flight for cache_key.
+ */
+static int fetch_weather_from_api_async(const Location* location,
+                                        const char*     cache_key) {
+    WeatherRequestContext* ctx = malloc(sizeof(WeatherRequestContext));
+    if (!ctx) {
+        single_flight_complete(g_weather_flights, cache_key, -1, NULL);
+        return -1;
+    }
+
+    ctx->latitude  = location->latitude;
+    ctx->longitude = location->longitude;
+    strncpy(ctx->cache_key, cache_key, sizeof(ctx->cache_key) - 1);
+    ctx->cache_key[sizeof(ctx->cache_key) - 1] = '\0';
+
     char* url = build_api_url(location->latitude, location->longitude);
     if (!url) {
+        single_flight_complete(g_weather_flights, ctx->cache_key, -1, NULL);
+        free(ctx);
         return -1;
     }
 
-    printf("[METEO] Fetching: %s\n", url);
+    LOGGER_DEBUG("[METEO] Fetching: %s", url);
 
-    char* response_data = NULL;
-    int   http_status   = 0;
-
-    int result = fetch_url_sync(url, &response_data, &http_status);
+    int result = http_pool_get(url, NULL, 30000, weather_fetch_callback, ctx);
     free(url);
 
-    if (result != 0 || !response_data) {
+    if (result < 0) {
+        single_flight_complete(g_weather_flights, ctx->cache_key, -2, NULL);
+        free(ctx);
         return -2;
     }
 
-    /* debug: raw response suppressed */
+    return 0;
+}
 
-    *data = (WeatherData*)calloc(1, sizeof(WeatherData));
-    if (!*data) {
-        free(response_data);
-        return -3;
+/**
+ * Start one upstream fetch for every flight in a batch, which it takes
+ * ownership of. Like a single fetch, every outcome completes all of them.
+ */
+static int fetch_weather_batch_async(WeatherBatchContext* batch) {
+    int   result = 0;
+    char* url    = build_batch_api_url(batch->items, batch->count);
+
+    if (!url) {
+        result = -1;
+    } else {
+        LOGGER_DEBUG("[METEO] Fetching %zu locations in one request",
+                     batch->count);
+        if (http_pool_get(url, NULL, 30000, weather_batch_callback, batch) <
+            0) {
+            result = -2;
+        }
+        free(url);
     }
 
-    result = parse_weather_json(response_data, *data, location->latitude,
-                                location->longitude);
+    if (result < 0) {
+        for (size_t i = 0; i < batch->count; i++) {
+            single_flight_complete(g_weather_flights, batch->items[i].cache_key,
+                                   result, NULL);
+        }
+        free(batch);
+    }
 
+    return result;
+}
+
+/**
+ * Add a flight led by the caller to *batch, allocating it for up to
+ * remaining locations, and send it once it holds OPEN_METEO_BATCH_MAX.
+ * A failed allocation completes the flight.
+ */
+static void batch_add(WeatherBatchContext** batch, size_t remaining,
+                      const Location* location, const char* cache_key) {
+    if (!*batch) {
+        size_t capacity = remaining < OPEN_METEO_BATCH_MAX
+                              ? remaining
+                              : OPEN_METEO_BATCH_MAX;
+        *batch          = malloc(sizeof(WeatherBatchContext) +
+                                 capacity * sizeof(WeatherRequestContext));
+        if (!*batch) {
+            single_flight_complete(g_weather_flights, cache_key, -1, NULL);
+            return;
+        }
+        (*batch)->count = 0;
+    }
+
+    WeatherRequestContext* item = &(*batch)->items[(*batch)->count++];
+    item->latitude              = location->latitude;
+    item->longitude             = location->longitude;
+    snprintf(item->cache_key, sizeof(item->cache_key), "%s", cache_key);
+
+    if ((*batch)->count == OPEN_METEO_BATCH_MAX) {
+        fetch_weather_batch_async(*batch);
+        *batch = NULL;
+    }
+}
+
+/* ============= Background Refresh ============= */
+
+static void on_background_refresh(int result, const WeatherData* data,
+                                  void* context) {
+    (void)data;
+    (void)context;
     if (result != 0) {
-        free(response_data);
-        free(*data);
-        *data = NULL;
-        return -4;
+        LOGGER_ERROR("[METEO] Background refresh failed (%d)", result);
+    }
+}
+
+/**
+ * Queue a refetch of a stale entry. Keys already queued or in flight are
+ * skipped; when the queue is full the entry is refetched by a later
+ * request instead.
+ */
+static void schedule_refresh(const Location* location, const char* cache_key) {
+    if (single_flight_waiters(g_weather_flights, cache_key) > 0) {
+        return;
     }
 
-    (*data)->_raw_json_cache = response_data;
+    for (size_t i = 0; i < g_refresh_count; i++) {
+        if (strcmp(g_refresh_queue[i].cache_key, cache_key) == 0) {
+            return;
+        }
+    }
 
-    printf("[METEO] Successfully fetched weather data\n");
-    return 0;
+    if (g_refresh_count == REFRESH_QUEUE_SIZE) {
+        LOGGER_WARN("[METEO] Refresh queue full, dropping refresh");
+        return;
+    }
+
+    PendingRefresh* pending     = &g_refresh_queue[g_refresh_count++];
+    pending->location.latitude  = location->latitude;
+    pending->location.longitude = location->longitude;
+    pending->location.name      = NULL;
+    snprintf(pending->cache_key, sizeof(pending->cache_key), "%s", cache_key);
+}
+
+/**
+ * Start the queued refreshes. Each one leads a flight with a no-op
+ * callback, so requests that miss meanwhile join it instead of fetching
+ * the same entry again.
+ */
+static void refresh_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+    (void)mon_time;
+
+    while (g_refresh_count > 0) {
+        PendingRefresh pending = g_refresh_queue[--g_refresh_count];
+
+        int role = single_flight_join(
+            g_weather_flights, pending.cache_key,
+            (SingleFlightCallback)on_background_refresh, NULL);
+        if (role == SINGLE_FLIGHT_LEADER) {
+            LOGGER_DEBUG("[METEO] Refreshing stale entry in the background");
+            fetch_weather_from_api_async(&pending.location, pending.cache_key);
+        }
+    }
 }
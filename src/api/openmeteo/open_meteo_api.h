@@ -4,6 +4,16 @@
 #define OPEN_METEO_API_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#define OPEN_METEO_CACHE_KEY_LENGTH 33 /* MD5 hex string + null terminator */
+
+/* Most coordinates sent in one multi-location forecast request */
+#define OPEN_METEO_BATCH_MAX 50
+
+/* Overrides the forecast endpoint URL (e.g. a mock upstream for benchmarks) */
+#define OPEN_METEO_URL_ENV "JWS_OPEN_METEO_URL"
 
 /* Weather data structure */
 typedef struct {
@@ -25,9 +35,6 @@ typedef struct {
 
     float latitude;
     float longitude;
-
-    /* Internal: raw JSON from API (for caching) - DO NOT USE DIRECTLY */
-    char* _raw_json_cache;
 } WeatherData;
 
 /* Location structure */
@@ -42,16 +49,72 @@ typedef struct {
     const char* cache_dir;
     int         cache_ttl;
     bool        use_cache;
+    size_t      memory_cache_bytes; /* In-memory tier budget (0 = disabled) */
+    double      grid_resolution;    /* Snap coordinates to this many degrees
+                                       before keying and fetching (0 = off) */
+    int         cache_hard_ttl;     /* Serve entries older than cache_ttl up
+                                       to this age, refreshing them in the
+                                       background (0 = off) */
 } WeatherConfig;
 
 /* Initialize weather API */
 int open_meteo_api_init(WeatherConfig* config);
 
-/* Get current weather for location */
-int open_meteo_api_get_current(Location* location, WeatherData** data);
-
-/* Free weather data */
-void open_meteo_api_free_current(WeatherData* data);
+/* Callback invoked when an asynchronous weather lookup completes.
+ * result is 0 on success and negative on error (data is NULL then).
+ * data is owned by the API and only valid for the duration of the callback. */
+typedef void (*OpenMeteoOnCurrent)(int result, const WeatherData* data,
+                                   void* context);
+
+/* Get current weather for location without blocking the event loop.
+ * Cache hits and early failures invoke the callback before returning;
+ * with a cache_hard_ttl, so do stale hits, and a background task refetches
+ * the entry through the same coalescing path as misses;
+ * cache misses invoke it from the http_client response callback.
+ * Concurrent misses for the same coordinates share one upstream fetch.
+ * With a grid_resolution configured, all coordinates in the same grid cell
+ * share one cache entry; data->latitude/longitude are the snapped values. */
+int open_meteo_api_get_current_async(const Location*    location,
+                                     OpenMeteoOnCurrent callback,
+                                     void*              context);
+
+/* Look up many locations at once. callback runs once per location with the
+ * matching entry of contexts, in no particular order, each as described for
+ * open_meteo_api_get_current_async(). Cache misses that no other request is
+ * fetching are sent upstream together, up to OPEN_METEO_BATCH_MAX
+ * coordinates per request; the result for each one is stored in its own
+ * cache entry. Returns 0 once every location has been started or answered,
+ * -1 on invalid parameters (no callback runs then). */
+int open_meteo_api_get_current_many_async(const Location*    locations,
+                                          size_t             count,
+                                          OpenMeteoOnCurrent callback,
+                                          void* const*       contexts);
+
+/* Refetch every location whose entry is missing, stale or expires within
+ * lead_seconds, batched like open_meteo_api_get_current_many_async(). No
+ * callback runs; results are stored and reported to the refresh hook, and
+ * requests that miss meanwhile join the fetch. Locations already being
+ * fetched are skipped. Returns the number of fetches started. */
+size_t open_meteo_api_prefetch_many(const Location* locations, size_t count,
+                                    int lead_seconds);
+
+/* Compute the weather cache key for coordinates (after grid snapping), so
+ * derived caches can refer to the entry. out needs
+ * OPEN_METEO_CACHE_KEY_LENGTH bytes. Returns 0 on success, -1 on error. */
+int open_meteo_api_cache_key(float latitude, float longitude, char* out,
+                             size_t out_size);
+
+/* Get when a cached weather entry was fetched and when it expires.
+ * Returns 0 on success, -1 if the entry is missing or stale (responses
+ * built from a stale entry are therefore not cached downstream). */
+int open_meteo_api_cache_times(const char* cache_key, time_t* out_fetched_at,
+                               time_t* out_expires_at);
+
+/* Called with the cache key after a fresh upstream result has been stored */
+typedef void (*OpenMeteoOnRefresh)(const char* cache_key);
+
+/* Register the refresh hook (NULL removes it) */
+void open_meteo_api_set_refresh_hook(OpenMeteoOnRefresh hook);
 
 /* Cleanup */
 void open_meteo_api_cleanup(void);
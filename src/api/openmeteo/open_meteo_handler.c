@@ -11,14 +11,32 @@
 
 #include "open_meteo_handler.h"
 
+#include "city_grid.h"
+#include "city_index.h"
+#include "json_writer.h"
 #include "open_meteo_api.h"
 #include "response_builder.h"
 
-#include <jansson.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+/**
+ * @brief Search radius for the nearest_city field of /v1/current.
+ * @internal
+ */
+#define NEAREST_CITY_MAX_KM 50.0
+
+/**
+ * @brief City index and spatial grid used for reverse geocoding.
+ * @internal
+ *
+ * Both are owned by the caller of open_meteo_handler_set_city_lookup().
+ */
+static const CityIndex* g_city_lookup_index = NULL;
+static const CityGrid*  g_city_lookup_grid  = NULL;
+
 /**
  * @brief Initialize the Open-Meteo handler module.
  *
@@ -27,123 +45,265 @@
  * @return 0 on success, non-zero on failure.
  */
 int open_meteo_handler_init(void) {
-    WeatherConfig config = {.cache_dir = "./cache/weather_cache",
-                            .cache_ttl = 900, /* 15 minutes */
-                            .use_cache = true};
+    WeatherConfig config = {.cache_dir          = "./cache/weather_cache",
+                            .cache_ttl          = 900,  /* 15 minutes */
+                            .cache_hard_ttl     = 3600, /* Stale for 45 more */
+                            .use_cache          = true,
+                            .memory_cache_bytes = 8 * 1024 * 1024,
+                            .grid_resolution    = 0.01}; /* ~1 km */
 
     return open_meteo_api_init(&config);
 }
 
 /**
- * @brief Handle GET /v1/current endpoint request.
- *
- * Parses latitude and longitude from query string, fetches current weather
- * data from Open-Meteo API, and builds a JSON response with weather details.
- *
- * @param[in]  query_string  URL query parameters containing lat and lon.
- * @param[out] response_json Allocated JSON response string (caller frees).
- * @param[out] status_code   HTTP status code for the response.
+ * @brief Set the city index and grid used to resolve nearest cities.
+ */
+void open_meteo_handler_set_city_lookup(const CityIndex* index,
+                                        const CityGrid*  grid) {
+    g_city_lookup_index = index;
+    g_city_lookup_grid  = grid;
+}
+
+/**
+ * @brief Write the nearest_city member for a coordinate.
+ * @internal
  *
- * @return 0 on success, -1 on error.
+ * Writes nothing if no lookup is configured or no city lies within
+ * NEAREST_CITY_MAX_KM.
  */
-int open_meteo_handler_current(const char* query_string, char** response_json,
-                               int* status_code) {
-    if (!response_json || !status_code) {
-        return -1;
+static void write_nearest_city(JsonWriter* writer, float lat, float lon) {
+    if (!g_city_lookup_index || !g_city_lookup_grid) {
+        return;
     }
 
-    *response_json = NULL;
-    *status_code   = HTTP_INTERNAL_ERROR;
-
-    /* Parse query parameters */
-    float lat, lon;
-    if (open_meteo_api_parse_query(query_string, &lat, &lon) != 0) {
-        *response_json = response_builder_error(
-            HTTP_BAD_REQUEST, response_builder_get_error_type(HTTP_BAD_REQUEST),
-            "Invalid query parameters. Expected format: "
-            "lat=XX.XXXX&lon=YY.YYYY");
-        *status_code = HTTP_BAD_REQUEST;
-        return -1;
+    CityGridMatch  match;
+    CityIndexEntry entry;
+    if (city_grid_nearest(g_city_lookup_grid, lat, lon, 1,
+                          NEAREST_CITY_MAX_KM, &match) == 0 ||
+        city_index_get(g_city_lookup_index, match.id, &entry) !=
+            CITY_INDEX_OK) {
+        return;
     }
 
-    /* Create location */
-    Location location = {
-        .latitude = lat, .longitude = lon, .name = "Query Location"};
+    json_write_key_object(writer, "nearest_city");
+    json_write_key_str(writer, "name", entry.name);
+    json_write_key_str(writer, "country", entry.country);
+    json_write_key_str(writer, "country_code", entry.country_code);
+    json_write_key_double(writer, "latitude", entry.latitude);
+    json_write_key_double(writer, "longitude", entry.longitude);
+    json_write_key_int(writer, "population", entry.population);
+    json_write_key_double(writer, "distance_km",
+                          round(match.distance_km * 10.0) / 10.0);
+    json_write_end_object(writer);
+}
 
-    /* Get current weather */
-    WeatherData* weather_data = NULL;
-    int          result = open_meteo_api_get_current(&location, &weather_data);
+/**
+ * @brief Per-request state for an asynchronous /v1/current lookup.
+ * @internal
+ */
+typedef struct {
+    OpenMeteoHandlerOnResponse callback;
+    void*                      context;
+    RequestArena*              arena; /* Owns this struct if set */
+    float                      latitude;
+    float                      longitude;
+} CurrentWeatherRequest;
 
-    if (result != 0 || !weather_data) {
-        *response_json = response_builder_error(
-            HTTP_INTERNAL_ERROR,
-            response_builder_get_error_type(HTTP_INTERNAL_ERROR),
-            "Failed to fetch weather data from Open-Meteo API");
-        *status_code = HTTP_INTERNAL_ERROR;
-        return -1;
+/**
+ * @brief Deliver a response to the caller and release the JSON string.
+ * @internal
+ *
+ * @param[in] cache_info Validators for a cacheable response, or NULL.
+ * @param[in] arena      Arena the string was built in, or NULL if it is a
+ *                       heap string to free.
+ */
+static void respond(OpenMeteoHandlerOnResponse callback, void* context,
+                    char* response_json, int status_code,
+                    const HttpCacheInfo* cache_info, RequestArena* arena) {
+    callback(response_json, status_code, cache_info, context);
+    if (!arena) {
+        free(response_json);
     }
+}
 
-    /* Build structured JSON response */
-    json_t* data = json_object();
+/**
+ * @brief Release request state that was not taken from an arena.
+ * @internal
+ */
+static void release_request(CurrentWeatherRequest* request) {
+    if (!request->arena) {
+        free(request);
+    }
+}
+
+/**
+ * @brief Build the /v1/current success body from weather data.
+ * @internal
+ *
+ * Rendered with the streaming writer; the layout matches what
+ * response_builder_success() produced for the equivalent jansson tree.
+ *
+ * @param[in] weather_data Weather data returned by the Open-Meteo client.
+ * @param[in] lat          Latitude from the request query.
+ * @param[in] lon          Longitude from the request query.
+ * @param[in] arena        Arena to render into, or NULL for the heap.
+ *
+ * @return JSON response string (arena-owned if arena is set), or NULL on
+ *         failure.
+ */
+static char* build_current_response(const WeatherData* weather_data, float lat,
+                                    float lon, RequestArena* arena) {
+    JsonWriter writer;
+    json_writer_initiate(&writer, arena);
+
+    json_write_begin_object(&writer);
+    json_write_key_bool(&writer, "success", true);
+    json_write_key_object(&writer, "data");
 
     /* Weather data - add first (order matches documentation) */
-    json_t* weather_obj = json_object();
-    json_object_set_new(weather_obj, "temperature",
-                        json_real(weather_data->temperature));
-    json_object_set_new(weather_obj, "temperature_unit",
-                        json_string(weather_data->temperature_unit));
-    json_object_set_new(weather_obj, "windspeed",
-                        json_real(weather_data->windspeed));
-    json_object_set_new(weather_obj, "windspeed_unit",
-                        json_string(weather_data->windspeed_unit));
-    json_object_set_new(weather_obj, "wind_direction_10m",
-                        json_integer(weather_data->winddirection));
-    json_object_set_new(weather_obj, "wind_direction_name",
-                        json_string(open_meteo_api_get_wind_direction(
-                            weather_data->winddirection)));
-    json_object_set_new(weather_obj, "weather_code",
-                        json_integer(weather_data->weather_code));
-    json_object_set_new(weather_obj, "weather_description",
-                        json_string(open_meteo_api_get_description(
-                            weather_data->weather_code)));
-    json_object_set_new(weather_obj, "is_day",
-                        json_integer(weather_data->is_day ? 1 : 0));
-    json_object_set_new(weather_obj, "precipitation",
-                        json_real(weather_data->precipitation));
-    json_object_set_new(weather_obj, "precipitation_unit", json_string("mm"));
-    json_object_set_new(weather_obj, "humidity",
-                        json_real(weather_data->humidity));
-    json_object_set_new(weather_obj, "pressure",
-                        json_real(weather_data->pressure));
+    json_write_key_object(&writer, "current_weather");
+    json_write_key_double(&writer, "temperature", weather_data->temperature);
+    json_write_key_str(&writer, "temperature_unit",
+                       weather_data->temperature_unit);
+    json_write_key_double(&writer, "windspeed", weather_data->windspeed);
+    json_write_key_str(&writer, "windspeed_unit",
+                       weather_data->windspeed_unit);
+    json_write_key_int(&writer, "wind_direction_10m",
+                       weather_data->winddirection);
+    json_write_key_str(
+        &writer, "wind_direction_name",
+        open_meteo_api_get_wind_direction(weather_data->winddirection));
+    json_write_key_int(&writer, "weather_code", weather_data->weather_code);
+    json_write_key_str(
+        &writer, "weather_description",
+        open_meteo_api_get_description(weather_data->weather_code));
+    json_write_key_int(&writer, "is_day", weather_data->is_day ? 1 : 0);
+    json_write_key_double(&writer, "precipitation",
+                          weather_data->precipitation);
+    json_write_key_str(&writer, "precipitation_unit", "mm");
+    json_write_key_double(&writer, "humidity", weather_data->humidity);
+    json_write_key_double(&writer, "pressure", weather_data->pressure);
 
     /* Format time as "YYYY-MM-DDTHH:MM" */
     time_t     now     = time(NULL);
     struct tm* tm_info = localtime(&now);
     char       time_str[32];
     strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M", tm_info);
-    json_object_set_new(weather_obj, "time", json_string(time_str));
+    json_write_key_str(&writer, "time", time_str);
 
-    json_object_set_new(data, "current_weather", weather_obj);
+    json_write_end_object(&writer);
 
     /* Location information - add last */
-    json_t* location_obj = json_object();
-    json_object_set_new(location_obj, "latitude", json_real(lat));
-    json_object_set_new(location_obj, "longitude", json_real(lon));
-    json_object_set_new(data, "location", location_obj);
+    json_write_key_object(&writer, "location");
+    json_write_key_double(&writer, "latitude", lat);
+    json_write_key_double(&writer, "longitude", lon);
+    write_nearest_city(&writer, lat, lon);
+    json_write_end_object(&writer);
+
+    json_write_end_object(&writer); /* data */
+    json_write_end_object(&writer);
 
-    /* Cleanup weather data */
-    open_meteo_api_free_current(weather_data);
+    return json_writer_finish(&writer, NULL);
+}
 
-    /* Build standardized response */
-    *response_json = response_builder_success(data);
+/**
+ * @brief Weather lookup completion callback.
+ * @internal
+ *
+ * Invoked by open_meteo_api_get_current_async(), either synchronously on a
+ * cache hit or later from the http_client response callback.
+ */
+static void on_current_weather(int result, const WeatherData* weather_data,
+                               void* context) {
+    CurrentWeatherRequest* request = (CurrentWeatherRequest*)context;
 
-    if (!*response_json) {
-        json_decref(data);
-        *status_code = HTTP_INTERNAL_ERROR;
+    if (result != 0 || !weather_data) {
+        respond(request->callback, request->context,
+                response_builder_error(
+                    HTTP_INTERNAL_ERROR,
+                    response_builder_get_error_type(HTTP_INTERNAL_ERROR),
+                    "Failed to fetch weather data from Open-Meteo API"),
+                HTTP_INTERNAL_ERROR, NULL, NULL);
+        release_request(request);
+        return;
+    }
+
+    char* response_json =
+        build_current_response(weather_data, request->latitude,
+                               request->longitude, request->arena);
+
+    /* Fresh for as long as the weather entry the body was built from */
+    char          cache_key[OPEN_METEO_CACHE_KEY_LENGTH];
+    HttpCacheInfo cache_info = {0};
+    bool          cacheable =
+        response_json &&
+        open_meteo_api_cache_key(request->latitude, request->longitude,
+                                 cache_key, sizeof(cache_key)) == 0 &&
+        open_meteo_api_cache_times(cache_key, &cache_info.last_modified,
+                                   &cache_info.expires_at) == 0;
+
+    respond(request->callback, request->context, response_json,
+            response_json ? HTTP_OK : HTTP_INTERNAL_ERROR,
+            cacheable ? &cache_info : NULL, request->arena);
+
+    release_request(request);
+}
+
+/**
+ * @brief Handle GET /v1/current endpoint request asynchronously.
+ *
+ * Parses latitude and longitude from query string and starts a
+ * non-blocking weather lookup. The response is delivered via callback.
+ *
+ * @param[in] query_string URL query parameters containing lat and lon.
+ * @param[in] arena        Request arena, or NULL to use the heap.
+ * @param[in] callback     Completion callback (required).
+ * @param[in] context      User context passed to the callback.
+ *
+ * @return 0 if the request was accepted, -1 on error.
+ */
+int open_meteo_handler_current_async(const char*                query_string,
+                                     RequestArena*              arena,
+                                     OpenMeteoHandlerOnResponse callback,
+                                     void*                      context) {
+    if (!callback) {
+        return -1;
+    }
+
+    /* Parse query parameters */
+    float lat, lon;
+    if (open_meteo_api_parse_query(query_string, &lat, &lon) != 0) {
+        respond(callback, context,
+                response_builder_error(
+                    HTTP_BAD_REQUEST,
+                    response_builder_get_error_type(HTTP_BAD_REQUEST),
+                    "Invalid query parameters. Expected format: "
+                    "lat=XX.XXXX&lon=YY.YYYY"),
+                HTTP_BAD_REQUEST, NULL, NULL);
         return -1;
     }
 
-    *status_code = HTTP_OK;
+    CurrentWeatherRequest* request =
+        arena ? request_arena_alloc(arena, sizeof(CurrentWeatherRequest))
+              : malloc(sizeof(CurrentWeatherRequest));
+    if (!request) {
+        respond(callback, context, NULL, HTTP_INTERNAL_ERROR, NULL, NULL);
+        return -1;
+    }
+
+    request->callback  = callback;
+    request->context   = context;
+    request->arena     = arena;
+    request->latitude  = lat;
+    request->longitude = lon;
+
+    /* Create location */
+    Location location = {
+        .latitude = lat, .longitude = lon, .name = "Query Location"};
+
+    /* Errors are reported through on_current_weather */
+    open_meteo_api_get_current_async(&location, on_current_weather, request);
+
     return 0;
 }
 
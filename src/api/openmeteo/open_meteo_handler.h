@@ -18,6 +18,11 @@
 #ifndef OPEN_METEO_HANDLER_H
 #define OPEN_METEO_HANDLER_H
 
+#include "city_grid.h"
+#include "city_index.h"
+#include "http_cache.h"
+#include "request_arena.h"
+
 /**
  * @brief Initialize the Open-Meteo handler module.
  *
@@ -25,6 +30,8 @@
  * - Cache directory: ./cache/weather_cache
  * - Cache TTL: 900 seconds (15 minutes)
  * - Caching enabled
+ * - Coordinates snapped to a 0.01 degree grid (~1 km), so nearby requests
+ *   share one cache entry; responses still echo the requested coordinates
  *
  * This function must be called before any other handler functions.
  *
@@ -35,24 +42,61 @@
 int open_meteo_handler_init(void);
 
 /**
- * @brief Handle GET /v1/current endpoint request.
+ * @brief Enable reverse geocoding for /v1/current responses.
+ *
+ * When set, successful responses include a location.nearest_city object
+ * for the closest known city within 50 km, resolved locally from the grid.
+ *
+ * @param[in] index City index the grid was built from (NULL disables).
+ * @param[in] grid  Spatial grid over index (NULL disables).
+ *
+ * @note Both must stay valid until cleared or the handler is cleaned up.
+ */
+void open_meteo_handler_set_city_lookup(const CityIndex* index,
+                                        const CityGrid*  grid);
+
+/**
+ * @brief Callback invoked when a handler response is ready.
+ *
+ * @param[in] response_json Null-terminated JSON response, or NULL if the
+ *                          response could not be built. Owned by the handler
+ *                          and only valid for the duration of the callback.
+ * @param[in] status_code   HTTP status code for the response.
+ * @param[in] cache_info    Validators and freshness of a successful
+ *                          response (see http_cache_send()), or NULL if it
+ *                          must not be cached.
+ * @param[in] context       User context passed to the handler.
+ *
+ * @return Currently unused.
+ */
+typedef int (*OpenMeteoHandlerOnResponse)(char* response_json, int status_code,
+                                          const HttpCacheInfo* cache_info,
+                                          void*                context);
+
+/**
+ * @brief Handle GET /v1/current endpoint request asynchronously.
  *
  * Processes a request for current weather data at specified coordinates.
- * Parses query parameters, fetches weather data from Open-Meteo API,
- * and builds a standardized JSON response.
+ * Parses query parameters, starts a non-blocking weather lookup, and builds
+ * a standardized JSON response once the data is available.
+ *
+ * The callback is invoked exactly once: synchronously for invalid queries
+ * and cache hits, or later from the upstream HTTP response callback. The
+ * event loop is never blocked waiting for Open-Meteo.
  *
- * @param[in]  query_string  Query parameters string (e.g.,
+ * @param[in] query_string Query parameters string (e.g.,
  * "lat=37.7749&lon=-122.4194"). Must contain valid 'lat' and 'lon' parameters.
- * @param[out] response_json Pointer to receive the allocated JSON response
- * string. Caller is responsible for freeing this memory. Set to NULL on entry,
- * always set on return (even on error).
- * @param[out] status_code   Pointer to receive the HTTP status code.
- *                           Will be set to HTTP_OK (200), HTTP_BAD_REQUEST
- * (400), or HTTP_INTERNAL_ERROR (500).
+ * @param[in] arena        Request arena for the request state and the
+ *                         response body (must outlive the callback), or NULL
+ *                         to use the heap.
+ * @param[in] callback     Callback receiving the response. Must not be NULL.
+ *                         Status is HTTP_OK (200), HTTP_BAD_REQUEST (400), or
+ *                         HTTP_INTERNAL_ERROR (500).
+ * @param[in] context      User context passed through to the callback.
  *
- * @return 0 on success, -1 on error.
+ * @return 0 if the lookup was started or answered, -1 on error.
  *
- * @note On error, response_json will contain a properly formatted error
+ * @note On error, the callback still receives a properly formatted error
  * response.
  *
  * @par Response Format (Success):
@@ -78,7 +122,16 @@ int open_meteo_handler_init(void);
  *     },
  *     "location": {
  *       "latitude": 37.7749,
- *       "longitude": -122.4194
+ *       "longitude": -122.4194,
+ *       "nearest_city": {
+ *         "name": "San Francisco",
+ *         "country": "United States",
+ *         "country_code": "US",
+ *         "latitude": 37.7558,
+ *         "longitude": -122.4449,
+ *         "population": 3364862,
+ *         "distance_km": 3.1
+ *       }
  *     }
  *   }
  * }
@@ -86,17 +139,21 @@ int open_meteo_handler_init(void);
  *
  * @par Example Usage:
  * @code{.c}
- * char* json = NULL;
- * int status = 0;
- * int result = open_meteo_handler_current("lat=37.7749&lon=-122.4194", &json,
- * &status); if (result == 0) { send_http_response(client_fd, status,
- * "application/json", json);
+ * static int on_response(char* json, int status,
+ *                        const HttpCacheInfo* cache_info, void* ctx) {
+ *     HTTPServerConnection* conn = ctx;
+ *     return http_cache_send(conn, status, "application/json", json,
+ *                            strlen(json), cache_info);
  * }
- * free(json);
+ *
+ * open_meteo_handler_current_async("lat=37.7749&lon=-122.4194", NULL,
+ *                                  on_response, conn);
  * @endcode
  */
-int open_meteo_handler_current(const char* query_string, char** response_json,
-                               int* status_code);
+int open_meteo_handler_current_async(const char*                query_string,
+                                     RequestArena*              arena,
+                                     OpenMeteoHandlerOnResponse callback,
+                                     void*                      context);
 
 /**
  * @brief Clean up the Open-Meteo handler module.
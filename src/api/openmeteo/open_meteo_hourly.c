@@ -0,0 +1,299 @@
+#include <cache_utils/file_cache.h>
+#include <cache_utils/single_flight.h>
+#include <http_pool.h>
+#include <jansson.h>
+#include <logger.h>
+#include <open_meteo_api.h>
+#include <open_meteo_hourly.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ============= Configuration ============= */
+
+#define API_BASE_URL "http://api.open-meteo.com/v1/forecast"
+#define API_HOURLY_PARAMS                                                      \
+    "&hourly=shortwave_radiation,cloud_cover,temperature_2m"                   \
+    "&past_days=1&forecast_days=2&timezone=GMT&timeformat=unixtime"
+#define CACHE_FILE_EXTENSION ".bin"
+#define CACHE_MEMORY_BYTES (2 * 1024 * 1024)
+#define CACHE_DISK_BYTES (16 * 1024 * 1024) /* Janitor budget for the files */
+
+/* Binary cache record: header followed by the raw HourlyForecast struct */
+#define HOURLY_RECORD_MAGIC 0x4857534Au /* "JSWH" */
+#define HOURLY_RECORD_VERSION 1
+
+/* ============= Internal Structures ============= */
+
+/* Per-fetch state carried through http_pool_get */
+typedef struct {
+    float latitude;
+    float longitude;
+    char  cache_key[FILE_CACHE_KEY_LENGTH];
+} HourlyRequestContext;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size; /* sizeof(HourlyForecast) of the writer */
+} HourlyRecordHeader;
+
+typedef struct {
+    HourlyRecordHeader header;
+    HourlyForecast     forecast;
+} HourlyRecord;
+
+/* ============= Global State ============= */
+
+static FileCacheInstance* g_hourly_cache   = NULL;
+static SingleFlightTable* g_hourly_flights = NULL;
+
+/* ============= Cache Records ============= */
+
+static int save_hourly_record(const char*           cache_key,
+                              const HourlyForecast* forecast) {
+    HourlyRecord record;
+    memset(&record, 0, sizeof(record));
+
+    record.header.magic   = HOURLY_RECORD_MAGIC;
+    record.header.version = HOURLY_RECORD_VERSION;
+    record.header.size    = sizeof(HourlyForecast);
+    record.forecast       = *forecast;
+
+    return file_cache_save(g_hourly_cache, cache_key, (const char*)&record,
+                           sizeof(record)) == FILE_CACHE_OK
+               ? 0
+               : -1;
+}
+
+/**
+ * Load a series from its cache record. Records written by another build
+ * (different magic, version or struct size) are rejected.
+ */
+static int load_hourly_record(const char* cache_key, HourlyForecast* out) {
+    char*  buffer = NULL;
+    size_t size   = 0;
+
+    if (!g_hourly_cache ||
+        file_cache_load(g_hourly_cache, cache_key, &buffer, &size) !=
+            FILE_CACHE_OK) {
+        return -1;
+    }
+
+    const HourlyRecord* record = (const HourlyRecord*)buffer;
+    if (size != sizeof(HourlyRecord) ||
+        record->header.magic != HOURLY_RECORD_MAGIC ||
+        record->header.version != HOURLY_RECORD_VERSION ||
+        record->header.size != sizeof(HourlyForecast)) {
+        free(buffer);
+        return -2;
+    }
+
+    *out = record->forecast;
+    free(buffer);
+    return 0;
+}
+
+/* ============= Parsing ============= */
+
+/**
+ * Read one hourly variable into out. offset skips leading values, which
+ * shifts Open-Meteo's "mean of the preceding hour" onto the hour it
+ * describes.
+ */
+static void parse_series(const json_t* hourly, const char* name, size_t offset,
+                         size_t count, float* out) {
+    const json_t* values = json_object_get(hourly, name);
+    for (size_t i = 0; i < count; i++) {
+        /* null (no data) reads as 0 */
+        out[i] = (float)json_number_value(json_array_get(values, i + offset));
+    }
+}
+
+static int parse_hourly_json(const char* json_str, float lat, float lon,
+                             HourlyForecast* out) {
+    json_error_t error;
+    json_t*      root = json_loadb(json_str, strlen(json_str), 0, &error);
+    if (!root) {
+        return -1;
+    }
+
+    const json_t* hourly = json_object_get(root, "hourly");
+    const json_t* times  = json_object_get(hourly, "time");
+    size_t        count  = json_array_size(times);
+    if (!json_is_array(times) || count < 2 ||
+        !json_is_integer(json_array_get(times, 0))) {
+        json_decref(root);
+        return -1;
+    }
+
+    /* The last radiation value describes the hour before it */
+    count = count - 1;
+    if (count > OPEN_METEO_HOURLY_MAX) {
+        count = OPEN_METEO_HOURLY_MAX;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->latitude   = lat;
+    out->longitude  = lon;
+    out->start      = (time_t)json_integer_value(json_array_get(times, 0));
+    out->count      = count;
+    out->fetched_at = time(NULL);
+
+    parse_series(hourly, "shortwave_radiation", 1, count, out->radiation);
+    parse_series(hourly, "cloud_cover", 0, count, out->cloud_cover);
+    parse_series(hourly, "temperature_2m", 0, count, out->temperature);
+
+    json_decref(root);
+    return 0;
+}
+
+/* ============= Upstream Fetch ============= */
+
+static void deliver_hourly(SingleFlightCallback callback, void* context,
+                           int result, const void* value) {
+    OpenMeteoOnHourly on_hourly = (OpenMeteoOnHourly)callback;
+    on_hourly(result, (const HourlyForecast*)value, context);
+}
+
+static void hourly_fetch_callback(const char* event, const char* response,
+                                  void* context) {
+    HourlyRequestContext* ctx = (HourlyRequestContext*)context;
+    if (!ctx) {
+        return;
+    }
+
+    if (strcmp(event, "RESPONSE") == 0 && response) {
+        HourlyForecast forecast;
+        if (parse_hourly_json(response, ctx->latitude, ctx->longitude,
+                              &forecast) != 0) {
+            LOGGER_ERROR("[METEO] Failed to parse hourly response");
+            single_flight_complete(g_hourly_flights, ctx->cache_key, -4,
+                                   NULL);
+        } else {
+            if (save_hourly_record(ctx->cache_key, &forecast) != 0) {
+                LOGGER_ERROR("[METEO] Failed to save hourly record");
+            }
+            LOGGER_DEBUG("[METEO] Fetched %zu hourly values", forecast.count);
+            single_flight_complete(g_hourly_flights, ctx->cache_key, 0,
+                                   &forecast);
+        }
+    } else if (strcmp(event, "ERROR") == 0 || strcmp(event, "TIMEOUT") == 0) {
+        LOGGER_ERROR("[METEO] Hourly fetch failed: %s", event);
+        single_flight_complete(g_hourly_flights, ctx->cache_key, -3, NULL);
+    } else {
+        return; /* Intermediate event, request still in flight */
+    }
+
+    free(ctx);
+}
+
+/**
+ * Start the upstream fetch for a flight led by the caller. Every outcome,
+ * including a failure to start, completes the flight for cache_key.
+ */
+static int fetch_hourly_async(float lat, float lon, const char* cache_key) {
+    HourlyRequestContext* ctx = malloc(sizeof(HourlyRequestContext));
+    if (!ctx) {
+        single_flight_complete(g_hourly_flights, cache_key, -1, NULL);
+        return -1;
+    }
+
+    ctx->latitude  = lat;
+    ctx->longitude = lon;
+    snprintf(ctx->cache_key, sizeof(ctx->cache_key), "%s", cache_key);
+
+    const char* base = getenv(OPEN_METEO_URL_ENV);
+    char        url[512];
+    snprintf(url, sizeof(url),
+             "%s?latitude=%.6f&longitude=%.6f" API_HOURLY_PARAMS,
+             base && base[0] ? base : API_BASE_URL, lat, lon);
+
+    LOGGER_DEBUG("[METEO] Fetching: %s", url);
+
+    if (http_pool_get(url, NULL, 30000, hourly_fetch_callback, ctx) < 0) {
+        single_flight_complete(g_hourly_flights, ctx->cache_key, -2, NULL);
+        free(ctx);
+        return -2;
+    }
+
+    return 0;
+}
+
+/* ============= Public API ============= */
+
+int open_meteo_hourly_init(void) {
+    if (g_hourly_flights) {
+        return 0;
+    }
+
+    FileCacheConfig cache_cfg = {.cache_dir    = OPEN_METEO_HOURLY_CACHE_DIR,
+                                 .ttl_seconds  = OPEN_METEO_HOURLY_TTL,
+                                 .enabled      = true,
+                                 .memory_bytes = CACHE_MEMORY_BYTES,
+                                 .extension    = CACHE_FILE_EXTENSION,
+                                 .write_behind = true,
+                                 .disk_bytes   = CACHE_DISK_BYTES};
+
+    g_hourly_cache = file_cache_create(&cache_cfg);
+    if (!g_hourly_cache) {
+        LOGGER_WARN("[METEO] Warning: Failed to initialize hourly cache");
+    }
+
+    g_hourly_flights = single_flight_create(deliver_hourly);
+    if (!g_hourly_flights) {
+        LOGGER_ERROR("[METEO] Failed to create hourly fetch table");
+        file_cache_destroy(g_hourly_cache);
+        g_hourly_cache = NULL;
+        return -1;
+    }
+
+    LOGGER_INFO("[METEO] Hourly forecasts initialized (%s)",
+                OPEN_METEO_HOURLY_CACHE_DIR);
+    return 0;
+}
+
+void open_meteo_hourly_cleanup(void) {
+    /* Fetches still in flight complete into a NULL table and are dropped */
+    single_flight_destroy(g_hourly_flights);
+    g_hourly_flights = NULL;
+    file_cache_destroy(g_hourly_cache);
+    g_hourly_cache = NULL;
+}
+
+int open_meteo_hourly_get_async(float latitude, float longitude,
+                                OpenMeteoOnHourly callback, void* context) {
+    if (!callback) {
+        return -1;
+    }
+
+    char key_input[64];
+    char cache_key[FILE_CACHE_KEY_LENGTH];
+    snprintf(key_input, sizeof(key_input), "hourly_%.6f_%.6f", latitude,
+             longitude);
+    if (!g_hourly_flights ||
+        file_cache_generate_key(g_hourly_cache, key_input, cache_key,
+                                sizeof(cache_key)) != FILE_CACHE_OK) {
+        callback(-1, NULL, context);
+        return -1;
+    }
+
+    HourlyForecast forecast;
+    if (load_hourly_record(cache_key, &forecast) == 0) {
+        callback(0, &forecast, context);
+        return 0;
+    }
+
+    int role = single_flight_join(g_hourly_flights, cache_key,
+                                  (SingleFlightCallback)callback, context);
+    if (role == SINGLE_FLIGHT_ERROR) {
+        callback(-1, NULL, context);
+        return -1;
+    }
+    if (role == SINGLE_FLIGHT_WAITER) {
+        return 0;
+    }
+
+    return fetch_hourly_async(latitude, longitude, cache_key) == 0 ? 0 : -1;
+}
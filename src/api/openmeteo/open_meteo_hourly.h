@@ -0,0 +1,57 @@
+/* open_meteo_hourly.h - Hourly Open-Meteo forecast series for planning
+ *
+ * Fetches shortwave radiation, cloud cover and temperature for one point,
+ * one value per hour from yesterday 00:00 UTC through tomorrow, and keeps
+ * them as parallel float arrays (one per variable) so consumers can run
+ * straight loops over them. Series are cached in memory and on disk for
+ * OPEN_METEO_HOURLY_TTL, and concurrent misses for the same point share
+ * one upstream request.
+ *
+ * Coordinates are used as given; callers snap them to the grid they share
+ * entries on. The forecast endpoint honours OPEN_METEO_URL_ENV. */
+
+#ifndef OPEN_METEO_HOURLY_H
+#define OPEN_METEO_HOURLY_H
+
+#include <stddef.h>
+#include <time.h>
+
+#define OPEN_METEO_HOURLY_MAX 96   /* Hourly values kept per series */
+#define OPEN_METEO_HOURLY_TTL 3600 /* Open-Meteo models update hourly */
+#define OPEN_METEO_HOURLY_CACHE_DIR "./cache/hourly_cache"
+
+/* One forecast point; value i holds for the hour starting at
+ * start + i * 3600. Radiation is the mean over that hour, cloud cover and
+ * temperature are the values at its start. */
+typedef struct {
+    float  latitude;
+    float  longitude;
+    time_t start; /* UTC, on the hour */
+    size_t count;
+    time_t fetched_at;
+    float  radiation[OPEN_METEO_HOURLY_MAX];   /* Global horizontal, W/m2 */
+    float  cloud_cover[OPEN_METEO_HOURLY_MAX]; /* Percent */
+    float  temperature[OPEN_METEO_HOURLY_MAX]; /* 2 m air, degrees C */
+} HourlyForecast;
+
+/* Callback invoked when an hourly lookup completes. result is 0 on success
+ * and negative on error (forecast is NULL then). forecast is only valid for
+ * the duration of the callback. */
+typedef void (*OpenMeteoOnHourly)(int result, const HourlyForecast* forecast,
+                                  void* context);
+
+/* Create the cache and fetch table. Safe to call more than once.
+ * Returns 0 on success, -1 on failure. */
+int open_meteo_hourly_init(void);
+
+/* Release the cache; fetches still in flight are dropped */
+void open_meteo_hourly_cleanup(void);
+
+/* Look up the series for a point without blocking the event loop. Cache
+ * hits invoke the callback before returning, misses from the upstream
+ * response. Returns 0 if the lookup was answered or started, -1 on error
+ * (the callback has received the error). */
+int open_meteo_hourly_get_async(float latitude, float longitude,
+                                OpenMeteoOnHourly callback, void* context);
+
+#endif /* OPEN_METEO_HOURLY_H */
@@ -4,10 +4,17 @@
 
 #include "file_cache.h"
 
+#include "event_loop.h"
+#include "logger.h"
+#include "memory_cache.h"
+#include "metrics.h"
+
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <hash_md5.h>
 #include <jansson.h>
+#include <smw.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,14 +22,105 @@
 #include <time.h>
 #include <unistd.h>
 
+#define FILE_CACHE_DEFAULT_EXTENSION ".json"
+#define FILE_CACHE_MAX_EXTENSION 16
+#define FILE_CACHE_TMP_SUFFIX ".tmp"
+
+/* Shard directories "00".."ff", from the first two key characters */
+#define FILE_CACHE_SHARD_COUNT 256
+
+#define FILE_CACHE_QUEUE_MAX 512      /* Further saves write synchronously */
+#define FILE_CACHE_WRITES_PER_TICK 16 /* Files the writer task writes a tick */
+
+/* One shard per instance per interval: a full pass takes about a minute */
+#define FILE_CACHE_JANITOR_INTERVAL_MS 250
+#define FILE_CACHE_TMP_GRACE_SECONDS 60 /* Older temp files are crash debris */
+
+/* Memory tier snapshot: header, then one record per entry, each followed
+ * by the key (without terminator) and the data */
+#define FILE_CACHE_SNAPSHOT_MAGIC 0x534D574Au /* "JWMS" */
+#define FILE_CACHE_SNAPSHOT_VERSION 1
+#define FILE_CACHE_SNAPSHOT_MAX_ENTRY (64 * 1024 * 1024)
+
 /* ============= Internal Structure ============= */
 
 struct FileCacheInstance {
-    char cache_dir[FILE_CACHE_MAX_PATH_LENGTH];
-    int  ttl_seconds;
-    bool enabled;
+    char         cache_dir[FILE_CACHE_MAX_PATH_LENGTH];
+    int          ttl_seconds;
+    int          hard_ttl_seconds; /* >= ttl_seconds */
+    bool         enabled;
+    char         extension[FILE_CACHE_MAX_EXTENSION];
+    MemoryCache* memory; /* Optional in-process tier, NULL when disabled */
+    bool         write_behind;
+    size_t       queued; /* Entries of this instance in the write queue */
+
+    /* Janitor: next shard to visit (FILE_CACHE_SHARD_COUNT is the flat
+     * directory of older builds) and the bytes each shard held when it
+     * was last visited */
+    size_t   disk_bytes;
+    unsigned janitor_shard;
+    uint64_t disk_estimate;
+    uint64_t shard_bytes[FILE_CACHE_SHARD_COUNT];
+
+    struct FileCacheInstance* next; /* Live instances, for file_cache_next */
+
+    MetricsCounter memory_hits;
+    MetricsCounter disk_hits;
+    MetricsCounter misses;
+    MetricsCounter expired;
+    MetricsCounter stale;
+    MetricsCounter writes;
+    MetricsCounter write_errors;
+    MetricsCounter evictions;
 };
 
+/* A save waiting for the writer task; it owns a copy of the data */
+typedef struct PendingWrite {
+    FileCacheInstance*   cache;
+    char                 key[FILE_CACHE_KEY_LENGTH];
+    char*                data;
+    size_t               size;
+    time_t               saved_at;
+    struct PendingWrite* next;
+} PendingWrite;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+} SnapshotHeader;
+
+typedef struct {
+    int64_t  expires_at;
+    uint32_t key_length;
+    uint32_t size;
+} SnapshotRecord;
+
+typedef struct {
+    FILE* fp;
+    int   count;
+    bool  failed;
+} SnapshotWriter;
+
+/* A file the janitor may evict for the size budget */
+typedef struct {
+    char   name[64];
+    time_t mtime;
+    off_t  size;
+} ShardFile;
+
+/* ============= Global State ============= */
+
+static FileCacheInstance* g_instances = NULL;
+
+/* Write queue shared by all write-behind instances, oldest first */
+static PendingWrite* g_queue_head   = NULL;
+static PendingWrite* g_queue_tail   = NULL;
+static size_t        g_queue_length = 0;
+
+static SmwTask* g_writer_task            = NULL;
+static size_t   g_write_behind_instances = 0;
+static uint64_t g_janitor_last_ms        = 0;
+
 /* ============= Internal Helpers ============= */
 
 /**
@@ -68,30 +166,445 @@ static int mkdir_recursive(const char* path, mode_t mode) {
 }
 
 /**
- * Build full filepath for cache entry
+ * Build full filepath for cache entry, inside its shard directory
  */
 static void build_filepath(const FileCacheInstance* cache,
                            const char* cache_key, char* out_path,
                            size_t path_size) {
-    snprintf(out_path, path_size, "%s/%s.json", cache->cache_dir, cache_key);
+    snprintf(out_path, path_size, "%s/%.2s/%s%s", cache->cache_dir,
+             cache_key, cache_key, cache->extension);
+}
+
+static bool has_suffix(const char* name, const char* suffix) {
+    size_t name_len   = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return name_len > suffix_len &&
+           strcmp(name + name_len - suffix_len, suffix) == 0;
 }
 
 /**
- * Check if file exists and is within TTL
+ * Write an entry to a temporary file and rename it into place, so readers
+ * see either the old file or the complete new one. The file gets saved_at
+ * as its mtime, which the TTL checks read.
  */
-static bool is_file_valid(const char* filepath, int ttl_seconds) {
+static FileCacheResult write_entry_file(FileCacheInstance* cache,
+                                        const char*        cache_key,
+                                        const char* data, size_t data_size,
+                                        time_t saved_at) {
+    char filepath[FILE_CACHE_MAX_PATH_LENGTH];
+    char tmppath[FILE_CACHE_MAX_PATH_LENGTH + 32];
+    build_filepath(cache, cache_key, filepath, sizeof(filepath));
+
+    /* Workers share the directory; the pid keeps their temp files apart */
+    snprintf(tmppath, sizeof(tmppath), "%s.%ld" FILE_CACHE_TMP_SUFFIX,
+             filepath, (long)getpid());
+
+    int fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == ENOENT) {
+        /* First entry of this shard */
+        char shard[FILE_CACHE_MAX_PATH_LENGTH];
+        snprintf(shard, sizeof(shard), "%s/%.2s", cache->cache_dir,
+                 cache_key);
+        if (mkdir(shard, 0755) == 0 || errno == EEXIST) {
+            fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        }
+    }
+
+    if (fd < 0) {
+        metrics_counter_add(&cache->write_errors, 1);
+        return FILE_CACHE_ERROR_IO;
+    }
+
+    size_t written = 0;
+    while (written < data_size) {
+        ssize_t n = write(fd, data + written, data_size - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += (size_t)n;
+    }
+
+    struct timespec times[2] = {{.tv_sec = saved_at}, {.tv_sec = saved_at}};
+    futimens(fd, times);
+
+    bool complete = written == data_size;
+    complete      = close(fd) == 0 && complete;
+
+    if (!complete || rename(tmppath, filepath) != 0) {
+        unlink(tmppath);
+        metrics_counter_add(&cache->write_errors, 1);
+        return FILE_CACHE_ERROR_IO;
+    }
+
+    metrics_counter_add(&cache->writes, 1);
+    return FILE_CACHE_OK;
+}
+
+/* ============= Write Queue ============= */
+
+static PendingWrite* find_pending(const FileCacheInstance* cache,
+                                  const char* cache_key, PendingWrite** prev) {
+    PendingWrite* before = NULL;
+    if (cache->queued > 0) {
+        for (PendingWrite* pending = g_queue_head; pending;
+             pending               = pending->next) {
+            if (pending->cache == cache &&
+                strcmp(pending->key, cache_key) == 0) {
+                if (prev) {
+                    *prev = before;
+                }
+                return pending;
+            }
+            before = pending;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Unlink a queued save (prev precedes it, NULL at the head) and free it
+ */
+static void queue_drop(PendingWrite* prev, PendingWrite* pending) {
+    if (prev) {
+        prev->next = pending->next;
+    } else {
+        g_queue_head = pending->next;
+    }
+    if (g_queue_tail == pending) {
+        g_queue_tail = prev;
+    }
+
+    g_queue_length--;
+    pending->cache->queued--;
+    free(pending->data);
+    free(pending);
+}
+
+/**
+ * Queue a save for the writer task. A save of a key that is still queued
+ * replaces the queued data.
+ *
+ * @return false if the save has to be written synchronously instead
+ */
+static bool queue_write(FileCacheInstance* cache, const char* cache_key,
+                        const char* data, size_t data_size, time_t saved_at) {
+    if (!g_writer_task || strlen(cache_key) >= FILE_CACHE_KEY_LENGTH) {
+        return false;
+    }
+
+    PendingWrite* pending = find_pending(cache, cache_key, NULL);
+    if (!pending && g_queue_length >= FILE_CACHE_QUEUE_MAX) {
+        return false;
+    }
+
+    char* copy = malloc(data_size ? data_size : 1);
+    if (!copy) {
+        return false;
+    }
+    memcpy(copy, data, data_size);
+
+    if (!pending) {
+        pending = calloc(1, sizeof(PendingWrite));
+        if (!pending) {
+            free(copy);
+            return false;
+        }
+
+        pending->cache = cache;
+        snprintf(pending->key, sizeof(pending->key), "%s", cache_key);
+        if (g_queue_tail) {
+            g_queue_tail->next = pending;
+        } else {
+            g_queue_head = pending;
+        }
+        g_queue_tail = pending;
+        g_queue_length++;
+        cache->queued++;
+    }
+
+    free(pending->data);
+    pending->data     = copy;
+    pending->size     = data_size;
+    pending->saved_at = saved_at;
+    return true;
+}
+
+/**
+ * Remove every queued save of an instance, writing it out first if asked
+ *
+ * @return Number of failed writes
+ */
+static int queue_drain(FileCacheInstance* cache, bool write_out) {
+    int           errors  = 0;
+    PendingWrite* prev    = NULL;
+    PendingWrite* pending = g_queue_head;
+
+    while (pending && cache->queued > 0) {
+        PendingWrite* next = pending->next;
+        if (pending->cache != cache) {
+            prev    = pending;
+            pending = next;
+            continue;
+        }
+
+        if (write_out && write_entry_file(cache, pending->key, pending->data,
+                                          pending->size, pending->saved_at) !=
+                             FILE_CACHE_OK) {
+            errors++;
+        }
+        queue_drop(prev, pending);
+        pending = next;
+    }
+
+    return errors;
+}
+
+/* ============= Janitor ============= */
+
+static int compare_oldest(const void* a, const void* b) {
+    const ShardFile* left  = a;
+    const ShardFile* right = b;
+    return (left->mtime > right->mtime) - (left->mtime < right->mtime);
+}
+
+/**
+ * Remove this cache's files from a directory, or with only_expired just
+ * those past the hard TTL. Temp files go only once they are older than
+ * FILE_CACHE_TMP_GRACE_SECONDS, either way: another worker may still be
+ * writing one, such as its snapshot. With only_expired and a disk_bytes
+ * budget, the oldest remaining files are evicted too, until no more than
+ * keep_bytes are left.
+ *
+ * @return Bytes the directory still holds
+ */
+static uint64_t sweep_directory(FileCacheInstance* cache, const char* path,
+                                bool only_expired, uint64_t keep_bytes,
+                                int* errors) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        if (errno != ENOENT && errors) {
+            (*errors)++;
+        }
+        return 0;
+    }
+
+    bool           budget   = only_expired && cache->disk_bytes > 0;
+    ShardFile*     files    = NULL;
+    size_t         count    = 0;
+    size_t         capacity = 0;
+    uint64_t       bytes    = 0;
+    time_t         now      = time(NULL);
+    char           filepath[FILE_CACHE_MAX_PATH_LENGTH];
+    struct dirent* entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        bool temporary = has_suffix(entry->d_name, FILE_CACHE_TMP_SUFFIX);
+        if (!temporary && !has_suffix(entry->d_name, cache->extension)) {
+            continue; /* Not ours (also skips ".", ".." and shards) */
+        }
+
+        int written = snprintf(filepath, sizeof(filepath), "%s/%s", path,
+                               entry->d_name);
+        if (written < 0 || (size_t)written >= sizeof(filepath)) {
+            continue; /* Path too long, skip */
+        }
+
+        struct stat file_stat;
+        if (stat(filepath, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+            continue;
+        }
+
+        double age    = difftime(now, file_stat.st_mtime);
+        bool   expire = temporary ? age > FILE_CACHE_TMP_GRACE_SECONDS
+                                  : !only_expired ||
+                                        age > cache->hard_ttl_seconds;
+        if (expire) {
+            if (unlink(filepath) != 0) {
+                if (errors) {
+                    (*errors)++;
+                }
+            } else if (only_expired && !temporary) {
+                metrics_counter_add(&cache->evictions, 1);
+            }
+            continue;
+        }
+
+        if (temporary) {
+            continue; /* Probably being written right now */
+        }
+
+        bytes += (uint64_t)file_stat.st_size;
+        if (budget && strlen(entry->d_name) < sizeof(files[0].name)) {
+            if (count == capacity) {
+                size_t     grown = capacity ? capacity * 2 : 64;
+                ShardFile* more  = realloc(files, grown * sizeof(ShardFile));
+                if (!more) {
+                    continue;
+                }
+                files    = more;
+                capacity = grown;
+            }
+            snprintf(files[count].name, sizeof(files[count].name), "%s",
+                     entry->d_name);
+            files[count].mtime = file_stat.st_mtime;
+            files[count].size  = file_stat.st_size;
+            count++;
+        }
+    }
+
+    closedir(dir);
+
+    /* Over its share of the budget: the oldest entries go first */
+    if (budget && bytes > keep_bytes) {
+        qsort(files, count, sizeof(ShardFile), compare_oldest);
+        for (size_t i = 0; i < count && bytes > keep_bytes; i++) {
+            snprintf(filepath, sizeof(filepath), "%s/%s", path,
+                     files[i].name);
+            if (unlink(filepath) == 0) {
+                bytes -= (uint64_t)files[i].size;
+                metrics_counter_add(&cache->evictions, 1);
+            }
+        }
+    }
+
+    free(files);
+    return bytes;
+}
+
+/**
+ * Visit the next shard of an instance
+ */
+static void janitor_step(FileCacheInstance* cache) {
+    unsigned shard       = cache->janitor_shard;
+    cache->janitor_shard = (shard + 1) % (FILE_CACHE_SHARD_COUNT + 1);
+
+    if (shard == FILE_CACHE_SHARD_COUNT) {
+        /* Unsharded files of older builds are never read again */
+        sweep_directory(cache, cache->cache_dir, false, 0, NULL);
+        return;
+    }
+
+    /* Keys are uniform hashes, so evenly shared budgets approximate
+     * evicting the oldest entries of the whole cache */
+    uint64_t keep = UINT64_MAX;
+    if (cache->disk_bytes > 0 && cache->disk_estimate > cache->disk_bytes) {
+        keep = cache->disk_bytes / FILE_CACHE_SHARD_COUNT;
+    }
+
+    char path[FILE_CACHE_MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%02x", cache->cache_dir, shard);
+
+    uint64_t bytes = sweep_directory(cache, path, true, keep, NULL);
+    cache->disk_estimate += bytes - cache->shard_bytes[shard];
+    cache->shard_bytes[shard] = bytes;
+}
+
+/**
+ * Background task: write a batch of queued saves, then let the janitor
+ * visit one shard of every write-behind instance once per interval
+ */
+static void writer_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+
+    for (size_t i = 0; i < FILE_CACHE_WRITES_PER_TICK && g_queue_head; i++) {
+        PendingWrite* pending = g_queue_head;
+        if (write_entry_file(pending->cache, pending->key, pending->data,
+                             pending->size,
+                             pending->saved_at) != FILE_CACHE_OK) {
+            LOGGER_ERROR("[FILE_CACHE] Failed to write entry to: %s",
+                         pending->cache->cache_dir);
+        }
+        queue_drop(NULL, pending);
+    }
+    if (g_queue_head) {
+        event_loop_schedule(mon_time); /* Drain the backlog without sleeping */
+    }
+
+    if (mon_time - g_janitor_last_ms < FILE_CACHE_JANITOR_INTERVAL_MS) {
+        return;
+    }
+    g_janitor_last_ms = mon_time;
+
+    for (FileCacheInstance* cache = g_instances; cache; cache = cache->next) {
+        if (cache->write_behind) {
+            janitor_step(cache);
+        }
+    }
+}
+
+/**
+ * Check if file exists and is within TTL. out_mtime (optional) receives the
+ * file modification time.
+ */
+static bool is_file_valid(const char* filepath, int ttl_seconds,
+                          time_t* out_mtime) {
     struct stat file_stat;
 
     if (stat(filepath, &file_stat) != 0) {
         return false; /* File does not exist */
     }
 
+    if (out_mtime) {
+        *out_mtime = file_stat.st_mtime;
+    }
+
     time_t now = time(NULL);
     double age = difftime(now, file_stat.st_mtime);
 
     return (age <= ttl_seconds);
 }
 
+/**
+ * Classify the entry for cache_key by age. out_saved_at (optional) receives
+ * the time it was saved, or 0 if there is no entry.
+ *
+ * The memory tier keeps entries until the hard TTL, so their save time is
+ * the stored expiry minus hard_ttl_seconds. Queued saves are checked next,
+ * as their files are not written yet.
+ */
+static FileCacheFreshness entry_freshness(FileCacheInstance* cache,
+                                          const char*        cache_key,
+                                          time_t*            out_saved_at) {
+    time_t saved_at   = 0;
+    time_t expires_at = 0;
+
+    PendingWrite* pending = NULL;
+
+    if (memory_cache_get_expiry(cache->memory, cache_key, &expires_at)) {
+        saved_at = expires_at - cache->hard_ttl_seconds;
+    } else if ((pending = find_pending(cache, cache_key, NULL)) != NULL) {
+        saved_at = pending->saved_at;
+    } else {
+        char filepath[FILE_CACHE_MAX_PATH_LENGTH];
+        build_filepath(cache, cache_key, filepath, sizeof(filepath));
+        if (!is_file_valid(filepath, cache->hard_ttl_seconds, &saved_at)) {
+            if (out_saved_at) {
+                *out_saved_at = saved_at;
+            }
+            return FILE_CACHE_MISSING;
+        }
+    }
+
+    if (out_saved_at) {
+        *out_saved_at = saved_at;
+    }
+
+    return difftime(time(NULL), saved_at) <= cache->ttl_seconds
+               ? FILE_CACHE_FRESH
+               : FILE_CACHE_STALE;
+}
+
+/**
+ * Count a lookup that found nothing usable: mtime is non-zero when a file
+ * existed but was older than the TTL.
+ */
+static void count_miss(FileCacheInstance* cache, time_t mtime) {
+    metrics_counter_add(mtime ? &cache->expired : &cache->misses, 1);
+}
+
 /* ============= Lifecycle Implementation ============= */
 
 FileCacheInstance* file_cache_create(const FileCacheConfig* config) {
@@ -105,21 +618,71 @@ FileCacheInstance* file_cache_create(const FileCacheConfig* config) {
     }
 
     strncpy(cache->cache_dir, config->cache_dir, sizeof(cache->cache_dir) - 1);
-    cache->ttl_seconds = config->ttl_seconds;
-    cache->enabled     = config->enabled;
+    cache->ttl_seconds      = config->ttl_seconds;
+    cache->hard_ttl_seconds = config->hard_ttl_seconds > config->ttl_seconds
+                                  ? config->hard_ttl_seconds
+                                  : config->ttl_seconds;
+    cache->enabled          = config->enabled;
+    snprintf(cache->extension, sizeof(cache->extension), "%s",
+             config->extension ? config->extension
+                               : FILE_CACHE_DEFAULT_EXTENSION);
+
+    cache->disk_bytes = config->disk_bytes;
+
+    if (cache->enabled && config->memory_bytes > 0) {
+        cache->memory = memory_cache_create(config->memory_bytes);
+        if (!cache->memory) {
+            LOGGER_WARN("[FILE_CACHE] Warning: Memory tier disabled for: %s",
+                        cache->cache_dir);
+        }
+    }
 
     /* Create cache directory if it doesn't exist */
     if (mkdir_recursive(cache->cache_dir, 0755) != 0) {
-        fprintf(stderr,
-                "[FILE_CACHE] Warning: Failed to create cache directory: %s\n",
-                cache->cache_dir);
+        LOGGER_WARN(
+            "[FILE_CACHE] Warning: Failed to create cache directory: %s",
+            cache->cache_dir);
     }
 
+    /* One task drains the queue of every write-behind instance */
+    if (cache->enabled && config->write_behind) {
+        if (!g_writer_task) {
+            g_writer_task = smw_create_task(NULL, writer_task_work);
+        }
+        if (g_writer_task) {
+            cache->write_behind = true;
+            g_write_behind_instances++;
+        } else {
+            LOGGER_WARN("[FILE_CACHE] Warning: Writing synchronously to: %s",
+                        cache->cache_dir);
+        }
+    }
+
+    cache->next = g_instances;
+    g_instances = cache;
+
     return cache;
 }
 
 void file_cache_destroy(FileCacheInstance* cache) {
     if (cache) {
+        FileCacheInstance** link = &g_instances;
+        while (*link && *link != cache) {
+            link = &(*link)->next;
+        }
+        if (*link) {
+            *link = cache->next;
+        }
+
+        if (cache->write_behind) {
+            queue_drain(cache, true);
+            if (--g_write_behind_instances == 0 && g_writer_task) {
+                smw_destroy_task(g_writer_task);
+                g_writer_task = NULL;
+            }
+        }
+
+        memory_cache_destroy(cache->memory);
         free(cache);
     }
 }
@@ -147,10 +710,51 @@ bool file_cache_is_valid(FileCacheInstance* cache, const char* cache_key) {
         return false;
     }
 
-    char filepath[FILE_CACHE_MAX_PATH_LENGTH];
-    build_filepath(cache, cache_key, filepath, sizeof(filepath));
+    time_t saved_at = 0;
+    if (entry_freshness(cache, cache_key, &saved_at) != FILE_CACHE_FRESH) {
+        count_miss(cache, saved_at);
+        return false;
+    }
+
+    return true;
+}
 
-    return is_file_valid(filepath, cache->ttl_seconds);
+FileCacheFreshness file_cache_freshness(FileCacheInstance* cache,
+                                        const char*        cache_key) {
+    if (!cache || !cache->enabled || !cache_key) {
+        return FILE_CACHE_MISSING;
+    }
+
+    time_t             saved_at  = 0;
+    FileCacheFreshness freshness = entry_freshness(cache, cache_key, &saved_at);
+    if (freshness == FILE_CACHE_MISSING) {
+        count_miss(cache, saved_at);
+    } else if (freshness == FILE_CACHE_STALE) {
+        metrics_counter_add(&cache->stale, 1);
+    }
+
+    return freshness;
+}
+
+FileCacheResult file_cache_get_expiry(FileCacheInstance* cache,
+                                      const char*        cache_key,
+                                      time_t*            out_expires_at) {
+    if (!cache || !cache_key || !out_expires_at) {
+        return FILE_CACHE_ERROR_PARAM;
+    }
+
+    if (!cache->enabled) {
+        return FILE_CACHE_ERROR_NOT_FOUND;
+    }
+
+    time_t saved_at = 0;
+    if (entry_freshness(cache, cache_key, &saved_at) != FILE_CACHE_FRESH) {
+        count_miss(cache, saved_at);
+        return saved_at ? FILE_CACHE_ERROR_EXPIRED : FILE_CACHE_ERROR_NOT_FOUND;
+    }
+
+    *out_expires_at = saved_at + cache->ttl_seconds;
+    return FILE_CACHE_OK;
 }
 
 FileCacheResult file_cache_load(FileCacheInstance* cache, const char* cache_key,
@@ -163,17 +767,44 @@ FileCacheResult file_cache_load(FileCacheInstance* cache, const char* cache_key,
         return FILE_CACHE_ERROR_NOT_FOUND;
     }
 
+    /* Hot path: served from RAM without touching the filesystem */
+    if (memory_cache_get(cache->memory, cache_key, out_data, out_size)) {
+        metrics_counter_add(&cache->memory_hits, 1);
+        return FILE_CACHE_OK;
+    }
+
+    /* Saved but not written yet */
+    PendingWrite* pending = find_pending(cache, cache_key, NULL);
+    if (pending) {
+        char* buffer = malloc(pending->size + 1);
+        if (!buffer) {
+            return FILE_CACHE_ERROR_MEMORY;
+        }
+        memcpy(buffer, pending->data, pending->size);
+        buffer[pending->size] = '\0';
+
+        metrics_counter_add(&cache->memory_hits, 1);
+        *out_data = buffer;
+        if (out_size) {
+            *out_size = pending->size;
+        }
+        return FILE_CACHE_OK;
+    }
+
     char filepath[FILE_CACHE_MAX_PATH_LENGTH];
     build_filepath(cache, cache_key, filepath, sizeof(filepath));
 
-    /* Check TTL */
-    if (!is_file_valid(filepath, cache->ttl_seconds)) {
+    /* Check TTL; stale entries load until the hard TTL */
+    time_t mtime = 0;
+    if (!is_file_valid(filepath, cache->hard_ttl_seconds, &mtime)) {
+        count_miss(cache, mtime);
         return FILE_CACHE_ERROR_EXPIRED;
     }
 
     /* Open and read file */
     FILE* fp = fopen(filepath, "r");
     if (!fp) {
+        count_miss(cache, 0);
         return FILE_CACHE_ERROR_NOT_FOUND;
     }
 
@@ -205,6 +836,11 @@ FileCacheResult file_cache_load(FileCacheInstance* cache, const char* cache_key,
 
     buffer[bytes_read] = '\0';
 
+    /* Promote into the memory tier; it expires together with the file */
+    memory_cache_put(cache->memory, cache_key, buffer, bytes_read,
+                     mtime + cache->hard_ttl_seconds);
+    metrics_counter_add(&cache->disk_hits, 1);
+
     *out_data = buffer;
     if (out_size) {
         *out_size = bytes_read;
@@ -223,26 +859,21 @@ FileCacheResult file_cache_save(FileCacheInstance* cache, const char* cache_key,
         return FILE_CACHE_OK; /* Silently succeed when disabled */
     }
 
-    char filepath[FILE_CACHE_MAX_PATH_LENGTH];
-    build_filepath(cache, cache_key, filepath, sizeof(filepath));
-
     if (data_size == 0) {
         data_size = strlen(data);
     }
 
-    FILE* fp = fopen(filepath, "w");
-    if (!fp) {
-        return FILE_CACHE_ERROR_IO;
-    }
-
-    size_t bytes_written = fwrite(data, 1, data_size, fp);
-    fclose(fp);
+    /* Write-through: the memory tier sees the entry before the file does */
+    time_t now = time(NULL);
+    memory_cache_put(cache->memory, cache_key, data, data_size,
+                     now + cache->hard_ttl_seconds);
 
-    if (bytes_written != data_size) {
-        return FILE_CACHE_ERROR_IO;
+    if (cache->write_behind &&
+        queue_write(cache, cache_key, data, data_size, now)) {
+        return FILE_CACHE_OK;
     }
 
-    return FILE_CACHE_OK;
+    return write_entry_file(cache, cache_key, data, data_size, now);
 }
 
 /* ============= JSON Helpers Implementation ============= */
@@ -280,7 +911,7 @@ FileCacheResult file_cache_save_json(FileCacheInstance* cache,
     }
 
     char* json_str =
-        json_dumps((json_t*)json, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+        json_dumps((json_t*)json, JSON_COMPACT | JSON_PRESERVE_ORDER);
     if (!json_str) {
         return FILE_CACHE_ERROR_MEMORY;
     }
@@ -299,6 +930,14 @@ FileCacheResult file_cache_invalidate(FileCacheInstance* cache,
         return FILE_CACHE_ERROR_PARAM;
     }
 
+    memory_cache_remove(cache->memory, cache_key);
+
+    PendingWrite* prev    = NULL;
+    PendingWrite* pending = find_pending(cache, cache_key, &prev);
+    if (pending) {
+        queue_drop(prev, pending);
+    }
+
     char filepath[FILE_CACHE_MAX_PATH_LENGTH];
     build_filepath(cache, cache_key, filepath, sizeof(filepath));
 
@@ -309,50 +948,33 @@ FileCacheResult file_cache_invalidate(FileCacheInstance* cache,
     return FILE_CACHE_OK;
 }
 
-FileCacheResult file_cache_clear(FileCacheInstance* cache) {
+FileCacheResult file_cache_flush(FileCacheInstance* cache) {
     if (!cache) {
         return FILE_CACHE_ERROR_PARAM;
     }
 
-    DIR* dir = opendir(cache->cache_dir);
-    if (!dir) {
-        if (errno == ENOENT) {
-            return FILE_CACHE_OK; /* Directory doesn't exist, nothing to clear
-                                   */
-        }
-        return FILE_CACHE_ERROR_IO;
-    }
-
-    struct dirent* entry;
-    char           filepath[FILE_CACHE_MAX_PATH_LENGTH];
-    int            errors = 0;
+    return queue_drain(cache, true) == 0 ? FILE_CACHE_OK : FILE_CACHE_ERROR_IO;
+}
 
-    while ((entry = readdir(dir)) != NULL) {
-        /* Skip . and .. */
-        if (strcmp(entry->d_name, ".") == 0 ||
-            strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
+FileCacheResult file_cache_clear(FileCacheInstance* cache) {
+    if (!cache) {
+        return FILE_CACHE_ERROR_PARAM;
+    }
 
-        /* Only delete .json files */
-        size_t name_len = strlen(entry->d_name);
-        if (name_len > 5 &&
-            strcmp(entry->d_name + name_len - 5, ".json") == 0) {
-            int written = snprintf(filepath, sizeof(filepath), "%s/%s",
-                                   cache->cache_dir, entry->d_name);
+    memory_cache_clear(cache->memory);
+    queue_drain(cache, false);
 
-            if (written < 0 || (size_t)written >= sizeof(filepath)) {
-                errors++;
-                continue; /* Path too long, skip */
-            }
+    /* The top level holds files of the unsharded layout */
+    int errors = 0;
+    sweep_directory(cache, cache->cache_dir, false, 0, &errors);
 
-            if (unlink(filepath) != 0) {
-                errors++;
-            }
-        }
+    char path[FILE_CACHE_MAX_PATH_LENGTH];
+    for (unsigned shard = 0; shard < FILE_CACHE_SHARD_COUNT; shard++) {
+        snprintf(path, sizeof(path), "%s/%02x", cache->cache_dir, shard);
+        sweep_directory(cache, path, false, 0, &errors);
+        cache->shard_bytes[shard] = 0;
     }
-
-    closedir(dir);
+    cache->disk_estimate = 0;
 
     return (errors == 0) ? FILE_CACHE_OK : FILE_CACHE_ERROR_IO;
 }
@@ -408,3 +1030,146 @@ FileCacheResult file_cache_get_filepath(FileCacheInstance* cache,
     build_filepath(cache, cache_key, out_path, path_size);
     return FILE_CACHE_OK;
 }
+
+/* ============= Snapshots Implementation ============= */
+
+static bool snapshot_write_entry(const char* key, const char* data,
+                                 size_t size, time_t expires_at,
+                                 void* context) {
+    SnapshotWriter* writer = (SnapshotWriter*)context;
+    SnapshotRecord  record = {.expires_at = (int64_t)expires_at,
+                              .key_length = (uint32_t)strlen(key),
+                              .size       = (uint32_t)size};
+
+    if (fwrite(&record, sizeof(record), 1, writer->fp) != 1 ||
+        fwrite(key, 1, record.key_length, writer->fp) != record.key_length ||
+        fwrite(data, 1, size, writer->fp) != size) {
+        writer->failed = true;
+        return false;
+    }
+
+    writer->count++;
+    return true;
+}
+
+int file_cache_snapshot_save(FileCacheInstance* cache, const char* name) {
+    if (!cache || !name) {
+        return FILE_CACHE_ERROR_PARAM;
+    }
+    if (!cache->memory) {
+        return 0;
+    }
+
+    char filepath[FILE_CACHE_MAX_PATH_LENGTH];
+    char tmppath[FILE_CACHE_MAX_PATH_LENGTH + 32];
+    snprintf(filepath, sizeof(filepath), "%s/%s", cache->cache_dir, name);
+    snprintf(tmppath, sizeof(tmppath), "%s.%ld" FILE_CACHE_TMP_SUFFIX,
+             filepath, (long)getpid());
+
+    SnapshotWriter writer = {.fp = fopen(tmppath, "wb")};
+    if (!writer.fp) {
+        return FILE_CACHE_ERROR_IO;
+    }
+
+    SnapshotHeader header = {.magic   = FILE_CACHE_SNAPSHOT_MAGIC,
+                             .version = FILE_CACHE_SNAPSHOT_VERSION};
+    if (fwrite(&header, sizeof(header), 1, writer.fp) != 1) {
+        writer.failed = true;
+    } else {
+        memory_cache_visit(cache->memory, snapshot_write_entry, &writer);
+    }
+
+    writer.failed = fclose(writer.fp) != 0 || writer.failed;
+    if (writer.failed || rename(tmppath, filepath) != 0) {
+        unlink(tmppath);
+        return FILE_CACHE_ERROR_IO;
+    }
+
+    return writer.count;
+}
+
+int file_cache_snapshot_restore(FileCacheInstance* cache, const char* name) {
+    if (!cache || !name) {
+        return FILE_CACHE_ERROR_PARAM;
+    }
+
+    char filepath[FILE_CACHE_MAX_PATH_LENGTH];
+    snprintf(filepath, sizeof(filepath), "%s/%s", cache->cache_dir, name);
+
+    FILE* fp = fopen(filepath, "rb");
+    if (!fp) {
+        return FILE_CACHE_ERROR_NOT_FOUND;
+    }
+    unlink(filepath); /* Read once; a later start must not see it again */
+
+    SnapshotHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        header.magic != FILE_CACHE_SNAPSHOT_MAGIC ||
+        header.version != FILE_CACHE_SNAPSHOT_VERSION) {
+        fclose(fp);
+        return FILE_CACHE_ERROR_PARSE;
+    }
+
+    int             count  = 0;
+    char*           data   = NULL;
+    time_t          now    = time(NULL);
+    FileCacheResult result = FILE_CACHE_OK;
+    SnapshotRecord  record;
+    char            key[FILE_CACHE_KEY_LENGTH];
+
+    while (fread(&record, sizeof(record), 1, fp) == 1) {
+        if (record.key_length >= sizeof(key) ||
+            record.size > FILE_CACHE_SNAPSHOT_MAX_ENTRY) {
+            result = FILE_CACHE_ERROR_PARSE;
+            break;
+        }
+
+        char* grown = realloc(data, record.size ? record.size : 1);
+        if (!grown) {
+            result = FILE_CACHE_ERROR_MEMORY;
+            break;
+        }
+        data = grown;
+
+        if (fread(key, 1, record.key_length, fp) != record.key_length ||
+            fread(data, 1, record.size, fp) != record.size) {
+            result = FILE_CACHE_ERROR_PARSE;
+            break;
+        }
+        key[record.key_length] = '\0';
+
+        if ((time_t)record.expires_at >= now &&
+            memory_cache_put(cache->memory, key, data, record.size,
+                             (time_t)record.expires_at)) {
+            count++;
+        }
+    }
+
+    free(data);
+    fclose(fp);
+    return count > 0 || result == FILE_CACHE_OK ? count : result;
+}
+
+/* ============= Statistics Implementation ============= */
+
+FileCacheInstance* file_cache_next(const FileCacheInstance* cache) {
+    return cache ? cache->next : g_instances;
+}
+
+void file_cache_get_stats(const FileCacheInstance* cache,
+                          FileCacheStats*          out_stats) {
+    if (!cache || !out_stats) {
+        return;
+    }
+
+    out_stats->cache_dir    = cache->cache_dir;
+    out_stats->memory_hits  = metrics_counter_get(&cache->memory_hits);
+    out_stats->disk_hits    = metrics_counter_get(&cache->disk_hits);
+    out_stats->misses       = metrics_counter_get(&cache->misses);
+    out_stats->expired      = metrics_counter_get(&cache->expired);
+    out_stats->stale        = metrics_counter_get(&cache->stale);
+    out_stats->writes       = metrics_counter_get(&cache->writes);
+    out_stats->write_errors = metrics_counter_get(&cache->write_errors);
+    out_stats->evictions    = metrics_counter_get(&cache->evictions);
+    out_stats->queued       = cache->queued;
+}
@@ -3,6 +3,32 @@
  *
  * Provides a generic caching API with TTL-based expiration,
  * MD5 key generation, and JSON support via jansson.
+ *
+ * An optional in-memory LRU tier (see memory_cache.h) sits in front of the
+ * files. Saves write through to both; loads and validity checks are served
+ * from RAM when possible, and files loaded from disk are promoted into it.
+ *
+ * With hard_ttl_seconds above ttl_seconds, entries have a soft and a hard
+ * TTL. Past the soft TTL (ttl_seconds) they are stale: file_cache_is_valid
+ * and file_cache_get_expiry report them as expired. file_cache_freshness
+ * tells them apart, and file_cache_load still returns them until the hard
+ * TTL. The caller can answer from a stale entry and refresh it meanwhile.
+ *
+ * Files are sharded into one subdirectory per two-character key prefix
+ * (<cache_dir>/ab/abcdef...<extension>) and always written to a temporary
+ * file that is renamed into place, so readers never see a partial entry.
+ *
+ * With write_behind, file_cache_save only updates the memory tier and a
+ * queue; a background smw task writes the queued entries a few per tick.
+ * Queued entries are visible to every lookup until they are on disk. The
+ * same task runs a janitor over these instances: it visits one shard per
+ * interval, removes entries past the hard TTL and, with disk_bytes set,
+ * the oldest entries of shards over their share of the budget.
+ *
+ * Every instance counts its lookups (file_cache_get_stats). A load counts
+ * a hit on the tier that served it. A miss or expiry is counted wherever it
+ * is reported (validity check, expiry query or load), so the usual "check,
+ * then load" sequence counts each lookup once.
  */
 
 #ifndef FILE_CACHE_H
@@ -10,6 +36,8 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 
 #define FILE_CACHE_MAX_PATH_LENGTH 512
 #define FILE_CACHE_KEY_LENGTH 33 /* MD5 hex string + null terminator */
@@ -28,11 +56,37 @@ typedef enum {
 
 /* Configuration for a cache instance */
 typedef struct {
-    const char* cache_dir;   /* Directory for cache files */
-    int         ttl_seconds; /* Time-to-live in seconds */
-    bool        enabled;     /* Whether caching is enabled */
+    const char* cache_dir;        /* Directory for cache files */
+    int         ttl_seconds;      /* Time-to-live in seconds (soft TTL) */
+    bool        enabled;          /* Whether caching is enabled */
+    size_t      memory_bytes;     /* In-memory tier budget (0 = files only) */
+    const char* extension;        /* File suffix incl. dot (NULL = ".json") */
+    int         hard_ttl_seconds; /* Stale entries load until (0 = none) */
+    bool        write_behind;     /* Queue saves for the background writer */
+    size_t      disk_bytes;       /* Janitor size budget (0 = TTL only) */
 } FileCacheConfig;
 
+/* Age class of a cache entry, see file_cache_freshness */
+typedef enum {
+    FILE_CACHE_MISSING = 0, /* No entry, or older than the hard TTL */
+    FILE_CACHE_FRESH,       /* Within ttl_seconds */
+    FILE_CACHE_STALE        /* Past ttl_seconds, within hard_ttl_seconds */
+} FileCacheFreshness;
+
+/* Lookup and write counters of one instance */
+typedef struct {
+    const char* cache_dir;    /* Owned by the instance */
+    uint64_t    memory_hits;  /* Loads served by the memory tier */
+    uint64_t    disk_hits;    /* Loads served from a file */
+    uint64_t    misses;       /* No entry */
+    uint64_t    expired;      /* Entry older than the TTL */
+    uint64_t    stale;        /* Stale entries found by file_cache_freshness */
+    uint64_t    writes;       /* Successful saves */
+    uint64_t    write_errors; /* Saves that failed to write the file */
+    uint64_t    evictions;    /* Files removed by the janitor */
+    size_t      queued;       /* Saves waiting for the background writer */
+} FileCacheStats;
+
 /* Opaque cache instance handle */
 typedef struct FileCacheInstance FileCacheInstance;
 
@@ -79,8 +133,34 @@ FileCacheResult file_cache_generate_key(FileCacheInstance* cache,
 bool file_cache_is_valid(FileCacheInstance* cache, const char* cache_key);
 
 /**
- * Load raw data from cache file.
- * Checks TTL before loading. Returns FILE_CACHE_ERROR_EXPIRED if entry stale.
+ * Classify a cache entry as fresh, stale or missing. Unlike
+ * file_cache_is_valid, this reports an entry between the soft and the hard
+ * TTL as FILE_CACHE_STALE instead of expired.
+ *
+ * @param cache      Cache instance
+ * @param cache_key  The cache key
+ * @return           FILE_CACHE_FRESH, FILE_CACHE_STALE or FILE_CACHE_MISSING
+ */
+FileCacheFreshness file_cache_freshness(FileCacheInstance* cache,
+                                        const char*        cache_key);
+
+/**
+ * Get the time at which a valid cache entry expires.
+ *
+ * @param cache           Cache instance
+ * @param cache_key       The cache key
+ * @param out_expires_at  Output expiry time (wall clock)
+ * @return                FILE_CACHE_OK, FILE_CACHE_ERROR_NOT_FOUND or
+ *                        FILE_CACHE_ERROR_EXPIRED
+ */
+FileCacheResult file_cache_get_expiry(FileCacheInstance* cache,
+                                      const char*        cache_key,
+                                      time_t*            out_expires_at);
+
+/**
+ * Load raw data from the memory tier or the cache file.
+ * Checks the hard TTL before loading (the TTL when none is configured), so
+ * a stale entry still loads. Returns FILE_CACHE_ERROR_EXPIRED past it.
  *
  * @param cache      Cache instance
  * @param cache_key  The cache key
@@ -141,7 +221,17 @@ FileCacheResult file_cache_invalidate(FileCacheInstance* cache,
                                       const char*        cache_key);
 
 /**
- * Clear all cache entries for this cache instance.
+ * Write every queued save of this instance to disk now. Called by
+ * file_cache_destroy; a no-op without write_behind.
+ *
+ * @param cache  Cache instance
+ * @return       FILE_CACHE_OK, or FILE_CACHE_ERROR_IO if a write failed
+ */
+FileCacheResult file_cache_flush(FileCacheInstance* cache);
+
+/**
+ * Clear all cache entries (files with the configured extension, in every
+ * shard) for this cache instance, including queued saves.
  *
  * @param cache  Cache instance
  * @return       FILE_CACHE_OK on success, error code otherwise
@@ -164,7 +254,7 @@ FileCacheResult file_cache_normalize_string(const char* input, char* output,
                                             size_t output_size);
 
 /**
- * Get the full filepath for a cache entry.
+ * Get the full filepath (inside its shard directory) for a cache entry.
  *
  * @param cache      Cache instance
  * @param cache_key  The cache key
@@ -176,4 +266,50 @@ FileCacheResult file_cache_get_filepath(FileCacheInstance* cache,
                                         const char* cache_key, char* out_path,
                                         size_t path_size);
 
+/* ============= Snapshots ============= */
+
+/**
+ * Write the memory tier to <cache_dir>/<name>, replacing any earlier
+ * snapshot atomically. Entries keep their expiry and their recency, so a
+ * process that restores the file starts with the same tier. Nothing is
+ * written for an instance without a memory tier.
+ *
+ * @param cache  Cache instance
+ * @param name   File name inside the cache directory
+ * @return       Number of entries written, or a negative FileCacheResult
+ */
+int file_cache_snapshot_save(FileCacheInstance* cache, const char* name);
+
+/**
+ * Load a snapshot written by file_cache_snapshot_save into the memory tier
+ * and delete the file. Expired entries are skipped. Entries are taken as
+ * they were when the snapshot was written, so restore only right after
+ * another process saved it (a reload), not from an old file.
+ *
+ * @param cache  Cache instance
+ * @param name   File name inside the cache directory
+ * @return       Number of entries restored, or a negative FileCacheResult
+ *               (FILE_CACHE_ERROR_NOT_FOUND without a snapshot)
+ */
+int file_cache_snapshot_restore(FileCacheInstance* cache, const char* name);
+
+/* ============= Statistics ============= */
+
+/**
+ * Iterate over every live cache instance, newest first.
+ *
+ * @param cache  Previous instance, or NULL to get the first one
+ * @return       Next instance, or NULL at the end
+ */
+FileCacheInstance* file_cache_next(const FileCacheInstance* cache);
+
+/**
+ * Read the lookup and write counters of a cache instance.
+ *
+ * @param cache      Cache instance
+ * @param out_stats  Output counters
+ */
+void file_cache_get_stats(const FileCacheInstance* cache,
+                          FileCacheStats*          out_stats);
+
 #endif /* FILE_CACHE_H */
@@ -0,0 +1,319 @@
+/**
+ * memory_cache.c - In-process LRU tier implementation
+ */
+
+#include "memory_cache.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMORY_CACHE_SHARDS 16
+#define MEMORY_CACHE_BUCKETS 256 /* Per shard */
+
+/* ============= Internal Structures ============= */
+
+/* Entry header; key and data follow in the same allocation */
+typedef struct MemoryCacheEntry {
+    uint32_t                 hash;
+    time_t                   expires_at;
+    size_t                   size;
+    size_t                   charge; /* Bytes counted against the budget */
+    char*                    key;
+    char*                    data;
+    struct MemoryCacheEntry* chain_next;
+    struct MemoryCacheEntry* lru_prev; /* Towards most recently used */
+    struct MemoryCacheEntry* lru_next; /* Towards least recently used */
+} MemoryCacheEntry;
+
+typedef struct {
+    MemoryCacheEntry* buckets[MEMORY_CACHE_BUCKETS];
+    MemoryCacheEntry* lru_head; /* Most recently used */
+    MemoryCacheEntry* lru_tail; /* Least recently used */
+    size_t            used_bytes;
+    size_t            max_bytes;
+} MemoryCacheShard;
+
+struct MemoryCache {
+    MemoryCacheShard shards[MEMORY_CACHE_SHARDS];
+};
+
+/* ============= Internal Helpers ============= */
+
+static uint32_t hash_key(const char* key) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static MemoryCacheShard* shard_for(MemoryCache* cache, uint32_t hash) {
+    return &cache->shards[hash % MEMORY_CACHE_SHARDS];
+}
+
+static MemoryCacheEntry** bucket_for(MemoryCacheShard* shard, uint32_t hash) {
+    return &shard->buckets[(hash / MEMORY_CACHE_SHARDS) % MEMORY_CACHE_BUCKETS];
+}
+
+static void lru_unlink(MemoryCacheShard* shard, MemoryCacheEntry* entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_front(MemoryCacheShard* shard, MemoryCacheEntry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head) {
+        shard->lru_head->lru_prev = entry;
+    }
+    shard->lru_head = entry;
+    if (!shard->lru_tail) {
+        shard->lru_tail = entry;
+    }
+}
+
+/**
+ * Unlink entry from its bucket and the LRU list, then free it
+ */
+static void remove_entry(MemoryCacheShard* shard, MemoryCacheEntry* entry) {
+    MemoryCacheEntry** link = bucket_for(shard, entry->hash);
+    while (*link && *link != entry) {
+        link = &(*link)->chain_next;
+    }
+    if (*link) {
+        *link = entry->chain_next;
+    }
+
+    lru_unlink(shard, entry);
+    shard->used_bytes -= entry->charge;
+    free(entry);
+}
+
+static MemoryCacheEntry* find_entry(MemoryCacheShard* shard, uint32_t hash,
+                                    const char* key) {
+    for (MemoryCacheEntry* e = *bucket_for(shard, hash); e; e = e->chain_next) {
+        if (e->hash == hash && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find a live entry; an expired one is dropped and reported as missing
+ */
+static MemoryCacheEntry* find_live(MemoryCache* cache, const char* key,
+                                   MemoryCacheShard** out_shard) {
+    uint32_t          hash  = hash_key(key);
+    MemoryCacheShard* shard = shard_for(cache, hash);
+    MemoryCacheEntry* entry = find_entry(shard, hash, key);
+
+    if (entry && time(NULL) > entry->expires_at) {
+        remove_entry(shard, entry);
+        entry = NULL;
+    }
+
+    *out_shard = shard;
+    return entry;
+}
+
+/* ============= Public API ============= */
+
+MemoryCache* memory_cache_create(size_t max_bytes) {
+    if (max_bytes == 0) {
+        return NULL;
+    }
+
+    MemoryCache* cache = calloc(1, sizeof(MemoryCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+        cache->shards[i].max_bytes = max_bytes / MEMORY_CACHE_SHARDS;
+    }
+
+    return cache;
+}
+
+void memory_cache_destroy(MemoryCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    memory_cache_clear(cache);
+    free(cache);
+}
+
+bool memory_cache_contains(MemoryCache* cache, const char* key) {
+    if (!cache || !key) {
+        return false;
+    }
+
+    MemoryCacheShard* shard = NULL;
+    return find_live(cache, key, &shard) != NULL;
+}
+
+bool memory_cache_get_expiry(MemoryCache* cache, const char* key,
+                             time_t* out_expires_at) {
+    if (!cache || !key || !out_expires_at) {
+        return false;
+    }
+
+    MemoryCacheShard* shard = NULL;
+    MemoryCacheEntry* entry = find_live(cache, key, &shard);
+    if (!entry) {
+        return false;
+    }
+
+    *out_expires_at = entry->expires_at;
+    return true;
+}
+
+bool memory_cache_get(MemoryCache* cache, const char* key, char** out_data,
+                      size_t* out_size) {
+    if (!cache || !key || !out_data) {
+        return false;
+    }
+
+    MemoryCacheShard* shard = NULL;
+    MemoryCacheEntry* entry = find_live(cache, key, &shard);
+    if (!entry) {
+        return false;
+    }
+
+    char* copy = malloc(entry->size + 1);
+    if (!copy) {
+        return false;
+    }
+
+    memcpy(copy, entry->data, entry->size);
+    copy[entry->size] = '\0';
+
+    lru_unlink(shard, entry);
+    lru_push_front(shard, entry);
+
+    *out_data = copy;
+    if (out_size) {
+        *out_size = entry->size;
+    }
+
+    return true;
+}
+
+bool memory_cache_put(MemoryCache* cache, const char* key, const char* data,
+                      size_t size, time_t expires_at) {
+    if (!cache || !key || !data) {
+        return false;
+    }
+
+    uint32_t          hash    = hash_key(key);
+    MemoryCacheShard* shard   = shard_for(cache, hash);
+    size_t            key_len = strlen(key);
+    size_t            charge  = sizeof(MemoryCacheEntry) + key_len + 1 + size;
+
+    MemoryCacheEntry* existing = find_entry(shard, hash, key);
+    if (existing) {
+        remove_entry(shard, existing);
+    }
+
+    if (charge > shard->max_bytes) {
+        return false; /* Would never fit in this shard */
+    }
+
+    while (shard->used_bytes + charge > shard->max_bytes && shard->lru_tail) {
+        remove_entry(shard, shard->lru_tail);
+    }
+
+    MemoryCacheEntry* entry = malloc(charge);
+    if (!entry) {
+        return false;
+    }
+
+    entry->hash       = hash;
+    entry->expires_at = expires_at;
+    entry->size       = size;
+    entry->charge     = charge;
+    entry->key        = (char*)(entry + 1);
+    entry->data       = entry->key + key_len + 1;
+
+    memcpy(entry->key, key, key_len + 1);
+    memcpy(entry->data, data, size);
+
+    MemoryCacheEntry** bucket = bucket_for(shard, hash);
+    entry->chain_next         = *bucket;
+    *bucket                   = entry;
+
+    lru_push_front(shard, entry);
+    shard->used_bytes += charge;
+
+    return true;
+}
+
+void memory_cache_remove(MemoryCache* cache, const char* key) {
+    if (!cache || !key) {
+        return;
+    }
+
+    uint32_t          hash  = hash_key(key);
+    MemoryCacheShard* shard = shard_for(cache, hash);
+    MemoryCacheEntry* entry = find_entry(shard, hash, key);
+    if (entry) {
+        remove_entry(shard, entry);
+    }
+}
+
+void memory_cache_clear(MemoryCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    for (size_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+        MemoryCacheShard* shard = &cache->shards[i];
+        MemoryCacheEntry* entry = shard->lru_head;
+        while (entry) {
+            MemoryCacheEntry* next = entry->lru_next;
+            free(entry);
+            entry = next;
+        }
+
+        memset(shard->buckets, 0, sizeof(shard->buckets));
+        shard->lru_head   = NULL;
+        shard->lru_tail   = NULL;
+        shard->used_bytes = 0;
+    }
+}
+
+void memory_cache_visit(MemoryCache* cache, MemoryCacheVisitor visitor,
+                        void* context) {
+    if (!cache || !visitor) {
+        return;
+    }
+
+    time_t now = time(NULL);
+    for (size_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+        MemoryCacheEntry* entry = cache->shards[i].lru_tail;
+        while (entry) {
+            if (now <= entry->expires_at &&
+                !visitor(entry->key, entry->data, entry->size,
+                         entry->expires_at, context)) {
+                return;
+            }
+            entry = entry->lru_prev;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * memory_cache.h - In-process LRU tier for cached blobs
+ *
+ * Byte-budgeted map from cache key to an owned copy of the cached data and
+ * its expiry time. Keys are spread over fixed shards, each with its own hash
+ * table, LRU list and share of the budget, so eviction and lookups only ever
+ * touch a small table. Not thread-safe; call from the event loop only.
+ */
+
+#ifndef MEMORY_CACHE_H
+#define MEMORY_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/* Opaque memory cache handle */
+typedef struct MemoryCache MemoryCache;
+
+/* Called by memory_cache_visit for one entry; return false to stop */
+typedef bool (*MemoryCacheVisitor)(const char* key, const char* data,
+                                   size_t size, time_t expires_at,
+                                   void* context);
+
+/**
+ * Create a memory cache.
+ *
+ * @param max_bytes  Total budget for keys, data and bookkeeping
+ * @return           Cache handle, or NULL on error
+ */
+MemoryCache* memory_cache_create(size_t max_bytes);
+
+/**
+ * Destroy a memory cache and free all entries.
+ *
+ * @param cache  Cache to destroy (NULL is allowed)
+ */
+void memory_cache_destroy(MemoryCache* cache);
+
+/**
+ * Check whether an unexpired entry exists for key.
+ * Expired entries found on the way are dropped.
+ */
+bool memory_cache_contains(MemoryCache* cache, const char* key);
+
+/**
+ * Read the expiry time of an unexpired entry without copying its data.
+ *
+ * @param cache           Cache handle
+ * @param key             Cache key
+ * @param out_expires_at  Output expiry time
+ * @return                true on hit, false if missing or expired
+ */
+bool memory_cache_get_expiry(MemoryCache* cache, const char* key,
+                             time_t* out_expires_at);
+
+/**
+ * Copy the entry for key into a new NUL-terminated buffer and mark it as
+ * most recently used.
+ *
+ * @param cache     Cache handle
+ * @param key       Cache key
+ * @param out_data  Output buffer (caller must free)
+ * @param out_size  Output data size, excluding the terminator (optional)
+ * @return          true on hit, false if missing, expired or out of memory
+ */
+bool memory_cache_get(MemoryCache* cache, const char* key, char** out_data,
+                      size_t* out_size);
+
+/**
+ * Insert or replace the entry for key, evicting least recently used
+ * entries of the same shard until it fits.
+ *
+ * @param cache       Cache handle
+ * @param key         Cache key
+ * @param data        Data to copy
+ * @param size        Size of data in bytes
+ * @param expires_at  Wall-clock time after which the entry is stale
+ * @return            true if stored, false if too large or out of memory
+ */
+bool memory_cache_put(MemoryCache* cache, const char* key, const char* data,
+                      size_t size, time_t expires_at);
+
+/**
+ * Remove the entry for key, if any.
+ */
+void memory_cache_remove(MemoryCache* cache, const char* key);
+
+/**
+ * Remove all entries.
+ */
+void memory_cache_clear(MemoryCache* cache);
+
+/**
+ * Call visitor for every unexpired entry, least recently used first within
+ * each shard, so putting them into an empty cache in that order rebuilds
+ * the same recency. The cache must not be modified from the visitor.
+ */
+void memory_cache_visit(MemoryCache* cache, MemoryCacheVisitor visitor,
+                        void* context);
+
+#endif /* MEMORY_CACHE_H */
@@ -0,0 +1,310 @@
+/**
+ * response_cache.c - Cache of finished HTTP response bodies
+ */
+
+#include "response_cache.h"
+
+#include "http_gzip.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESPONSE_CACHE_BUCKETS 1024
+#define RESPONSE_CACHE_TAG_BUCKETS 256
+
+/* ============= Internal Structures ============= */
+
+/* Entry header; key, tag, body and the gzip copy follow in the same
+ * allocation */
+typedef struct ResponseCacheEntry {
+    uint32_t                   hash;
+    uint32_t                   tag_hash;
+    time_t                     modified_at;
+    time_t                     expires_at;
+    size_t                     length;
+    size_t                     gzip_length;
+    size_t                     charge; /* Bytes counted against the budget */
+    char*                      key;
+    char*                      tag; /* NULL if untagged */
+    char*                      body;
+    char*                      gzip_body; /* NULL if not compressed */
+    char                       etag[RESPONSE_CACHE_ETAG_LENGTH];
+    struct ResponseCacheEntry* chain_next;
+    struct ResponseCacheEntry* tag_prev; /* Entries sharing a tag bucket */
+    struct ResponseCacheEntry* tag_next;
+    struct ResponseCacheEntry* lru_prev; /* Towards most recently used */
+    struct ResponseCacheEntry* lru_next; /* Towards least recently used */
+} ResponseCacheEntry;
+
+struct ResponseCache {
+    ResponseCacheEntry* buckets[RESPONSE_CACHE_BUCKETS];
+    ResponseCacheEntry* tags[RESPONSE_CACHE_TAG_BUCKETS];
+    ResponseCacheEntry* lru_head; /* Most recently used */
+    ResponseCacheEntry* lru_tail; /* Least recently used */
+    size_t              used_bytes;
+    size_t              max_bytes;
+};
+
+/* ============= Internal Helpers ============= */
+
+static uint32_t hash_string(const char* text) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void lru_unlink(ResponseCache* cache, ResponseCacheEntry* entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_front(ResponseCache* cache, ResponseCacheEntry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    }
+    cache->lru_head = entry;
+    if (!cache->lru_tail) {
+        cache->lru_tail = entry;
+    }
+}
+
+/**
+ * Unlink entry from its bucket, tag list and the LRU list, then free it
+ */
+static void remove_entry(ResponseCache* cache, ResponseCacheEntry* entry) {
+    ResponseCacheEntry** link =
+        &cache->buckets[entry->hash % RESPONSE_CACHE_BUCKETS];
+    while (*link && *link != entry) {
+        link = &(*link)->chain_next;
+    }
+    if (*link) {
+        *link = entry->chain_next;
+    }
+
+    if (entry->tag) {
+        if (entry->tag_prev) {
+            entry->tag_prev->tag_next = entry->tag_next;
+        } else {
+            cache->tags[entry->tag_hash % RESPONSE_CACHE_TAG_BUCKETS] =
+                entry->tag_next;
+        }
+        if (entry->tag_next) {
+            entry->tag_next->tag_prev = entry->tag_prev;
+        }
+    }
+
+    lru_unlink(cache, entry);
+    cache->used_bytes -= entry->charge;
+    free(entry);
+}
+
+static ResponseCacheEntry* find_entry(ResponseCache* cache, uint32_t hash,
+                                      const char* key) {
+    for (ResponseCacheEntry* e = cache->buckets[hash % RESPONSE_CACHE_BUCKETS];
+         e; e = e->chain_next) {
+        if (e->hash == hash && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* ============= Public API ============= */
+
+ResponseCache* response_cache_create(size_t max_bytes) {
+    if (max_bytes == 0) {
+        return NULL;
+    }
+
+    ResponseCache* cache = calloc(1, sizeof(ResponseCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->max_bytes = max_bytes;
+    return cache;
+}
+
+void response_cache_destroy(ResponseCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    response_cache_clear(cache);
+    free(cache);
+}
+
+bool response_cache_get(ResponseCache* cache, const char* key,
+                        ResponseCacheHit* out) {
+    if (!cache || !key || !out) {
+        return false;
+    }
+
+    ResponseCacheEntry* entry = find_entry(cache, hash_string(key), key);
+    if (!entry) {
+        return false;
+    }
+
+    if (entry->expires_at <= time(NULL)) {
+        remove_entry(cache, entry);
+        return false;
+    }
+
+    lru_unlink(cache, entry);
+    lru_push_front(cache, entry);
+
+    out->body        = entry->body;
+    out->length      = entry->length;
+    out->etag        = entry->etag;
+    out->gzip_body   = entry->gzip_body;
+    out->gzip_length = entry->gzip_length;
+    out->modified_at = entry->modified_at;
+    out->expires_at  = entry->expires_at;
+    return true;
+}
+
+bool response_cache_put(ResponseCache* cache, const char* key, const char* tag,
+                        const char* body, size_t length, time_t modified_at,
+                        time_t expires_at) {
+    if (!cache || !key || !body) {
+        return false;
+    }
+
+    /* Compressed once here instead of on every request */
+    char*  gzip     = NULL;
+    size_t gzip_len = 0;
+    http_gzip_compress(body, length, &gzip, &gzip_len);
+
+    size_t key_len = strlen(key) + 1;
+    size_t tag_len = tag ? strlen(tag) + 1 : 0;
+    size_t charge  = sizeof(ResponseCacheEntry) + key_len + tag_len +
+                     length + 1 + gzip_len;
+    if (charge > cache->max_bytes) {
+        free(gzip);
+        return false;
+    }
+
+    uint32_t            hash     = hash_string(key);
+    ResponseCacheEntry* existing = find_entry(cache, hash, key);
+    if (existing) {
+        remove_entry(cache, existing);
+    }
+
+    while (cache->used_bytes + charge > cache->max_bytes && cache->lru_tail) {
+        remove_entry(cache, cache->lru_tail);
+    }
+
+    ResponseCacheEntry* entry = malloc(charge);
+    if (!entry) {
+        free(gzip);
+        return false;
+    }
+
+    memset(entry, 0, sizeof(ResponseCacheEntry));
+    entry->hash        = hash;
+    entry->modified_at = modified_at;
+    entry->expires_at  = expires_at;
+    entry->length      = length;
+    entry->charge      = charge;
+    entry->key         = (char*)(entry + 1);
+    memcpy(entry->key, key, key_len);
+
+    char* next = entry->key + key_len;
+    if (tag) {
+        entry->tag = next;
+        memcpy(entry->tag, tag, tag_len);
+        next += tag_len;
+    }
+
+    entry->body = next;
+    memcpy(entry->body, body, length);
+    entry->body[length] = '\0';
+    response_cache_etag(body, length, entry->etag);
+
+    if (gzip) {
+        entry->gzip_body   = entry->body + length + 1;
+        entry->gzip_length = gzip_len;
+        memcpy(entry->gzip_body, gzip, gzip_len);
+        free(gzip);
+    }
+
+    size_t bucket          = hash % RESPONSE_CACHE_BUCKETS;
+    entry->chain_next      = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+
+    if (entry->tag) {
+        entry->tag_hash = hash_string(entry->tag);
+        ResponseCacheEntry** head =
+            &cache->tags[entry->tag_hash % RESPONSE_CACHE_TAG_BUCKETS];
+        entry->tag_next = *head;
+        if (*head) {
+            (*head)->tag_prev = entry;
+        }
+        *head = entry;
+    }
+
+    lru_push_front(cache, entry);
+    cache->used_bytes += charge;
+    return true;
+}
+
+size_t response_cache_invalidate_tag(ResponseCache* cache, const char* tag) {
+    if (!cache || !tag) {
+        return 0;
+    }
+
+    uint32_t            tag_hash = hash_string(tag);
+    size_t              removed  = 0;
+    ResponseCacheEntry* entry =
+        cache->tags[tag_hash % RESPONSE_CACHE_TAG_BUCKETS];
+
+    while (entry) {
+        ResponseCacheEntry* next = entry->tag_next;
+        if (entry->tag_hash == tag_hash && strcmp(entry->tag, tag) == 0) {
+            remove_entry(cache, entry);
+            removed++;
+        }
+        entry = next;
+    }
+
+    return removed;
+}
+
+void response_cache_clear(ResponseCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    while (cache->lru_tail) {
+        remove_entry(cache, cache->lru_tail);
+    }
+}
+
+void response_cache_etag(const char* body, size_t length, char* out) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)body[i];
+        hash *= 1099511628211ull;
+    }
+    snprintf(out, RESPONSE_CACHE_ETAG_LENGTH, "\"%016llx\"",
+             (unsigned long long)hash);
+}
@@ -0,0 +1,108 @@
+/**
+ * response_cache.h - Cache of finished HTTP response bodies
+ *
+ * Maps a normalized request key to the exact body bytes that were sent for
+ * it, their length and an ETag, so a repeated request can be answered
+ * without geocoding, weather lookups or JSON rendering. Entries expire at
+ * a fixed time and may carry a tag naming the data they were built from
+ * (for /v1/weather, the weather cache key); invalidating a tag drops every
+ * response built from that data at once.
+ *
+ * Bodies large enough to benefit are gzip-compressed once when stored, and
+ * the compressed copy is kept next to the original for clients that
+ * accept it.
+ *
+ * Byte-budgeted with LRU eviction. Not thread-safe; call from the event
+ * loop only.
+ */
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/* Quoted strong ETag: '"' + 16 hex digits + '"' + NUL */
+#define RESPONSE_CACHE_ETAG_LENGTH 19
+
+/* A cached response; pointers are owned by the cache */
+typedef struct {
+    const char* body;
+    size_t      length;
+    const char* etag;
+    const char* gzip_body; /* gzip copy of body, or NULL */
+    size_t      gzip_length;
+    time_t      modified_at; /* When the source data was produced */
+    time_t      expires_at;
+} ResponseCacheHit;
+
+/* Opaque response cache handle */
+typedef struct ResponseCache ResponseCache;
+
+/**
+ * Create a response cache.
+ *
+ * @param max_bytes  Total budget for keys, bodies and bookkeeping
+ * @return           Cache handle, or NULL on error
+ */
+ResponseCache* response_cache_create(size_t max_bytes);
+
+/**
+ * Destroy a response cache and free all entries.
+ *
+ * @param cache  Cache to destroy (NULL is allowed)
+ */
+void response_cache_destroy(ResponseCache* cache);
+
+/**
+ * Look up a live entry and mark it as most recently used. Expired entries
+ * are dropped and reported as missing.
+ *
+ * @param cache  Cache handle
+ * @param key    Request key
+ * @param out    Hit details, valid until the next put, invalidate or clear
+ * @return       true on hit
+ */
+bool response_cache_get(ResponseCache* cache, const char* key,
+                        ResponseCacheHit* out);
+
+/**
+ * Insert or replace the response for key.
+ *
+ * @param cache        Cache handle
+ * @param key          Request key
+ * @param tag          Source data tag for response_cache_invalidate_tag, or
+ *                     NULL for none
+ * @param body         Response body to copy
+ * @param length       Body length in bytes
+ * @param modified_at  When the source data was produced (Last-Modified)
+ * @param expires_at   Wall-clock time after which the entry is stale
+ * @return             true if stored, false if too large or out of memory
+ */
+bool response_cache_put(ResponseCache* cache, const char* key, const char* tag,
+                        const char* body, size_t length, time_t modified_at,
+                        time_t expires_at);
+
+/**
+ * Drop every entry stored with tag.
+ *
+ * @return Number of entries removed
+ */
+size_t response_cache_invalidate_tag(ResponseCache* cache, const char* tag);
+
+/**
+ * Remove all entries.
+ */
+void response_cache_clear(ResponseCache* cache);
+
+/**
+ * Compute the ETag response_cache_put stores for a body (FNV-1a 64).
+ *
+ * @param body    Body bytes
+ * @param length  Body length
+ * @param out     Output buffer of RESPONSE_CACHE_ETAG_LENGTH bytes
+ */
+void response_cache_etag(const char* body, size_t length, char* out);
+
+#endif /* RESPONSE_CACHE_H */
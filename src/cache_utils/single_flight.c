@@ -0,0 +1,180 @@
+/**
+ * single_flight.c - Request coalescing implementation
+ */
+
+#include "single_flight.h"
+
+#include "file_cache.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SINGLE_FLIGHT_BUCKETS 64
+
+/* ============= Internal Structures ============= */
+
+typedef struct SingleFlightWaiter {
+    SingleFlightCallback       callback;
+    void*                      context;
+    struct SingleFlightWaiter* next;
+} SingleFlightWaiter;
+
+typedef struct SingleFlight {
+    char                 key[FILE_CACHE_KEY_LENGTH];
+    SingleFlightWaiter*  head;
+    SingleFlightWaiter*  tail;
+    size_t               waiter_count;
+    struct SingleFlight* next;
+} SingleFlight;
+
+struct SingleFlightTable {
+    SingleFlightDeliver deliver;
+    SingleFlight*       buckets[SINGLE_FLIGHT_BUCKETS];
+};
+
+/* ============= Internal Helpers ============= */
+
+/**
+ * FNV-1a over the key; cache keys are already hashes, but this keeps the
+ * table usable with arbitrary strings.
+ */
+static size_t bucket_index(const char* key) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash % SINGLE_FLIGHT_BUCKETS;
+}
+
+static SingleFlight* find_flight(SingleFlightTable* table, const char* key) {
+    for (SingleFlight* f = table->buckets[bucket_index(key)]; f; f = f->next) {
+        if (strcmp(f->key, key) == 0) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+/* ============= Public API ============= */
+
+SingleFlightTable* single_flight_create(SingleFlightDeliver deliver) {
+    if (!deliver) {
+        return NULL;
+    }
+
+    SingleFlightTable* table = calloc(1, sizeof(SingleFlightTable));
+    if (!table) {
+        return NULL;
+    }
+
+    table->deliver = deliver;
+    return table;
+}
+
+void single_flight_destroy(SingleFlightTable* table) {
+    if (!table) {
+        return;
+    }
+
+    for (size_t i = 0; i < SINGLE_FLIGHT_BUCKETS; i++) {
+        SingleFlight* flight = table->buckets[i];
+        while (flight) {
+            SingleFlight*       next_flight = flight->next;
+            SingleFlightWaiter* waiter      = flight->head;
+            while (waiter) {
+                SingleFlightWaiter* next_waiter = waiter->next;
+                free(waiter);
+                waiter = next_waiter;
+            }
+            free(flight);
+            flight = next_flight;
+        }
+    }
+
+    free(table);
+}
+
+int single_flight_join(SingleFlightTable* table, const char* key,
+                       SingleFlightCallback callback, void* context) {
+    if (!table || !key || !callback ||
+        strlen(key) >= FILE_CACHE_KEY_LENGTH) {
+        return SINGLE_FLIGHT_ERROR;
+    }
+
+    SingleFlightWaiter* waiter = malloc(sizeof(SingleFlightWaiter));
+    if (!waiter) {
+        return SINGLE_FLIGHT_ERROR;
+    }
+
+    waiter->callback = callback;
+    waiter->context  = context;
+    waiter->next     = NULL;
+
+    SingleFlight* flight = find_flight(table, key);
+    if (flight) {
+        flight->tail->next = waiter;
+        flight->tail       = waiter;
+        flight->waiter_count++;
+        return SINGLE_FLIGHT_WAITER;
+    }
+
+    flight = calloc(1, sizeof(SingleFlight));
+    if (!flight) {
+        free(waiter);
+        return SINGLE_FLIGHT_ERROR;
+    }
+
+    strcpy(flight->key, key);
+    flight->head         = waiter;
+    flight->tail         = waiter;
+    flight->waiter_count = 1;
+
+    size_t index          = bucket_index(key);
+    flight->next          = table->buckets[index];
+    table->buckets[index] = flight;
+
+    return SINGLE_FLIGHT_LEADER;
+}
+
+size_t single_flight_complete(SingleFlightTable* table, const char* key,
+                              int result, const void* value) {
+    if (!table || !key) {
+        return 0;
+    }
+
+    /* Detach the flight first so callbacks can start a new one */
+    SingleFlight** link = &table->buckets[bucket_index(key)];
+    while (*link && strcmp((*link)->key, key) != 0) {
+        link = &(*link)->next;
+    }
+
+    SingleFlight* flight = *link;
+    if (!flight) {
+        return 0;
+    }
+    *link = flight->next;
+
+    size_t              notified = 0;
+    SingleFlightWaiter* waiter   = flight->head;
+    while (waiter) {
+        SingleFlightWaiter* next = waiter->next;
+        table->deliver(waiter->callback, waiter->context, result, value);
+        free(waiter);
+        waiter = next;
+        notified++;
+    }
+
+    free(flight);
+    return notified;
+}
+
+size_t single_flight_waiters(SingleFlightTable* table, const char* key) {
+    if (!table || !key) {
+        return 0;
+    }
+
+    SingleFlight* flight = find_flight(table, key);
+    return flight ? flight->waiter_count : 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * single_flight.h - Request coalescing for identical upstream lookups
+ *
+ * Tracks in-flight fetches by cache key. The first miss for a key becomes
+ * the leader and starts the upstream request; later misses for the same key
+ * attach as waiters. When the leader completes, every waiter receives the
+ * same result and the flight is removed.
+ *
+ * The table is type-agnostic: callbacks are stored as generic function
+ * pointers and handed back to a per-table deliver function, which casts
+ * them to the API-specific callback type.
+ */
+
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <stddef.h>
+
+/* Return values of single_flight_join */
+#define SINGLE_FLIGHT_LEADER 1 /* Caller must start the fetch */
+#define SINGLE_FLIGHT_WAITER 0 /* Attached to an in-flight fetch */
+#define SINGLE_FLIGHT_ERROR -1 /* Invalid parameter or out of memory */
+
+/* Generic callback pointer; cast back to the real type in the deliver fn */
+typedef void (*SingleFlightCallback)(void);
+
+/**
+ * Deliver a flight result to one waiter.
+ *
+ * @param callback  Waiter callback as passed to single_flight_join
+ * @param context   Waiter context as passed to single_flight_join
+ * @param result    Result code passed to single_flight_complete
+ * @param value     Result value passed to single_flight_complete
+ */
+typedef void (*SingleFlightDeliver)(SingleFlightCallback callback,
+                                    void* context, int result,
+                                    const void* value);
+
+/* Opaque table handle */
+typedef struct SingleFlightTable SingleFlightTable;
+
+/**
+ * Create an empty single-flight table.
+ *
+ * @param deliver  Function used to invoke waiter callbacks
+ * @return         Table handle, or NULL on error
+ */
+SingleFlightTable* single_flight_create(SingleFlightDeliver deliver);
+
+/**
+ * Destroy a table. Pending waiters are dropped without being called.
+ *
+ * @param table  Table to destroy (NULL is allowed)
+ */
+void single_flight_destroy(SingleFlightTable* table);
+
+/**
+ * Attach a waiter to the flight for key, creating the flight if needed.
+ *
+ * @param table     Table handle
+ * @param key       Cache key identifying the upstream lookup
+ * @param callback  Waiter callback (cast to SingleFlightCallback)
+ * @param context   Waiter context
+ * @return          SINGLE_FLIGHT_LEADER if the caller must start the fetch,
+ *                  SINGLE_FLIGHT_WAITER if a fetch is already in flight,
+ *                  SINGLE_FLIGHT_ERROR on failure (waiter not attached)
+ */
+int single_flight_join(SingleFlightTable* table, const char* key,
+                       SingleFlightCallback callback, void* context);
+
+/**
+ * Complete the flight for key: deliver the result to every waiter in join
+ * order and remove the flight. The flight is detached before any callback
+ * runs, so callbacks may safely start a new flight for the same key.
+ *
+ * @param table   Table handle
+ * @param key     Cache key of the completed lookup
+ * @param result  Result code forwarded to the waiters
+ * @param value   Result value forwarded to the waiters (borrowed)
+ * @return        Number of waiters notified
+ */
+size_t single_flight_complete(SingleFlightTable* table, const char* key,
+                              int result, const void* value);
+
+/**
+ * Number of waiters attached to the flight for key (0 if none in flight).
+ */
+size_t single_flight_waiters(SingleFlightTable* table, const char* key);
+
+#endif /* SINGLE_FLIGHT_H */
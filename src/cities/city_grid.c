@@ -0,0 +1,201 @@
+/**
+ * city_grid.c - Spatial grid implementation
+ */
+
+#include "city_grid.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRID_ROWS 180 /* 1 degree latitude bands, -90..90 */
+#define GRID_COLS 360 /* 1 degree longitude bands, -180..180 */
+#define GRID_CELLS (GRID_ROWS * GRID_COLS)
+
+#define EARTH_RADIUS_KM 6371.0
+#define KM_PER_DEGREE 111.195 /* Along a meridian */
+#define DEG_TO_RAD (3.14159265358979323846 / 180.0)
+
+/* ============= Internal Structure ============= */
+
+/* Cities are stored cell by cell: cell c owns [cell_start[c],
+ * cell_start[c + 1]) of the id and coordinate arrays */
+struct CityGrid {
+    uint32_t* cell_start; /* GRID_CELLS + 1 offsets */
+    uint32_t* ids;
+    float*    lat;
+    float*    lon;
+    uint32_t  count;
+};
+
+/* ============= Internal Helpers ============= */
+
+static int row_of(double latitude) {
+    int row = (int)floor(latitude + 90.0);
+    return row < 0 ? 0 : (row >= GRID_ROWS ? GRID_ROWS - 1 : row);
+}
+
+static int col_of(double longitude) {
+    int col = (int)floor(longitude + 180.0) % GRID_COLS;
+    return col < 0 ? col + GRID_COLS : col;
+}
+
+static double haversine_km(double lat1, double lon1, double lat2,
+                           double lon2) {
+    double dlat = (lat2 - lat1) * DEG_TO_RAD;
+    double dlon = (lon2 - lon1) * DEG_TO_RAD;
+    double a    = sin(dlat / 2) * sin(dlat / 2) +
+               cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) *
+                   sin(dlon / 2) * sin(dlon / 2);
+    return 2.0 * EARTH_RADIUS_KM * atan2(sqrt(a), sqrt(1.0 - a));
+}
+
+/**
+ * Insert a candidate into the distance-sorted result list
+ */
+static size_t insert_match(CityGridMatch* out, size_t found, size_t k,
+                           uint32_t id, double distance_km) {
+    if (found == k && distance_km >= out[found - 1].distance_km) {
+        return found;
+    }
+
+    size_t pos = found < k ? found++ : found - 1;
+    while (pos > 0 && distance_km < out[pos - 1].distance_km) {
+        out[pos] = out[pos - 1];
+        pos--;
+    }
+
+    out[pos].id          = id;
+    out[pos].distance_km = distance_km;
+    return found;
+}
+
+/* ============= Public API ============= */
+
+int city_grid_build(const CityIndex* index, CityGrid** out_grid) {
+    if (!index || !out_grid) {
+        return CITY_INDEX_ERROR_PARAM;
+    }
+
+    size_t    count = city_index_count(index);
+    CityGrid* grid  = calloc(1, sizeof(CityGrid));
+    if (!grid) {
+        return CITY_INDEX_ERROR_MEMORY;
+    }
+
+    grid->count      = (uint32_t)count;
+    grid->cell_start = calloc(GRID_CELLS + 1, sizeof(uint32_t));
+    grid->ids        = malloc((count + 1) * sizeof(uint32_t));
+    grid->lat        = malloc((count + 1) * sizeof(float));
+    grid->lon        = malloc((count + 1) * sizeof(float));
+    uint32_t* cells  = malloc((count + 1) * sizeof(uint32_t));
+
+    if (!grid->cell_start || !grid->ids || !grid->lat || !grid->lon ||
+        !cells) {
+        free(cells);
+        city_grid_free(grid);
+        return CITY_INDEX_ERROR_MEMORY;
+    }
+
+    /* Pass 1: count cities per cell */
+    for (uint32_t id = 0; id < count; id++) {
+        CityIndexEntry entry;
+        city_index_get(index, id, &entry);
+        cells[id] = (uint32_t)(row_of(entry.latitude) * GRID_COLS +
+                               col_of(entry.longitude));
+        grid->cell_start[cells[id] + 1]++;
+    }
+
+    for (size_t c = 0; c < GRID_CELLS; c++) {
+        grid->cell_start[c + 1] += grid->cell_start[c];
+    }
+
+    /* Pass 2: scatter ids and coordinates into their cells */
+    uint32_t* fill = malloc(GRID_CELLS * sizeof(uint32_t));
+    if (!fill) {
+        free(cells);
+        city_grid_free(grid);
+        return CITY_INDEX_ERROR_MEMORY;
+    }
+    memcpy(fill, grid->cell_start, GRID_CELLS * sizeof(uint32_t));
+
+    for (uint32_t id = 0; id < count; id++) {
+        CityIndexEntry entry;
+        city_index_get(index, id, &entry);
+
+        uint32_t slot   = fill[cells[id]]++;
+        grid->ids[slot] = id;
+        grid->lat[slot] = entry.latitude;
+        grid->lon[slot] = entry.longitude;
+    }
+
+    free(fill);
+    free(cells);
+
+    *out_grid = grid;
+    return CITY_INDEX_OK;
+}
+
+void city_grid_free(CityGrid* grid) {
+    if (!grid) {
+        return;
+    }
+
+    free(grid->cell_start);
+    free(grid->ids);
+    free(grid->lat);
+    free(grid->lon);
+    free(grid);
+}
+
+size_t city_grid_nearest(const CityGrid* grid, double latitude,
+                         double longitude, size_t k, double max_km,
+                         CityGridMatch* out) {
+    if (!grid || !out || k == 0 || max_km <= 0 || latitude < -90.0 ||
+        latitude > 90.0 || longitude < -180.0 || longitude > 180.0) {
+        return 0;
+    }
+
+    /* Cells overlapping the bounding box of the search circle. Longitude
+     * degrees shrink with latitude, so widen the box towards the poles. */
+    double dlat    = max_km / KM_PER_DEGREE;
+    double lat_min = latitude - dlat;
+    double lat_max = latitude + dlat;
+    double edge    = fmax(fabs(lat_min), fabs(lat_max));
+    int    dcols   = GRID_COLS / 2;
+
+    if (edge < 89.0) {
+        double dlon = dlat / cos(edge * DEG_TO_RAD);
+        if (dlon < GRID_COLS / 2) {
+            dcols = (int)ceil(dlon) + 1;
+        }
+    }
+
+    int    row_lo = row_of(lat_min);
+    int    row_hi = row_of(lat_max);
+    int    col    = col_of(longitude);
+    size_t found  = 0;
+
+    for (int row = row_lo; row <= row_hi; row++) {
+        for (int dc = -dcols; dc <= dcols; dc++) {
+            if (dcols == GRID_COLS / 2 && dc == dcols) {
+                break; /* Whole band already covered */
+            }
+
+            int      c     = (col + dc + GRID_COLS) % GRID_COLS;
+            size_t   cell  = (size_t)row * GRID_COLS + c;
+            uint32_t begin = grid->cell_start[cell];
+            uint32_t end   = grid->cell_start[cell + 1];
+
+            for (uint32_t i = begin; i < end; i++) {
+                double d = haversine_km(latitude, longitude, grid->lat[i],
+                                        grid->lon[i]);
+                if (d <= max_km) {
+                    found = insert_match(out, found, k, grid->ids[i], d);
+                }
+            }
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,57 @@
+/**
+ * city_grid.h - Spatial grid over the city index for reverse geocoding
+ *
+ * Buckets every city of a CityIndex into 1x1 degree cells (compressed,
+ * one flat id array plus per-cell offsets). A nearest-city query only
+ * visits the cells overlapping the search radius, so it costs a few
+ * hundred distance checks at most and never touches the network.
+ */
+
+#ifndef CITY_GRID_H
+#define CITY_GRID_H
+
+#include "city_index.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* One nearest-city result */
+typedef struct {
+    uint32_t id;          /* City index entry id */
+    double   distance_km; /* Great-circle distance from the query point */
+} CityGridMatch;
+
+/* Opaque grid handle */
+typedef struct CityGrid CityGrid;
+
+/**
+ * Build a grid from all cities of an index. The grid keeps its own copy of
+ * the coordinates; the index must outlive it only for city_index_get.
+ *
+ * @param index     Source city index
+ * @param out_grid  Output handle (release with city_grid_free)
+ * @return          CITY_INDEX_OK or a negative CITY_INDEX_ERROR_* code
+ */
+int city_grid_build(const CityIndex* index, CityGrid** out_grid);
+
+/**
+ * Free a grid (NULL is allowed).
+ */
+void city_grid_free(CityGrid* grid);
+
+/**
+ * Find up to k cities closest to a point, nearest first.
+ *
+ * @param grid       Grid handle
+ * @param latitude   Query latitude in degrees
+ * @param longitude  Query longitude in degrees
+ * @param k          Capacity of out
+ * @param max_km     Search radius in kilometres
+ * @param out        Output matches
+ * @return           Number of matches written
+ */
+size_t city_grid_nearest(const CityGrid* grid, double latitude,
+                         double longitude, size_t k, double max_km,
+                         CityGridMatch* out);
+
+#endif /* CITY_GRID_H */
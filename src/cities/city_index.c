@@ -0,0 +1,406 @@
+/**
+ * city_index.c - Memory-mapped binary city index implementation
+ */
+
+#include "city_index.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ============= File Format ============= */
+
+#define CITY_INDEX_MAGIC "JWCI"
+#define CITY_INDEX_VERSION 2
+#define CITY_FLAG_HOT 0x01
+#define CITY_INDEX_NO_ENTRY 0xFFFFFFFFu /* Padding in prefix top lists */
+
+/* Section order in the header, see scripts/build_city_index.py */
+enum {
+    SECTION_NORM_NAME = 0,
+    SECTION_NAME,
+    SECTION_COUNTRY,
+    SECTION_CODE,
+    SECTION_LAT,
+    SECTION_LON,
+    SECTION_POPULATION,
+    SECTION_FLAGS,
+    SECTION_POOL,
+    SECTION_PREFIX,
+    SECTION_PREFIX_TOP,
+    SECTION_COUNT
+};
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t pool_size;
+    uint32_t prefix_count;
+    uint32_t sections[SECTION_COUNT];
+} CityIndexHeader;
+
+_Static_assert(sizeof(CityIndexHeader) == 64, "index header must be 64 bytes");
+
+struct CityIndex {
+    void*           map;
+    size_t          map_size;
+    uint32_t        count;
+    const uint32_t* norm_name;
+    const uint32_t* name;
+    const uint32_t* country;
+    const uint32_t* code;
+    const float*    lat;
+    const float*    lon;
+    const uint32_t* population;
+    const uint8_t*  flags;
+    const char*     pool;
+    uint32_t        pool_size;
+    uint32_t        prefix_count;
+    const uint32_t* prefix;     /* Sorted pool offsets of hot prefixes */
+    const uint32_t* prefix_top; /* CITY_INDEX_TOP_K ids per prefix */
+};
+
+/* ============= Normalization Tables ============= */
+
+/*
+ * ASCII fold for U+00C0..U+024F and U+1E00..U+1EFF, generated from
+ * normalize_city_name() in scripts/generate_city_datasets.py. '.' means the
+ * code point is dropped. Multi-letter folds are handled in fold_multi().
+ */
+static const char LATIN_FOLD[] =
+    "aaaaaaaceeeeiiiidnooooo.ouuuuytsaaaaaaaceeeeiiiidnooooo.ouuuuyty"
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghh..iiiiiiiii...jjkk.llllll."
+    ".llnnnnnn...oooooooorrrrrrsssssssstttt..uuuuuuuuuuuuwwyyyzzzzzz."
+    "................................oo.............uu..............."
+    ".............aaiioouuuuuuuuuu.aaaa....ggkkoooo..j...gg..nnaa...."
+    "aaaaeeeeiiiioooorrrruuuusstt..hh......aaeeooooooooyy............"
+    "................";
+
+static const char LATIN_EXTENDED_FOLD[] =
+    "aabbbbbbccddddddddddeeeeeeeeeeffgghhhhhhhhhhiiiikkkkkkllllllllmm"
+    "mmmmnnnnnnnnoooooooopppprrrrrrrrssssssssssttttttttuuuuuuuuuuvvvv"
+    "wwwwwwwwwwxxxxyyzzzzzzhtwy....s.aaaaaaaaaaaaaaaaaaaaaaaaeeeeeeee"
+    "eeeeeeeeiiiioooooooooooooooooooooooouuuuuuuuuuuuuuyyyyyyyy......";
+
+static const char* fold_multi(uint32_t cp) {
+    switch (cp) {
+    case 0x00C6: /* Æ */
+    case 0x00E6: /* æ */
+        return "ae";
+    case 0x00DE: /* Þ */
+    case 0x00FE: /* þ */
+        return "th";
+    case 0x00DF: /* ß */
+    case 0x1E9E: /* ẞ */
+        return "ss";
+    case 0x0152: /* Œ */
+    case 0x0153: /* œ */
+        return "oe";
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * Decode one UTF-8 sequence. Invalid bytes decode as U+FFFD and consume one
+ * byte, which the fold then drops.
+ */
+static uint32_t utf8_decode(const unsigned char** p) {
+    const unsigned char* s = *p;
+    uint32_t             cp;
+    int                  extra;
+
+    if (s[0] < 0x80) {
+        *p = s + 1;
+        return s[0];
+    } else if ((s[0] & 0xE0) == 0xC0) {
+        cp    = s[0] & 0x1F;
+        extra = 1;
+    } else if ((s[0] & 0xF0) == 0xE0) {
+        cp    = s[0] & 0x0F;
+        extra = 2;
+    } else if ((s[0] & 0xF8) == 0xF0) {
+        cp    = s[0] & 0x07;
+        extra = 3;
+    } else {
+        *p = s + 1;
+        return 0xFFFD;
+    }
+
+    for (int i = 1; i <= extra; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *p = s + 1;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+
+    *p = s + extra + 1;
+    return cp;
+}
+
+/* ============= Internal Helpers ============= */
+
+static const char* pool_string(const CityIndex* index, uint32_t offset) {
+    return offset < index->pool_size ? index->pool + offset : "";
+}
+
+static const void* section_ptr(const void* map, int section) {
+    const CityIndexHeader* header = (const CityIndexHeader*)map;
+    return (const char*)map + header->sections[section];
+}
+
+static bool section_fits(const CityIndexHeader* header, size_t file_size,
+                         int section, size_t length) {
+    size_t offset = header->sections[section];
+    return offset >= sizeof(CityIndexHeader) && offset % 4 == 0 &&
+           offset <= file_size && length <= file_size - offset;
+}
+
+/**
+ * Ranking used by search: hot cities first, then larger population
+ */
+static bool ranks_before(const CityIndex* index, uint32_t a, uint32_t b) {
+    bool hot_a = index->flags[a] & CITY_FLAG_HOT;
+    bool hot_b = index->flags[b] & CITY_FLAG_HOT;
+    if (hot_a != hot_b) {
+        return hot_a;
+    }
+    return index->population[a] > index->population[b];
+}
+
+/* ============= Public API ============= */
+
+size_t city_index_normalize(const char* input, char* out, size_t out_size) {
+    if (!out || out_size == 0) {
+        return 0;
+    }
+
+    size_t len = 0;
+    if (!input) {
+        out[0] = '\0';
+        return 0;
+    }
+
+    const unsigned char* p = (const unsigned char*)input;
+    while (*p && len + 1 < out_size) {
+        uint32_t    cp    = utf8_decode(&p);
+        const char* multi = fold_multi(cp);
+        char        c     = '.';
+
+        if (multi) {
+            for (; *multi && len + 1 < out_size; multi++) {
+                out[len++] = *multi;
+            }
+            continue;
+        }
+
+        if (cp < 0x80) {
+            c = (char)cp;
+            if (c >= 'A' && c <= 'Z') {
+                c = (char)(c - 'A' + 'a');
+            }
+        } else if (cp >= 0x00C0 && cp < 0x00C0 + sizeof(LATIN_FOLD) - 1) {
+            c = LATIN_FOLD[cp - 0x00C0];
+        } else if (cp >= 0x1E00 &&
+                   cp < 0x1E00 + sizeof(LATIN_EXTENDED_FOLD) - 1) {
+            c = LATIN_EXTENDED_FOLD[cp - 0x1E00];
+        }
+
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == ' ' ||
+            c == '-' || c == '_') {
+            out[len++] = c;
+        }
+    }
+
+    out[len] = '\0';
+    return len;
+}
+
+int city_index_open(const char* path, CityIndex** out_index) {
+    if (!path || !out_index) {
+        return CITY_INDEX_ERROR_PARAM;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return CITY_INDEX_ERROR_IO;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CityIndexHeader)) {
+        close(fd);
+        return CITY_INDEX_ERROR_FORMAT;
+    }
+
+    size_t file_size = (size_t)st.st_size;
+    void*  map       = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return CITY_INDEX_ERROR_MEMORY;
+    }
+
+    const CityIndexHeader* header = (const CityIndexHeader*)map;
+    size_t                 count  = header->count;
+    size_t                 prefix = header->prefix_count;
+
+    if (memcmp(header->magic, CITY_INDEX_MAGIC, 4) != 0 ||
+        header->version != CITY_INDEX_VERSION || header->pool_size == 0 ||
+        !section_fits(header, file_size, SECTION_NORM_NAME, count * 4) ||
+        !section_fits(header, file_size, SECTION_NAME, count * 4) ||
+        !section_fits(header, file_size, SECTION_COUNTRY, count * 4) ||
+        !section_fits(header, file_size, SECTION_CODE, count * 4) ||
+        !section_fits(header, file_size, SECTION_LAT, count * 4) ||
+        !section_fits(header, file_size, SECTION_LON, count * 4) ||
+        !section_fits(header, file_size, SECTION_POPULATION, count * 4) ||
+        !section_fits(header, file_size, SECTION_FLAGS, count) ||
+        !section_fits(header, file_size, SECTION_POOL, header->pool_size) ||
+        !section_fits(header, file_size, SECTION_PREFIX, prefix * 4) ||
+        !section_fits(header, file_size, SECTION_PREFIX_TOP,
+                      prefix * CITY_INDEX_TOP_K * 4)) {
+        munmap(map, file_size);
+        return CITY_INDEX_ERROR_FORMAT;
+    }
+
+    const char* pool = section_ptr(map, SECTION_POOL);
+    if (pool[header->pool_size - 1] != '\0') {
+        munmap(map, file_size); /* Last string must be terminated */
+        return CITY_INDEX_ERROR_FORMAT;
+    }
+
+    CityIndex* index = calloc(1, sizeof(CityIndex));
+    if (!index) {
+        munmap(map, file_size);
+        return CITY_INDEX_ERROR_MEMORY;
+    }
+
+    index->map          = map;
+    index->map_size     = file_size;
+    index->count        = header->count;
+    index->norm_name    = section_ptr(map, SECTION_NORM_NAME);
+    index->name         = section_ptr(map, SECTION_NAME);
+    index->country      = section_ptr(map, SECTION_COUNTRY);
+    index->code         = section_ptr(map, SECTION_CODE);
+    index->lat          = section_ptr(map, SECTION_LAT);
+    index->lon          = section_ptr(map, SECTION_LON);
+    index->population   = section_ptr(map, SECTION_POPULATION);
+    index->flags        = section_ptr(map, SECTION_FLAGS);
+    index->pool         = pool;
+    index->pool_size    = header->pool_size;
+    index->prefix_count = header->prefix_count;
+    index->prefix       = section_ptr(map, SECTION_PREFIX);
+    index->prefix_top   = section_ptr(map, SECTION_PREFIX_TOP);
+
+    /* Lookups are binary searches; read-ahead would only waste page cache */
+    madvise(map, file_size, MADV_RANDOM);
+
+    *out_index = index;
+    return CITY_INDEX_OK;
+}
+
+void city_index_close(CityIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    munmap(index->map, index->map_size);
+    free(index);
+}
+
+size_t city_index_count(const CityIndex* index) {
+    return index ? index->count : 0;
+}
+
+int city_index_get(const CityIndex* index, uint32_t id, CityIndexEntry* out) {
+    if (!index || !out || id >= index->count) {
+        return CITY_INDEX_ERROR_PARAM;
+    }
+
+    out->name         = pool_string(index, index->name[id]);
+    out->country      = pool_string(index, index->country[id]);
+    out->country_code = pool_string(index, index->code[id]);
+    out->latitude     = index->lat[id];
+    out->longitude    = index->lon[id];
+    out->population   = index->population[id];
+    out->hot          = index->flags[id] & CITY_FLAG_HOT;
+
+    return CITY_INDEX_OK;
+}
+
+size_t city_index_search(const CityIndex* index, const char* query,
+                         uint32_t* out_ids, size_t max_ids) {
+    if (!index || !query || !out_ids || max_ids == 0) {
+        return 0;
+    }
+
+    char   prefix[CITY_INDEX_MAX_NAME];
+    size_t prefix_len = city_index_normalize(query, prefix, sizeof(prefix));
+    if (prefix_len == 0) {
+        return 0;
+    }
+
+    /* Popular prefix: copy the precomputed ranking */
+    uint32_t lo = 0;
+    uint32_t hi = index->prefix_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int      cmp = strcmp(pool_string(index, index->prefix[mid]), prefix);
+        if (cmp == 0) {
+            const uint32_t* top =
+                &index->prefix_top[(size_t)mid * CITY_INDEX_TOP_K];
+            size_t found = 0;
+            while (found < max_ids && found < CITY_INDEX_TOP_K &&
+                   top[found] != CITY_INDEX_NO_ENTRY &&
+                   top[found] < index->count) {
+                out_ids[found] = top[found];
+                found++;
+            }
+            return found;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* Lower bound: first name >= prefix */
+    lo = 0;
+    hi = index->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strcmp(pool_string(index, index->norm_name[mid]), prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* Keep the best max_ids of the (short) prefix range, sorted by rank */
+    size_t found = 0;
+    for (uint32_t id = lo; id < index->count; id++) {
+        const char* name = pool_string(index, index->norm_name[id]);
+        if (strncmp(name, prefix, prefix_len) != 0) {
+            break;
+        }
+
+        if (found == max_ids && !ranks_before(index, id, out_ids[found - 1])) {
+            continue;
+        }
+
+        size_t pos = found < max_ids ? found++ : found - 1;
+        while (pos > 0 && ranks_before(index, id, out_ids[pos - 1])) {
+            out_ids[pos] = out_ids[pos - 1];
+            pos--;
+        }
+        out_ids[pos] = id;
+    }
+
+    return found;
+}
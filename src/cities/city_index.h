@@ -0,0 +1,99 @@
+/**
+ * city_index.h - Memory-mapped binary city index
+ *
+ * Read-only view of data/cities.idx, generated at build time by
+ * scripts/build_city_index.py. Opening the index maps the file and checks
+ * its header; no parsing happens and pages are only faulted in when a
+ * search touches them, so every server process shares the same memory.
+ *
+ * Entries are sorted by normalized name, which makes prefix search a
+ * binary search over the name array. Prefixes that match many names (short
+ * autocomplete queries like "sa") have their ranked top results
+ * precomputed, so no query scans more than a few dozen entries.
+ */
+
+#ifndef CITY_INDEX_H
+#define CITY_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CITY_INDEX_DEFAULT_PATH "./data/cities.idx"
+#define CITY_INDEX_MAX_NAME 128 /* Normalized query buffer size */
+#define CITY_INDEX_TOP_K 10     /* Precomputed results per prefix */
+
+/* Result codes */
+#define CITY_INDEX_OK 0
+#define CITY_INDEX_ERROR_PARAM -1  /* Invalid parameter */
+#define CITY_INDEX_ERROR_IO -2     /* File missing or unreadable */
+#define CITY_INDEX_ERROR_FORMAT -3 /* Bad magic, version or layout */
+#define CITY_INDEX_ERROR_MEMORY -4 /* Allocation or mmap failed */
+
+/* One city, pointing into the mapped string pool */
+typedef struct {
+    const char* name;         /* Display name (UTF-8) */
+    const char* country;      /* Country name */
+    const char* country_code; /* ISO 3166-1 alpha-2 */
+    float       latitude;
+    float       longitude;
+    uint32_t    population;
+    bool        hot; /* Listed in hot_cities.json */
+} CityIndexEntry;
+
+/* Opaque index handle */
+typedef struct CityIndex CityIndex;
+
+/**
+ * Map an index file read-only and validate its header.
+ *
+ * @param path       Path to the index file
+ * @param out_index  Output handle (release with city_index_close)
+ * @return           CITY_INDEX_OK or a negative CITY_INDEX_ERROR_* code
+ */
+int city_index_open(const char* path, CityIndex** out_index);
+
+/**
+ * Unmap the index and free the handle (NULL is allowed).
+ */
+void city_index_close(CityIndex* index);
+
+/**
+ * Number of cities in the index.
+ */
+size_t city_index_count(const CityIndex* index);
+
+/**
+ * Read one entry. Strings stay valid until city_index_close.
+ *
+ * @return CITY_INDEX_OK, or CITY_INDEX_ERROR_PARAM if id is out of range
+ */
+int city_index_get(const CityIndex* index, uint32_t id, CityIndexEntry* out);
+
+/**
+ * Prefix search on normalized names. Matches are ranked hot cities first,
+ * then by population. Results beyond CITY_INDEX_TOP_K are only returned
+ * for prefixes that are not in the precomputed table.
+ *
+ * @param index    Index handle
+ * @param query    User query (UTF-8, normalized internally)
+ * @param out_ids  Output entry ids, best match first
+ * @param max_ids  Capacity of out_ids
+ * @return         Number of ids written
+ */
+size_t city_index_search(const CityIndex* index, const char* query,
+                         uint32_t* out_ids, size_t max_ids);
+
+/**
+ * Normalize a UTF-8 city name the way the index generator does: fold Latin
+ * accents to ASCII, transliterate ligatures, lowercase, and keep only
+ * a-z, 0-9, space, '-' and '_'.
+ *
+ * @param input     UTF-8 input
+ * @param out       Output buffer
+ * @param out_size  Size of out (always NUL-terminated when > 0)
+ * @return          Length of the normalized string
+ */
+size_t city_index_normalize(const char* input, char* out, size_t out_size);
+
+#endif /* CITY_INDEX_H */
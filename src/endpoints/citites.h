@@ -1,22 +1,72 @@
+#include "http_request.h"
 #include "weather_location_handler.h"
+#include "weather_server_instance.h"
 
 #include <http_utils.h>
 #include <stdlib.h>
 #include <string.h>
 
-int handle_weather_by_city(HTTPServerConnection* conn, const char* query) {
-    char* json_response = NULL;
-    int   status_code   = 0;
+typedef struct {
+    WeatherServerReply reply;
+} WeatherRouteContext;
 
-    weather_location_handler_by_city(query, &json_response, &status_code);
+static int weather_route_callback(char* json_response, int status_code,
+                                  const HttpCacheInfo* cache_info, void* ctx) {
+    WeatherRouteContext*  context = (WeatherRouteContext*)ctx;
+    HTTPServerConnection* conn =
+        context ? weather_server_reply_take(&context->reply) : NULL;
+    if (!conn) {
+        return 0; /* The client is gone */
+    }
 
     if (!json_response) {
+        send_json_error(conn, 500, "Failed to fetch weather data for city");
+    } else {
+        http_cache_send(conn, status_code, "application/json", json_response,
+                        strlen(json_response), cache_info);
+    }
+    return 0;
+}
+
+int handle_weather_by_city(HTTPServerConnection* conn, const char* query,
+                           WeatherServerInstance* instance) {
+    RequestArena* arena = &instance->arena;
+
+    /* Lives in the request arena, no free needed */
+    WeatherRouteContext* ctx =
+        request_arena_alloc(arena, sizeof(WeatherRouteContext));
+    if (!ctx) {
         return send_json_error(conn, 500,
                                "Failed to fetch weather data for city");
     }
 
-    int ret = send_response(conn, status_code, "application/json",
-                            json_response, strlen(json_response));
-    free(json_response);
-    return ret;
+    ctx->reply = weather_server_instance_defer(instance);
+
+    /* The request stays in flight until weather_route_callback runs;
+     * errors are answered through the callback as well */
+    weather_location_handler_by_city_async(query, arena,
+                                           weather_route_callback, ctx);
+    return 0;
+}
+
+int handle_weather_batch(HTTPServerConnection* conn, const char* query,
+                         WeatherServerInstance* instance) {
+    RequestArena* arena = &instance->arena;
+
+    WeatherRouteContext* ctx =
+        request_arena_alloc(arena, sizeof(WeatherRouteContext));
+    if (!ctx) {
+        return send_json_error(conn, 500, "Failed to fetch weather data");
+    }
+
+    ctx->reply = weather_server_instance_defer(instance);
+
+    /* POST carries the location list as a JSON body */
+    size_t      body_length = 0;
+    const char* body        = strcmp(conn->method, "POST") == 0
+                                  ? http_request_body(conn, &body_length)
+                                  : NULL;
+    weather_location_handler_batch_async(query, body, body_length, arena,
+                                         weather_route_callback, ctx);
+    return 0;
 }
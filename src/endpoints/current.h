@@ -1,22 +1,53 @@
 #include "open_meteo_handler.h"
+#include "weather_location_handler.h"
+#include "weather_server_instance.h"
 
 #include <http_utils.h>
 #include <stdlib.h>
 #include <string.h>
 
-int handle_current_weather(HTTPServerConnection* conn, const char* query) {
-    char* json_response = NULL;
-    int   status_code   = 0;
+typedef struct {
+    WeatherServerReply reply;
+} CurrentRouteContext;
 
-    open_meteo_handler_current(query, &json_response, &status_code);
+static int current_route_callback(char* json_response, int status_code,
+                                  const HttpCacheInfo* cache_info, void* ctx) {
+    CurrentRouteContext*  context = (CurrentRouteContext*)ctx;
+    HTTPServerConnection* conn =
+        context ? weather_server_reply_take(&context->reply) : NULL;
+    if (!conn) {
+        return 0; /* The client is gone */
+    }
 
     if (!json_response) {
+        send_json_error(conn, 500,
+                        "Failed to fetch weather data from Open-Meteo API");
+    } else {
+        http_cache_send(conn, status_code, "application/json", json_response,
+                        strlen(json_response), cache_info);
+    }
+    return 0;
+}
+
+int handle_current_weather(HTTPServerConnection* conn, const char* query,
+                           WeatherServerInstance* instance) {
+    RequestArena* arena = &instance->arena;
+
+    /* Lives in the request arena, no free needed */
+    CurrentRouteContext* ctx =
+        request_arena_alloc(arena, sizeof(CurrentRouteContext));
+    if (!ctx) {
         return send_json_error(
             conn, 500, "Failed to fetch weather data from Open-Meteo API");
     }
 
-    int ret = send_response(conn, status_code, "application/json",
-                            json_response, strlen(json_response));
-    free(json_response);
-    return ret;
+    ctx->reply = weather_server_instance_defer(instance);
+
+    /* Shared init: caches, request coalescing and the nearest-city grid */
+    weather_location_handler_init();
+
+    /* The request stays in flight until current_route_callback runs;
+     * errors are answered through the callback as well */
+    open_meteo_handler_current_async(query, arena, current_route_callback, ctx);
+    return 0;
 }
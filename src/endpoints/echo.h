@@ -1,6 +1,10 @@
+#include "request_arena.h"
+#include "weather_server_instance.h"
+
 #include <http_utils.h>
 
-int handle_echo(HTTPServerConnection* conn, const char* query) {
+int handle_echo(HTTPServerConnection* conn, const char* query,
+                WeatherServerInstance* instance) {
     size_t body_len = conn->read_buffer_size;
     return send_response(conn, 200, "text/plain", (char*)conn->read_buffer,
                          body_len);
@@ -1,37 +1,67 @@
 // In your routes file
 #include "api/elpris/elpris_api.h"
+#include "api/elpris/elpris_cache.h"
+#include "http_cache.h"
+#include "request_arena.h"
+#include "weather_server_instance.h"
 
 #include <http_server_connection.h>
 #include <http_utils.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+/* Published prices never change; the limit only bounds client caches */
+#define ELPRIS_ROUTE_MAX_AGE 3600
 
 typedef struct {
-    HTTPServerConnection* conn;
+    WeatherServerReply reply;
 } ElprisRouteContext;
 
-static int elpris_route_callback(char* json_data, void* ctx) {
-    ElprisRouteContext* context = (ElprisRouteContext*)ctx;
-    if (context && context->conn) {
-        if (!json_data) {
-            send_json_error(context->conn, 404, "no data that matches query");
-            free(context);
-            return 0;
-        };
-        send_response(context->conn, 200, "application/json", json_data,
-                      strlen(json_data));
+static void elpris_route_callback(int result, const ElprisDay* day,
+                                  void* ctx) {
+    ElprisRouteContext*   context = (ElprisRouteContext*)ctx;
+    HTTPServerConnection* conn =
+        context ? weather_server_reply_take(&context->reply) : NULL;
+    if (!conn) {
+        return; /* The client is gone */
     }
-    free(context);
-    return 0;
+
+    if (result != 0 || !day) {
+        send_json_error(conn, 404, "no data that matches query");
+        return;
+    }
+
+    HttpCacheInfo cache_info = {.etag          = day->etag,
+                                .gzip_body     = day->gzip_json,
+                                .gzip_length   = day->gzip_length,
+                                .last_modified = day->fetched_at,
+                                .expires_at    = time(NULL) +
+                                              ELPRIS_ROUTE_MAX_AGE};
+
+    http_cache_send(conn, 200, "application/json", day->json,
+                    day->json_length, &cache_info);
 }
 
-int handle_elpris_route(HTTPServerConnection* conn, const char* query) {
-    ElprisRouteContext* ctx = malloc(sizeof(ElprisRouteContext));
+int handle_elpris_route(HTTPServerConnection* conn, const char* query,
+                        WeatherServerInstance* instance) {
+    unsigned int year, month, day;
+    char         price_group[4];
+    if (elpris_api_parse_query(query, &year, &month, &day, price_group) != 0) {
+        send_json_error(conn, 404, "no data that matches query");
+        return 0;
+    }
+
+    /* Lives in the request arena, no free needed */
+    ElprisRouteContext* ctx =
+        request_arena_alloc(&instance->arena, sizeof(ElprisRouteContext));
     if (!ctx) {
         return -1;
     }
 
-    ctx->conn = conn;
+    ctx->reply = weather_server_instance_defer(instance);
 
-    return elpris_api_fetch_query_async(query, elpris_route_callback, ctx);
+    elpris_cache_get_async(year, month, day, price_group,
+                           elpris_route_callback, ctx);
+    return 0;
 }
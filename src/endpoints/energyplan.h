@@ -0,0 +1,51 @@
+#include "energy_plan_handler.h"
+#include "http_cache.h"
+#include "request_arena.h"
+#include "weather_server_instance.h"
+
+#include <http_server_connection.h>
+#include <http_utils.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    WeatherServerReply reply;
+} EnergyPlanRouteContext;
+
+static int energy_plan_route_callback(char* json_response, int status_code,
+                                      const HttpCacheInfo* cache_info,
+                                      void*                ctx) {
+    EnergyPlanRouteContext* context = (EnergyPlanRouteContext*)ctx;
+    HTTPServerConnection*   conn =
+        context ? weather_server_reply_take(&context->reply) : NULL;
+    if (!conn) {
+        return 0; /* The client is gone */
+    }
+
+    if (!json_response) {
+        send_json_error(conn, 500, "Failed to build the energy plan");
+    } else {
+        http_cache_send(conn, status_code, "application/json", json_response,
+                        strlen(json_response), cache_info);
+    }
+    return 0;
+}
+
+int handle_energy_plan(HTTPServerConnection* conn, const char* query,
+                       WeatherServerInstance* instance) {
+    RequestArena* arena = &instance->arena;
+
+    /* Lives in the request arena, no free needed */
+    EnergyPlanRouteContext* ctx =
+        request_arena_alloc(arena, sizeof(EnergyPlanRouteContext));
+    if (!ctx) {
+        return send_json_error(conn, 500, "Failed to build the energy plan");
+    }
+
+    ctx->reply = weather_server_instance_defer(instance);
+
+    /* The request stays in flight until energy_plan_route_callback runs;
+     * errors are answered through the callback as well */
+    energy_plan_handler_async(query, arena, energy_plan_route_callback, ctx);
+    return 0;
+}
@@ -1,7 +1,25 @@
+#include "http_cache.h"
+#include "http_gzip.h"
+#include "request_arena.h"
+#include "weather_server_instance.h"
+#include "static_assets.h"
+
 #include <http_utils.h>
 #include <string.h>
+#include <time.h>
+
+#define HOMEPAGE_MAX_AGE 3600 /* Seconds */
+
+int handle_homepage(HTTPServerConnection* conn, const char* query,
+                    WeatherServerInstance* instance) {
+    /* The front-end from public/, when it was loaded at startup */
+    static const char  index_path[] = "/index.html";
+    const StaticAsset* page =
+        static_assets_find(index_path, sizeof(index_path) - 1);
+    if (page) {
+        return static_assets_send(conn, page);
+    }
 
-int handle_homepage(HTTPServerConnection* conn, const char* query) {
     const char* html = "<!DOCTYPE html>"
                        "<html>"
                        "<head><title>Just Weather</title></head>"
@@ -15,8 +33,13 @@ int handle_homepage(HTTPServerConnection* conn, const char* query) {
                        "weather by coordinates</li>"
                        "  <li><b>GET /v1/weather?city=NAME&country=CODE</b> - "
                        "weather by city name</li>"
+                       "  <li><b>GET|POST /v1/weather/batch</b> - weather for "
+                       "several cities or coordinates</li>"
                        "  <li><b>GET /v1/cities?query=SEARCH</b> - city search "
                        "(autocomplete)</li>"
+                       "  <li><b>GET /v1/energyplan?lat=XX&lon=YY&price=SE3</b>"
+                       " - battery plan from spot prices and solar forecast"
+                       "</li>"
                        "</ul>"
                        "<p>Source code on <a "
                        "href=\"https://github.com/Stockholm-3/"
@@ -24,5 +47,18 @@ int handle_homepage(HTTPServerConnection* conn, const char* query) {
                        "</body>"
                        "</html>";
 
-    return send_response(conn, 200, "text/html", html, strlen(html));
+    /* Compressed on first use and kept for the life of the process */
+    static char*  gzip_html   = NULL;
+    static size_t gzip_length = 0;
+    size_t        length      = strlen(html);
+
+    if (!gzip_html) {
+        http_gzip_compress(html, length, &gzip_html, &gzip_length);
+    }
+
+    HttpCacheInfo cache_info = {.gzip_body   = gzip_html,
+                                .gzip_length = gzip_length,
+                                .expires_at  = time(NULL) + HOMEPAGE_MAX_AGE};
+
+    return http_cache_send(conn, 200, "text/html", html, length, &cache_info);
 }
@@ -0,0 +1,248 @@
+#include "file_cache.h"
+#include "http_pool.h"
+#include "logger.h"
+#include "metrics.h"
+#include "request_arena.h"
+#include "reuseport.h"
+#include "weather_server_instance.h"
+
+#include <http_utils.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+#define METRICS_MAX_LABELS 320
+
+static const char* const g_status_classes[5] = {"1xx", "2xx", "3xx", "4xx",
+                                                "5xx"};
+
+static void write_route_metrics(MetricsText* text) {
+    char   labels[METRICS_MAX_LABELS];
+    size_t count = metrics_route_count();
+
+    metrics_text_family(text, "jws_http_request_duration_seconds", "histogram",
+                        "Time from dispatch until the response is queued");
+    for (size_t i = 0; i < count; i++) {
+        const MetricsRoute* route = metrics_route_get(i);
+        snprintf(labels, sizeof(labels), "method=\"%s\",route=\"%s\"",
+                 route->method, route->path);
+        metrics_text_histogram(text, "jws_http_request_duration_seconds",
+                               labels, &route->latency);
+    }
+
+    metrics_text_family(text, "jws_http_responses_total", "counter",
+                        "Responses sent, by route and status class");
+    for (size_t i = 0; i < count; i++) {
+        const MetricsRoute* route = metrics_route_get(i);
+        for (size_t c = 0; c < 5; c++) {
+            snprintf(labels, sizeof(labels),
+                     "method=\"%s\",route=\"%s\",code=\"%s\"", route->method,
+                     route->path, g_status_classes[c]);
+            metrics_text_sample(text, "jws_http_responses_total", labels,
+                                metrics_counter_get(&route->responses[c]));
+        }
+    }
+}
+
+/* cache label: the directory name, "./cache/geo_cache" -> geo_cache */
+static const char* file_cache_label(const FileCacheStats* stats) {
+    const char* slash = strrchr(stats->cache_dir, '/');
+    return slash ? slash + 1 : stats->cache_dir;
+}
+
+static void write_file_cache_metrics(MetricsText* text) {
+    char labels[METRICS_MAX_LABELS];
+
+    metrics_text_family(text, "jws_file_cache_lookups_total", "counter",
+                        "File cache lookups, by cache and outcome");
+    for (FileCacheInstance* cache = file_cache_next(NULL); cache;
+         cache                    = file_cache_next(cache)) {
+        FileCacheStats stats;
+        file_cache_get_stats(cache, &stats);
+
+        const char* name      = file_cache_label(&stats);
+        const char* names[4]  = {"memory_hit", "disk_hit", "miss", "expired"};
+        uint64_t    values[4] = {stats.memory_hits, stats.disk_hits,
+                                 stats.misses, stats.expired};
+        for (size_t i = 0; i < 4; i++) {
+            snprintf(labels, sizeof(labels), "cache=\"%s\",result=\"%s\"",
+                     name, names[i]);
+            metrics_text_sample(text, "jws_file_cache_lookups_total", labels,
+                                values[i]);
+        }
+    }
+
+    metrics_text_family(text, "jws_file_cache_writes_total", "counter",
+                        "File cache saves, by cache and outcome");
+    for (FileCacheInstance* cache = file_cache_next(NULL); cache;
+         cache                    = file_cache_next(cache)) {
+        FileCacheStats stats;
+        file_cache_get_stats(cache, &stats);
+
+        const char* name = file_cache_label(&stats);
+        snprintf(labels, sizeof(labels), "cache=\"%s\",result=\"ok\"", name);
+        metrics_text_sample(text, "jws_file_cache_writes_total", labels,
+                            stats.writes);
+        snprintf(labels, sizeof(labels), "cache=\"%s\",result=\"error\"",
+                 name);
+        metrics_text_sample(text, "jws_file_cache_writes_total", labels,
+                            stats.write_errors);
+    }
+
+    metrics_text_family(text, "jws_file_cache_evictions_total", "counter",
+                        "Files removed by the janitor, by cache");
+    for (FileCacheInstance* cache = file_cache_next(NULL); cache;
+         cache                    = file_cache_next(cache)) {
+        FileCacheStats stats;
+        file_cache_get_stats(cache, &stats);
+
+        snprintf(labels, sizeof(labels), "cache=\"%s\"",
+                 file_cache_label(&stats));
+        metrics_text_sample(text, "jws_file_cache_evictions_total", labels,
+                            stats.evictions);
+    }
+
+    metrics_text_family(text, "jws_file_cache_queued_writes", "gauge",
+                        "Saves waiting for the background writer");
+    for (FileCacheInstance* cache = file_cache_next(NULL); cache;
+         cache                    = file_cache_next(cache)) {
+        FileCacheStats stats;
+        file_cache_get_stats(cache, &stats);
+
+        snprintf(labels, sizeof(labels), "cache=\"%s\"",
+                 file_cache_label(&stats));
+        metrics_text_sample(text, "jws_file_cache_queued_writes", labels,
+                            stats.queued);
+    }
+
+    metrics_text_family(text, "jws_file_cache_stale_total", "counter",
+                        "Entries found past the soft TTL and served stale");
+    for (FileCacheInstance* cache = file_cache_next(NULL); cache;
+         cache                    = file_cache_next(cache)) {
+        FileCacheStats stats;
+        file_cache_get_stats(cache, &stats);
+
+        snprintf(labels, sizeof(labels), "cache=\"%s\"",
+                 file_cache_label(&stats));
+        metrics_text_sample(text, "jws_file_cache_stale_total", labels,
+                            stats.stale);
+    }
+}
+
+/* host label: the URL authority, with the port only when it is not the
+ * scheme default */
+static void upstream_host_label(const HttpPoolHostStats* host, char* out,
+                                size_t size) {
+    const char* fallback = host->tls ? "443" : "80";
+    if (strcmp(host->port, fallback) == 0) {
+        snprintf(out, size, "host=\"%s\"", host->name);
+    } else {
+        snprintf(out, size, "host=\"%s:%s\"", host->name, host->port);
+    }
+}
+
+static void write_upstream_metrics(MetricsText* text) {
+    char   host_label[METRICS_MAX_LABELS];
+    char   labels[METRICS_MAX_LABELS + 32];
+    size_t count = http_pool_host_count();
+
+    metrics_text_family(text, "jws_upstream_request_duration_seconds",
+                        "histogram",
+                        "Upstream fetch time, from request to callback");
+    for (size_t i = 0; i < count; i++) {
+        HttpPoolHostStats host;
+        if (http_pool_host_stats(i, &host)) {
+            upstream_host_label(&host, host_label, sizeof(host_label));
+            metrics_text_histogram(text,
+                                   "jws_upstream_request_duration_seconds",
+                                   host_label, host.latency);
+        }
+    }
+
+    metrics_text_family(text, "jws_upstream_requests_total", "counter",
+                        "Upstream fetches, by host and outcome");
+    for (size_t i = 0; i < count; i++) {
+        HttpPoolHostStats host;
+        if (!http_pool_host_stats(i, &host)) {
+            continue;
+        }
+
+        upstream_host_label(&host, host_label, sizeof(host_label));
+        const char* names[3]  = {"response", "error", "timeout"};
+        uint64_t    values[3] = {host.responses, host.errors, host.timeouts};
+        for (size_t r = 0; r < 3; r++) {
+            snprintf(labels, sizeof(labels), "%s,result=\"%s\"", host_label,
+                     names[r]);
+            metrics_text_sample(text, "jws_upstream_requests_total", labels,
+                                values[r]);
+        }
+    }
+
+    metrics_text_family(text, "jws_upstream_open_connections", "gauge",
+                        "Pooled upstream connections currently open");
+    for (size_t i = 0; i < count; i++) {
+        HttpPoolHostStats host;
+        if (http_pool_host_stats(i, &host)) {
+            upstream_host_label(&host, host_label, sizeof(host_label));
+            metrics_text_sample(text, "jws_upstream_open_connections",
+                                host_label, host.open);
+        }
+    }
+
+    HttpPoolStats pool;
+    http_pool_stats(&pool);
+
+    metrics_text_family(text, "jws_upstream_connections_opened_total",
+                        "counter", "Upstream connections opened");
+    metrics_text_sample(text, "jws_upstream_connections_opened_total", NULL,
+                        pool.connections);
+    metrics_text_family(text, "jws_upstream_connections_reused_total",
+                        "counter", "Upstream requests sent on an idle socket");
+    metrics_text_sample(text, "jws_upstream_connections_reused_total", NULL,
+                        pool.reused);
+    metrics_text_family(text, "jws_upstream_tls_resumed_total", "counter",
+                        "TLS handshakes that offered a saved session");
+    metrics_text_sample(text, "jws_upstream_tls_resumed_total", NULL,
+                        pool.tls_resumed);
+    metrics_text_family(text, "jws_upstream_queued_requests", "gauge",
+                        "Upstream requests waiting for a connection");
+    metrics_text_sample(text, "jws_upstream_queued_requests", NULL,
+                        pool.queued);
+}
+
+int handle_metrics(HTTPServerConnection* conn, const char* query,
+                   WeatherServerInstance* instance) {
+    MetricsText text;
+    metrics_text_initiate(&text, &instance->arena);
+
+    /* Series of one worker; tell them apart when scraping several */
+    const char* worker = getenv(REUSEPORT_WORKER_ENV);
+    char        labels[METRICS_MAX_LABELS];
+    snprintf(labels, sizeof(labels), "worker=\"%s\"", worker ? worker : "");
+    metrics_text_family(&text, "jws_worker_info", "gauge",
+                        "Worker that answered this scrape");
+    metrics_text_sample(&text, "jws_worker_info", labels, 1);
+
+    metrics_text_family(&text, "jws_active_instances", "gauge",
+                        "Client connections with a live server instance");
+    metrics_text_sample(&text, "jws_active_instances", NULL,
+                        metrics_active_instances());
+
+    metrics_text_family(&text, "jws_log_dropped_total", "counter",
+                        "Log lines dropped because the ring buffer was full");
+    metrics_text_sample(&text, "jws_log_dropped_total", NULL,
+                        logger_dropped());
+
+    write_route_metrics(&text);
+    write_file_cache_metrics(&text);
+    write_upstream_metrics(&text);
+
+    size_t length = 0;
+    char*  body   = metrics_text_finish(&text, &length);
+    if (!body) {
+        return send_json_error(conn, 500, "Failed to render metrics");
+    }
+
+    return send_response(conn, 200, METRICS_CONTENT_TYPE, body, length);
+}
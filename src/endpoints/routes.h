@@ -2,17 +2,28 @@
 #include "endpoints/current.h"
 #include "endpoints/echo.h"
 #include "endpoints/elpris.h"
+#include "endpoints/energyplan.h"
 #include "endpoints/home.h"
+#include "endpoints/prometheus.h"
 #include "endpoints/weather.h"
+#include "request_arena.h"
+#include "weather_server_instance.h"
 
 #include <http_utils.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 // -------------------------
 // Routing table
 // -------------------------
 
-typedef int (*RouteHandler)(HTTPServerConnection*, const char*);
+/* Handlers get the query string and the connection's instance. Its arena
+ * stays valid until the next request on the same connection; handlers that
+ * answer from a callback keep weather_server_instance_defer()'s handle, not
+ * the connection */
+typedef int (*RouteHandler)(HTTPServerConnection*, const char*,
+                            WeatherServerInstance*);
 
 typedef struct {
     const char*  method;
@@ -25,19 +36,94 @@ Route g_routes[] = {
     {"GET", "/echo", handle_echo},
     {"POST", "/echo", handle_echo},
     {"GET", "/v1/weather", handle_weather_by_city},
+    {"GET", "/v1/weather/batch", handle_weather_batch},
+    {"POST", "/v1/weather/batch", handle_weather_batch},
     {"GET", "/v1/current", handle_current_weather},
     {"GET", "/v1/cities", handle_city_search},
     {"GET", "/v1/elpris", handle_elpris_route},
+    {"GET", "/v1/energyplan", handle_energy_plan},
+    {"GET", "/metrics", handle_metrics},
 };
 
 #define ROUTE_COUNT (sizeof(g_routes) / sizeof(g_routes[0]))
 
-int handle_not_found(HTTPServerConnection* conn, const char* path) {
-    char msg[512];
-    snprintf(msg, sizeof(msg),
-             "The requested endpoint '%s' was not found. Available endpoints: "
-             "GET /, POST /echo, GET /v1/current?lat=XX&lon=YY, GET "
-             "/v1/weather?city=NAME&country=CODE, GET /v1/cities?query=SEARCH",
-             path);
-    return send_json_error(conn, 404, msg);
+// -------------------------
+// Route lookup
+// -------------------------
+
+/* Open-addressing table over g_routes, keyed on method + path. Built once
+ * on first dispatch; with the table well over twice the route count a
+ * lookup is one hash of the request line plus, almost always, a single
+ * slot probe. Misses stop at the first empty slot. */
+#define ROUTE_TABLE_SIZE 32
+
+_Static_assert(ROUTE_COUNT * 2 <= ROUTE_TABLE_SIZE,
+               "ROUTE_TABLE_SIZE too small for g_routes");
+
+static const Route* g_route_table[ROUTE_TABLE_SIZE];
+static int          g_route_table_ready = 0;
+
+static uint32_t route_hash(const char* method, size_t method_len,
+                           const char* path, size_t path_len) {
+    uint32_t hash = 2166136261u; /* FNV-1a */
+    for (size_t i = 0; i < method_len; i++) {
+        hash = (hash ^ (uint8_t)method[i]) * 16777619u;
+    }
+    hash = (hash ^ (uint8_t)' ') * 16777619u;
+    for (size_t i = 0; i < path_len; i++) {
+        hash = (hash ^ (uint8_t)path[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void route_table_build(void) {
+    for (size_t i = 0; i < ROUTE_COUNT; i++) {
+        const Route* route = &g_routes[i];
+        uint32_t     slot  = route_hash(route->method, strlen(route->method),
+                                        route->path, strlen(route->path)) %
+                        ROUTE_TABLE_SIZE;
+        while (g_route_table[slot]) {
+            slot = (slot + 1) % ROUTE_TABLE_SIZE;
+        }
+        g_route_table[slot] = route;
+    }
+    g_route_table_ready = 1;
+}
+
+/**
+ * Find the route for a method and a path slice (not NUL-terminated).
+ * Returns NULL when nothing matches.
+ */
+static const Route* route_find(const char* method, const char* path,
+                               size_t path_len) {
+    if (!g_route_table_ready) {
+        route_table_build();
+    }
+
+    size_t   method_len = strlen(method);
+    uint32_t slot = route_hash(method, method_len, path, path_len) %
+                    ROUTE_TABLE_SIZE;
+
+    while (g_route_table[slot]) {
+        const Route* route = g_route_table[slot];
+        if (strncmp(route->path, path, path_len) == 0 &&
+            route->path[path_len] == '\0' &&
+            strcmp(route->method, method) == 0) {
+            return route;
+        }
+        slot = (slot + 1) % ROUTE_TABLE_SIZE;
+    }
+
+    return NULL;
+}
+
+/* Same body for every miss, so 404 floods cost no formatting */
+static const char g_not_found_message[] =
+    "The requested endpoint was not found. Available endpoints: "
+    "GET /, POST /echo, GET /v1/current?lat=XX&lon=YY, GET "
+    "/v1/weather?city=NAME&country=CODE, GET|POST /v1/weather/batch, GET "
+    "/v1/cities?query=SEARCH, GET /v1/energyplan?lat=XX&lon=YY&price=SE3";
+
+int handle_not_found(HTTPServerConnection* conn) {
+    return send_json_error(conn, 404, g_not_found_message);
 }
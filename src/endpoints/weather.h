@@ -1,21 +1,49 @@
 #include "weather_location_handler.h"
+#include "weather_server_instance.h"
 
 #include <http_utils.h>
 #include <stdlib.h>
 #include <string.h>
 
-int handle_city_search(HTTPServerConnection* conn, const char* query) {
-    char* json_response = NULL;
-    int   status_code   = 0;
+typedef struct {
+    WeatherServerReply reply;
+} CitySearchRouteContext;
 
-    weather_location_handler_search_cities(query, &json_response, &status_code);
+static int city_search_route_callback(char* json_response, int status_code,
+                                      const HttpCacheInfo* cache_info,
+                                      void*                ctx) {
+    CitySearchRouteContext* context = (CitySearchRouteContext*)ctx;
+    HTTPServerConnection*   conn =
+        context ? weather_server_reply_take(&context->reply) : NULL;
+    if (!conn) {
+        return 0; /* The client is gone */
+    }
 
     if (!json_response) {
+        send_json_error(conn, 500, "Failed to search cities");
+    } else {
+        http_cache_send(conn, status_code, "application/json", json_response,
+                        strlen(json_response), cache_info);
+    }
+    return 0;
+}
+
+int handle_city_search(HTTPServerConnection* conn, const char* query,
+                       WeatherServerInstance* instance) {
+    RequestArena* arena = &instance->arena;
+
+    /* Lives in the request arena, no free needed */
+    CitySearchRouteContext* ctx =
+        request_arena_alloc(arena, sizeof(CitySearchRouteContext));
+    if (!ctx) {
         return send_json_error(conn, 500, "Failed to search cities");
     }
 
-    int ret = send_response(conn, status_code, "application/json",
-                            json_response, strlen(json_response));
-    free(json_response);
-    return ret;
+    ctx->reply = weather_server_instance_defer(instance);
+
+    /* The request stays in flight until city_search_route_callback runs;
+     * errors are answered through the callback as well */
+    weather_location_handler_search_cities_async(
+        query, arena, city_search_route_callback, ctx);
+    return 0;
 }
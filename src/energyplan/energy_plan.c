@@ -0,0 +1,237 @@
+/**
+ * energy_plan.c - Battery charge/discharge planning over one day of prices
+ */
+
+#include "energy_plan.h"
+
+#include <math.h>
+#include <string.h>
+
+/* Solar: system losses (inverter, wiring, soiling) and cell heating */
+#define PV_PERFORMANCE_RATIO 0.85f
+#define PV_TEMPERATURE_COEFFICIENT -0.004f /* Per degree C above 25 */
+#define PV_HEATING_PER_WATT 0.03f          /* Degrees C per W/m2 */
+
+/* Cost of a level that cannot reach the end-of-day condition; small
+ * enough that adding slot costs never overflows */
+#define PLAN_UNREACHABLE 1e30f
+
+/* The largest level change per slot, in either direction */
+#define PLAN_MAX_STEPS (ENERGY_PLAN_SOC_LEVELS - 1)
+#define PLAN_DELTAS (2 * PLAN_MAX_STEPS + 1)
+
+/* Share of the daily load per local hour (Swedish villa without electric
+ * heating: low at night, a morning peak and a larger evening peak).
+ * energy_series_build() normalizes over the hours the day really has. */
+static const float g_load_profile[24] = {
+    0.028f, 0.025f, 0.024f, 0.024f, 0.025f, 0.030f, 0.040f, 0.048f,
+    0.045f, 0.040f, 0.038f, 0.038f, 0.039f, 0.038f, 0.038f, 0.040f,
+    0.046f, 0.056f, 0.063f, 0.062f, 0.058f, 0.052f, 0.043f, 0.035f};
+
+/* ============= Series ============= */
+
+/**
+ * Energy per kWp over one slot from the mean radiation and air temperature
+ */
+static float pv_yield(float radiation, float temperature, float hours) {
+    if (radiation <= 0) {
+        return 0;
+    }
+
+    float cell   = temperature + PV_HEATING_PER_WATT * radiation;
+    float derate = 1.0f + PV_TEMPERATURE_COEFFICIENT * (cell - 25.0f);
+    float yield  = radiation / 1000.0f * PV_PERFORMANCE_RATIO * derate;
+    return yield > 0 ? yield * hours : 0;
+}
+
+int energy_series_build(const ElprisPrice* prices, size_t count,
+                        const HourlyForecast* forecast, EnergySeries* out) {
+    if (!prices || count == 0 || count > ENERGY_PLAN_MAX_SLOTS || !out) {
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->count = count;
+
+    float load_total = 0;
+    for (size_t i = 0; i < count; i++) {
+        out->start[i] = prices[i].start;
+        out->hours[i] = (float)(prices[i].end - prices[i].start) / 3600.0f;
+        out->price[i] = prices[i].sek_per_kwh;
+
+        /* The day starts at local midnight, so this is the local hour
+         * (the 25th hour of a DST day counts as the last one) */
+        long hour = (long)((prices[i].start - prices[0].start) / 3600);
+        out->load_share[i] = g_load_profile[hour < 24 ? hour : 23] *
+                             out->hours[i];
+        load_total += out->load_share[i];
+
+        long index =
+            forecast ? (long)((prices[i].start - forecast->start) / 3600) : -1;
+        if (!forecast || prices[i].start < forecast->start ||
+            (size_t)index >= forecast->count) {
+            continue;
+        }
+        out->radiation[i]   = forecast->radiation[index];
+        out->cloud_cover[i] = forecast->cloud_cover[index];
+        out->temperature[i] = forecast->temperature[index];
+        out->pv_yield[i]    = pv_yield(out->radiation[i], out->temperature[i],
+                                       out->hours[i]);
+    }
+
+    if (load_total <= 0) {
+        return -1; /* Intervals of no length */
+    }
+    for (size_t i = 0; i < count; i++) {
+        out->load_share[i] /= load_total;
+    }
+
+    return 0;
+}
+
+/* ============= Planning ============= */
+
+/* Parameters of one planning run, clamped and derived from the params */
+typedef struct {
+    int   levels;     /* 1 without a battery */
+    float step_kwh;   /* Stored energy between two levels */
+    float efficiency; /* One direction */
+    float power_kw;
+    float pv_kwp;
+    float load_kwh;
+    float grid_fee;
+} PlanSetup;
+
+static float clampf(float value, float low, float high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+static PlanSetup plan_setup(const EnergyPlanParams* params) {
+    PlanSetup setup    = {0};
+    float     capacity = params->battery_kwh > 0 ? params->battery_kwh : 0;
+
+    setup.levels     = capacity > 0 && params->battery_kw > 0
+                           ? ENERGY_PLAN_SOC_LEVELS
+                           : 1;
+    setup.step_kwh   = setup.levels > 1 ? capacity / (setup.levels - 1) : 0;
+    setup.efficiency = sqrtf(clampf(params->efficiency, 0.01f, 1.0f));
+    setup.power_kw   = params->battery_kw > 0 ? params->battery_kw : 0;
+    setup.pv_kwp     = params->pv_kwp > 0 ? params->pv_kwp : 0;
+    setup.load_kwh   = params->daily_load_kwh > 0 ? params->daily_load_kwh : 0;
+    setup.grid_fee   = params->grid_fee;
+    return setup;
+}
+
+/**
+ * Grid cost of every level change in slot t. costs[PLAN_MAX_STEPS + d] is
+ * the cost of moving d levels up (negative: down).
+ *
+ * @return  The largest |d| the power limit allows
+ */
+static int slot_costs(const EnergySeries* series, const PlanSetup* setup,
+                      size_t t, float* costs) {
+    float load = setup->load_kwh * series->load_share[t];
+    float net  = load - setup->pv_kwp * series->pv_yield[t];
+    float buy  = series->price[t] + setup->grid_fee;
+    float sell = series->price[t];
+
+    int reach = 0;
+    if (setup->levels > 1) {
+        float steps = setup->power_kw * series->hours[t] / setup->step_kwh;
+        reach       = steps >= PLAN_MAX_STEPS ? PLAN_MAX_STEPS
+                                              : (int)(steps + 1e-4f);
+    }
+
+    for (int d = -reach; d <= reach; d++) {
+        float stored = (float)d * setup->step_kwh;
+        float flow   = stored > 0 ? stored / setup->efficiency
+                                  : stored * setup->efficiency;
+        float grid   = net + flow;
+        costs[PLAN_MAX_STEPS + d] = grid > 0 ? grid * buy : grid * sell;
+    }
+    return reach;
+}
+
+int energy_plan_compute(const EnergySeries* series,
+                        const EnergyPlanParams* params, EnergyPlan* out) {
+    if (!series || !params || !out || series->count == 0 ||
+        series->count > ENERGY_PLAN_MAX_SLOTS) {
+        return -1;
+    }
+
+    PlanSetup setup  = plan_setup(params);
+    size_t    count  = series->count;
+    int       levels = setup.levels;
+    int       first  = (int)lroundf(clampf(params->initial_soc, 0, 1) *
+                                    (float)(levels - 1));
+
+    /* value[t][s]: cheapest cost from the start of slot t at level s */
+    float value[ENERGY_PLAN_MAX_SLOTS + 1][ENERGY_PLAN_SOC_LEVELS];
+    float costs[PLAN_DELTAS];
+
+    for (int s = 0; s < levels; s++) {
+        value[count][s] = s >= first ? 0 : PLAN_UNREACHABLE;
+    }
+
+    for (size_t t = count; t-- > 0;) {
+        int          reach = slot_costs(series, &setup, t, costs);
+        const float* next  = value[t + 1];
+        float*       cur   = value[t];
+
+        for (int s = 0; s < levels; s++) {
+            cur[s] = PLAN_UNREACHABLE;
+        }
+
+        /* One contiguous add-and-min per level change */
+        for (int d = -reach; d <= reach; d++) {
+            float        cost = costs[PLAN_MAX_STEPS + d];
+            int          low  = d < 0 ? -d : 0;
+            int          high = d > 0 ? levels - d : levels;
+            const float* to   = next + d;
+            for (int s = low; s < high; s++) {
+                float candidate = cost + to[s];
+                cur[s]          = candidate < cur[s] ? candidate : cur[s];
+            }
+        }
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->count = count;
+
+    int level = first;
+    for (size_t t = 0; t < count; t++) {
+        int reach = slot_costs(series, &setup, t, costs);
+
+        /* Staying put wins ties, so the battery does not cycle for nothing */
+        int   best_d = 0;
+        float best   = costs[PLAN_MAX_STEPS] + value[t + 1][level];
+        for (int d = -reach; d <= reach; d++) {
+            int to = level + d;
+            if (d == 0 || to < 0 || to >= levels) {
+                continue;
+            }
+            float candidate = costs[PLAN_MAX_STEPS + d] + value[t + 1][to];
+            if (candidate < best) {
+                best   = candidate;
+                best_d = d;
+            }
+        }
+
+        float stored = (float)best_d * setup.step_kwh;
+
+        out->pv_kwh[t]      = setup.pv_kwp * series->pv_yield[t];
+        out->load_kwh[t]    = setup.load_kwh * series->load_share[t];
+        out->battery_kwh[t] = stored > 0 ? stored / setup.efficiency
+                                         : stored * setup.efficiency;
+        out->grid_kwh[t] =
+            out->load_kwh[t] - out->pv_kwh[t] + out->battery_kwh[t];
+
+        out->cost += costs[PLAN_MAX_STEPS + best_d];
+        out->baseline_cost += costs[PLAN_MAX_STEPS];
+
+        level       = level + best_d;
+        out->soc[t] = levels > 1 ? (float)level / (float)(levels - 1) : 0;
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * energy_plan.h - Battery charge/discharge planning over one day of prices
+ *
+ * An EnergySeries holds the inputs of one delivery day as parallel arrays,
+ * one entry per price interval (24 hourly or 96 quarter-hour slots, a few
+ * more or fewer on DST days): spot price, solar yield per installed kWp,
+ * the share of the daily household load, and the weather the yield was
+ * derived from. It depends only on the forecast point, price area and
+ * date, so one series serves every household in a grid cell.
+ *
+ * energy_plan_compute() finds the cheapest battery schedule for one
+ * household by dynamic programming over ENERGY_PLAN_SOC_LEVELS charge
+ * levels. Per slot it runs one pass per reachable level change over the
+ * contiguous array of levels, each a branch-free add-and-min the compiler
+ * vectorizes, and then walks the best path forward. A 96-slot day takes
+ * some tens of microseconds.
+ *
+ * Model:
+ * - Solar: global horizontal radiation times a fixed performance ratio,
+ *   derated for cell temperature (air temperature plus a radiation term).
+ * - Load: the daily consumption spread by a typical Swedish household
+ *   profile over local hours.
+ * - Battery: charging and discharging each lose the square root of the
+ *   round-trip efficiency and are limited to battery_kw.
+ * - Grid: imports cost the spot price plus grid_fee, exports earn the spot
+ *   price.
+ * - The battery ends the day at least as full as it started, so plans are
+ *   comparable with running without one.
+ */
+
+#ifndef ENERGY_PLAN_H
+#define ENERGY_PLAN_H
+
+#include "elpris_cache.h"
+#include "open_meteo_hourly.h"
+
+#include <stddef.h>
+#include <time.h>
+
+#define ENERGY_PLAN_MAX_SLOTS ELPRIS_CACHE_MAX_PRICES
+#define ENERGY_PLAN_SOC_LEVELS 41 /* Battery levels, 2.5% apart */
+
+/* Inputs of one day; entry i covers [start[i], start[i] + hours[i]) */
+typedef struct {
+    size_t count;
+    time_t start[ENERGY_PLAN_MAX_SLOTS];
+    float  hours[ENERGY_PLAN_MAX_SLOTS];
+    float  price[ENERGY_PLAN_MAX_SLOTS];      /* SEK per kWh */
+    float  pv_yield[ENERGY_PLAN_MAX_SLOTS];   /* kWh per installed kWp */
+    float  load_share[ENERGY_PLAN_MAX_SLOTS]; /* Of the daily load */
+    float  radiation[ENERGY_PLAN_MAX_SLOTS];  /* W/m2 */
+    float  cloud_cover[ENERGY_PLAN_MAX_SLOTS];
+    float  temperature[ENERGY_PLAN_MAX_SLOTS];
+} EnergySeries;
+
+/* One household */
+typedef struct {
+    float battery_kwh;    /* Usable capacity (0 = no battery) */
+    float battery_kw;     /* Charge and discharge power limit */
+    float efficiency;     /* Round trip, 0..1 */
+    float initial_soc;    /* Charge at the start of the day, 0..1 */
+    float pv_kwp;         /* Installed solar peak power */
+    float daily_load_kwh; /* Consumption over the day */
+    float grid_fee;       /* Added to the spot price on import, SEK/kWh */
+} EnergyPlanParams;
+
+/* A schedule; energies are per slot, as seen from the house */
+typedef struct {
+    size_t count;
+    float  pv_kwh[ENERGY_PLAN_MAX_SLOTS];
+    float  load_kwh[ENERGY_PLAN_MAX_SLOTS];
+    float  battery_kwh[ENERGY_PLAN_MAX_SLOTS]; /* Charge (+), discharge (-) */
+    float  grid_kwh[ENERGY_PLAN_MAX_SLOTS];    /* Import (+), export (-) */
+    float  soc[ENERGY_PLAN_MAX_SLOTS];         /* Charge at slot end, 0..1 */
+    float  cost;          /* Grid cost with the schedule, SEK */
+    float  baseline_cost; /* Grid cost without a battery, SEK */
+} EnergyPlan;
+
+/**
+ * Combine one day of prices with an hourly forecast. Slots the forecast
+ * does not cover get no solar yield.
+ *
+ * @param prices    Price intervals of the delivery day, in order
+ * @param count     Number of intervals
+ * @param forecast  Forecast for the household's grid cell
+ * @param out       Series to fill
+ * @return          0 on success, -1 if there are no usable prices
+ */
+int energy_series_build(const ElprisPrice* prices, size_t count,
+                        const HourlyForecast* forecast, EnergySeries* out);
+
+/**
+ * Plan the battery for one household over a series.
+ *
+ * @param series  Inputs of the day
+ * @param params  Household; values out of range are clamped
+ * @param out     Schedule and costs
+ * @return        0 on success, -1 on an empty series
+ */
+int energy_plan_compute(const EnergySeries* series,
+                        const EnergyPlanParams* params, EnergyPlan* out);
+
+#endif /* ENERGY_PLAN_H */
@@ -0,0 +1,612 @@
+/**
+ * energy_plan_handler.c - GET /v1/energyplan
+ */
+
+#include "energy_plan_handler.h"
+
+#include "elpris_cache.h"
+#include "energy_plan.h"
+#include "json_writer.h"
+#include "logger.h"
+#include "open_meteo_hourly.h"
+#include "response_cache.h"
+
+#include <math.h>
+#include <response_builder.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ENERGY_PLAN_SERIES_SLOTS 64 /* Cells, areas and days kept */
+#define ENERGY_PLAN_RESPONSE_CACHE_BYTES (8 * 1024 * 1024)
+#define ENERGY_PLAN_MAX_QUERY 512
+#define ENERGY_PLAN_EFFICIENCY 0.9f /* Battery round trip */
+
+/* Household defaults for parameters the query leaves out */
+#define DEFAULT_BATTERY_KWH 10.0f
+#define DEFAULT_BATTERY_KW 5.0f
+#define DEFAULT_PV_KWP 6.0f
+#define DEFAULT_LOAD_KWH 15.0f
+#define DEFAULT_SOC_PERCENT 50.0f
+#define DEFAULT_GRID_FEE 0.0f
+
+/* Below this a slot counts as idle in the "action" field */
+#define ACTION_THRESHOLD_KWH 0.0005f
+
+/* ============= Internal Structures ============= */
+
+/* Inputs of one grid cell, price area and day */
+typedef struct {
+    char         key[48]; /* "59.3_18.1_2025-01-31_SE3" */
+    EnergySeries series;
+    time_t       fetched_at; /* Of the forecast */
+    time_t       expires_at;
+    uint64_t     last_used;
+} CachedSeries;
+
+/* Per-request state; the two lookups finish in either order */
+typedef struct {
+    EnergyPlanOnResponse callback;
+    void*                context;
+    RequestArena*        arena; /* Owns this struct if set */
+
+    float            latitude; /* Grid cell */
+    float            longitude;
+    unsigned int     year;
+    unsigned int     month;
+    unsigned int     day;
+    char             price_group[4];
+    EnergyPlanParams params;
+
+    char series_key[sizeof(((CachedSeries*)0)->key)];
+    char response_key[256];
+
+    int         pending; /* Lookups running, +1 while starting them */
+    int         error_status;
+    const char* error_message;
+
+    ElprisPrice    prices[ELPRIS_CACHE_MAX_PRICES];
+    size_t         price_count;
+    HourlyForecast forecast;
+} EnergyPlanRequest;
+
+/* ============= Global State ============= */
+
+static bool           g_initialized = false;
+static ResponseCache* g_response_cache = NULL;
+
+/* Least recently used evicted first */
+static CachedSeries* g_series[ENERGY_PLAN_SERIES_SLOTS];
+static uint64_t      g_use_counter = 0;
+
+/* ============= Series Table ============= */
+
+static CachedSeries* series_find(const char* key, time_t now) {
+    for (size_t i = 0; i < ENERGY_PLAN_SERIES_SLOTS; i++) {
+        if (g_series[i] && strcmp(g_series[i]->key, key) == 0) {
+            if (g_series[i]->expires_at <= now) {
+                return NULL; /* Replaced once the new forecast is in */
+            }
+            g_series[i]->last_used = ++g_use_counter;
+            return g_series[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Store a series, replacing the same key or the least recently used slot
+ */
+static CachedSeries* series_insert(const char* key, const EnergySeries* series,
+                                   time_t fetched_at, time_t expires_at) {
+    size_t victim = 0;
+    for (size_t i = 0; i < ENERGY_PLAN_SERIES_SLOTS; i++) {
+        if (!g_series[i] || strcmp(g_series[i]->key, key) == 0) {
+            victim = i;
+            break;
+        }
+        if (g_series[i]->last_used < g_series[victim]->last_used) {
+            victim = i;
+        }
+    }
+
+    if (!g_series[victim]) {
+        g_series[victim] = malloc(sizeof(CachedSeries));
+        if (!g_series[victim]) {
+            return NULL;
+        }
+    }
+
+    CachedSeries* cached = g_series[victim];
+    snprintf(cached->key, sizeof(cached->key), "%s", key);
+    cached->series     = *series;
+    cached->fetched_at = fetched_at;
+    cached->expires_at = expires_at;
+    cached->last_used  = ++g_use_counter;
+    return cached;
+}
+
+/* ============= Query ============= */
+
+/**
+ * Parse a number that must fill the whole value and lie in [low, high]
+ */
+static bool parse_number(const char* text, float low, float high,
+                         float* out) {
+    char* end   = NULL;
+    float value = strtof(text, &end);
+    if (end == text || *end != '\0' || !isfinite(value) || value < low ||
+        value > high) {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+/**
+ * Fill the request from the query string
+ *
+ * @return  NULL on success, otherwise the message for the 400 response
+ */
+static const char* parse_query(const char* query, EnergyPlanRequest* request) {
+    char copy[ENERGY_PLAN_MAX_QUERY];
+    if (!query) {
+        query = "";
+    }
+    if (query[0] == '?') {
+        query++;
+    }
+    if (strlen(query) >= sizeof(copy)) {
+        return "Query string too long";
+    }
+    snprintf(copy, sizeof(copy), "%s", query);
+
+    EnergyPlanParams* params = &request->params;
+    float soc_percent        = DEFAULT_SOC_PERCENT;
+    bool  has_lat = false, has_lon = false;
+
+    params->battery_kwh    = DEFAULT_BATTERY_KWH;
+    params->battery_kw     = DEFAULT_BATTERY_KW;
+    params->efficiency     = ENERGY_PLAN_EFFICIENCY;
+    params->pv_kwp         = DEFAULT_PV_KWP;
+    params->daily_load_kwh = DEFAULT_LOAD_KWH;
+    params->grid_fee       = DEFAULT_GRID_FEE;
+
+    char* save = NULL;
+    for (char* pair = strtok_r(copy, "&", &save); pair;
+         pair       = strtok_r(NULL, "&", &save)) {
+        char* value = strchr(pair, '=');
+        if (!value) {
+            continue;
+        }
+        *value++ = '\0';
+
+        bool valid = true;
+        if (strcmp(pair, "lat") == 0) {
+            valid = has_lat =
+                parse_number(value, -90, 90, &request->latitude);
+        } else if (strcmp(pair, "lon") == 0 || strcmp(pair, "long") == 0) {
+            valid = has_lon =
+                parse_number(value, -180, 180, &request->longitude);
+        } else if (strcmp(pair, "price") == 0) {
+            valid = strlen(value) == 3 && strncmp(value, "SE", 2) == 0 &&
+                    value[2] >= '1' && value[2] <= '4';
+            snprintf(request->price_group, sizeof(request->price_group), "%s",
+                     valid ? value : "");
+        } else if (strcmp(pair, "date") == 0) {
+            valid = sscanf(value, "%4u-%2u-%2u", &request->year,
+                           &request->month, &request->day) == 3;
+        } else if (strcmp(pair, "battery") == 0) {
+            valid = parse_number(value, 0, 1000, &params->battery_kwh);
+        } else if (strcmp(pair, "power") == 0) {
+            valid = parse_number(value, 0, 1000, &params->battery_kw);
+        } else if (strcmp(pair, "pv") == 0) {
+            valid = parse_number(value, 0, 1000, &params->pv_kwp);
+        } else if (strcmp(pair, "load") == 0) {
+            valid = parse_number(value, 0, 10000, &params->daily_load_kwh);
+        } else if (strcmp(pair, "soc") == 0) {
+            valid = parse_number(value, 0, 100, &soc_percent);
+        } else if (strcmp(pair, "fee") == 0) {
+            valid = parse_number(value, 0, 100, &params->grid_fee);
+        }
+
+        if (!valid) {
+            return "Invalid query parameters. Expected format: "
+                   "lat=XX.XX&lon=YY.YY&price=SE1..SE4[&date=YYYY-MM-DD]"
+                   "[&battery=KWH&power=KW&pv=KWP&load=KWH&soc=PCT&fee=SEK]";
+        }
+    }
+
+    if (!has_lat || !has_lon || request->price_group[0] == '\0') {
+        return "Missing parameter: lat, lon and price are required";
+    }
+    params->initial_soc = soc_percent / 100.0f;
+
+    /* The forecast covers yesterday through tomorrow */
+    unsigned int year, month, day;
+    elpris_cache_local_date(time(NULL), &year, &month, &day);
+    if (request->year == 0) {
+        request->year  = year;
+        request->month = month;
+        request->day   = day;
+    }
+
+    struct tm wanted = {.tm_year = (int)request->year - 1900,
+                        .tm_mon  = (int)request->month - 1,
+                        .tm_mday = (int)request->day,
+                        .tm_hour = 12};
+    struct tm today  = {.tm_year = (int)year - 1900,
+                        .tm_mon  = (int)month - 1,
+                        .tm_mday = (int)day,
+                        .tm_hour = 12};
+    double    days   = difftime(timegm(&wanted), timegm(&today)) / 86400.0;
+    if (request->month < 1 || request->month > 12 || request->day < 1 ||
+        request->day > 31 || days < -1.5 || days > 1.5) {
+        return "Invalid date: plans cover yesterday, today or tomorrow";
+    }
+
+    return NULL;
+}
+
+/* ============= Responses ============= */
+
+static void* request_alloc(RequestArena* arena, size_t size) {
+    return arena ? request_arena_calloc(arena, 1, size) : calloc(1, size);
+}
+
+static void request_release(EnergyPlanRequest* request) {
+    if (!request->arena) {
+        free(request);
+    }
+}
+
+static void respond_error(EnergyPlanOnResponse callback, void* context,
+                          int status_code, const char* message) {
+    char* body = response_builder_error(
+        status_code, response_builder_get_error_type(status_code), message);
+    callback(body, status_code, NULL, context);
+    free(body);
+}
+
+static bool respond_cached(const EnergyPlanRequest* request) {
+    ResponseCacheHit hit;
+    if (!g_response_cache ||
+        !response_cache_get(g_response_cache, request->response_key, &hit)) {
+        return false;
+    }
+
+    HttpCacheInfo cache_info = {.etag          = hit.etag,
+                                .gzip_body     = hit.gzip_body,
+                                .gzip_length   = hit.gzip_length,
+                                .last_modified = hit.modified_at,
+                                .expires_at    = hit.expires_at};
+
+    /* Borrowed: the callback only reads the body */
+    request->callback((char*)hit.body, HTTP_OK, &cache_info,
+                      request->context);
+    return true;
+}
+
+static double round_to(double value, double scale) {
+    return round(value * scale) / scale;
+}
+
+static void write_utc_time(JsonWriter* writer, const char* key, time_t when) {
+    struct tm utc;
+    char      text[32];
+    gmtime_r(&when, &utc);
+    strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    json_write_key_str(writer, key, text);
+}
+
+static char* build_plan_response(const EnergyPlanRequest* request,
+                                 const EnergySeries*      series,
+                                 const EnergyPlan*        plan) {
+    const EnergyPlanParams* params = &request->params;
+
+    float pv = 0, load = 0, imported = 0, exported = 0;
+    for (size_t i = 0; i < plan->count; i++) {
+        pv += plan->pv_kwh[i];
+        load += plan->load_kwh[i];
+        if (plan->grid_kwh[i] > 0) {
+            imported += plan->grid_kwh[i];
+        } else {
+            exported -= plan->grid_kwh[i];
+        }
+    }
+
+    char date[16];
+    snprintf(date, sizeof(date), "%04u-%02u-%02u", request->year,
+             request->month, request->day);
+
+    JsonWriter writer;
+    json_writer_initiate(&writer, request->arena);
+
+    json_write_begin_object(&writer);
+    json_write_key_bool(&writer, "success", true);
+    json_write_key_object(&writer, "data");
+
+    json_write_key_object(&writer, "location");
+    json_write_key_double(&writer, "latitude", request->latitude);
+    json_write_key_double(&writer, "longitude", request->longitude);
+    json_write_key_double(&writer, "grid_degrees", ENERGY_PLAN_GRID_DEGREES);
+    json_write_end_object(&writer);
+
+    json_write_key_str(&writer, "date", date);
+    json_write_key_str(&writer, "price_area", request->price_group);
+
+    json_write_key_object(&writer, "household");
+    json_write_key_double(&writer, "battery_kwh", params->battery_kwh);
+    json_write_key_double(&writer, "battery_kw", params->battery_kw);
+    json_write_key_double(&writer, "pv_kwp", params->pv_kwp);
+    json_write_key_double(&writer, "daily_load_kwh", params->daily_load_kwh);
+    json_write_key_double(&writer, "initial_soc_percent",
+                          round_to(params->initial_soc * 100.0, 10));
+    json_write_key_double(&writer, "grid_fee_sek_per_kwh", params->grid_fee);
+    json_write_end_object(&writer);
+
+    json_write_key_object(&writer, "summary");
+    json_write_key_double(&writer, "cost_sek", round_to(plan->cost, 100));
+    json_write_key_double(&writer, "baseline_cost_sek",
+                          round_to(plan->baseline_cost, 100));
+    json_write_key_double(&writer, "savings_sek",
+                          round_to(plan->baseline_cost - plan->cost, 100));
+    json_write_key_double(&writer, "pv_kwh", round_to(pv, 1000));
+    json_write_key_double(&writer, "load_kwh", round_to(load, 1000));
+    json_write_key_double(&writer, "import_kwh", round_to(imported, 1000));
+    json_write_key_double(&writer, "export_kwh", round_to(exported, 1000));
+    json_write_key_double(
+        &writer, "final_soc_percent",
+        round_to(plan->count ? plan->soc[plan->count - 1] * 100.0 : 0, 10));
+    json_write_end_object(&writer);
+
+    json_write_key_array(&writer, "slots");
+    for (size_t i = 0; i < plan->count; i++) {
+        float       battery = plan->battery_kwh[i];
+        const char* action  = battery > ACTION_THRESHOLD_KWH    ? "charge"
+                              : battery < -ACTION_THRESHOLD_KWH ? "discharge"
+                                                                : "idle";
+
+        json_write_begin_object(&writer);
+        write_utc_time(&writer, "start", series->start[i]);
+        json_write_key_double(&writer, "hours", series->hours[i]);
+        json_write_key_double(&writer, "price_sek_per_kwh",
+                              round_to(series->price[i], 100000));
+        json_write_key_double(&writer, "radiation",
+                              round_to(series->radiation[i], 10));
+        json_write_key_double(&writer, "cloud_cover",
+                              round_to(series->cloud_cover[i], 10));
+        json_write_key_double(&writer, "temperature",
+                              round_to(series->temperature[i], 10));
+        json_write_key_double(&writer, "pv_kwh",
+                              round_to(plan->pv_kwh[i], 1000));
+        json_write_key_double(&writer, "load_kwh",
+                              round_to(plan->load_kwh[i], 1000));
+        json_write_key_double(&writer, "battery_kwh", round_to(battery, 1000));
+        json_write_key_double(&writer, "grid_kwh",
+                              round_to(plan->grid_kwh[i], 1000));
+        json_write_key_double(&writer, "soc_percent",
+                              round_to(plan->soc[i] * 100.0, 10));
+        json_write_key_str(&writer, "action", action);
+        json_write_end_object(&writer);
+    }
+    json_write_end_array(&writer);
+
+    json_write_end_object(&writer); /* data */
+    json_write_end_object(&writer);
+
+    return json_writer_finish(&writer, NULL);
+}
+
+/**
+ * Plan for the household, answer and keep the body for the same query
+ */
+static void plan_and_respond(EnergyPlanRequest*  request,
+                             const CachedSeries* cached) {
+    EnergyPlan plan;
+    char*      body = NULL;
+    if (energy_plan_compute(&cached->series, &request->params, &plan) == 0) {
+        body = build_plan_response(request, &cached->series, &plan);
+    }
+    if (!body) {
+        respond_error(request->callback, request->context, HTTP_INTERNAL_ERROR,
+                      "Failed to build the energy plan");
+        return;
+    }
+
+    HttpCacheInfo    cache_info = {.last_modified = cached->fetched_at,
+                                   .expires_at    = cached->expires_at};
+    ResponseCacheHit hit;
+    if (g_response_cache &&
+        response_cache_put(g_response_cache, request->response_key, NULL,
+                           body, strlen(body), cached->fetched_at,
+                           cached->expires_at) &&
+        response_cache_get(g_response_cache, request->response_key, &hit)) {
+        cache_info.etag        = hit.etag;
+        cache_info.gzip_body   = hit.gzip_body;
+        cache_info.gzip_length = hit.gzip_length;
+    }
+
+    request->callback(body, HTTP_OK, &cache_info, request->context);
+    if (!request->arena) {
+        free(body);
+    }
+}
+
+/* ============= Lookups ============= */
+
+/**
+ * Drop one pending lookup; the last one builds the series and answers
+ */
+static void lookup_done(EnergyPlanRequest* request) {
+    if (--request->pending > 0) {
+        return;
+    }
+
+    if (request->error_status) {
+        respond_error(request->callback, request->context,
+                      request->error_status, request->error_message);
+        request_release(request);
+        return;
+    }
+
+    EnergySeries  series;
+    CachedSeries* cached = NULL;
+    if (energy_series_build(request->prices, request->price_count,
+                            &request->forecast, &series) == 0) {
+        cached = series_insert(
+            request->series_key, &series, request->forecast.fetched_at,
+            request->forecast.fetched_at + OPEN_METEO_HOURLY_TTL);
+    }
+
+    if (cached) {
+        plan_and_respond(request, cached);
+    } else {
+        respond_error(request->callback, request->context, HTTP_INTERNAL_ERROR,
+                      "Failed to build the energy plan");
+    }
+    request_release(request);
+}
+
+static void on_prices(int result, const ElprisDay* day, void* context) {
+    EnergyPlanRequest* request = (EnergyPlanRequest*)context;
+
+    if (result != 0 || !day || day->count > ELPRIS_CACHE_MAX_PRICES) {
+        request->error_status  = HTTP_NOT_FOUND;
+        request->error_message = "No prices published for this day and "
+                                 "price area";
+    } else {
+        memcpy(request->prices, day->prices,
+               day->count * sizeof(ElprisPrice));
+        request->price_count = day->count;
+    }
+    lookup_done(request);
+}
+
+static void on_forecast(int result, const HourlyForecast* forecast,
+                        void* context) {
+    EnergyPlanRequest* request = (EnergyPlanRequest*)context;
+
+    if (result != 0 || !forecast) {
+        if (!request->error_status) {
+            request->error_status  = HTTP_INTERNAL_ERROR;
+            request->error_message = "Failed to fetch the solar forecast "
+                                     "from Open-Meteo API";
+        }
+    } else {
+        request->forecast = *forecast;
+    }
+    lookup_done(request);
+}
+
+/* ============= Public API ============= */
+
+int energy_plan_handler_init(void) {
+    if (g_initialized) {
+        return 0;
+    }
+
+    if (open_meteo_hourly_init() != 0) {
+        return -1;
+    }
+
+    /* Optional: without it every request runs the planner */
+    g_response_cache = response_cache_create(ENERGY_PLAN_RESPONSE_CACHE_BYTES);
+    if (!g_response_cache) {
+        LOGGER_WARN("[ENERGY_PLAN] Warning: Failed to create response cache");
+    }
+
+    g_initialized = true;
+    LOGGER_INFO("[ENERGY_PLAN] Initialized (%.1f degree grid)",
+                ENERGY_PLAN_GRID_DEGREES);
+    return 0;
+}
+
+void energy_plan_handler_cleanup(void) {
+    if (!g_initialized) {
+        return;
+    }
+
+    for (size_t i = 0; i < ENERGY_PLAN_SERIES_SLOTS; i++) {
+        free(g_series[i]);
+        g_series[i] = NULL;
+    }
+    response_cache_destroy(g_response_cache);
+    g_response_cache = NULL;
+    open_meteo_hourly_cleanup();
+
+    g_initialized = false;
+}
+
+int energy_plan_handler_async(const char* query, RequestArena* arena,
+                              EnergyPlanOnResponse callback, void* context) {
+    if (!callback) {
+        return -1;
+    }
+
+    if (energy_plan_handler_init() != 0) {
+        respond_error(callback, context, HTTP_INTERNAL_ERROR,
+                      "Energy plans are unavailable");
+        return -1;
+    }
+
+    EnergyPlanRequest* request = request_alloc(arena, sizeof(*request));
+    if (!request) {
+        callback(NULL, HTTP_INTERNAL_ERROR, NULL, context);
+        return -1;
+    }
+
+    request->callback = callback;
+    request->context  = context;
+    request->arena    = arena;
+
+    const char* error = parse_query(query, request);
+    if (error) {
+        respond_error(callback, context, HTTP_BAD_REQUEST, error);
+        request_release(request);
+        return -1;
+    }
+
+    /* One forecast, series and set of plans per grid cell */
+    request->latitude = (float)(round(request->latitude /
+                                      ENERGY_PLAN_GRID_DEGREES) *
+                                ENERGY_PLAN_GRID_DEGREES);
+    request->longitude = (float)(round(request->longitude /
+                                       ENERGY_PLAN_GRID_DEGREES) *
+                                 ENERGY_PLAN_GRID_DEGREES);
+
+    const EnergyPlanParams* params = &request->params;
+    snprintf(request->series_key, sizeof(request->series_key),
+             "%.1f_%.1f_%04u-%02u-%02u_%s", request->latitude,
+             request->longitude, request->year, request->month, request->day,
+             request->price_group);
+    snprintf(request->response_key, sizeof(request->response_key),
+             "%s|%g|%g|%g|%g|%g|%g", request->series_key,
+             params->battery_kwh, params->battery_kw, params->pv_kwp,
+             params->daily_load_kwh, params->initial_soc, params->grid_fee);
+
+    if (respond_cached(request)) {
+        request_release(request);
+        return 0;
+    }
+
+    CachedSeries* cached = series_find(request->series_key, time(NULL));
+    if (cached) {
+        plan_and_respond(request, cached);
+        request_release(request);
+        return 0;
+    }
+
+    /* Both lookups may answer before returning; the guard keeps the
+     * request alive until both have been started */
+    request->pending = 3;
+    elpris_cache_get_async(request->year, request->month, request->day,
+                           request->price_group, on_prices, request);
+    open_meteo_hourly_get_async(request->latitude, request->longitude,
+                                on_forecast, request);
+    lookup_done(request);
+    return 0;
+}
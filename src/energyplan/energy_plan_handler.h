@@ -0,0 +1,66 @@
+/**
+ * energy_plan_handler.h - GET /v1/energyplan
+ *
+ * Builds a 24 hour battery plan for a household from the day-ahead prices
+ * of its price area (elpris_cache.h) and the hourly solar forecast of its
+ * grid cell (open_meteo_hourly.h).
+ *
+ * Work is shared on three levels:
+ * - Coordinates are snapped to ENERGY_PLAN_GRID_DEGREES, and the combined
+ *   input series of one (grid cell, price area, day) is kept in a small
+ *   table until its forecast expires. Households in the same cell and area
+ *   never wait for upstream data once one of them has asked.
+ * - Each plan is a few tens of microseconds of arithmetic over that series
+ *   (energy_plan.h).
+ * - Rendered responses are kept in a response cache keyed by the cell, day
+ *   and every household parameter, so repeated requests skip the planner.
+ *
+ * Query: lat, lon and price (SE1-SE4) are required. date (YYYY-MM-DD,
+ * yesterday to tomorrow; default today in Sweden), battery (kWh), power
+ * (kW), pv (kWp), load (kWh per day), soc (percent at the start of the day)
+ * and fee (SEK per imported kWh) are optional.
+ */
+
+#ifndef ENERGY_PLAN_HANDLER_H
+#define ENERGY_PLAN_HANDLER_H
+
+#include "http_cache.h"
+#include "request_arena.h"
+
+#define ENERGY_PLAN_GRID_DEGREES 0.1 /* About 10 km; solar varies slowly */
+
+/**
+ * Callback invoked when a response is ready; same contract as
+ * WeatherLocationOnResponse (see weather_location_handler.h).
+ */
+typedef int (*EnergyPlanOnResponse)(char* response_json, int status_code,
+                                    const HttpCacheInfo* cache_info,
+                                    void*                context);
+
+/**
+ * Set up the forecast cache and the tables. Safe to call more than once.
+ *
+ * @return  0 on success, -1 on failure
+ */
+int energy_plan_handler_init(void);
+
+/**
+ * Release the tables and the forecast cache.
+ */
+void energy_plan_handler_cleanup(void);
+
+/**
+ * Handle GET /v1/energyplan without blocking the event loop. Errors are
+ * answered through the callback as well.
+ *
+ * @param query     Query string
+ * @param arena     Request arena for request state and the body, or NULL
+ *                  to use the heap
+ * @param callback  Completion callback (required)
+ * @param context   Passed through to the callback
+ * @return          0 if the request was accepted, -1 on error
+ */
+int energy_plan_handler_async(const char* query, RequestArena* arena,
+                              EnergyPlanOnResponse callback, void* context);
+
+#endif /* ENERGY_PLAN_HANDLER_H */
@@ -0,0 +1,303 @@
+#include "logger.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOGGER_BATCH_BYTES (64 * 1024) /* Per stream and write(2) */
+
+_Static_assert((LOGGER_SLOTS & (LOGGER_SLOTS - 1)) == 0,
+               "LOGGER_SLOTS must be a power of two");
+
+/* ============= Internal Structures ============= */
+
+/* sequence == position: free for the producer claiming position.
+ * sequence == position + 1: line published, owned by the writer. */
+typedef struct {
+    atomic_size_t sequence;
+    uint8_t       level;
+    uint16_t      length; /* Including the newline */
+    char          text[LOGGER_LINE_MAX];
+} LoggerSlot;
+
+/* Output buffer of one stream */
+typedef struct {
+    int    fd;
+    size_t used;
+    char   data[LOGGER_BATCH_BYTES];
+} LoggerBatch;
+
+/* ============= Global State ============= */
+
+#ifdef NDEBUG
+LoggerLevel g_logger_level = LOGGER_LEVEL_INFO;
+#else
+LoggerLevel g_logger_level = LOGGER_LEVEL_DEBUG;
+#endif
+
+static LoggerSlot    g_slots[LOGGER_SLOTS];
+static atomic_size_t g_head = 0; /* Next position to claim */
+static size_t        g_tail = 0; /* Next position to write; writer only */
+
+static atomic_bool      g_running  = false; /* Ring in use */
+static atomic_bool      g_stopping = false;
+static atomic_bool      g_parked   = false; /* Writer waits for g_wake_fd */
+static _Atomic uint64_t g_dropped  = 0;
+static int              g_wake_fd  = -1;
+static pthread_t        g_writer;
+
+static LoggerBatch g_out = {.fd = STDOUT_FILENO};
+static LoggerBatch g_err = {.fd = STDERR_FILENO};
+
+/* ============= Writer ============= */
+
+static void batch_flush(LoggerBatch* batch) {
+    size_t done = 0;
+    while (done < batch->used) {
+        ssize_t n = write(batch->fd, batch->data + done, batch->used - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break; /* Nowhere to write; drop the batch */
+        }
+        done += (size_t)n;
+    }
+    batch->used = 0;
+}
+
+static void batch_append(LoggerBatch* batch, const char* text,
+                         size_t length) {
+    if (batch->used + length > sizeof(batch->data)) {
+        batch_flush(batch);
+    }
+    memcpy(batch->data + batch->used, text, length);
+    batch->used += length;
+}
+
+/**
+ * Write every published line and hand the slots back to the producers.
+ *
+ * @return  Number of lines written
+ */
+static size_t writer_drain(void) {
+    size_t count = 0;
+    for (;;) {
+        LoggerSlot* slot = &g_slots[g_tail & (LOGGER_SLOTS - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) !=
+            g_tail + 1) {
+            break;
+        }
+
+        batch_append(slot->level >= LOGGER_LEVEL_WARN ? &g_err : &g_out,
+                     slot->text, slot->length);
+        atomic_store_explicit(&slot->sequence, g_tail + LOGGER_SLOTS,
+                              memory_order_release);
+        g_tail++;
+        count++;
+    }
+
+    static uint64_t reported = 0;
+    uint64_t dropped = atomic_load_explicit(&g_dropped, memory_order_relaxed);
+    if (dropped != reported) {
+        char line[96];
+        int  length = snprintf(line, sizeof(line),
+                              "[LOGGER] Ring full, dropped %llu lines\n",
+                              (unsigned long long)(dropped - reported));
+        batch_append(&g_err, line, (size_t)length);
+        reported = dropped;
+    }
+
+    batch_flush(&g_out);
+    batch_flush(&g_err);
+    return count;
+}
+
+static bool ring_ready(void) {
+    const LoggerSlot* slot = &g_slots[g_tail & (LOGGER_SLOTS - 1)];
+    return atomic_load(&slot->sequence) == g_tail + 1;
+}
+
+static void* writer_main(void* arg) {
+    (void)arg;
+    struct timespec pause = {.tv_sec  = 0,
+                             .tv_nsec = LOGGER_BATCH_MS * 1000000L};
+
+    for (;;) {
+        size_t written = writer_drain();
+        if (written >= LOGGER_SLOTS / 4) {
+            continue; /* Falling behind: no pause */
+        }
+        if (written > 0) {
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        if (atomic_load(&g_stopping)) {
+            break;
+        }
+
+        /* Paired with the check in logger_write: either this sees the new
+         * line or the producer sees g_parked and wakes us */
+        atomic_store(&g_parked, true);
+        if (ring_ready() || atomic_load(&g_stopping)) {
+            atomic_store(&g_parked, false);
+            continue;
+        }
+
+        struct pollfd wake = {.fd = g_wake_fd, .events = POLLIN};
+        if (poll(&wake, 1, -1) > 0) {
+            uint64_t value;
+            ssize_t  n = read(g_wake_fd, &value, sizeof(value));
+            (void)n;
+        }
+        atomic_store(&g_parked, false);
+    }
+
+    return NULL;
+}
+
+static void writer_wake(void) {
+    /* Only the first line after a quiet period pays the system call */
+    if (atomic_load(&g_parked) && atomic_exchange(&g_parked, false)) {
+        uint64_t one = 1;
+        ssize_t  n   = write(g_wake_fd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+/* ============= Public API ============= */
+
+int logger_init(void) {
+    if (atomic_load(&g_running)) {
+        return 0;
+    }
+
+    const char* level = getenv(LOGGER_LEVEL_ENV);
+    if (level && level[0]) {
+        static const char* names[] = {"debug", "info", "warn", "error"};
+        for (int i = 0; i <= LOGGER_LEVEL_ERROR; i++) {
+            if (strcmp(level, names[i]) == 0) {
+                g_logger_level = (LoggerLevel)i;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < LOGGER_SLOTS; i++) {
+        atomic_init(&g_slots[i].sequence, i);
+    }
+    atomic_store(&g_head, 0);
+    g_tail = 0;
+    atomic_store(&g_stopping, false);
+
+    g_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (g_wake_fd < 0) {
+        perror("[LOGGER] eventfd");
+        return -1;
+    }
+
+    /* Signals stay with the main thread */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int result = pthread_create(&g_writer, NULL, writer_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (result != 0) {
+        fprintf(stderr, "[LOGGER] Failed to start writer thread: %s\n",
+                strerror(result));
+        close(g_wake_fd);
+        g_wake_fd = -1;
+        return -1;
+    }
+
+    /* Lines printed before this point may still sit in stdio buffers */
+    fflush(stdout);
+    fflush(stderr);
+    atomic_store(&g_running, true);
+    return 0;
+}
+
+void logger_dispose(void) {
+    if (!atomic_exchange(&g_running, false)) {
+        return;
+    }
+
+    atomic_store(&g_stopping, true);
+    uint64_t one = 1;
+    ssize_t  n   = write(g_wake_fd, &one, sizeof(one));
+    (void)n;
+    pthread_join(g_writer, NULL);
+
+    close(g_wake_fd);
+    g_wake_fd = -1;
+}
+
+void logger_write(LoggerLevel level, const char* format, ...) {
+    int     saved_errno = errno; /* Callers often log right before perror */
+    va_list args;
+
+    if (!atomic_load_explicit(&g_running, memory_order_acquire)) {
+        FILE* stream = level >= LOGGER_LEVEL_WARN ? stderr : stdout;
+        va_start(args, format);
+        vfprintf(stream, format, args);
+        va_end(args);
+        fputc('\n', stream);
+        errno = saved_errno;
+        return;
+    }
+
+    size_t      position = atomic_load_explicit(&g_head, memory_order_relaxed);
+    LoggerSlot* slot;
+    for (;;) {
+        slot = &g_slots[position & (LOGGER_SLOTS - 1)];
+        size_t sequence =
+            atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == position) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &g_head, &position, position + 1, memory_order_relaxed,
+                    memory_order_relaxed)) {
+                break;
+            }
+        } else if (sequence < position) {
+            /* The writer has not freed this slot yet: the ring is full */
+            atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+            errno = saved_errno;
+            return;
+        } else {
+            position = atomic_load_explicit(&g_head, memory_order_relaxed);
+        }
+    }
+
+    /* Room for the newline after the text */
+    va_start(args, format);
+    int length = vsnprintf(slot->text, LOGGER_LINE_MAX - 1, format, args);
+    va_end(args);
+    if (length < 0) {
+        length = 0;
+    } else if (length > LOGGER_LINE_MAX - 2) {
+        length = LOGGER_LINE_MAX - 2;
+        memcpy(slot->text + length - 3, "...", 3);
+    }
+    slot->text[length] = '\n';
+    slot->length       = (uint16_t)(length + 1);
+    slot->level        = (uint8_t)level;
+
+    /* Sequentially consistent, paired with g_parked in writer_main */
+    atomic_store(&slot->sequence, position + 1);
+    writer_wake();
+    errno = saved_errno;
+}
+
+uint64_t logger_dropped(void) {
+    return atomic_load_explicit(&g_dropped, memory_order_relaxed);
+}
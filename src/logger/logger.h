@@ -0,0 +1,95 @@
+/**
+ * logger.h - Leveled logging through a lock-free ring buffer
+ *
+ * LOGGER_* format the line into a slot of a bounded ring buffer and return;
+ * they never take the stdio lock or wait for the terminal. A writer thread
+ * drains the ring in batches with one write(2) per stream: debug and info
+ * lines go to stdout, warnings and errors to stderr, each in the order they
+ * were logged. When the ring is full, lines are dropped and counted rather
+ * than stalling the event loop; the writer reports the count.
+ *
+ * After a small batch the writer pauses for LOGGER_BATCH_MS so the next one
+ * is larger. A pause that brings nothing new parks it on an eventfd, and
+ * the first line logged after that wakes it; an idle server has no logger
+ * wakeups and a busy one makes no system call per line.
+ *
+ * Any thread may log; slots are claimed with a compare-and-swap on the
+ * head index and published with a per-slot sequence number.
+ *
+ * Lines below LOGGER_LEVEL_ENV ("debug", "info", "warn" or "error"; info
+ * by default in release builds, debug otherwise) are skipped with one load
+ * and no formatting. Debug lines are compiled out of release builds
+ * (NDEBUG); their arguments are still type-checked. Before logger_init()
+ * and after logger_dispose() lines are written synchronously, so startup
+ * and shutdown messages are never lost.
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+
+#define LOGGER_LEVEL_ENV "JWS_LOG_LEVEL"
+
+#define LOGGER_SLOTS 4096   /* Ring capacity in lines, a power of two */
+#define LOGGER_LINE_MAX 256 /* Longer lines are cut and end in "..." */
+#define LOGGER_BATCH_MS 2   /* Writer pause after a small batch */
+
+typedef enum {
+    LOGGER_LEVEL_DEBUG = 0,
+    LOGGER_LEVEL_INFO,
+    LOGGER_LEVEL_WARN,
+    LOGGER_LEVEL_ERROR,
+} LoggerLevel;
+
+/* Lowest level that is written; set from LOGGER_LEVEL_ENV by logger_init */
+extern LoggerLevel g_logger_level;
+
+#ifdef NDEBUG
+#define LOGGER_DEBUG(...)                                                      \
+    do {                                                                       \
+        if (0) {                                                               \
+            logger_write(LOGGER_LEVEL_DEBUG, __VA_ARGS__);                     \
+        }                                                                      \
+    } while (0)
+#else
+#define LOGGER_DEBUG(...) LOGGER_AT(LOGGER_LEVEL_DEBUG, __VA_ARGS__)
+#endif
+#define LOGGER_INFO(...) LOGGER_AT(LOGGER_LEVEL_INFO, __VA_ARGS__)
+#define LOGGER_WARN(...) LOGGER_AT(LOGGER_LEVEL_WARN, __VA_ARGS__)
+#define LOGGER_ERROR(...) LOGGER_AT(LOGGER_LEVEL_ERROR, __VA_ARGS__)
+
+/* Skip the call and the formatting for filtered levels */
+#define LOGGER_AT(level, ...)                                                  \
+    do {                                                                       \
+        if ((level) >= g_logger_level) {                                       \
+            logger_write((level), __VA_ARGS__);                                \
+        }                                                                      \
+    } while (0)
+
+/**
+ * Read the level from the environment and start the writer thread.
+ *
+ * @return  0 on success, -1 if the thread cannot be started (logging stays
+ *          synchronous)
+ */
+int logger_init(void);
+
+/**
+ * Write out everything still queued and stop the writer thread.
+ */
+void logger_dispose(void);
+
+/**
+ * Queue one line. A trailing newline is added; the format should not end
+ * in one. Prefer the LOGGER_* macros, which filter by level first.
+ */
+void logger_write(LoggerLevel level, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Lines dropped because the ring was full, since start.
+ */
+uint64_t logger_dropped(void);
+
+#endif /* LOGGER_H */
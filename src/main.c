@@ -1,46 +1,113 @@
+#include "event_loop.h"
+#include "logger.h"
+#include "reuseport.h"
+#include "server_reload.h"
 #include "smw.h"
 #include "utils.h"
 #include "weather_server.h"
 
 #include <signal.h>
-#include <stdio.h>
+#include <stdlib.h>
 #include <sys/resource.h>
 #include <unistd.h>
 
 static volatile sig_atomic_t g_shutdown_requested = 0;
+static volatile sig_atomic_t g_drain_requested    = 0;
+static volatile sig_atomic_t g_snapshot_requested = 0;
 
 static void handle_shutdown_signal(int signum) {
     (void)signum;
     g_shutdown_requested = 1;
+    event_loop_wake();
+}
+
+/* SIGQUIT: finish the requests in progress, then exit (server_reload.h) */
+static void handle_drain_signal(int signum) {
+    (void)signum;
+    g_drain_requested = 1;
+    event_loop_wake();
+}
+
+/* SIGUSR1: write the cache snapshot for a replacement process */
+static void handle_snapshot_signal(int signum) {
+    (void)signum;
+    g_snapshot_requested = 1;
+    event_loop_wake();
 }
 
 int main() {
+    /* First, so even startup messages stay off the event loop */
+    logger_init();
+
     signal(SIGPIPE, SIG_IGN);
     signal(SIGTERM, handle_shutdown_signal);
     signal(SIGINT, handle_shutdown_signal);
-    printf("[MAIN] Signal handlers configured\n");
+    signal(SIGQUIT, handle_drain_signal);
+    signal(SIGUSR1, handle_snapshot_signal);
+    LOGGER_INFO("[MAIN] Signal handlers configured");
 
     struct rlimit rlim;
     getrlimit(RLIMIT_NOFILE, &rlim);
     rlim.rlim_cur = 65536;
     setrlimit(RLIMIT_NOFILE, &rlim);
-    printf("[MAIN] FD limit: %lu\n", rlim.rlim_cur);
+    LOGGER_INFO("[MAIN] FD limit: %lu", rlim.rlim_cur);
 
+    /* A server that fails to start must not report ready: on a reload
+     * the watchdog would then retire the one it was meant to replace */
     smw_init();
+    if (event_loop_init() != 0) {
+        LOGGER_ERROR("[MAIN] Failed to set up the event loop");
+        smw_dispose();
+        logger_dispose();
+        return EXIT_FAILURE;
+    }
 
     WeatherServer server;
-    weather_server_initiate(&server);
+    if (weather_server_initiate(&server) != 0) {
+        LOGGER_ERROR("[MAIN] Failed to start the server");
+        event_loop_dispose();
+        smw_dispose();
+        logger_dispose();
+        return EXIT_FAILURE;
+    }
+    server_reload_snapshot_restore();
 
-    printf("[MAIN] Server started on port 10680 (PID %d)\n", getpid());
+    const char* worker = getenv(REUSEPORT_WORKER_ENV);
+    if (worker) {
+        LOGGER_INFO("[MAIN] Server started on port 10680 (PID %d, worker %s)",
+                    getpid(), worker);
+    } else {
+        LOGGER_INFO("[MAIN] Server started on port 10680 (PID %d)", getpid());
+    }
+    server_reload_notify(SERVER_RELOAD_READY);
 
+    /* Sleeps in epoll between passes while there is nothing to do */
     while (!g_shutdown_requested) {
         smw_work(system_monotonic_ms());
+        event_loop_wait(system_monotonic_ms());
+
+        if (g_snapshot_requested) {
+            g_snapshot_requested = 0;
+            if (server_reload_snapshot_save() >= 0) {
+                server_reload_notify(SERVER_RELOAD_SNAPSHOT_SAVED);
+            }
+        }
+
+        if (g_drain_requested) {
+            uint64_t now = system_monotonic_ms();
+            weather_server_drain(&server, now);
+            if (weather_server_drained(&server, now)) {
+                break;
+            }
+        }
     }
 
-    printf("[MAIN] Shutdown signal received, cleaning up...\n");
+    LOGGER_INFO("[MAIN] Shutting down, cleaning up...");
     weather_server_dispose(&server);
+    event_loop_dispose();
     smw_dispose();
-    printf("[MAIN] Server stopped gracefully\n");
+    LOGGER_INFO("[MAIN] Server stopped gracefully");
+    logger_dispose();
 
     return 0;
 }
\ No newline at end of file
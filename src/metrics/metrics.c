@@ -0,0 +1,289 @@
+/**
+ * metrics.c - Lock-free counters, latency histograms and request timing
+ */
+
+#include "metrics.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Pending requests by connection; a power of two well above the number of
+ * connections with a request in flight */
+#define METRICS_PENDING_SLOTS 4096
+
+#define METRICS_TEXT_INITIAL_CAPACITY 8192
+
+typedef struct {
+    const void* connection; /* NULL: free slot */
+    int         route_id;
+    uint64_t    started_us;
+} PendingRequest;
+
+/* ============= Global State ============= */
+
+static const uint64_t g_bounds_us[METRICS_BUCKET_COUNT] =
+    METRICS_BUCKET_BOUNDS_US;
+
+static MetricsRoute   g_routes[METRICS_MAX_ROUTES];
+static MetricsCounter g_route_count      = 0;
+static MetricsCounter g_active_instances = 0;
+
+/* Touched from the event loop only, like the connections themselves */
+static PendingRequest g_pending[METRICS_PENDING_SLOTS];
+static size_t         g_pending_count = 0;
+
+/* ============= Primitives ============= */
+
+void metrics_counter_add(MetricsCounter* counter, uint64_t amount) {
+    atomic_fetch_add_explicit(counter, amount, memory_order_relaxed);
+}
+
+uint64_t metrics_counter_get(const MetricsCounter* counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+uint64_t metrics_now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u;
+}
+
+void metrics_histogram_observe(MetricsHistogram* histogram,
+                               uint64_t          elapsed_us) {
+    size_t bucket = 0;
+    while (bucket < METRICS_BUCKET_COUNT && elapsed_us > g_bounds_us[bucket]) {
+        bucket++;
+    }
+
+    metrics_counter_add(&histogram->buckets[bucket], 1);
+    metrics_counter_add(&histogram->count, 1);
+    metrics_counter_add(&histogram->sum_us, elapsed_us);
+}
+
+/* ============= Request Timing ============= */
+
+static size_t pending_slot(const void* connection) {
+    uint64_t hash = (uint64_t)(uintptr_t)connection * 0x9E3779B97F4A7C15u;
+    return (size_t)(hash >> 52) & (METRICS_PENDING_SLOTS - 1);
+}
+
+static PendingRequest* pending_find(const void* connection) {
+    size_t slot = pending_slot(connection);
+    for (size_t probes = 0; probes < METRICS_PENDING_SLOTS; probes++) {
+        PendingRequest* entry = &g_pending[slot];
+        if (entry->connection == connection || !entry->connection) {
+            return entry;
+        }
+        slot = (slot + 1) & (METRICS_PENDING_SLOTS - 1);
+    }
+    return NULL; /* Table full */
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones */
+static void pending_remove(PendingRequest* entry) {
+    size_t hole = (size_t)(entry - g_pending);
+    size_t slot = hole;
+
+    for (;;) {
+        slot = (slot + 1) & (METRICS_PENDING_SLOTS - 1);
+        if (!g_pending[slot].connection) {
+            break;
+        }
+
+        size_t home = pending_slot(g_pending[slot].connection);
+        /* Move the entry back unless its home lies in (hole, slot] */
+        bool stays = hole <= slot ? (home > hole && home <= slot)
+                                  : (home > hole || home <= slot);
+        if (!stays) {
+            g_pending[hole] = g_pending[slot];
+            hole            = slot;
+        }
+    }
+
+    g_pending[hole].connection = NULL;
+    g_pending_count--;
+}
+
+int metrics_route_register(const char* method, const char* path) {
+    uint64_t id = metrics_counter_get(&g_route_count);
+    if (id >= METRICS_MAX_ROUTES) {
+        return -1;
+    }
+
+    g_routes[id].method = method;
+    g_routes[id].path   = path;
+    metrics_counter_add(&g_route_count, 1);
+    return (int)id;
+}
+
+void metrics_request_begin(const void* connection, int route_id) {
+    if (!connection || route_id < 0 ||
+        (uint64_t)route_id >= metrics_counter_get(&g_route_count)) {
+        return;
+    }
+
+    PendingRequest* entry = pending_find(connection);
+    if (entry) {
+        if (!entry->connection) {
+            g_pending_count++;
+        }
+        entry->connection = connection;
+        entry->route_id   = route_id;
+        entry->started_us = metrics_now_us();
+    }
+}
+
+void metrics_request_end(const void* connection, int status) {
+    if (!connection) {
+        return;
+    }
+
+    PendingRequest* entry = pending_find(connection);
+    if (!entry || !entry->connection) {
+        return;
+    }
+
+    MetricsRoute* route   = &g_routes[entry->route_id];
+    uint64_t      elapsed = metrics_now_us() - entry->started_us;
+    pending_remove(entry);
+
+    metrics_histogram_observe(&route->latency, elapsed);
+    if (status >= 100 && status < 600) {
+        metrics_counter_add(&route->responses[status / 100 - 1], 1);
+    }
+}
+
+void metrics_request_discard(const void* connection) {
+    PendingRequest* entry = connection ? pending_find(connection) : NULL;
+    if (entry && entry->connection) {
+        pending_remove(entry);
+    }
+}
+
+void metrics_instance_opened(void) {
+    metrics_counter_add(&g_active_instances, 1);
+}
+
+void metrics_instance_closed(void) {
+    atomic_fetch_sub_explicit(&g_active_instances, 1, memory_order_relaxed);
+}
+
+/* ============= Readers ============= */
+
+size_t metrics_route_count(void) {
+    return (size_t)metrics_counter_get(&g_route_count);
+}
+
+const MetricsRoute* metrics_route_get(size_t route_id) {
+    return route_id < metrics_route_count() ? &g_routes[route_id] : NULL;
+}
+
+uint64_t metrics_active_instances(void) {
+    return metrics_counter_get(&g_active_instances);
+}
+
+size_t metrics_pending_requests(void) { return g_pending_count; }
+
+/* ============= Prometheus Text ============= */
+
+void metrics_text_initiate(MetricsText* text, RequestArena* arena) {
+    memset(text, 0, sizeof(*text));
+    text->arena = arena;
+}
+
+static void text_append(MetricsText* text, const char* fmt, ...) {
+    if (text->failed) {
+        return;
+    }
+
+    for (;;) {
+        size_t  room = text->capacity - text->length;
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(text->data ? text->data + text->length : NULL,
+                                room, fmt, args);
+        va_end(args);
+
+        if (written < 0) {
+            text->failed = true;
+            return;
+        }
+        if ((size_t)written < room) {
+            text->length += (size_t)written;
+            return;
+        }
+
+        size_t capacity = text->capacity ? text->capacity * 2
+                                         : METRICS_TEXT_INITIAL_CAPACITY;
+        while (capacity - text->length <= (size_t)written) {
+            capacity *= 2;
+        }
+
+        char* data = request_arena_realloc(text->arena, text->data,
+                                           text->capacity, capacity);
+        if (!data) {
+            text->failed = true;
+            return;
+        }
+        text->data     = data;
+        text->capacity = capacity;
+    }
+}
+
+void metrics_text_family(MetricsText* text, const char* name,
+                         const char* type, const char* help) {
+    text_append(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_text_sample(MetricsText* text, const char* name,
+                         const char* labels, uint64_t value) {
+    if (labels && *labels) {
+        text_append(text, "%s{%s} %" PRIu64 "\n", name, labels, value);
+    } else {
+        text_append(text, "%s %" PRIu64 "\n", name, value);
+    }
+}
+
+void metrics_text_histogram(MetricsText* text, const char* name,
+                            const char* labels,
+                            const MetricsHistogram* histogram) {
+    const char* separator = labels && *labels ? "," : "";
+    if (!labels) {
+        labels = "";
+    }
+
+    /* Buckets are stored per range; the format wants running totals */
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < METRICS_BUCKET_COUNT; i++) {
+        cumulative += metrics_counter_get(&histogram->buckets[i]);
+        text_append(text, "%s_bucket{%s%sle=\"%g\"} %" PRIu64 "\n", name,
+                    labels, separator, (double)g_bounds_us[i] / 1e6,
+                    cumulative);
+    }
+    cumulative +=
+        metrics_counter_get(&histogram->buckets[METRICS_BUCKET_COUNT]);
+    text_append(text, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n", name, labels,
+                separator, cumulative);
+
+    const char* open  = *labels ? "{" : "";
+    const char* close = *labels ? "}" : "";
+    text_append(text, "%s_sum%s%s%s %.6f\n", name, open, labels, close,
+                (double)metrics_counter_get(&histogram->sum_us) / 1e6);
+    text_append(text, "%s_count%s%s%s %" PRIu64 "\n", name, open, labels,
+                close, cumulative);
+}
+
+char* metrics_text_finish(MetricsText* text, size_t* out_length) {
+    text_append(text, "%s", "");
+    if (text->failed || !text->data) {
+        return NULL;
+    }
+
+    if (out_length) {
+        *out_length = text->length;
+    }
+    return text->data;
+}
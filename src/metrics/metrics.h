@@ -0,0 +1,151 @@
+/**
+ * metrics.h - Lock-free counters, latency histograms and request timing
+ *
+ * Counters are relaxed atomics, so bumping one on a hot path costs a single
+ * locked add and never blocks. Every latency histogram shares one fixed set
+ * of bucket bounds (METRICS_BUCKET_BOUNDS_US), so observing a value is a
+ * short scan with no allocation.
+ *
+ * Request timing runs from dispatch to response. The router calls
+ * metrics_request_begin() with the route id. send_response() and
+ * send_json_error() are wrapped at link time (lib_hooks.h) to call
+ * metrics_request_end(), so the first response sent on that connection
+ * ends the measurement and records its status. Nothing has to be threaded
+ * through the async handlers.
+ *
+ * Values are per process. With `--workers N` each worker keeps its own
+ * series, and a scrape is answered by whichever worker the kernel picks.
+ *
+ * MetricsText renders the Prometheus text format (version 0.0.4) into a
+ * request arena. Label strings are passed preformatted (`key="value"`);
+ * values must not contain quotes, backslashes or newlines.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "request_arena.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Upper bounds of the finite buckets, in microseconds (0.5 ms .. 10 s) */
+#define METRICS_BUCKET_BOUNDS_US                                               \
+    {500,    1000,   2500,    5000,    10000,   25000,   50000,                \
+     100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000}
+#define METRICS_BUCKET_COUNT 14
+
+#define METRICS_MAX_ROUTES 32
+
+typedef _Atomic uint64_t MetricsCounter;
+
+/* Latency histogram; zero-initialized is empty */
+typedef struct {
+    MetricsCounter buckets[METRICS_BUCKET_COUNT + 1]; /* Last one is +Inf */
+    MetricsCounter count;
+    MetricsCounter sum_us;
+} MetricsHistogram;
+
+/* One timed route, indexed by the id metrics_route_register() returned */
+typedef struct {
+    const char*      method;
+    const char*      path;
+    MetricsHistogram latency;
+    MetricsCounter   responses[5]; /* By status class, 1xx .. 5xx */
+} MetricsRoute;
+
+/* ============= Primitives ============= */
+
+void     metrics_counter_add(MetricsCounter* counter, uint64_t amount);
+uint64_t metrics_counter_get(const MetricsCounter* counter);
+
+/**
+ * Monotonic clock in microseconds, for measuring elapsed times.
+ */
+uint64_t metrics_now_us(void);
+
+void metrics_histogram_observe(MetricsHistogram* histogram,
+                               uint64_t          elapsed_us);
+
+/* ============= Request Timing ============= */
+
+/**
+ * Register a route to time. Strings must outlive the process.
+ *
+ * @return  Route id, or -1 when METRICS_MAX_ROUTES are registered
+ */
+int metrics_route_register(const char* method, const char* path);
+
+/**
+ * Start timing a request on a connection. The connection pointer is only
+ * used as a key. A request already pending on it is replaced.
+ */
+void metrics_request_begin(const void* connection, int route_id);
+
+/**
+ * Stop timing the request on a connection and count its status.
+ * Does nothing when no request is pending, so only the first response
+ * of a request is recorded.
+ */
+void metrics_request_end(const void* connection, int status);
+
+/**
+ * Forget a pending request, for a connection that closes before the
+ * response is sent.
+ */
+void metrics_request_discard(const void* connection);
+
+void metrics_instance_opened(void);
+void metrics_instance_closed(void);
+
+/* ============= Readers ============= */
+
+size_t              metrics_route_count(void);
+const MetricsRoute* metrics_route_get(size_t route_id);
+uint64_t            metrics_active_instances(void);
+
+/**
+ * Requests dispatched and not answered yet (event loop only).
+ */
+size_t metrics_pending_requests(void);
+
+/* ============= Prometheus Text ============= */
+
+typedef struct {
+    char*         data;
+    size_t        length;
+    size_t        capacity;
+    RequestArena* arena;
+    bool          failed;
+} MetricsText;
+
+void metrics_text_initiate(MetricsText* text, RequestArena* arena);
+
+/**
+ * Write the HELP and TYPE lines that start a metric family.
+ */
+void metrics_text_family(MetricsText* text, const char* name,
+                         const char* type, const char* help);
+
+/**
+ * Write one sample. labels is `key="value",...` without braces, or NULL.
+ */
+void metrics_text_sample(MetricsText* text, const char* name,
+                         const char* labels, uint64_t value);
+
+/**
+ * Write the _bucket, _sum and _count series of a histogram, in seconds.
+ */
+void metrics_text_histogram(MetricsText* text, const char* name,
+                            const char* labels,
+                            const MetricsHistogram* histogram);
+
+/**
+ * @return  The NUL-terminated text (arena memory), or NULL if an
+ *          allocation failed
+ */
+char* metrics_text_finish(MetricsText* text, size_t* out_length);
+
+#endif /* METRICS_H */
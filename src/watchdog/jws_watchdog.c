@@ -3,6 +3,17 @@
  *
  * Monitors the server process and restarts it on crash.
  * Implements exponential backoff for restart attempts.
+ *
+ * With --workers N, N server processes are started and supervised
+ * independently (each with its own restart window and backoff). The
+ * workers share port 10680 through SO_REUSEPORT, see reuseport.h.
+ *
+ * The watchdog opens each worker's listening socket and hands it to the
+ * server, so SIGHUP can replace the servers one at a time without closing
+ * the port: the new binary starts on the same socket, and the old one is
+ * told to drain once the new one reports ready (see server_reload.h).
+ * With --snapshot the old server first writes its memory cache, which the
+ * new one restores before taking requests.
  */
 
 #define _GNU_SOURCE
@@ -12,15 +23,21 @@
 #include <getopt.h>
 #include <limits.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <netinet/in.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "reuseport.h"
+#include "server_reload.h"
+
 #define DEFAULT_SERVER_PATH "./just-weather-server"
 #define DEFAULT_PID_FILE "/tmp/jws-watchdog.pid"
 
@@ -29,31 +46,77 @@
 #define INITIAL_BACKOFF_MS 1000
 #define MAX_BACKOFF_MS 30000
 
+#define MAX_WORKERS 64
+
+#define LISTEN_PORT 10680
+
+#define RELOAD_SNAPSHOT_TIMEOUT_MS 5000
+#define RELOAD_READY_TIMEOUT_MS 30000
+#define RELOAD_DRAIN_TIMEOUT_MS 60000 /* Then SIGKILL */
+
 typedef struct {
     const char* server_path;
     const char* pid_file;
     int         foreground;
+    int         workers;
+    int         snapshot; /* Carry the memory cache over on reload */
 } WatchdogConfig;
 
+typedef enum {
+    RELOAD_IDLE = 0,
+    RELOAD_SNAPSHOT, /* Waiting for the old server's snapshot */
+    RELOAD_STARTING, /* Waiting for the new server to be ready */
+} ReloadPhase;
+
 typedef struct {
-    pid_t  server_pid;
-    int    restart_count;
-    time_t last_restart_window_start;
-    int    current_backoff_ms;
+    pid_t    server_pid;
+    int      restart_count;
+    time_t   last_restart_window_start;
+    int      current_backoff_ms;
+    uint64_t restart_at_ms; /* Respawn time while backing off, else 0 */
+    int      retired;       /* Clean exit or restart limit reached */
+
+    int         listen_fd; /* Handed to every server of this worker */
+    int         status_fd; /* Read end of server_pid's status pipe */
+    pid_t       next_pid;  /* Replacement being started by a reload */
+    int         next_status_fd;
+    pid_t       draining_pid; /* Replaced server finishing its requests */
+    uint64_t    draining_deadline_ms;
+    ReloadPhase reload_phase;
+    uint64_t    reload_deadline_ms;
 } WatchdogState;
 
 static volatile sig_atomic_t g_shutdown_requested = 0;
-static WatchdogState         g_state              = {0};
+static volatile sig_atomic_t g_reload_requested   = 0;
+static WatchdogState         g_state[MAX_WORKERS] = {0};
+static int                   g_worker_count       = 1;
+static int                   g_reload_worker      = -1; /* -1: no reload */
 
 static void watchdog_signal_handler(int signum) {
     if (signum == SIGTERM || signum == SIGINT) {
         g_shutdown_requested = 1;
-        if (g_state.server_pid > 0) {
-            kill(g_state.server_pid, SIGTERM);
+        for (int i = 0; i < g_worker_count; i++) {
+            if (g_state[i].server_pid > 0) {
+                kill(g_state[i].server_pid, SIGTERM);
+            }
+            if (g_state[i].next_pid > 0) {
+                kill(g_state[i].next_pid, SIGTERM);
+            }
+            if (g_state[i].draining_pid > 0) {
+                kill(g_state[i].draining_pid, SIGTERM);
+            }
         }
+    } else if (signum == SIGHUP) {
+        g_reload_requested = 1;
     }
 }
 
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
 static void setup_signals(void) {
     struct sigaction sa;
     memset(&sa, 0, sizeof(sa));
@@ -62,6 +125,7 @@ static void setup_signals(void) {
 
     sigaction(SIGTERM, &sa, NULL);
     sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
 
     signal(SIGCHLD, SIG_DFL);
 }
@@ -123,24 +187,136 @@ static int write_pid_file(const char* path) {
 
 static void remove_pid_file(const char* path) { unlink(path); }
 
-static pid_t spawn_server(const char* server_path) {
+/* Listening socket of one worker. Every worker gets its own, in the same
+ * SO_REUSEPORT group, so the kernel keeps balancing between them */
+static int open_listener(void) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (g_worker_count > 1 &&
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(LISTEN_PORT);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Start a server on the worker's listening socket. *status_fd receives
+ * the read end of its status pipe, or -1 if none could be created */
+static pid_t spawn_server(const char* server_path, int worker, int restore,
+                          int* status_fd) {
+    WatchdogState* state = &g_state[worker];
+
+    if (state->listen_fd < 0) {
+        state->listen_fd = open_listener();
+        if (state->listen_fd < 0) {
+            fprintf(stderr,
+                    "[WATCHDOG] Cannot open port %d (%s), worker %d binds "
+                    "its own\n",
+                    LISTEN_PORT, strerror(errno), worker);
+        }
+    }
+
+    int pipe_fds[2] = {-1, -1};
+    if (pipe2(pipe_fds, O_CLOEXEC) < 0) {
+        pipe_fds[0] = pipe_fds[1] = -1;
+    }
+
     pid_t pid = fork();
 
     if (pid < 0) {
+        if (pipe_fds[0] >= 0) {
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+        }
         return -1;
     }
 
     if (pid == 0) {
+        char value[16];
+        if (state->listen_fd >= 0) {
+            fcntl(state->listen_fd, F_SETFD, 0);
+            snprintf(value, sizeof(value), "%d", state->listen_fd);
+            setenv(REUSEPORT_LISTEN_FD_ENV, value, 1);
+        }
+        if (pipe_fds[1] >= 0) {
+            fcntl(pipe_fds[1], F_SETFD, 0);
+            snprintf(value, sizeof(value), "%d", pipe_fds[1]);
+            setenv(SERVER_RELOAD_STATUS_FD_ENV, value, 1);
+        }
+        if (restore) {
+            setenv(SERVER_RELOAD_RESTORE_ENV, "1", 1);
+        }
+        if (g_worker_count > 1) {
+            snprintf(value, sizeof(value), "%d", worker);
+            setenv(REUSEPORT_ENV, "1", 1);
+            setenv(REUSEPORT_WORKER_ENV, value, 1);
+        }
         execl(server_path, server_path, NULL);
         _exit(127);
     }
 
+    if (pipe_fds[1] >= 0) {
+        close(pipe_fds[1]);
+        fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+    }
+    *status_fd = pipe_fds[0];
     return pid;
 }
 
-static int monitor_server(void) {
+/* Read what a server has reported so far: 1 if it reported wanted, 0 if
+ * not yet, -1 if it never will (pipe closed) */
+static int read_status(int fd, char wanted) {
+    if (fd < 0) {
+        return -1;
+    }
+
+    int  found = 0;
+    char buf[16];
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            if (memchr(buf, wanted, (size_t)n)) {
+                found = 1;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0 && !found) {
+            return -1;
+        }
+        return found;
+    }
+}
+
+static void close_fd(int* fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static int monitor_server(pid_t pid) {
     int   status;
-    pid_t result = waitpid(g_state.server_pid, &status, WNOHANG);
+    pid_t result = waitpid(pid, &status, WNOHANG);
 
     if (result == 0) {
         return 0;
@@ -163,30 +339,252 @@ static int monitor_server(void) {
     return 1;
 }
 
-static int should_restart(void) {
+static int should_restart(WatchdogState* state) {
     time_t now = time(NULL);
 
-    if (now - g_state.last_restart_window_start > RESTART_WINDOW_SEC) {
-        g_state.restart_count             = 0;
-        g_state.last_restart_window_start = now;
-        g_state.current_backoff_ms        = INITIAL_BACKOFF_MS;
+    if (now - state->last_restart_window_start > RESTART_WINDOW_SEC) {
+        state->restart_count             = 0;
+        state->last_restart_window_start = now;
+        state->current_backoff_ms        = INITIAL_BACKOFF_MS;
     }
 
-    if (g_state.restart_count >= MAX_RESTARTS) {
+    if (state->restart_count >= MAX_RESTARTS) {
         return 0;
     }
 
     return 1;
 }
 
-static void apply_backoff(void) {
-    usleep((useconds_t)g_state.current_backoff_ms * 1000);
+/* Schedule the respawn instead of sleeping, so the other workers keep
+ * being supervised while this one backs off */
+static void apply_backoff(WatchdogState* state) {
+    state->restart_at_ms = monotonic_ms() + (uint64_t)state->current_backoff_ms;
 
-    g_state.current_backoff_ms *= 2;
-    if (g_state.current_backoff_ms > MAX_BACKOFF_MS) {
-        g_state.current_backoff_ms = MAX_BACKOFF_MS;
+    state->current_backoff_ms *= 2;
+    if (state->current_backoff_ms > MAX_BACKOFF_MS) {
+        state->current_backoff_ms = MAX_BACKOFF_MS;
+    }
+    state->restart_count++;
+}
+
+static void supervise_worker(const WatchdogConfig* config, int worker) {
+    WatchdogState* state = &g_state[worker];
+
+    if (state->retired) {
+        return;
+    }
+
+    if (state->server_pid <= 0) {
+        /* A reload in progress brings up the replacement itself */
+        if (state->restart_at_ms > monotonic_ms() ||
+            state->reload_phase != RELOAD_IDLE) {
+            return;
+        }
+        state->restart_at_ms = 0;
+        state->server_pid    = spawn_server(config->server_path, worker, 0,
+                                            &state->status_fd);
+        if (state->server_pid <= 0) {
+            apply_backoff(state); /* fork failed, retry later */
+            return;
+        }
+    }
+
+    int status = monitor_server(state->server_pid);
+
+    if (status != 0) {
+        state->server_pid = -1;
+        close_fd(&state->status_fd);
+        /* The kernel keeps routing connections to a worker's socket while
+         * it is down; with other workers, let them take the traffic. A
+         * replacement being started keeps using it */
+        if ((g_worker_count > 1 || status < 0) &&
+            state->reload_phase == RELOAD_IDLE) {
+            close_fd(&state->listen_fd);
+        }
+    }
+
+    if (status > 0) {
+        if (g_shutdown_requested) {
+            return;
+        }
+        if (should_restart(state)) {
+            apply_backoff(state);
+        } else {
+            state->retired = 1;
+        }
+    } else if (status < 0) {
+        state->retired = 1;
+    }
+}
+
+/* Reap a replaced server once it has drained, or kill it if it takes too
+ * long */
+static void reap_draining(WatchdogState* state) {
+    if (state->draining_pid <= 0) {
+        return;
+    }
+
+    int   status;
+    pid_t result = waitpid(state->draining_pid, &status, WNOHANG);
+    if (result == 0 && monotonic_ms() >= state->draining_deadline_ms) {
+        fprintf(stderr, "[WATCHDOG] Server %d did not drain, killing it\n",
+                state->draining_pid);
+        kill(state->draining_pid, SIGKILL);
+        result = waitpid(state->draining_pid, &status, 0);
+    }
+    if (result != 0) {
+        state->draining_pid = -1;
+    }
+}
+
+static int drains_pending(void) {
+    for (int i = 0; i < g_worker_count; i++) {
+        if (g_state[i].draining_pid > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void start_replacement(const WatchdogConfig* config, int worker,
+                              int restore) {
+    WatchdogState* state = &g_state[worker];
+
+    state->next_pid = spawn_server(config->server_path, worker, restore,
+                                   &state->next_status_fd);
+    if (state->next_pid <= 0) {
+        fprintf(stderr, "[WATCHDOG] Reload of worker %d failed: fork\n",
+                worker);
+        state->next_pid     = -1;
+        state->reload_phase = RELOAD_IDLE;
+        return;
+    }
+    state->reload_phase       = RELOAD_STARTING;
+    state->reload_deadline_ms = monotonic_ms() + RELOAD_READY_TIMEOUT_MS;
+}
+
+/* Stop a replacement that never became ready; the old server keeps
+ * running as if nothing happened */
+static void abort_replacement(WatchdogState* state, int worker) {
+    fprintf(stderr,
+            "[WATCHDOG] Reload of worker %d failed: new server %d did not "
+            "start, keeping %d\n",
+            worker, state->next_pid, state->server_pid);
+
+    int status;
+    if (waitpid(state->next_pid, &status, WNOHANG) == 0) {
+        kill(state->next_pid, SIGTERM);
+        waitpid(state->next_pid, &status, 0);
+    }
+    state->next_pid = -1;
+    close_fd(&state->next_status_fd);
+    state->reload_phase = RELOAD_IDLE;
+}
+
+/* Advance the reload of one worker. Returns 1 once it is done, whether the
+ * server was replaced or not */
+static int reload_worker(const WatchdogConfig* config, int worker) {
+    WatchdogState* state = &g_state[worker];
+    uint64_t       now   = monotonic_ms();
+
+    switch (state->reload_phase) {
+    case RELOAD_IDLE:
+        /* Nothing to replace without a server on a socket we own */
+        if (state->server_pid <= 0 || state->listen_fd < 0) {
+            return 1;
+        }
+        if (config->snapshot) {
+            kill(state->server_pid, SIGUSR1);
+            state->reload_phase       = RELOAD_SNAPSHOT;
+            state->reload_deadline_ms = now + RELOAD_SNAPSHOT_TIMEOUT_MS;
+            return 0;
+        }
+        start_replacement(config, worker, 0);
+        break;
+
+    case RELOAD_SNAPSHOT: {
+        int saved = read_status(state->status_fd, SERVER_RELOAD_SNAPSHOT_SAVED);
+        if (saved == 0 && now < state->reload_deadline_ms) {
+            return 0;
+        }
+        if (saved != 1) {
+            fprintf(stderr,
+                    "[WATCHDOG] Worker %d saved no snapshot, reloading "
+                    "with a cold cache\n",
+                    worker);
+        }
+        start_replacement(config, worker, saved == 1);
+        break;
+    }
+
+    case RELOAD_STARTING: {
+        int ready = read_status(state->next_status_fd, SERVER_RELOAD_READY);
+        if (ready == 0 && now < state->reload_deadline_ms) {
+            return 0;
+        }
+        if (ready != 1) {
+            abort_replacement(state, worker);
+            return 1;
+        }
+
+        if (state->server_pid > 0) {
+            kill(state->server_pid, SIGQUIT);
+            state->draining_pid         = state->server_pid;
+            state->draining_deadline_ms = now + RELOAD_DRAIN_TIMEOUT_MS;
+        }
+        printf("[WATCHDOG] Worker %d reloaded: server %d replaces %d\n",
+               worker, state->next_pid, state->server_pid);
+
+        state->server_pid = state->next_pid;
+        state->next_pid   = -1;
+        close_fd(&state->status_fd);
+        state->status_fd      = state->next_status_fd;
+        state->next_status_fd = -1;
+        state->reload_phase   = RELOAD_IDLE;
+        return 1;
+    }
+    }
+
+    return state->reload_phase == RELOAD_IDLE;
+}
+
+/* Replace the workers one at a time, so the others keep serving. A new
+ * SIGHUP starts over once the replaced servers have drained */
+static void supervise_reload(const WatchdogConfig* config) {
+    if (g_reload_worker < 0) {
+        if (!g_reload_requested || drains_pending()) {
+            return;
+        }
+        g_reload_requested = 0;
+        g_reload_worker    = 0;
+        printf("[WATCHDOG] Reloading %s\n", config->server_path);
+    }
+
+    while (g_reload_worker < g_worker_count &&
+           reload_worker(config, g_reload_worker)) {
+        g_reload_worker++;
+    }
+    if (g_reload_worker >= g_worker_count) {
+        g_reload_worker = -1;
+    }
+}
+
+static int workers_active(void) {
+    for (int i = 0; i < g_worker_count; i++) {
+        if (!g_state[i].retired || g_state[i].draining_pid > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void stop_process(pid_t* pid) {
+    if (*pid > 0) {
+        int status;
+        kill(*pid, SIGTERM);
+        waitpid(*pid, &status, 0);
+        *pid = -1;
     }
-    g_state.restart_count++;
 }
 
 static void print_usage(const char* prog) {
@@ -197,7 +595,13 @@ static void print_usage(const char* prog) {
     printf("  -p, --pid PATH      PID file path (default: %s)\n",
            DEFAULT_PID_FILE);
     printf("  -f, --foreground    Run in foreground (don't daemonize)\n");
+    printf("  -w, --workers N     Server processes sharing the port via\n"
+           "                      SO_REUSEPORT (default: 1, 0 = one per "
+           "CPU)\n");
+    printf("  -c, --snapshot      Carry the memory cache over on reload\n");
     printf("  -h, --help          Show this help\n");
+    printf("\nSend SIGHUP to replace the servers with the binary at PATH\n"
+           "without closing the port.\n");
 }
 
 static void parse_args(int argc, char* argv[], WatchdogConfig* config) {
@@ -205,11 +609,13 @@ static void parse_args(int argc, char* argv[], WatchdogConfig* config) {
         {"server", required_argument, 0, 's'},
         {"pid", required_argument, 0, 'p'},
         {"foreground", no_argument, 0, 'f'},
+        {"workers", required_argument, 0, 'w'},
+        {"snapshot", no_argument, 0, 'c'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}};
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "s:p:fh", long_options, NULL)) !=
+    while ((opt = getopt_long(argc, argv, "s:p:fw:ch", long_options, NULL)) !=
            -1) {
         switch (opt) {
         case 's':
@@ -221,6 +627,21 @@ static void parse_args(int argc, char* argv[], WatchdogConfig* config) {
         case 'f':
             config->foreground = 1;
             break;
+        case 'w': {
+            char* end;
+            long  workers = strtol(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0' || workers < 0 ||
+                workers > MAX_WORKERS) {
+                fprintf(stderr, "Error: --workers must be 0..%d\n",
+                        MAX_WORKERS);
+                exit(1);
+            }
+            config->workers = (int)workers;
+            break;
+        }
+        case 'c':
+            config->snapshot = 1;
+            break;
         case 'h':
             print_usage(argv[0]);
             exit(0);
@@ -236,10 +657,19 @@ int main(int argc, char* argv[]) {
         .server_path = DEFAULT_SERVER_PATH,
         .pid_file    = DEFAULT_PID_FILE,
         .foreground  = 0,
+        .workers     = 1,
+        .snapshot    = 0,
     };
 
     parse_args(argc, argv, &config);
 
+    if (config.workers == 0) {
+        long cpus      = sysconf(_SC_NPROCESSORS_ONLN);
+        config.workers = cpus < 1 ? 1 : (cpus > MAX_WORKERS ? MAX_WORKERS
+                                                            : (int)cpus);
+    }
+    g_worker_count = config.workers;
+
     if (access(config.server_path, X_OK) != 0) {
         fprintf(stderr,
                 "Error: Server binary not found or not executable: %s\n",
@@ -269,37 +699,43 @@ int main(int argc, char* argv[]) {
 
     setup_signals();
 
-    g_state.server_pid                = -1;
-    g_state.restart_count             = 0;
-    g_state.last_restart_window_start = time(NULL);
-    g_state.current_backoff_ms        = INITIAL_BACKOFF_MS;
+    for (int i = 0; i < g_worker_count; i++) {
+        g_state[i].server_pid                = -1;
+        g_state[i].restart_count             = 0;
+        g_state[i].last_restart_window_start = time(NULL);
+        g_state[i].current_backoff_ms        = INITIAL_BACKOFF_MS;
+        g_state[i].listen_fd                 = -1;
+        g_state[i].status_fd                 = -1;
+        g_state[i].next_pid                  = -1;
+        g_state[i].next_status_fd            = -1;
+        g_state[i].draining_pid              = -1;
+    }
 
-    while (!g_shutdown_requested) {
-        if (g_state.server_pid <= 0) {
-            g_state.server_pid = spawn_server(config.server_path);
+    while (!g_shutdown_requested && workers_active()) {
+        for (int i = 0; i < g_worker_count && !g_shutdown_requested; i++) {
+            supervise_worker(&config, i);
+            reap_draining(&g_state[i]);
         }
-
-        int status = monitor_server();
-
-        if (status > 0) {
-            g_state.server_pid = -1;
-
-            if (!g_shutdown_requested && should_restart()) {
-                apply_backoff();
-            } else if (!g_shutdown_requested) {
-                break;
-            }
-        } else if (status < 0) {
-            break;
+        if (!g_shutdown_requested) {
+            supervise_reload(&config);
         }
 
         usleep(100000);
     }
 
-    if (g_state.server_pid > 0) {
-        int status;
-        kill(g_state.server_pid, SIGTERM);
-        waitpid(g_state.server_pid, &status, 0);
+    for (int i = 0; i < g_worker_count; i++) {
+        if (g_state[i].server_pid > 0) {
+            kill(g_state[i].server_pid, SIGTERM);
+        }
+    }
+    for (int i = 0; i < g_worker_count; i++) {
+        if (g_state[i].server_pid > 0) {
+            int status;
+            waitpid(g_state[i].server_pid, &status, 0);
+        }
+        stop_process(&g_state[i].next_pid);
+        stop_process(&g_state[i].draining_pid);
+        close_fd(&g_state[i].listen_fd);
     }
 
     remove_pid_file(config.pid_file);
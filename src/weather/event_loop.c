@@ -0,0 +1,295 @@
+/**
+ * @file event_loop.c
+ * @brief epoll readiness backend and its socket hooks.
+ *
+ * @see event_loop.h
+ */
+
+#include "event_loop.h"
+
+#include "logger.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utils.h>
+
+/** @brief Events taken from the kernel per epoll_wait() call. */
+#define EVENT_LOOP_MAX_EVENTS 64
+
+/** @brief Listening sockets remembered for event_loop_stop_accepting(). */
+#define EVENT_LOOP_MAX_LISTENERS 4
+
+/** @brief Per-descriptor state, cleared when the descriptor is closed. */
+typedef struct {
+    EventLoopCloseCallback callback; /* From event_loop_on_close() */
+    void*                  context;
+    bool                   connecting; /* Watched for connect completion */
+} FdState;
+
+/* ============= Global State ============= */
+
+static int      g_epoll_fd      = -1;
+static int      g_wake_fd       = -1;
+static bool     g_busy_poll     = false;
+static uint64_t g_deadline_ms   = UINT64_MAX;
+static uint64_t g_spin_until_ms = 0;
+
+static int    g_listeners[EVENT_LOOP_MAX_LISTENERS];
+static size_t g_listener_count = 0;
+static bool   g_accepting      = true;
+
+/* Indexed by descriptor. Loop thread only: the socket hooks skip it for
+ * calls from other threads, which never own a descriptor in it */
+static FdState* g_fds      = NULL;
+static size_t   g_fd_count = 0;
+
+/* Set on the thread that called event_loop_init() */
+static _Thread_local bool t_loop_thread = false;
+
+/* ============= Public API ============= */
+
+int event_loop_init(void) {
+    if (g_epoll_fd >= 0) {
+        return 0;
+    }
+
+    const char* busy = getenv(EVENT_LOOP_BUSY_POLL_ENV);
+    g_busy_poll      = busy && strcmp(busy, "1") == 0;
+    if (g_busy_poll) {
+        LOGGER_INFO("[EVENT] Busy polling (%s=1)", EVENT_LOOP_BUSY_POLL_ENV);
+    }
+
+    t_loop_thread = true;
+
+    g_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_epoll_fd < 0) {
+        perror("[EVENT] epoll_create1");
+        return -1;
+    }
+
+    g_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_wake_fd < 0 || event_loop_watch(g_wake_fd, EVENT_LOOP_READ) != 0) {
+        perror("[EVENT] eventfd");
+        event_loop_dispose();
+        return -1;
+    }
+
+    if (!g_fds) {
+        struct rlimit limit;
+        size_t        count = 1024;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+            limit.rlim_cur != RLIM_INFINITY) {
+            count = (size_t)limit.rlim_cur;
+        }
+        if (count > EVENT_LOOP_MAX_FDS) {
+            count = EVENT_LOOP_MAX_FDS;
+        }
+        g_fds      = calloc(count, sizeof(FdState));
+        g_fd_count = g_fds ? count : 0;
+    }
+
+    return 0;
+}
+
+void event_loop_dispose(void) {
+    assert(t_loop_thread);
+    free(g_fds);
+    g_fds      = NULL;
+    g_fd_count = 0;
+
+    if (g_wake_fd >= 0) {
+        close(g_wake_fd);
+        g_wake_fd = -1;
+    }
+    if (g_epoll_fd >= 0) {
+        close(g_epoll_fd);
+        g_epoll_fd = -1;
+    }
+}
+
+int event_loop_watch(int fd, uint32_t events) {
+    if (g_epoll_fd < 0 || fd < 0) {
+        return -1;
+    }
+    assert(t_loop_thread);
+    if ((size_t)fd < g_fd_count) {
+        g_fds[fd].connecting = false; /* The caller decides from now on */
+    }
+
+    struct epoll_event event = {.data.fd = fd};
+    if (events & EVENT_LOOP_READ) {
+        event.events |= EPOLLIN;
+    }
+    if (events & EVENT_LOOP_WRITE) {
+        event.events |= EPOLLOUT;
+    }
+
+    if (epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0) {
+        return 0;
+    }
+    if (errno == EEXIST &&
+        epoll_ctl(g_epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0) {
+        return 0;
+    }
+    return -1;
+}
+
+void event_loop_unwatch(int fd) {
+    if (g_epoll_fd >= 0 && fd >= 0) {
+        epoll_ctl(g_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+}
+
+int event_loop_on_close(int fd, EventLoopCloseCallback callback,
+                        void* context) {
+    if (fd < 0 || (size_t)fd >= g_fd_count) {
+        return -1;
+    }
+    assert(t_loop_thread);
+
+    g_fds[fd].callback = callback;
+    g_fds[fd].context  = callback ? context : NULL;
+    return 0;
+}
+
+void event_loop_schedule(uint64_t deadline_ms) {
+    if (deadline_ms < g_deadline_ms) {
+        g_deadline_ms = deadline_ms;
+    }
+}
+
+void event_loop_wake(void) {
+    int saved = errno;
+    if (g_wake_fd >= 0) {
+        uint64_t one     = 1;
+        ssize_t  written = write(g_wake_fd, &one, sizeof(one));
+        (void)written; /* EAGAIN: a wakeup is already pending */
+    }
+    errno = saved;
+}
+
+void event_loop_wait(uint64_t now_ms) {
+    uint64_t deadline = g_deadline_ms;
+    g_deadline_ms     = UINT64_MAX;
+
+    if (g_epoll_fd < 0 || g_busy_poll || now_ms < g_spin_until_ms) {
+        return;
+    }
+
+    int timeout = EVENT_LOOP_MAX_SLEEP_MS;
+    if (deadline <= now_ms) {
+        timeout = 0;
+    } else if (deadline - now_ms < (uint64_t)timeout) {
+        timeout = (int)(deadline - now_ms);
+    }
+
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int count = epoll_wait(g_epoll_fd, events, EVENT_LOOP_MAX_EVENTS, timeout);
+    if (count <= 0) {
+        return; /* Timeout, or EINTR from a signal */
+    }
+
+    for (int i = 0; i < count; i++) {
+        int fd = events[i].data.fd;
+        if (fd == g_wake_fd) {
+            uint64_t value;
+            ssize_t  drained = read(g_wake_fd, &value, sizeof(value));
+            (void)drained;
+        } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+            /* Stays set until the owner closes the socket; its next poll
+             * sees the error, so stop waking up for it */
+            event_loop_unwatch(fd);
+        } else if ((size_t)fd < g_fd_count && g_fds[fd].connecting) {
+            /* Connected: from now on only input matters */
+            event_loop_watch(fd, EVENT_LOOP_READ);
+        }
+    }
+
+    g_spin_until_ms = system_monotonic_ms() + EVENT_LOOP_SPIN_MS;
+}
+
+void event_loop_stop_accepting(void) {
+    g_accepting = false;
+    for (size_t i = 0; i < g_listener_count; i++) {
+        event_loop_unwatch(g_listeners[i]);
+    }
+}
+
+/* ============= Socket Hooks ============= */
+
+/* Watch a socket returned to the caller, keeping the caller's errno */
+static void watch_new_socket(int fd, uint32_t events) {
+    int saved = errno;
+    event_loop_watch(fd, events);
+    errno = saved;
+}
+
+bool event_loop_refuse_accept(int sockfd) {
+    if (!t_loop_thread || g_accepting) {
+        return false;
+    }
+    for (size_t i = 0; i < g_listener_count; i++) {
+        if (g_listeners[i] == sockfd) {
+            errno = EAGAIN;
+            return true;
+        }
+    }
+    return false;
+}
+
+void event_loop_socket_listening(int fd) {
+    if (!t_loop_thread) {
+        return;
+    }
+    if (g_listener_count < EVENT_LOOP_MAX_LISTENERS) {
+        g_listeners[g_listener_count++] = fd;
+    }
+    watch_new_socket(fd, EVENT_LOOP_READ);
+}
+
+void event_loop_socket_accepted(int fd) {
+    if (t_loop_thread) {
+        watch_new_socket(fd, EVENT_LOOP_READ);
+    }
+}
+
+void event_loop_socket_connecting(int fd, bool in_progress) {
+    if (!t_loop_thread) {
+        return;
+    }
+    if (!in_progress) {
+        watch_new_socket(fd, EVENT_LOOP_READ);
+        return;
+    }
+
+    /* Completion shows up as writability; event_loop_wait() switches to
+     * input once it does, unless the caller watches it itself */
+    bool tracked = fd >= 0 && (size_t)fd < g_fd_count;
+    watch_new_socket(fd, tracked ? EVENT_LOOP_WRITE : EVENT_LOOP_READ);
+    if (tracked) {
+        g_fds[fd].connecting = true;
+    }
+}
+
+void event_loop_socket_closing(int fd) {
+    if (!t_loop_thread || fd < 0 || (size_t)fd >= g_fd_count) {
+        return;
+    }
+
+    FdState state = g_fds[fd];
+    g_fds[fd]     = (FdState){0};
+    if (state.callback) {
+        int saved = errno;
+        state.callback(fd, state.context);
+        errno = saved;
+    }
+}
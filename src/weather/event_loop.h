@@ -0,0 +1,179 @@
+/**
+ * @file event_loop.h
+ * @brief epoll readiness backend that lets the smw main loop sleep.
+ *
+ * smw tasks are polled: every smw_work() pass runs every task, whether it
+ * has anything to do or not. Driving that in a tight loop keeps one core
+ * busy even when the server is idle. event_loop_wait() runs between two
+ * passes and blocks in epoll_wait() until one of these happens:
+ *
+ * - a watched socket becomes readable (or writable, if asked for),
+ * - the earliest deadline announced with event_loop_schedule() is due,
+ * - another thread or a signal handler calls event_loop_wake(),
+ * - EVENT_LOOP_MAX_SLEEP_MS pass, for timeouts that tasks only poll.
+ *
+ * The HTTP server and client in lib create their own sockets. Their
+ * listen(), accept(), accept4() and connect() calls are wrapped at link
+ * time (lib_hooks.h) and reported through the socket hooks below, so
+ * every socket they set up is watched for input without changes to lib.
+ * A connect() still in progress is watched for output until it completes
+ * or fails. Sockets are watched level-triggered and drop out of the set
+ * by themselves when closed.
+ *
+ * lib does not report when it closes a connection, so close() is wrapped
+ * as well, and event_loop_on_close() asks for a callback once a socket is
+ * closed. Registered for the socket a connection holds, this ties
+ * per-connection state to the lifetime of the connection.
+ *
+ * A request takes several passes to move through the lib state machines
+ * after its bytes arrive. Once something happened, the loop therefore
+ * keeps polling without sleeping for EVENT_LOOP_SPIN_MS, and under load it
+ * never sleeps at all.
+ *
+ * Setting EVENT_LOOP_BUSY_POLL_ENV to "1" turns waiting off and restores
+ * the old spinning loop, for latency measurements on a dedicated core.
+ *
+ * @par Usage:
+ * @code{.c}
+ * smw_init();
+ * event_loop_init();
+ * while (running) {
+ *     smw_work(system_monotonic_ms());
+ *     event_loop_wait(system_monotonic_ms());
+ * }
+ * event_loop_dispose();
+ * @endcode
+ *
+ * @note Apart from event_loop_wake() and the socket hooks, call only from
+ *       the smw scheduler thread, the one that called event_loop_init().
+ *       Debug builds assert this. The socket hooks run on every thread but
+ *       ignore calls from other threads, whose descriptors the loop never
+ *       tracks.
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Interest flags for event_loop_watch(). */
+#define EVENT_LOOP_READ 0x1u
+#define EVENT_LOOP_WRITE 0x2u
+
+/** @brief Keep polling this long after the last event (milliseconds). */
+#define EVENT_LOOP_SPIN_MS 2
+
+/** @brief Longest sleep, which bounds the delay of polled timeouts. */
+#define EVENT_LOOP_MAX_SLEEP_MS 20
+
+/** @brief Set to "1" to spin instead of waiting. */
+#define EVENT_LOOP_BUSY_POLL_ENV "JWS_BUSY_POLL"
+
+/** @brief Upper bound for descriptors with per-descriptor state. */
+#define EVENT_LOOP_MAX_FDS (1u << 20)
+
+/**
+ * @brief Called from close(), before the descriptor is closed.
+ */
+typedef void (*EventLoopCloseCallback)(int fd, void* context);
+
+/**
+ * @brief Create the epoll set and the wakeup eventfd.
+ *
+ * Call before the server opens its listening socket. Until then,
+ * event_loop_wait() returns at once and the loop spins.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int event_loop_init(void);
+
+/**
+ * @brief Close the epoll set and the wakeup eventfd.
+ */
+void event_loop_dispose(void);
+
+/**
+ * @brief Watch a socket, or change what it is watched for.
+ *
+ * @param fd     Socket descriptor
+ * @param events EVENT_LOOP_READ and/or EVENT_LOOP_WRITE
+ * @return 0 on success, -1 if epoll refused the descriptor.
+ */
+int event_loop_watch(int fd, uint32_t events);
+
+/**
+ * @brief Stop watching a socket that stays open (no-op if not watched).
+ */
+void event_loop_unwatch(int fd);
+
+/**
+ * @brief Call callback once when fd is closed, or cancel with NULL.
+ *
+ * The callback is dropped before it runs, so it may register a new one
+ * for the same number. Descriptors at or above the RLIMIT_NOFILE soft
+ * limit seen by event_loop_init() cannot be registered.
+ *
+ * @return 0 on success, -1 if fd is out of range or not initialized.
+ */
+int event_loop_on_close(int fd, EventLoopCloseCallback callback,
+                        void* context);
+
+/**
+ * @brief Ask for the next event_loop_wait() to return by deadline_ms.
+ *
+ * Only the earliest deadline announced during a pass is kept; tasks that
+ * need another one announce it again on their next run.
+ */
+void event_loop_schedule(uint64_t deadline_ms);
+
+/**
+ * @brief Make the current or next event_loop_wait() return.
+ *
+ * Safe to call from any thread and from signal handlers.
+ */
+void event_loop_wake(void);
+
+/**
+ * @brief Stop taking connections from the listening sockets.
+ *
+ * They are no longer watched and accept() on them fails with EAGAIN, so
+ * connections already accepted are served while new ones stay queued in
+ * the kernel for another process sharing the socket (see reuseport.h).
+ */
+void event_loop_stop_accepting(void);
+
+/**
+ * @brief Block until there is work for the next smw_work() pass.
+ *
+ * @param now_ms Current scheduler time (system_monotonic_ms())
+ */
+void event_loop_wait(uint64_t now_ms);
+
+/* ============= Socket Hooks (lib_hooks.c) ============= */
+
+/**
+ * @brief Whether accept() on sockfd should fail, after
+ *        event_loop_stop_accepting(). Sets errno to EAGAIN if so.
+ */
+bool event_loop_refuse_accept(int sockfd);
+
+/** @brief listen() succeeded on fd. */
+void event_loop_socket_listening(int fd);
+
+/** @brief accept() or accept4() returned fd. */
+void event_loop_socket_accepted(int fd);
+
+/**
+ * @brief connect() on fd succeeded, or with in_progress failed with
+ *        EINPROGRESS.
+ */
+void event_loop_socket_connecting(int fd, bool in_progress);
+
+/**
+ * @brief fd is about to be closed; runs its event_loop_on_close()
+ *        callback. Keeps errno.
+ */
+void event_loop_socket_closing(int fd);
+
+#endif /* EVENT_LOOP_H */
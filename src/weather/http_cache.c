@@ -0,0 +1,182 @@
+/**
+ * @file http_cache.c
+ * @brief HTTP validators and freshness headers implementation.
+ *
+ * @see http_cache.h
+ */
+
+#define _GNU_SOURCE
+
+#include "http_cache.h"
+
+#include "http_gzip.h"
+#include "http_request.h"
+#include "http_response.h"
+#include "response_cache.h"
+
+#include <http_utils.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HTTP_DATE_FORMAT "%a, %d %b %Y %H:%M:%S GMT"
+
+/* ============= Internal Helpers ============= */
+
+/**
+ * @brief Check an If-None-Match list against an ETag (weak comparison).
+ * @internal
+ */
+static bool etag_matches(const char* list, size_t length, const char* etag) {
+    size_t      etag_length = strlen(etag);
+    const char* end         = list + length;
+
+    while (list < end) {
+        while (list < end && (*list == ' ' || *list == ',')) {
+            list++;
+        }
+
+        const char* token = list;
+        while (list < end && *list != ',') {
+            list++;
+        }
+
+        const char* token_end = list;
+        while (token_end > token && token_end[-1] == ' ') {
+            token_end--;
+        }
+
+        if (token_end - token >= 2 && strncmp(token, "W/", 2) == 0) {
+            token += 2;
+        }
+
+        size_t token_length = (size_t)(token_end - token);
+        if ((token_length == 1 && *token == '*') ||
+            (token_length == etag_length &&
+             memcmp(token, etag, etag_length) == 0)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Decide whether the client's cached copy is still current.
+ * @internal
+ *
+ * If-None-Match takes precedence; If-Modified-Since is only consulted when
+ * the request carries no entity tags.
+ */
+static bool is_not_modified(const HTTPServerConnection* conn,
+                            const char* etag, time_t last_modified) {
+    size_t      length = 0;
+    const char* value  = http_request_header(conn, "If-None-Match", &length);
+    if (value) {
+        return etag_matches(value, length, etag);
+    }
+
+    value = http_request_header(conn, "If-Modified-Since", &length);
+    if (!value || last_modified == 0) {
+        return false;
+    }
+
+    char date[64];
+    if (length >= sizeof(date)) {
+        return false;
+    }
+    memcpy(date, value, length);
+    date[length] = '\0';
+
+    struct tm tm = {0};
+    if (!strptime(date, HTTP_DATE_FORMAT, &tm)) {
+        return false;
+    }
+
+    return last_modified <= timegm(&tm);
+}
+
+/**
+ * @brief Check whether the request allows a gzip-encoded response.
+ * @internal
+ */
+static bool accepts_gzip(const HTTPServerConnection* conn) {
+    size_t      length = 0;
+    const char* value  = http_request_header(conn, "Accept-Encoding", &length);
+    return value && http_gzip_accepted(value, length);
+}
+
+/* ============= Public API ============= */
+
+int http_cache_send(HTTPServerConnection* conn, int status_code,
+                    const char* content_type, const char* body, size_t length,
+                    const HttpCacheInfo* info) {
+    if (!info || status_code != 200) {
+        return send_response(conn, status_code, content_type, body, length);
+    }
+
+    char etag[RESPONSE_CACHE_ETAG_LENGTH + 3];
+    if (info->etag) {
+        snprintf(etag, sizeof(etag), "%s", info->etag);
+    } else {
+        response_cache_etag(body, length, etag);
+    }
+
+    /* Pick the representation; a body compressed here is freed below */
+    char*       compressed  = NULL;
+    const char* gzip_body   = info->gzip_body;
+    size_t      gzip_length = info->gzip_length;
+
+    if (accepts_gzip(conn)) {
+        if (!gzip_body &&
+            http_gzip_compress(body, length, &compressed, &gzip_length) == 0) {
+            gzip_body = compressed;
+        }
+    } else {
+        gzip_body = NULL;
+    }
+
+    if (gzip_body) {
+        /* "0123456789abcdef" becomes "0123456789abcdef-gz" */
+        size_t quote = strlen(etag) - 1;
+        snprintf(etag + quote, sizeof(etag) - quote, "-gz\"");
+        body   = gzip_body;
+        length = gzip_length;
+    }
+
+    time_t now     = time(NULL);
+    long   max_age = info->expires_at > now ? (long)(info->expires_at - now)
+                                            : 0;
+
+    char cache_control[48];
+    snprintf(cache_control, sizeof(cache_control), "public, max-age=%ld",
+             max_age);
+
+    HttpHeader headers[5] = {{"ETag", etag},
+                             {"Cache-Control", cache_control},
+                             {"Vary", "Accept-Encoding"}};
+    size_t     count      = 3;
+
+    if (gzip_body) {
+        headers[count++] = (HttpHeader){"Content-Encoding", "gzip"};
+    }
+
+    char date[64];
+    if (info->last_modified > 0) {
+        struct tm tm;
+        gmtime_r(&info->last_modified, &tm);
+        strftime(date, sizeof(date), HTTP_DATE_FORMAT, &tm);
+        headers[count++] = (HttpHeader){"Last-Modified", date};
+    }
+
+    int result =
+        is_not_modified(conn, etag, info->last_modified)
+            ? http_response_send(conn, HTTP_CACHE_NOT_MODIFIED, content_type,
+                                 headers, count, "", 0)
+            : http_response_send(conn, 200, content_type, headers, count, body,
+                                 length);
+
+    free(compressed);
+    return result;
+}
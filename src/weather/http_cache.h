@@ -0,0 +1,66 @@
+/**
+ * @file http_cache.h
+ * @brief HTTP validators and freshness headers for cacheable responses.
+ *
+ * Successful weather and city responses carry an ETag, a Last-Modified
+ * date and a Cache-Control max-age equal to the time left on the cache
+ * entry they were rendered from. Requests whose If-None-Match (or, when
+ * that is absent, If-Modified-Since) still matches are answered with an
+ * empty 304 Not Modified.
+ *
+ * Clients that accept gzip get a compressed body (see http_gzip.h), taken
+ * from HttpCacheInfo when the caller has one stored and compressed on the
+ * spot otherwise. The compressed representation has its own ETag.
+ *
+ * The validator and freshness headers are sent as a header list through
+ * http_response_send() (see http_response.h).
+ */
+
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <http_server_connection.h>
+#include <stddef.h>
+#include <time.h>
+
+/** @brief HTTP status sent when the client copy is still valid. */
+#define HTTP_CACHE_NOT_MODIFIED 304
+
+/**
+ * @brief Cache metadata of a successful response.
+ */
+typedef struct {
+    /** @brief Quoted strong ETag, or NULL to derive it from the body. */
+    const char* etag;
+
+    /** @brief Precompressed gzip copy of the body, or NULL. */
+    const char* gzip_body;
+
+    /** @brief Length of gzip_body in bytes. */
+    size_t gzip_length;
+
+    /** @brief When the underlying data was produced (0 omits the header). */
+    time_t last_modified;
+
+    /** @brief When the underlying cache entry expires. */
+    time_t expires_at;
+} HttpCacheInfo;
+
+/**
+ * @brief Send a response with validators, or 304 if the client's copy
+ *        still matches. The body is gzip-encoded if the client accepts it.
+ *
+ * @param[in] conn         Connection to answer.
+ * @param[in] status_code  HTTP status; only 200 responses get validators.
+ * @param[in] content_type Content-Type of the body.
+ * @param[in] body         Response body.
+ * @param[in] length       Body length in bytes.
+ * @param[in] info         Cache metadata; NULL sends a plain response.
+ *
+ * @return Result of send_response().
+ */
+int http_cache_send(HTTPServerConnection* conn, int status_code,
+                    const char* content_type, const char* body, size_t length,
+                    const HttpCacheInfo* info);
+
+#endif /* HTTP_CACHE_H */
@@ -0,0 +1,101 @@
+/**
+ * @file http_request.c
+ * @brief Raw request access implementation.
+ *
+ * @see http_request.h
+ */
+
+#define _GNU_SOURCE
+
+#include "http_request.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+/* ============= Public API ============= */
+
+const char* http_request_header(const HTTPServerConnection* conn,
+                                const char* name, size_t* out_length) {
+    const char* data        = (const char*)conn->read_buffer;
+    const char* end         = data ? data + conn->read_buffer_size : NULL;
+    size_t      name_length = strlen(name);
+
+    if (!data) {
+        return NULL;
+    }
+
+    /* Skip the request line */
+    const char* line = memchr(data, '\n', (size_t)(end - data));
+    while (line && ++line < end) {
+        const char* eol = memchr(line, '\n', (size_t)(end - line));
+        if (!eol) {
+            eol = end;
+        }
+
+        size_t length = (size_t)(eol - line);
+        if (length > 0 && line[length - 1] == '\r') {
+            length--;
+        }
+        if (length == 0) {
+            return NULL; /* End of the header block */
+        }
+
+        if (length > name_length && line[name_length] == ':' &&
+            strncasecmp(line, name, name_length) == 0) {
+            const char* value     = line + name_length + 1;
+            const char* value_end = line + length;
+
+            while (value < value_end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            while (value_end > value &&
+                   (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+                value_end--;
+            }
+
+            *out_length = (size_t)(value_end - value);
+            return value;
+        }
+
+        line = eol;
+    }
+
+    return NULL;
+}
+
+const char* http_request_body(const HTTPServerConnection* conn,
+                              size_t* out_length) {
+    const char* data = (const char*)conn->read_buffer;
+    size_t      size = conn->read_buffer_size;
+
+    *out_length = 0;
+    if (!data) {
+        return NULL;
+    }
+
+    const char* head_end = memmem(data, size, "\r\n\r\n", 4);
+    if (!head_end) {
+        return NULL;
+    }
+    const char* body      = head_end + 4;
+    size_t      available = size - (size_t)(body - data);
+
+    size_t      length = 0;
+    const char* value  = http_request_header(conn, "Content-Length", &length);
+    if (!value || length == 0) {
+        return NULL;
+    }
+
+    size_t content_length = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (value[i] < '0' || value[i] > '9' ||
+            content_length > (SIZE_MAX - 9) / 10) {
+            return NULL;
+        }
+        content_length = content_length * 10 + (size_t)(value[i] - '0');
+    }
+
+    *out_length = content_length < available ? content_length : available;
+    return *out_length > 0 ? body : NULL;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file http_request.h
+ * @brief Access to the raw request held by an HTTPServerConnection.
+ *
+ * lib keeps the whole request in conn->read_buffer: the request line, the
+ * header block and the body, as received. It parses the method and path
+ * but exposes neither the other headers nor where the body starts; these
+ * helpers find both without copying.
+ */
+
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <http_server_connection.h>
+#include <stddef.h>
+
+/**
+ * @brief Find a request header (name compared case-insensitively).
+ *
+ * @param[in]  conn       Connection whose request is searched.
+ * @param[in]  name       Header name without the colon.
+ * @param[out] out_length Length of the value, without surrounding spaces.
+ *
+ * @return Start of the value (not NUL-terminated), or NULL if the header
+ *         is absent.
+ */
+const char* http_request_header(const HTTPServerConnection* conn,
+                                const char* name, size_t* out_length);
+
+/**
+ * @brief Find the request body.
+ *
+ * The body starts after the blank line ending the header block and is
+ * bounded by Content-Length; a request without one has no body. A body
+ * shorter than announced is returned as far as it was received.
+ *
+ * @param[in]  conn       Connection whose request is searched.
+ * @param[out] out_length Length of the body in bytes (0 without a body).
+ *
+ * @return Start of the body (not NUL-terminated), or NULL if there is none.
+ */
+const char* http_request_body(const HTTPServerConnection* conn,
+                              size_t* out_length);
+
+#endif /* HTTP_REQUEST_H */
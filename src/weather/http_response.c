@@ -0,0 +1,88 @@
+/**
+ * @file http_response.c
+ * @brief Responses with extra header lines implementation.
+ *
+ * @see http_response.h
+ */
+
+#include "http_response.h"
+
+#include "logger.h"
+
+#include <http_utils.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ============= Internal Helpers ============= */
+
+/**
+ * @brief Check a header name: a non-empty token.
+ * @internal
+ */
+static bool valid_name(const char* name) {
+    if (!name || !name[0]) {
+        return false;
+    }
+    for (const char* c = name; *c; c++) {
+        if (*c <= ' ' || *c == ':' || *c == 0x7f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check a header value: no line breaks or other control bytes.
+ * @internal
+ */
+static bool valid_value(const char* value) {
+    if (!value) {
+        return false;
+    }
+    for (const char* c = value; *c; c++) {
+        if ((*c < ' ' && *c != '\t') || *c == 0x7f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ============= Public API ============= */
+
+int http_response_send(HTTPServerConnection* conn, int status_code,
+                       const char* content_type, const HttpHeader* headers,
+                       size_t header_count, const char* body, size_t length) {
+    if (!valid_value(content_type)) {
+        LOGGER_ERROR("[HTTP] Invalid Content-Type, answering 500");
+        return send_json_error(conn, 500, "Internal server error");
+    }
+
+    /* send_response() ends the Content-Type line itself, so the extra
+     * lines go after its value: "type\r\nName: value\r\nName: value" */
+    char block[HTTP_RESPONSE_MAX_HEADERS];
+    int  written = snprintf(block, sizeof(block), "%s", content_type);
+    if (written < 0 || (size_t)written >= sizeof(block)) {
+        LOGGER_ERROR("[HTTP] Response headers too long, answering 500");
+        return send_json_error(conn, 500, "Internal server error");
+    }
+    size_t used = (size_t)written;
+
+    for (size_t i = 0; i < header_count; i++) {
+        if (!valid_name(headers[i].name) || !valid_value(headers[i].value)) {
+            LOGGER_ERROR("[HTTP] Invalid header %s, answering 500",
+                         headers[i].name ? headers[i].name : "(null)");
+            return send_json_error(conn, 500, "Internal server error");
+        }
+
+        written = snprintf(block + used, sizeof(block) - used, "\r\n%s: %s",
+                           headers[i].name, headers[i].value);
+        if (written < 0 || (size_t)written >= sizeof(block) - used) {
+            LOGGER_ERROR("[HTTP] Response headers too long, answering 500");
+            return send_json_error(conn, 500, "Internal server error");
+        }
+        used += (size_t)written;
+    }
+
+    return send_response(conn, status_code, block, body, length);
+}
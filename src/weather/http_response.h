@@ -0,0 +1,60 @@
+/**
+ * @file http_response.h
+ * @brief Responses with extra header lines.
+ *
+ * lib's send_response() writes the status line, Content-Type,
+ * Content-Length and the body; it has no parameter for other headers.
+ * http_response_send() takes the extra headers as a list instead, checks
+ * that no name or value can break the header block, and passes them on
+ * as complete header lines. How they reach lib is private to this
+ * module, so it is the only code to change once lib takes extra headers.
+ *
+ * @par Usage:
+ * @code{.c}
+ * HttpHeader headers[] = {{"ETag", "\"0123456789abcdef\""},
+ *                         {"Cache-Control", "public, max-age=60"}};
+ * http_response_send(conn, 200, "application/json", headers, 2, body,
+ *                    length);
+ * @endcode
+ */
+
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <http_server_connection.h>
+#include <stddef.h>
+
+/** @brief Size of the header block, Content-Type value included. */
+#define HTTP_RESPONSE_MAX_HEADERS 1024
+
+/**
+ * @brief One response header line.
+ */
+typedef struct {
+    /** @brief Header name, a token without the colon. */
+    const char* name;
+
+    /** @brief Header value, without line breaks. */
+    const char* value;
+} HttpHeader;
+
+/**
+ * @brief Send a response with extra headers.
+ *
+ * @param[in] conn         Connection to answer.
+ * @param[in] status_code  HTTP status code.
+ * @param[in] content_type Content-Type value.
+ * @param[in] headers      Extra headers, sent in order (may be NULL).
+ * @param[in] header_count Number of entries in headers.
+ * @param[in] body         Response body (may be empty).
+ * @param[in] length       Body length in bytes.
+ *
+ * @return Result of send_response(). If a header is invalid or the headers
+ *         exceed HTTP_RESPONSE_MAX_HEADERS, the error is logged and a 500
+ *         is sent instead, so the request is still answered.
+ */
+int http_response_send(HTTPServerConnection* conn, int status_code,
+                       const char* content_type, const HttpHeader* headers,
+                       size_t header_count, const char* body, size_t length);
+
+#endif /* HTTP_RESPONSE_H */
@@ -0,0 +1,101 @@
+/**
+ * @file lib_hooks.c
+ * @brief Link-time wrappers implementation.
+ *
+ * @see lib_hooks.h
+ */
+
+#include "lib_hooks.h"
+
+#include "event_loop.h"
+#include "metrics.h"
+#include "reuseport.h"
+
+#include <errno.h>
+
+/* Resolved by the linker to the wrapped functions in libc and lib */
+int __real_bind(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
+int __real_listen(int sockfd, int backlog);
+int __real_accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen);
+int __real_accept4(int sockfd, struct sockaddr* addr, socklen_t* addrlen,
+                   int flags);
+int __real_connect(int sockfd, const struct sockaddr* addr,
+                   socklen_t addrlen);
+int __real_close(int fd);
+int __real_send_response(HTTPServerConnection* conn, int status_code,
+                         const char* content_type, const char* body,
+                         size_t body_len);
+int __real_send_json_error(HTTPServerConnection* conn, int status_code,
+                           const char* message);
+
+/* ============= Sockets ============= */
+
+int __wrap_bind(int sockfd, const struct sockaddr* addr, socklen_t addrlen) {
+    if (reuseport_prepare_bind(sockfd, addr) == 1) {
+        return 0;
+    }
+    return __real_bind(sockfd, addr, addrlen);
+}
+
+int __wrap_listen(int sockfd, int backlog) {
+    int result = __real_listen(sockfd, backlog);
+    if (result == 0) {
+        event_loop_socket_listening(sockfd);
+    }
+    return result;
+}
+
+int __wrap_accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen) {
+    if (event_loop_refuse_accept(sockfd)) {
+        return -1;
+    }
+
+    int fd = __real_accept(sockfd, addr, addrlen);
+    if (fd >= 0) {
+        event_loop_socket_accepted(fd);
+    }
+    return fd;
+}
+
+int __wrap_accept4(int sockfd, struct sockaddr* addr, socklen_t* addrlen,
+                   int flags) {
+    if (event_loop_refuse_accept(sockfd)) {
+        return -1;
+    }
+
+    int fd = __real_accept4(sockfd, addr, addrlen, flags);
+    if (fd >= 0) {
+        event_loop_socket_accepted(fd);
+    }
+    return fd;
+}
+
+int __wrap_connect(int sockfd, const struct sockaddr* addr,
+                   socklen_t addrlen) {
+    int result = __real_connect(sockfd, addr, addrlen);
+    if (result == 0 || errno == EINPROGRESS) {
+        event_loop_socket_connecting(sockfd, result != 0);
+    }
+    return result;
+}
+
+int __wrap_close(int fd) {
+    event_loop_socket_closing(fd);
+    return __real_close(fd);
+}
+
+/* ============= Responses ============= */
+
+int __wrap_send_response(HTTPServerConnection* conn, int status_code,
+                         const char* content_type, const char* body,
+                         size_t body_len) {
+    metrics_request_end(conn, status_code);
+    return __real_send_response(conn, status_code, content_type, body,
+                                body_len);
+}
+
+int __wrap_send_json_error(HTTPServerConnection* conn, int status_code,
+                           const char* message) {
+    metrics_request_end(conn, status_code);
+    return __real_send_json_error(conn, status_code, message);
+}
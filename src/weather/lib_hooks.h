@@ -0,0 +1,52 @@
+/**
+ * @file lib_hooks.h
+ * @brief Link-time wrappers that report lib's socket and response calls.
+ *
+ * lib creates, binds, accepts, connects and closes its sockets itself and
+ * answers requests through http_utils, without callbacks for any of it.
+ * The server binary is therefore linked with `-Wl,--wrap=<symbol>` for
+ * the symbols below (SERVER_LDFLAGS in the Makefile). lib_hooks.c defines
+ * all the `__wrap_` functions. Each one calls the real function and tells
+ * the module that needs to know:
+ *
+ * - bind(): reuseport_prepare_bind() enables SO_REUSEPORT or takes over an
+ *   inherited listening socket (reuseport.h)
+ * - listen(), accept(), accept4(), connect(): the event loop watches the
+ *   new socket, and refuses accepts while draining (event_loop.h)
+ * - close(): the event loop runs the event_loop_on_close() callback
+ * - send_response(), send_json_error(): metrics_request_end() ends the
+ *   request timing (metrics.h)
+ *
+ * The linker redirects every call site in the binary, ours as well as
+ * lib's, and from any thread. The event loop hooks act only on the thread
+ * that called event_loop_init(). Calls from other threads, such as the
+ * logger's writer, pass straight through, and a socket the loop tracks is
+ * never closed on another thread.
+ *
+ * A new hook goes here, with its line in the list above and its symbol in
+ * SERVER_LDFLAGS. A wrapper can go once lib offers a callback for it.
+ */
+
+#ifndef LIB_HOOKS_H
+#define LIB_HOOKS_H
+
+#include <http_server_connection.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+int __wrap_bind(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
+int __wrap_listen(int sockfd, int backlog);
+int __wrap_accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen);
+int __wrap_accept4(int sockfd, struct sockaddr* addr, socklen_t* addrlen,
+                   int flags);
+int __wrap_connect(int sockfd, const struct sockaddr* addr,
+                   socklen_t addrlen);
+int __wrap_close(int fd);
+
+int __wrap_send_response(HTTPServerConnection* conn, int status_code,
+                         const char* content_type, const char* body,
+                         size_t body_len);
+int __wrap_send_json_error(HTTPServerConnection* conn, int status_code,
+                           const char* message);
+
+#endif /* LIB_HOOKS_H */
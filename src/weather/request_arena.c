@@ -0,0 +1,147 @@
+/**
+ * @file request_arena.c
+ * @brief Request-scoped bump allocator implementation.
+ *
+ * @see request_arena.h
+ */
+
+#include "request_arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REQUEST_ARENA_ALIGN (sizeof(max_align_t))
+
+struct RequestArenaChunk {
+    RequestArenaChunk* next;
+    size_t             size; /* Usable bytes in data */
+    size_t             offset;
+    max_align_t        data[];
+};
+
+/* ============= Internal Helpers ============= */
+
+static size_t align_up(size_t size) {
+    return (size + REQUEST_ARENA_ALIGN - 1) & ~(REQUEST_ARENA_ALIGN - 1);
+}
+
+static RequestArenaChunk* chunk_create(size_t size) {
+    RequestArenaChunk* chunk = malloc(sizeof(RequestArenaChunk) + size);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->next   = NULL;
+    chunk->size   = size;
+    chunk->offset = 0;
+    return chunk;
+}
+
+/* ============= Public API ============= */
+
+void request_arena_initiate(RequestArena* arena) {
+    arena->head = NULL;
+    arena->used = 0;
+}
+
+void* request_arena_alloc(RequestArena* arena, size_t size) {
+    if (!arena || size > SIZE_MAX - REQUEST_ARENA_ALIGN) {
+        return NULL;
+    }
+
+    size = align_up(size ? size : 1);
+
+    RequestArenaChunk* chunk = arena->head;
+    if (!chunk || chunk->size - chunk->offset < size) {
+        chunk = chunk_create(size > REQUEST_ARENA_CHUNK_SIZE
+                                 ? size
+                                 : REQUEST_ARENA_CHUNK_SIZE);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+
+    void* ptr = (char*)chunk->data + chunk->offset;
+    chunk->offset += size;
+    arena->used += size;
+
+    return ptr;
+}
+
+void* request_arena_calloc(RequestArena* arena, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void* ptr = request_arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void* request_arena_realloc(RequestArena* arena, void* ptr, size_t old_size,
+                            size_t new_size) {
+    if (!ptr) {
+        return request_arena_alloc(arena, new_size);
+    }
+
+    RequestArenaChunk* chunk = arena->head;
+    size_t             old   = align_up(old_size ? old_size : 1);
+    size_t             grown = align_up(new_size ? new_size : 1);
+
+    /* Last allocation of the current chunk: bump its end */
+    if (chunk && (char*)ptr + old == (char*)chunk->data + chunk->offset &&
+        grown >= old && chunk->size - chunk->offset >= grown - old) {
+        chunk->offset += grown - old;
+        arena->used += grown - old;
+        return ptr;
+    }
+
+    void* copy = request_arena_alloc(arena, new_size);
+    if (copy) {
+        memcpy(copy, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return copy;
+}
+
+char* request_arena_strdup(RequestArena* arena, const char* text) {
+    size_t length = strlen(text);
+    char*  copy   = request_arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, text, length + 1);
+    }
+    return copy;
+}
+
+void request_arena_reset(RequestArena* arena) {
+    if (!arena->head) {
+        return;
+    }
+
+    /* Keep the oldest chunk: it is the default size unless the first
+     * allocation of the arena was oversized */
+    RequestArenaChunk* keep = arena->head;
+    while (keep->next) {
+        RequestArenaChunk* next = keep->next;
+        free(keep);
+        keep = next;
+    }
+
+    keep->offset = 0;
+    arena->head  = keep;
+    arena->used  = 0;
+}
+
+void request_arena_dispose(RequestArena* arena) {
+    RequestArenaChunk* chunk = arena->head;
+    while (chunk) {
+        RequestArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->used = 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file request_arena.h
+ * @brief Request-scoped bump allocator.
+ *
+ * Every WeatherServerInstance owns one arena. Request state, route
+ * contexts and the serialized response body are carved out of it with a
+ * pointer bump and are never freed individually; the whole arena is reset
+ * when the next request arrives on the connection and released with the
+ * instance. The first chunk is kept across resets, so a connection that
+ * serves many requests stops calling malloc after the first one; an
+ * instance whose connection goes idle disposes the arena, which stays
+ * usable and allocates again on the next request.
+ *
+ * Response bodies are rendered into the arena by json_writer.h; growing
+ * the most recent allocation extends it in place when the chunk has room.
+ *
+ * @note Not thread-safe; used from the smw scheduler thread only.
+ */
+
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <stddef.h>
+
+/** @brief Default chunk size; larger allocations get a chunk of their own. */
+#define REQUEST_ARENA_CHUNK_SIZE 16384
+
+/** @brief One block of arena memory. @internal */
+typedef struct RequestArenaChunk RequestArenaChunk;
+
+/**
+ * @brief Arena state. Zero-initialized is a valid empty arena.
+ */
+typedef struct {
+    /** @brief Chunk list, most recent first. */
+    RequestArenaChunk* head;
+
+    /** @brief Bytes handed out since the last reset. */
+    size_t used;
+} RequestArena;
+
+/**
+ * @brief Initialize an empty arena (allocates nothing).
+ */
+void request_arena_initiate(RequestArena* arena);
+
+/**
+ * @brief Allocate size bytes, aligned like malloc.
+ *
+ * @return Memory valid until the next reset, or NULL if out of memory.
+ */
+void* request_arena_alloc(RequestArena* arena, size_t size);
+
+/**
+ * @brief Allocate zero-filled memory.
+ */
+void* request_arena_calloc(RequestArena* arena, size_t count, size_t size);
+
+/**
+ * @brief Grow an allocation to new_size bytes, preserving old_size bytes.
+ *
+ * Extends in place when ptr is the most recent allocation and its chunk
+ * has room, otherwise copies into a new block (the old one is reclaimed
+ * on reset). ptr may be NULL.
+ *
+ * @return Memory valid until the next reset, or NULL if out of memory.
+ */
+void* request_arena_realloc(RequestArena* arena, void* ptr, size_t old_size,
+                            size_t new_size);
+
+/**
+ * @brief Copy a NUL-terminated string into the arena.
+ */
+char* request_arena_strdup(RequestArena* arena, const char* text);
+
+/**
+ * @brief Drop every allocation, keeping the first chunk for reuse.
+ */
+void request_arena_reset(RequestArena* arena);
+
+/**
+ * @brief Release all memory owned by the arena.
+ */
+void request_arena_dispose(RequestArena* arena);
+
+#endif /* REQUEST_ARENA_H */
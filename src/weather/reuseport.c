@@ -0,0 +1,93 @@
+/**
+ * @file reuseport.c
+ * @brief bind() hook that enables SO_REUSEPORT for worker processes.
+ *
+ * @see reuseport.h
+ */
+
+#include "reuseport.h"
+
+#include "logger.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int port_of(const struct sockaddr* addr) {
+    if (addr->sa_family == AF_INET) {
+        return ntohs(((const struct sockaddr_in*)addr)->sin_port);
+    }
+    if (addr->sa_family == AF_INET6) {
+        return ntohs(((const struct sockaddr_in6*)addr)->sin6_port);
+    }
+    return -1;
+}
+
+/**
+ * Replace sockfd with the listening socket from REUSEPORT_LISTEN_FD_ENV.
+ *
+ * @return 0 if it was taken over, -1 to bind normally
+ */
+static int adopt_listen_fd(int sockfd, const struct sockaddr* addr) {
+    const char* value = getenv(REUSEPORT_LISTEN_FD_ENV);
+    if (!value || !value[0]) {
+        return -1;
+    }
+    int listen_fd = atoi(value);
+    unsetenv(REUSEPORT_LISTEN_FD_ENV); /* Only the first bind takes it */
+
+    struct sockaddr_storage bound;
+    socklen_t               bound_len = sizeof(bound);
+    if (listen_fd <= STDERR_FILENO || listen_fd == sockfd ||
+        getsockname(listen_fd, (struct sockaddr*)&bound, &bound_len) != 0 ||
+        bound.ss_family != addr->sa_family ||
+        port_of((struct sockaddr*)&bound) != port_of(addr)) {
+        LOGGER_WARN("[REUSEPORT] Warning: Inherited socket %d does not "
+                    "match, binding a new one",
+                    listen_fd);
+        return -1;
+    }
+
+    int fd_flags     = fcntl(sockfd, F_GETFD);
+    int status_flags = fcntl(sockfd, F_GETFL);
+    if (dup2(listen_fd, sockfd) < 0) {
+        perror("[REUSEPORT] dup2");
+        return -1;
+    }
+    close(listen_fd);
+
+    if (fd_flags >= 0) {
+        fcntl(sockfd, F_SETFD, fd_flags);
+    }
+    if (status_flags >= 0) {
+        fcntl(sockfd, F_SETFL, status_flags);
+    }
+    return 0;
+}
+
+int reuseport_prepare_bind(int sockfd, const struct sockaddr* addr) {
+    if (addr && adopt_listen_fd(sockfd, addr) == 0) {
+        return 1;
+    }
+
+    const char* enabled = getenv(REUSEPORT_ENV);
+
+    int       type     = 0;
+    socklen_t type_len = sizeof(type);
+
+    if (enabled && strcmp(enabled, "1") == 0 &&
+        getsockopt(sockfd, SOL_SOCKET, SO_TYPE, &type, &type_len) == 0 &&
+        type == SOCK_STREAM) {
+        int one = 1;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one,
+                       sizeof(one)) < 0) {
+            perror("[REUSEPORT] setsockopt(SO_REUSEPORT)");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file reuseport.h
+ * @brief SO_REUSEPORT support for multi-process serving.
+ *
+ * The HTTP server in lib creates and binds its own listening socket, so
+ * bind() is wrapped at link time (lib_hooks.h) and every call goes through
+ * reuseport_prepare_bind() first. When the environment variable
+ * REUSEPORT_ENV is set to "1", the hook enables SO_REUSEPORT on TCP
+ * sockets before binding, which lets several server processes bind the
+ * same port and have the kernel spread new connections between them.
+ *
+ * The watchdog sets REUSEPORT_ENV and REUSEPORT_WORKER_ENV for each child
+ * in `--workers N` mode. Without it, binding stays exclusive so a second
+ * server started by accident still fails with EADDRINUSE.
+ *
+ * The watchdog also opens the listening socket of each worker itself and
+ * passes its descriptor in REUSEPORT_LISTEN_FD_ENV. The hook then takes
+ * that socket over instead of binding: it is moved onto the descriptor the
+ * caller created, keeping that descriptor's flags, and the inherited copy
+ * is closed. Because the watchdog never closes the socket, a replacement
+ * server can take it over while the old one still finishes its requests,
+ * and connections that arrive in between wait in the accept queue. A
+ * socket bound to another port than the one asked for is not used.
+ *
+ * @see jws_watchdog.c for the worker supervisor
+ */
+
+#ifndef REUSEPORT_H
+#define REUSEPORT_H
+
+#include <sys/socket.h>
+
+/** Set to "1" to bind listening sockets with SO_REUSEPORT. */
+#define REUSEPORT_ENV "JWS_REUSEPORT"
+
+/** Worker number (0..N-1) assigned by the watchdog, for logging. */
+#define REUSEPORT_WORKER_ENV "JWS_WORKER_ID"
+
+/** Listening socket inherited from the watchdog, taken over by bind(). */
+#define REUSEPORT_LISTEN_FD_ENV "JWS_LISTEN_FD"
+
+/**
+ * Called before sockfd is bound to addr.
+ *
+ * @return 1 if sockfd is now the inherited listening socket and must not
+ *         be bound, 0 to go on with bind()
+ */
+int reuseport_prepare_bind(int sockfd, const struct sockaddr* addr);
+
+#endif /* REUSEPORT_H */
@@ -0,0 +1,90 @@
+/**
+ * @file server_reload.c
+ * @brief Reload status reports and cache snapshots.
+ *
+ * @see server_reload.h
+ */
+
+#include "server_reload.h"
+
+#include "file_cache.h"
+#include "logger.h"
+#include "reuseport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* ============= Internal Helpers ============= */
+
+/**
+ * @brief Snapshot file name of this worker.
+ * @internal
+ */
+static void snapshot_name(char* out, size_t size) {
+    const char* worker = getenv(REUSEPORT_WORKER_ENV);
+    snprintf(out, size, SERVER_RELOAD_SNAPSHOT_NAME,
+             worker && worker[0] ? worker : "0");
+}
+
+/* ============= Public API ============= */
+
+void server_reload_notify(char status) {
+    const char* value = getenv(SERVER_RELOAD_STATUS_FD_ENV);
+    if (!value || !value[0]) {
+        return;
+    }
+
+    /* EPIPE if the watchdog is gone; SIGPIPE is ignored */
+    ssize_t written = write(atoi(value), &status, 1);
+    (void)written;
+}
+
+int server_reload_snapshot_save(void) {
+    char name[64];
+    snapshot_name(name, sizeof(name));
+
+    int total  = 0;
+    int failed = 0;
+    for (FileCacheInstance* cache = file_cache_next(NULL); cache;
+         cache                    = file_cache_next(cache)) {
+        int written = file_cache_snapshot_save(cache, name);
+        if (written < 0) {
+            failed++;
+        } else {
+            total += written;
+        }
+    }
+
+    if (failed > 0) {
+        LOGGER_WARN("[RELOAD] Warning: %d cache snapshots failed", failed);
+        if (total == 0) {
+            return -1;
+        }
+    }
+    LOGGER_INFO("[RELOAD] Saved %d cached entries", total);
+    return total;
+}
+
+int server_reload_snapshot_restore(void) {
+    const char* restore = getenv(SERVER_RELOAD_RESTORE_ENV);
+    if (!restore || strcmp(restore, "1") != 0) {
+        return 0;
+    }
+
+    char name[64];
+    snapshot_name(name, sizeof(name));
+
+    int total = 0;
+    for (FileCacheInstance* cache = file_cache_next(NULL); cache;
+         cache                    = file_cache_next(cache)) {
+        int restored = file_cache_snapshot_restore(cache, name);
+        if (restored > 0) {
+            total += restored;
+        }
+    }
+
+    LOGGER_INFO("[RELOAD] Restored %d cached entries", total);
+    return total;
+}
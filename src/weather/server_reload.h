@@ -0,0 +1,72 @@
+/**
+ * @file server_reload.h
+ * @brief Server side of the watchdog's zero-downtime reload.
+ *
+ * On SIGHUP the watchdog replaces its servers one at a time without
+ * closing the listening socket (see reuseport.h for the handoff):
+ *
+ * 1. With `--snapshot`, it sends SIGUSR1 to the running server, which
+ *    writes its in-memory cache tiers to disk and reports
+ *    SERVER_RELOAD_SNAPSHOT_SAVED.
+ * 2. It starts the new binary on the same socket, with
+ *    SERVER_RELOAD_RESTORE_ENV set if a snapshot was saved. The new server
+ *    restores the snapshot before it reports SERVER_RELOAD_READY.
+ * 3. It sends SIGQUIT to the old server, which stops accepting, answers
+ *    the requests it already has and exits (weather_server_drain()).
+ *
+ * Reports are single bytes written to the pipe whose descriptor the
+ * watchdog passes in SERVER_RELOAD_STATUS_FD_ENV. A server started
+ * without it reports nothing, and SIGUSR1 and SIGQUIT work the same.
+ *
+ * @note Not thread-safe; call from the main thread only.
+ */
+
+#ifndef SERVER_RELOAD_H
+#define SERVER_RELOAD_H
+
+/** @brief Write end of the status pipe to the watchdog. */
+#define SERVER_RELOAD_STATUS_FD_ENV "JWS_STATUS_FD"
+
+/** @brief Set to "1" to restore the cache snapshot at startup. */
+#define SERVER_RELOAD_RESTORE_ENV "JWS_RESTORE_SNAPSHOT"
+
+/** @brief Reported once the server takes requests. */
+#define SERVER_RELOAD_READY 'R'
+
+/** @brief Reported after a snapshot was written (even a partial one). */
+#define SERVER_RELOAD_SNAPSHOT_SAVED 'S'
+
+/**
+ * @brief Snapshot file name in every cache directory, per worker number.
+ *
+ * Workers share the cache directories but not their memory tiers; each
+ * one's replacement restores the snapshot of the worker it replaces.
+ */
+#define SERVER_RELOAD_SNAPSHOT_NAME "memory-%s.snapshot"
+
+/**
+ * @brief Report a reload step to the watchdog, if there is one.
+ *
+ * @param[in] status SERVER_RELOAD_READY or SERVER_RELOAD_SNAPSHOT_SAVED.
+ */
+void server_reload_notify(char status);
+
+/**
+ * @brief Write the memory tier of every file cache to its directory.
+ *
+ * @return Number of entries written, or -1 if no snapshot could be
+ *         written.
+ */
+int server_reload_snapshot_save(void);
+
+/**
+ * @brief Restore the snapshots written by the server this one replaces.
+ *
+ * Does nothing unless SERVER_RELOAD_RESTORE_ENV is set. Call once every
+ * file cache has been created.
+ *
+ * @return Number of entries restored.
+ */
+int server_reload_snapshot_restore(void);
+
+#endif /* SERVER_RELOAD_H */
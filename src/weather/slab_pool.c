@@ -0,0 +1,97 @@
+/**
+ * @file slab_pool.c
+ * @brief Fixed-capacity free-list pool implementation.
+ *
+ * @see slab_pool.h
+ */
+
+#include "slab_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Objects are aligned like malloc results so any struct fits */
+#define SLAB_POOL_ALIGN (sizeof(max_align_t))
+
+/* ============= Internal Helpers ============= */
+
+static int slab_pool_grow(SlabPool* pool) {
+    if (pool->slab_count >= pool->slab_max) {
+        return -1;
+    }
+
+    char* slab = malloc(pool->item_size * SLAB_POOL_SLAB_ITEMS);
+    if (!slab) {
+        return -2;
+    }
+    pool->slabs[pool->slab_count++] = slab;
+
+    /* Thread the new objects onto the free list, lowest address first */
+    for (size_t i = SLAB_POOL_SLAB_ITEMS; i-- > 0;) {
+        void* item = slab + i * pool->item_size;
+        memcpy(item, &pool->free_list, sizeof(void*));
+        pool->free_list = item;
+    }
+
+    return 0;
+}
+
+/* ============= Public API ============= */
+
+int slab_pool_initiate(SlabPool* pool, size_t item_size, size_t capacity) {
+    if (!pool || item_size == 0 || capacity == 0) {
+        return -1;
+    }
+
+    if (item_size < sizeof(void*)) {
+        item_size = sizeof(void*);
+    }
+    item_size = (item_size + SLAB_POOL_ALIGN - 1) & ~(SLAB_POOL_ALIGN - 1);
+
+    memset(pool, 0, sizeof(SlabPool));
+    pool->item_size = item_size;
+    pool->capacity  = capacity;
+    pool->slab_max =
+        (capacity + SLAB_POOL_SLAB_ITEMS - 1) / SLAB_POOL_SLAB_ITEMS;
+
+    pool->slabs = calloc(pool->slab_max, sizeof(void*));
+    if (!pool->slabs) {
+        return -2;
+    }
+
+    return 0;
+}
+
+void* slab_pool_alloc(SlabPool* pool) {
+    if (pool->in_use >= pool->capacity) {
+        return NULL;
+    }
+
+    if (!pool->free_list && slab_pool_grow(pool) != 0) {
+        return NULL;
+    }
+
+    void* item = pool->free_list;
+    memcpy(&pool->free_list, item, sizeof(void*));
+    pool->in_use++;
+
+    return item;
+}
+
+void slab_pool_free(SlabPool* pool, void* item) {
+    if (!item) {
+        return;
+    }
+
+    memcpy(item, &pool->free_list, sizeof(void*));
+    pool->free_list = item;
+    pool->in_use--;
+}
+
+void slab_pool_dispose(SlabPool* pool) {
+    for (size_t i = 0; i < pool->slab_count; i++) {
+        free(pool->slabs[i]);
+    }
+    free(pool->slabs);
+    memset(pool, 0, sizeof(SlabPool));
+}
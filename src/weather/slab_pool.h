@@ -0,0 +1,72 @@
+/**
+ * @file slab_pool.h
+ * @brief Fixed-capacity free-list pool for equally sized objects.
+ *
+ * Objects are carved out of slabs of SLAB_POOL_SLAB_ITEMS items that are
+ * allocated on demand and kept until the pool is disposed. Freed objects go
+ * onto an intrusive free list, so steady-state allocation and release are a
+ * pointer swap with no calls into malloc.
+ *
+ * @note Not thread-safe; used from the smw scheduler thread only.
+ */
+
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <stddef.h>
+
+/** @brief Objects per slab. */
+#define SLAB_POOL_SLAB_ITEMS 1024
+
+/**
+ * @brief Pool state.
+ */
+typedef struct {
+    /** @brief Size of one object (at least sizeof(void*)). */
+    size_t item_size;
+
+    /** @brief Maximum number of live objects. */
+    size_t capacity;
+
+    /** @brief Allocated slabs (capacity / SLAB_POOL_SLAB_ITEMS, rounded up). */
+    void** slabs;
+    size_t slab_count;
+    size_t slab_max;
+
+    /** @brief Head of the free list. */
+    void* free_list;
+
+    /** @brief Number of objects handed out. */
+    size_t in_use;
+} SlabPool;
+
+/**
+ * @brief Initialize an empty pool. No slab is allocated yet.
+ *
+ * @param[out] pool      Pool to initialize.
+ * @param[in]  item_size Object size in bytes.
+ * @param[in]  capacity  Maximum number of live objects.
+ *
+ * @return 0 on success, -1 on invalid parameters, -2 if allocation fails.
+ */
+int slab_pool_initiate(SlabPool* pool, size_t item_size, size_t capacity);
+
+/**
+ * @brief Take an object from the pool (contents are undefined).
+ *
+ * @return Object pointer, or NULL when the pool is at capacity or a new
+ *         slab cannot be allocated.
+ */
+void* slab_pool_alloc(SlabPool* pool);
+
+/**
+ * @brief Return an object to the pool (NULL is allowed).
+ */
+void slab_pool_free(SlabPool* pool, void* item);
+
+/**
+ * @brief Release every slab. Objects still in use become invalid.
+ */
+void slab_pool_dispose(SlabPool* pool);
+
+#endif /* SLAB_POOL_H */
@@ -0,0 +1,282 @@
+/**
+ * @file static_assets.c
+ * @brief In-memory static asset table implementation.
+ *
+ * @see static_assets.h
+ */
+
+#include "static_assets.h"
+
+#include "http_cache.h"
+#include "http_gzip.h"
+#include "logger.h"
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+/* Nesting limit for the directory walk */
+#define STATIC_ASSETS_MAX_DEPTH 8
+
+/* ============= Internal State ============= */
+
+/**
+ * @brief Assets sorted by path for binary search.
+ * @internal
+ */
+static StaticAsset* g_assets      = NULL;
+static size_t       g_asset_count = 0;
+
+/**
+ * @brief Content-Type by file extension.
+ * @internal
+ */
+static const struct {
+    const char* extension;
+    const char* content_type;
+    bool        compressible;
+} g_content_types[] = {
+    {"html", "text/html; charset=utf-8", true},
+    {"htm", "text/html; charset=utf-8", true},
+    {"css", "text/css; charset=utf-8", true},
+    {"js", "text/javascript; charset=utf-8", true},
+    {"mjs", "text/javascript; charset=utf-8", true},
+    {"json", "application/json", true},
+    {"map", "application/json", true},
+    {"txt", "text/plain; charset=utf-8", true},
+    {"xml", "application/xml", true},
+    {"svg", "image/svg+xml", true},
+    {"ico", "image/x-icon", true},
+    {"png", "image/png", false},
+    {"jpg", "image/jpeg", false},
+    {"jpeg", "image/jpeg", false},
+    {"gif", "image/gif", false},
+    {"webp", "image/webp", false},
+    {"woff", "font/woff", false},
+    {"woff2", "font/woff2", false},
+};
+
+#define CONTENT_TYPE_COUNT                                                     \
+    (sizeof(g_content_types) / sizeof(g_content_types[0]))
+
+/* ============= Internal Helpers ============= */
+
+/**
+ * @brief Look up the content type of a file name.
+ * @internal
+ */
+static const char* content_type_for(const char* name, bool* compressible) {
+    const char* dot = strrchr(name, '.');
+
+    if (dot) {
+        for (size_t i = 0; i < CONTENT_TYPE_COUNT; i++) {
+            if (strcasecmp(dot + 1, g_content_types[i].extension) == 0) {
+                *compressible = g_content_types[i].compressible;
+                return g_content_types[i].content_type;
+            }
+        }
+    }
+
+    *compressible = false;
+    return "application/octet-stream";
+}
+
+/**
+ * @brief Read a whole file into a new buffer.
+ * @internal
+ *
+ * @return 0 on success, -1 on I/O error or if the file is too large.
+ */
+static int read_file(const char* filepath, size_t size, char** out_data) {
+    FILE* fp = fopen(filepath, "rb");
+    if (!fp) {
+        return -1;
+    }
+
+    char* data = malloc(size + 1);
+    if (!data) {
+        fclose(fp);
+        return -1;
+    }
+
+    size_t read = fread(data, 1, size, fp);
+    fclose(fp);
+
+    if (read != size) {
+        free(data);
+        return -1;
+    }
+
+    data[size] = '\0';
+    *out_data  = data;
+    return 0;
+}
+
+static void asset_free(StaticAsset* asset) {
+    free(asset->path);
+    free(asset->body);
+    free(asset->gzip_body);
+}
+
+/**
+ * @brief Add one file to the table being built.
+ * @internal
+ */
+static void add_file(StaticAsset* assets, size_t* count, const char* filepath,
+                     const char* url_path, const struct stat* file_stat) {
+    if (*count >= STATIC_ASSETS_MAX_FILES) {
+        LOGGER_WARN("[ASSETS] Table full, skipping %s", filepath);
+        return;
+    }
+
+    if (file_stat->st_size > STATIC_ASSETS_MAX_FILE_SIZE) {
+        LOGGER_WARN("[ASSETS] Skipping %s (too large)", filepath);
+        return;
+    }
+
+    StaticAsset asset = {0};
+    bool        compressible;
+
+    asset.length       = (size_t)file_stat->st_size;
+    asset.modified_at  = file_stat->st_mtime;
+    asset.content_type = content_type_for(url_path, &compressible);
+    asset.path         = strdup(url_path);
+
+    if (!asset.path || read_file(filepath, asset.length, &asset.body) != 0) {
+        LOGGER_ERROR("[ASSETS] Failed to read %s", filepath);
+        asset_free(&asset);
+        return;
+    }
+
+    response_cache_etag(asset.body, asset.length, asset.etag);
+    if (compressible) {
+        http_gzip_compress(asset.body, asset.length, &asset.gzip_body,
+                           &asset.gzip_length);
+    }
+
+    assets[(*count)++] = asset;
+}
+
+/**
+ * @brief Walk a directory and add every regular, non-hidden file.
+ * @internal
+ */
+static void add_directory(StaticAsset* assets, size_t* count,
+                          const char* directory, const char* url_prefix,
+                          int depth) {
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue; /* ., .. and hidden files */
+        }
+
+        char filepath[1024];
+        char url_path[1024];
+        snprintf(filepath, sizeof(filepath), "%s/%s", directory,
+                 entry->d_name);
+        snprintf(url_path, sizeof(url_path), "%s/%s", url_prefix,
+                 entry->d_name);
+
+        struct stat file_stat;
+        if (stat(filepath, &file_stat) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(file_stat.st_mode) && depth < STATIC_ASSETS_MAX_DEPTH) {
+            add_directory(assets, count, filepath, url_path, depth + 1);
+        } else if (S_ISREG(file_stat.st_mode)) {
+            add_file(assets, count, filepath, url_path, &file_stat);
+        }
+    }
+
+    closedir(dir);
+}
+
+static int compare_assets(const void* a, const void* b) {
+    return strcmp(((const StaticAsset*)a)->path,
+                  ((const StaticAsset*)b)->path);
+}
+
+/* ============= Public API ============= */
+
+int static_assets_load(const char* directory) {
+    static_assets_unload();
+
+    StaticAsset* assets = calloc(STATIC_ASSETS_MAX_FILES, sizeof(StaticAsset));
+    if (!assets) {
+        return -1;
+    }
+
+    size_t count = 0;
+    add_directory(assets, &count, directory, "", 0);
+    qsort(assets, count, sizeof(StaticAsset), compare_assets);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        bytes += assets[i].length + assets[i].gzip_length;
+    }
+
+    g_assets      = assets;
+    g_asset_count = count;
+
+    LOGGER_INFO("[ASSETS] Loaded %zu files from %s (%zu bytes)", count,
+                directory, bytes);
+    return (int)count;
+}
+
+void static_assets_unload(void) {
+    for (size_t i = 0; i < g_asset_count; i++) {
+        asset_free(&g_assets[i]);
+    }
+
+    free(g_assets);
+    g_assets      = NULL;
+    g_asset_count = 0;
+}
+
+const StaticAsset* static_assets_find(const char* path, size_t path_len) {
+    size_t low  = 0;
+    size_t high = g_asset_count;
+
+    while (low < high) {
+        size_t      mid   = low + (high - low) / 2;
+        const char* name  = g_assets[mid].path;
+        int         order = strncmp(name, path, path_len);
+
+        if (order == 0 && name[path_len] != '\0') {
+            order = 1; /* name is longer, so it sorts after path */
+        }
+
+        if (order == 0) {
+            return &g_assets[mid];
+        }
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return NULL;
+}
+
+int static_assets_send(HTTPServerConnection* conn, const StaticAsset* asset) {
+    HttpCacheInfo cache_info = {
+        .etag          = asset->etag,
+        .gzip_body     = asset->gzip_body,
+        .gzip_length   = asset->gzip_length,
+        .last_modified = asset->modified_at,
+        .expires_at    = time(NULL) + STATIC_ASSETS_MAX_AGE};
+
+    return http_cache_send(conn, 200, asset->content_type, asset->body,
+                           asset->length, &cache_info);
+}
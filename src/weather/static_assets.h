@@ -0,0 +1,94 @@
+/**
+ * @file static_assets.h
+ * @brief Immutable in-memory table of the files under public/.
+ *
+ * Every regular file below the asset directory is read once at server
+ * start and kept in memory together with everything needed to answer a
+ * request for it: Content-Type, length, ETag, modification time and a
+ * gzip copy for compressible types. Serving an asset is a table lookup
+ * and a send; no file is opened, read or compressed per request.
+ *
+ * Files are addressed by their path below the directory, so
+ * public/js/app.js is served at /js/app.js. The table is not reloaded
+ * when files change; restart the server to pick up new assets.
+ *
+ * @note Not thread-safe; load and unload from the main thread only.
+ */
+
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include "response_cache.h"
+
+#include <http_server_connection.h>
+#include <stddef.h>
+#include <time.h>
+
+/** @brief Directory loaded by weather_server_initiate(). */
+#define STATIC_ASSETS_DEFAULT_DIR "./public"
+
+/** @brief Largest file that is loaded; bigger files are skipped. */
+#define STATIC_ASSETS_MAX_FILE_SIZE (8 * 1024 * 1024)
+
+/** @brief Maximum number of files in the table. */
+#define STATIC_ASSETS_MAX_FILES 256
+
+/** @brief Cache-Control max-age of asset responses, in seconds. */
+#define STATIC_ASSETS_MAX_AGE 300
+
+/**
+ * @brief One loaded file.
+ */
+typedef struct {
+    /** @brief URL path, e.g. "/index.html". */
+    char* path;
+
+    /** @brief Content-Type derived from the file extension. */
+    const char* content_type;
+
+    /** @brief File contents. */
+    char*  body;
+    size_t length;
+
+    /** @brief gzip copy of the contents, or NULL if not worth it. */
+    char*  gzip_body;
+    size_t gzip_length;
+
+    /** @brief Strong ETag of the contents. */
+    char etag[RESPONSE_CACHE_ETAG_LENGTH];
+
+    /** @brief File modification time (Last-Modified). */
+    time_t modified_at;
+} StaticAsset;
+
+/**
+ * @brief Load every file below a directory, replacing any loaded table.
+ *
+ * A missing directory is not an error; the table is just empty.
+ *
+ * @param[in] directory Asset root directory.
+ *
+ * @return Number of assets loaded, or -1 if out of memory.
+ */
+int static_assets_load(const char* directory);
+
+/**
+ * @brief Free the asset table.
+ */
+void static_assets_unload(void);
+
+/**
+ * @brief Find the asset for a URL path slice (not NUL-terminated).
+ *
+ * @return Asset, or NULL if no file is loaded at that path.
+ */
+const StaticAsset* static_assets_find(const char* path, size_t path_len);
+
+/**
+ * @brief Send an asset with its validators, gzip-encoded if accepted.
+ *
+ * @return Result of send_response().
+ */
+int static_assets_send(HTTPServerConnection* conn, const StaticAsset* asset);
+
+#endif /* STATIC_ASSETS_H */
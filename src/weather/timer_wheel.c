@@ -0,0 +1,129 @@
+/**
+ * @file timer_wheel.c
+ * @brief Hashed timer wheel implementation.
+ *
+ * @see timer_wheel.h
+ */
+
+#include "timer_wheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+_Static_assert((TIMER_WHEEL_SLOTS & TIMER_WHEEL_MASK) == 0,
+               "TIMER_WHEEL_SLOTS must be a power of two");
+
+/* ============= Internal Helpers ============= */
+
+static void node_unlink(TimerWheelNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev       = NULL;
+    node->next       = NULL;
+}
+
+static void node_link(TimerWheelNode* head, TimerWheelNode* node) {
+    node->prev       = head->prev;
+    node->next       = head;
+    head->prev->next = node;
+    head->prev       = node;
+}
+
+/* ============= Public API ============= */
+
+void timer_wheel_init(TimerWheel* wheel, uint64_t now_ms) {
+    for (size_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel->slots[i].prev     = &wheel->slots[i];
+        wheel->slots[i].next     = &wheel->slots[i];
+        wheel->slots[i].deadline = 0;
+    }
+    wheel->tick  = now_ms / TIMER_WHEEL_TICK_MS;
+    wheel->count = 0;
+}
+
+void timer_wheel_schedule(TimerWheel* wheel, TimerWheelNode* node,
+                          uint64_t deadline_ms) {
+    if (node->next) {
+        node_unlink(node);
+        wheel->count--;
+    }
+
+    /* Never file into an already processed bucket */
+    uint64_t tick = deadline_ms / TIMER_WHEEL_TICK_MS;
+    if (tick <= wheel->tick) {
+        tick = wheel->tick + 1;
+    }
+
+    node->deadline = deadline_ms;
+    node_link(&wheel->slots[tick & TIMER_WHEEL_MASK], node);
+    wheel->count++;
+}
+
+void timer_wheel_cancel(TimerWheel* wheel, TimerWheelNode* node) {
+    if (node->next) {
+        node_unlink(node);
+        wheel->count--;
+    }
+}
+
+int timer_wheel_is_armed(const TimerWheelNode* node) {
+    return node->next != NULL;
+}
+
+size_t timer_wheel_advance(TimerWheel* wheel, uint64_t now_ms,
+                           TimerWheelExpired expired, void* context) {
+    /* Only buckets whose whole tick has elapsed are processed, so every
+     * same-revolution timer in a bucket is due when it is visited */
+    uint64_t target = now_ms / TIMER_WHEEL_TICK_MS;
+    size_t   fired  = 0;
+
+    /* After a long stall one revolution covers every bucket */
+    if (target > wheel->tick + 1 + TIMER_WHEEL_SLOTS) {
+        wheel->tick = target - 1 - TIMER_WHEEL_SLOTS;
+    }
+
+    while (wheel->tick + 1 < target) {
+        wheel->tick++;
+        TimerWheelNode* head = &wheel->slots[wheel->tick & TIMER_WHEEL_MASK];
+
+        /* Detach the bucket first: callbacks may re-arm into it */
+        TimerWheelNode pending;
+        if (head->next == head) {
+            continue;
+        }
+        pending.next       = head->next;
+        pending.prev       = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        head->next         = head;
+        head->prev         = head;
+
+        while (pending.next != &pending) {
+            TimerWheelNode* node = pending.next;
+            node_unlink(node);
+
+            if (node->deadline > now_ms) {
+                node_link(head, node); /* Due in a later revolution */
+                continue;
+            }
+
+            wheel->count--;
+            fired++;
+            expired(node, now_ms, context);
+        }
+    }
+
+    return fired;
+}
+
+void timer_wheel_drain(TimerWheel* wheel, uint64_t now_ms,
+                       TimerWheelExpired expired, void* context) {
+    for (size_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        TimerWheelNode* head = &wheel->slots[i];
+        while (head->next != head) {
+            TimerWheelNode* node = head->next;
+            node_unlink(node);
+            wheel->count--;
+            expired(node, now_ms, context);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * @file timer_wheel.h
+ * @brief Hashed timer wheel for per-connection deadlines.
+ *
+ * Timers are intrusive nodes embedded in the object that owns them, so
+ * scheduling never allocates. The wheel has TIMER_WHEEL_SLOTS buckets of
+ * TIMER_WHEEL_TICK_MS each; advancing it only visits the buckets whose
+ * tick has elapsed, so the cost per scheduler pass is proportional to the
+ * number of timers due, not to the number of timers armed.
+ *
+ * Deadlines further out than one revolution of the wheel stay in their
+ * bucket and are looked at once per revolution until they are due.
+ *
+ * @par Usage:
+ * @code{.c}
+ * TimerWheel wheel;
+ * timer_wheel_init(&wheel, now_ms);
+ * timer_wheel_schedule(&wheel, &item->timer, now_ms + 30000);
+ * // in the scheduler task:
+ * timer_wheel_advance(&wheel, now_ms, on_expired, context);
+ * @endcode
+ *
+ * @note Not thread-safe; used from the smw scheduler thread only.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Number of buckets (power of two). */
+#define TIMER_WHEEL_SLOTS 512
+
+/** @brief Bucket width in milliseconds (one revolution is ~51 s). */
+#define TIMER_WHEEL_TICK_MS 100
+
+/**
+ * @brief Intrusive timer node.
+ *
+ * Zero-initialize before first use. A node is armed while it is linked
+ * into a bucket.
+ */
+typedef struct TimerWheelNode {
+    struct TimerWheelNode* prev;
+    struct TimerWheelNode* next;
+
+    /** @brief Absolute deadline in scheduler milliseconds. */
+    uint64_t deadline;
+} TimerWheelNode;
+
+/**
+ * @brief Timer wheel state.
+ */
+typedef struct {
+    /** @brief Bucket list heads (circular, sentinel nodes). */
+    TimerWheelNode slots[TIMER_WHEEL_SLOTS];
+
+    /** @brief Last tick that has been processed. */
+    uint64_t tick;
+
+    /** @brief Number of armed timers. */
+    size_t count;
+} TimerWheel;
+
+/**
+ * @brief Called for every expired timer; the node is already disarmed and
+ *        may be re-scheduled or released from inside the callback.
+ */
+typedef void (*TimerWheelExpired)(TimerWheelNode* node, uint64_t now_ms,
+                                  void* context);
+
+/**
+ * @brief Initialize an empty wheel starting at now_ms.
+ */
+void timer_wheel_init(TimerWheel* wheel, uint64_t now_ms);
+
+/**
+ * @brief Arm (or re-arm) a timer. Deadlines in the past fire on the next
+ *        timer_wheel_advance().
+ */
+void timer_wheel_schedule(TimerWheel* wheel, TimerWheelNode* node,
+                          uint64_t deadline_ms);
+
+/**
+ * @brief Disarm a timer (no-op if it is not armed).
+ */
+void timer_wheel_cancel(TimerWheel* wheel, TimerWheelNode* node);
+
+/**
+ * @brief Check whether a timer is armed.
+ */
+int timer_wheel_is_armed(const TimerWheelNode* node);
+
+/**
+ * @brief Fire every timer whose deadline is at or before now_ms.
+ *
+ * @return Number of timers fired.
+ */
+size_t timer_wheel_advance(TimerWheel* wheel, uint64_t now_ms,
+                           TimerWheelExpired expired, void* context);
+
+/**
+ * @brief Disarm every timer, calling expired for each (used on shutdown).
+ */
+void timer_wheel_drain(TimerWheel* wheel, uint64_t now_ms,
+                       TimerWheelExpired expired, void* context);
+
+#endif /* TIMER_WHEEL_H */
@@ -10,16 +10,32 @@
 
 #include "weather_location_handler.h"
 
+#include "city_grid.h"
+#include "city_index.h"
 #include "geocoding_api.h"
+#include "json_writer.h"
+#include "logger.h"
 #include "open_meteo_api.h"
 #include "open_meteo_handler.h"
 #include "popular_cities.h"
 #include "response_builder.h"
+#include "response_cache.h"
 
+#include <ctype.h>
 #include <jansson.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+/** @brief Memory budget for serialized /v1/weather and /v1/cities bodies. */
+#define WLH_RESPONSE_CACHE_BYTES (4 * 1024 * 1024)
+
+/** @brief Lifetime of a cached /v1/cities body, in seconds. */
+#define WLH_CITIES_RESPONSE_TTL 3600
+
+/** @brief Most locations in one /v1/weather/batch request. */
+#define WLH_BATCH_MAX_LOCATIONS OPEN_METEO_BATCH_MAX
 
 /**
  * @brief Global flag indicating whether the module has been initialized.
@@ -33,6 +49,27 @@ static bool g_initialized = false;
  */
 static PopularCitiesDB* g_wlh_popular_cities_db = NULL;
 
+/**
+ * @brief Memory-mapped city index, preferred over the JSON database.
+ * @internal
+ */
+static CityIndex* g_wlh_city_index = NULL;
+
+/**
+ * @brief Spatial grid over the city index for nearest-city lookups.
+ * @internal
+ */
+static CityGrid* g_wlh_city_grid = NULL;
+
+/**
+ * @brief Finished response bodies keyed by normalized query.
+ * @internal
+ *
+ * /v1/weather entries are tagged with the weather cache key they were
+ * rendered from and dropped when that entry is refreshed.
+ */
+static ResponseCache* g_wlh_response_cache = NULL;
+
 /**
  * @brief External reference to geocoding API's global popular cities DB
  * pointer.
@@ -42,15 +79,62 @@ static PopularCitiesDB* g_wlh_popular_cities_db = NULL;
  */
 extern void* g_popular_cities_db;
 
+/**
+ * @brief External reference to geocoding API's global city index pointer.
+ * @internal
+ */
+extern CityIndex* g_city_index;
+
 /* Forward declarations for internal functions */
 static void url_decode(const char* src, char* dst, size_t dst_size);
 static int  parse_city_query(const char* query, char* city, size_t city_size,
                              char* country, size_t country_size, char* region,
                              size_t region_size);
 static int  ensure_initialized(void);
+static void load_popular_cities(void);
+static void build_weather_response_key(const char* city, const char* country,
+                                       const char* region, char* out,
+                                       size_t out_size);
 
 /* ============= Lazy Initialization ============= */
 
+/**
+ * @brief Load the JSON city datasets into the popular cities database.
+ * @internal
+ *
+ * Only used when the binary city index is missing or invalid.
+ */
+static void load_popular_cities(void) {
+    /* Load popular cities database */
+    int cities_result =
+        popular_cities_load("./data/hot_cities.json", "./data/all_cities.json",
+                            &g_wlh_popular_cities_db);
+
+    if (cities_result != 0) {
+        LOGGER_WARN("[WEATHER_LOCATION] Warning: Failed to load popular cities "
+                    "database (fallback to API-only mode)");
+        /* Not a critical error - continue without local database */
+        g_popular_cities_db = NULL;
+    } else {
+        LOGGER_INFO("[WEATHER_LOCATION] Loaded popular cities database");
+        /* Set the global pointer for geocoding_api to use */
+        g_popular_cities_db = g_wlh_popular_cities_db;
+    }
+}
+
+/**
+ * @brief Drop cached /v1/weather bodies rendered from a refreshed entry.
+ * @internal
+ */
+static void on_weather_refreshed(const char* cache_key) {
+    size_t removed =
+        response_cache_invalidate_tag(g_wlh_response_cache, cache_key);
+    if (removed > 0) {
+        LOGGER_INFO("[WEATHER_LOCATION] Invalidated %zu cached responses",
+                    removed);
+    }
+}
+
 /**
  * @brief Ensure all dependent modules are initialized.
  * @internal
@@ -65,46 +149,63 @@ static int ensure_initialized(void) {
         return 0; /* Already initialized */
     }
 
-    printf("[WEATHER_LOCATION] Initializing modules...\n");
+    LOGGER_INFO("[WEATHER_LOCATION] Initializing modules...");
 
     /* FIX: Initialize Weather API FIRST */
     /* This will create ./cache/ and set up caching */
     if (open_meteo_handler_init() != 0) {
-        fprintf(stderr, "[WEATHER_LOCATION] Failed to init weather API\n");
+        LOGGER_ERROR("[WEATHER_LOCATION] Failed to init weather API");
         return -1;
     }
 
     /* Initialize geocoding API */
-    GeocodingConfig geo_config = {.cache_dir   = "./cache/geo_cache",
-                                  .cache_ttl   = 604800, /* 7 days */
-                                  .use_cache   = true,
-                                  .max_results = 10,
-                                  .language    = "eng"};
+    GeocodingConfig geo_config = {.cache_dir          = "./cache/geo_cache",
+                                  .cache_ttl          = 604800, /* 7 days */
+                                  .use_cache          = true,
+                                  .max_results        = 10,
+                                  .language           = "eng",
+                                  .memory_cache_bytes = 4 * 1024 * 1024};
 
     if (geocoding_api_init(&geo_config) != 0) {
-        fprintf(stderr, "[WEATHER_LOCATION] Failed to init geocoding API\n");
+        LOGGER_ERROR("[WEATHER_LOCATION] Failed to init geocoding API");
         return -1;
     }
 
-    /* Load popular cities database */
-    int cities_result =
-        popular_cities_load("./data/hot_cities.json", "./data/all_cities.json",
-                            &g_wlh_popular_cities_db);
+    /* Map the binary city index; parsing the JSON datasets is the fallback */
+    int index_result =
+        city_index_open(CITY_INDEX_DEFAULT_PATH, &g_wlh_city_index);
 
-    if (cities_result != 0) {
-        fprintf(stderr,
-                "[WEATHER_LOCATION] Warning: Failed to load popular cities "
-                "database (fallback to API-only mode)\n");
-        /* Not a critical error - continue without local database */
-        g_popular_cities_db = NULL;
+    if (index_result == CITY_INDEX_OK) {
+        LOGGER_INFO("[WEATHER_LOCATION] Mapped city index (%zu cities)",
+                    city_index_count(g_wlh_city_index));
+        g_city_index = g_wlh_city_index;
+
+        if (city_grid_build(g_wlh_city_index, &g_wlh_city_grid) ==
+            CITY_INDEX_OK) {
+            open_meteo_handler_set_city_lookup(g_wlh_city_index,
+                                               g_wlh_city_grid);
+        } else {
+            LOGGER_WARN("[WEATHER_LOCATION] Warning: Failed to build city grid "
+                        "(no nearest_city in /v1/current)");
+        }
     } else {
-        printf("[WEATHER_LOCATION] Loaded popular cities database\n");
-        /* Set the global pointer for geocoding_api to use */
-        g_popular_cities_db = g_wlh_popular_cities_db;
+        LOGGER_WARN("[WEATHER_LOCATION] Warning: City index unavailable (%d), "
+                    "loading JSON datasets (run 'make city-index')",
+                    index_result);
+        load_popular_cities();
+    }
+
+    /* Optional: without it every request is rendered from scratch */
+    g_wlh_response_cache = response_cache_create(WLH_RESPONSE_CACHE_BYTES);
+    if (g_wlh_response_cache) {
+        open_meteo_api_set_refresh_hook(on_weather_refreshed);
+    } else {
+        LOGGER_WARN("[WEATHER_LOCATION] Warning: Failed to create response "
+                    "cache");
     }
 
     g_initialized = true;
-    printf("[WEATHER_LOCATION] All modules initialized successfully\n");
+    LOGGER_INFO("[WEATHER_LOCATION] All modules initialized successfully");
     return 0;
 }
 
@@ -120,317 +221,954 @@ int weather_location_handler_init(void) {
     return ensure_initialized();
 }
 
+/* ============= Asynchronous Request State ============= */
+
+/**
+ * @brief Per-request state for /v1/weather (geocoding -> weather chain).
+ * @internal
+ */
+typedef struct {
+    WeatherLocationOnResponse callback;
+    void*                     context;
+    RequestArena*             arena; /* Owns this struct if set */
+    char                      city[128];
+    char                      country[8];
+    char                      response_key[256]; /* Response cache key */
+    GeocodingResult           location; /* Copy of the best geocoding hit */
+} CityWeatherRequest;
+
+/**
+ * @brief Per-request state for /v1/cities.
+ * @internal
+ */
+typedef struct {
+    WeatherLocationOnResponse callback;
+    void*                     context;
+    RequestArena*             arena; /* Owns this struct if set */
+    char                      query[256];
+} CitySearchRequest;
+
+/**
+ * @brief Allocate zeroed request state from the arena, or the heap if NULL.
+ * @internal
+ */
+static void* request_alloc(RequestArena* arena, size_t size) {
+    return arena ? request_arena_calloc(arena, 1, size) : calloc(1, size);
+}
+
+/**
+ * @brief Release request state that was not taken from an arena.
+ * @internal
+ */
+static void request_release(RequestArena* arena, void* request) {
+    if (!arena) {
+        free(request);
+    }
+}
+
+/**
+ * @brief Deliver a response to the caller and release the JSON string.
+ * @internal
+ *
+ * @param[in] cache_info Validators for a cacheable response, or NULL.
+ * @param[in] arena      Arena the string was built in, or NULL if it is a
+ *                       heap string to free.
+ */
+static void respond(WeatherLocationOnResponse callback, void* context,
+                    char* response_json, int status_code,
+                    const HttpCacheInfo* cache_info, RequestArena* arena) {
+    callback(response_json, status_code, cache_info, context);
+    if (!arena) {
+        free(response_json);
+    }
+}
+
+/**
+ * @brief Store a rendered body and complete its cache metadata.
+ * @internal
+ *
+ * On success the stored ETag and gzip copy are added to cache_info, so the
+ * first response already uses the body compressed for the cache.
+ */
+static void store_response(const char* key, const char* tag, const char* body,
+                           HttpCacheInfo* cache_info) {
+    ResponseCacheHit hit;
+    if (response_cache_put(g_wlh_response_cache, key, tag, body, strlen(body),
+                           cache_info->last_modified,
+                           cache_info->expires_at) &&
+        response_cache_get(g_wlh_response_cache, key, &hit)) {
+        cache_info->etag        = hit.etag;
+        cache_info->gzip_body   = hit.gzip_body;
+        cache_info->gzip_length = hit.gzip_length;
+    }
+}
+
+/**
+ * @brief Answer from the response cache if a live body exists for key.
+ * @internal
+ *
+ * @return true if the callback was invoked with the cached body.
+ */
+static bool respond_cached(WeatherLocationOnResponse callback, void* context,
+                           const char* key) {
+    ResponseCacheHit hit;
+    if (!response_cache_get(g_wlh_response_cache, key, &hit)) {
+        return false;
+    }
+
+    LOGGER_DEBUG("[WEATHER_LOCATION] Response cache HIT");
+
+    HttpCacheInfo cache_info = {.etag          = hit.etag,
+                                .gzip_body     = hit.gzip_body,
+                                .gzip_length   = hit.gzip_length,
+                                .last_modified = hit.modified_at,
+                                .expires_at    = hit.expires_at};
+
+    /* Borrowed: the callback only reads the body */
+    callback((char*)hit.body, HTTP_OK, &cache_info, context);
+    return true;
+}
+
+/**
+ * @brief Deliver a standardized error response.
+ * @internal
+ */
+static void respond_error(WeatherLocationOnResponse callback, void* context,
+                          int status_code, const char* message) {
+    respond(callback, context,
+            response_builder_error(status_code,
+                                   response_builder_get_error_type(status_code),
+                                   message),
+            status_code, NULL, NULL);
+}
+
+/**
+ * @brief Open the standard {"success": true, "data": {...}} envelope.
+ * @internal
+ */
+static void begin_success(JsonWriter* writer, RequestArena* arena) {
+    json_writer_initiate(writer, arena);
+    json_write_begin_object(writer);
+    json_write_key_bool(writer, "success", true);
+    json_write_key_object(writer, "data");
+}
+
+/**
+ * @brief Close the envelope and return the rendered body.
+ * @internal
+ *
+ * @return JSON response string (arena-owned if the writer has an arena),
+ *         or NULL on failure.
+ */
+static char* finish_success(JsonWriter* writer) {
+    json_write_end_object(writer); /* data */
+    json_write_end_object(writer);
+    return json_writer_finish(writer, NULL);
+}
+
+/**
+ * @brief Write the "location" object of a weather response.
+ * @internal
+ */
+static void write_location(JsonWriter*            writer,
+                           const GeocodingResult* location) {
+    json_write_key_object(writer, "location");
+    json_write_key_str(writer, "name", location->name);
+    json_write_key_str(writer, "country", location->country);
+    json_write_key_str(writer, "country_code", location->country_code);
+
+    if (location->admin1[0]) {
+        json_write_key_str(writer, "region", location->admin1);
+    }
+
+    json_write_key_double(writer, "latitude", location->latitude);
+    json_write_key_double(writer, "longitude", location->longitude);
+
+    if (location->population > 0) {
+        json_write_key_int(writer, "population", location->population);
+    }
+
+    if (location->timezone[0]) {
+        json_write_key_str(writer, "timezone", location->timezone);
+    }
+
+    json_write_end_object(writer);
+}
+
 /**
- * @brief Handle weather request by city name.
+ * @brief Write the "current_weather" object of a weather response.
+ * @internal
+ */
+static void write_current_weather(JsonWriter*        writer,
+                                  const WeatherData* weather_data) {
+    json_write_key_object(writer, "current_weather");
+    json_write_key_double(writer, "temperature", weather_data->temperature);
+    json_write_key_str(writer, "temperature_unit",
+                       weather_data->temperature_unit);
+    json_write_key_int(writer, "weather_code", weather_data->weather_code);
+    json_write_key_str(
+        writer, "weather_description",
+        open_meteo_api_get_description(weather_data->weather_code));
+    json_write_key_double(writer, "windspeed", weather_data->windspeed);
+    json_write_key_str(writer, "windspeed_unit", weather_data->windspeed_unit);
+    json_write_key_int(writer, "wind_direction_10m",
+                       weather_data->winddirection);
+    json_write_key_str(
+        writer, "wind_direction_name",
+        open_meteo_api_get_wind_direction(weather_data->winddirection));
+    json_write_key_double(writer, "humidity", weather_data->humidity);
+    json_write_key_double(writer, "pressure", weather_data->pressure);
+    json_write_key_double(writer, "precipitation",
+                          weather_data->precipitation);
+    json_write_key_int(writer, "is_day", weather_data->is_day ? 1 : 0);
+    json_write_end_object(writer);
+}
+
+/**
+ * @brief Build the /v1/weather success body.
+ * @internal
  *
- * @param[in]  query_string  URL query parameters.
- * @param[out] response_json Allocated JSON response (caller frees).
- * @param[out] status_code   HTTP status code.
+ * @param[in] best_location Geocoding result used for the lookup.
+ * @param[in] weather_data  Weather data for the location.
+ * @param[in] arena         Arena to render into, or NULL for the heap.
  *
- * @return 0 on success, -1 on error.
+ * @return JSON response string (arena-owned if arena is set), or NULL on
+ *         failure.
  */
-int weather_location_handler_by_city(const char* query_string,
-                                     char** response_json, int* status_code) {
-    if (!response_json || !status_code) {
+static char* build_city_weather_response(const GeocodingResult* best_location,
+                                         const WeatherData*     weather_data,
+                                         RequestArena*          arena) {
+    JsonWriter writer;
+    begin_success(&writer, arena);
+
+    write_location(&writer, best_location);
+    write_current_weather(&writer, weather_data);
+
+    return finish_success(&writer);
+}
+
+/**
+ * @brief Step 2 of /v1/weather: weather lookup completed.
+ * @internal
+ */
+static void on_city_weather(int result, const WeatherData* weather_data,
+                            void* context) {
+    CityWeatherRequest* request = (CityWeatherRequest*)context;
+
+    if (result != 0 || !weather_data) {
+        respond_error(request->callback, request->context, HTTP_INTERNAL_ERROR,
+                      "Failed to fetch weather data");
+        request_release(request->arena, request);
+        return;
+    }
+
+    /* 3. Build JSON response with city and weather information */
+    char* response_json = build_city_weather_response(
+        &request->location, weather_data, request->arena);
+
+    /* The body is fresh for as long as the weather entry behind it */
+    char          weather_key[OPEN_METEO_CACHE_KEY_LENGTH];
+    HttpCacheInfo cache_info = {0};
+    bool          cacheable  = false;
+
+    if (response_json) {
+        LOGGER_DEBUG("[WEATHER_LOCATION] Response generated successfully");
+
+        cacheable =
+            open_meteo_api_cache_key(request->location.latitude,
+                                     request->location.longitude, weather_key,
+                                     sizeof(weather_key)) == 0 &&
+            open_meteo_api_cache_times(weather_key, &cache_info.last_modified,
+                                       &cache_info.expires_at) == 0;
+    }
+
+    if (cacheable) {
+        store_response(request->response_key, weather_key, response_json,
+                       &cache_info);
+    }
+
+    respond(request->callback, request->context, response_json,
+            response_json ? HTTP_OK : HTTP_INTERNAL_ERROR,
+            cacheable ? &cache_info : NULL, request->arena);
+    request_release(request->arena, request);
+}
+
+/**
+ * @brief Step 1 of /v1/weather: geocoding completed.
+ * @internal
+ */
+static void on_city_geocoded(int result, GeocodingResponse* geo_response,
+                             void* context) {
+    CityWeatherRequest* request = (CityWeatherRequest*)context;
+
+    if (result != 0 || !geo_response || geo_response->count == 0) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "City not found: %s",
+                 request->city);
+        respond_error(request->callback, request->context, HTTP_NOT_FOUND,
+                      error_msg);
+        request_release(request->arena, request);
+        return;
+    }
+
+    /* Take the best result */
+    GeocodingResult* best_location = geocoding_api_get_best_result(
+        geo_response, request->country[0] ? request->country : NULL);
+    if (!best_location) {
+        respond_error(request->callback, request->context, HTTP_INTERNAL_ERROR,
+                      "Failed to determine best location");
+        request_release(request->arena, request);
+        return;
+    }
+
+    LOGGER_DEBUG("[WEATHER_LOCATION] Found: %s, %s (%.4f, %.4f)",
+                 best_location->name, best_location->country,
+                 best_location->latitude, best_location->longitude);
+
+    /* geo_response is released after this callback returns */
+    request->location = *best_location;
+
+    /* 2. Fetch weather for the found coordinates */
+    Location location = {.latitude  = request->location.latitude,
+                         .longitude = request->location.longitude,
+                         .name      = request->location.name};
+
+    open_meteo_api_get_current_async(&location, on_city_weather, request);
+}
+
+/**
+ * @brief Handle weather request by city name asynchronously.
+ *
+ * @param[in] query_string URL query parameters.
+ * @param[in] arena        Request arena, or NULL to use the heap.
+ * @param[in] callback     Completion callback.
+ * @param[in] context      User context passed to the callback.
+ *
+ * @return 0 if the request was accepted, -1 on error.
+ */
+int weather_location_handler_by_city_async(const char* query_string,
+                                           RequestArena*             arena,
+                                           WeatherLocationOnResponse callback,
+                                           void*                     context) {
+    if (!callback) {
         return -1;
     }
 
     /* Automatic initialization on first call */
     if (ensure_initialized() != 0) {
-        *response_json = response_builder_error(
-            HTTP_INTERNAL_ERROR,
-            response_builder_get_error_type(HTTP_INTERNAL_ERROR),
-            "Failed to initialize geocoding module");
-        *status_code = HTTP_INTERNAL_ERROR;
+        respond_error(callback, context, HTTP_INTERNAL_ERROR,
+                      "Failed to initialize geocoding module");
+        return -1;
+    }
+
+    CityWeatherRequest* request =
+        request_alloc(arena, sizeof(CityWeatherRequest));
+    if (!request) {
+        respond(callback, context, NULL, HTTP_INTERNAL_ERROR, NULL, NULL);
         return -1;
     }
 
-    *response_json = NULL;
-    *status_code   = HTTP_INTERNAL_ERROR;
+    request->callback = callback;
+    request->context  = context;
+    request->arena    = arena;
 
     /* Parse query parameters */
-    char city[128]  = {0};
-    char country[8] = {0};
     char region[64] = {0};
 
-    if (parse_city_query(query_string, city, sizeof(city), country,
-                         sizeof(country), region, sizeof(region)) != 0) {
-        *response_json = response_builder_error(
-            HTTP_BAD_REQUEST, response_builder_get_error_type(HTTP_BAD_REQUEST),
+    if (parse_city_query(query_string, request->city, sizeof(request->city),
+                         request->country, sizeof(request->country), region,
+                         sizeof(region)) != 0) {
+        respond_error(
+            callback, context, HTTP_BAD_REQUEST,
             "Invalid query parameters. Expected: city=<name>&country=<code>");
-        *status_code = HTTP_BAD_REQUEST;
+        request_release(arena, request);
         return -1;
     }
 
-    if (city[0] == '\0') {
-        *response_json = response_builder_error(
-            HTTP_BAD_REQUEST, response_builder_get_error_type(HTTP_BAD_REQUEST),
-            "Missing required parameter: city");
-        *status_code = HTTP_BAD_REQUEST;
+    if (request->city[0] == '\0') {
+        respond_error(callback, context, HTTP_BAD_REQUEST,
+                      "Missing required parameter: city");
+        request_release(arena, request);
         return -1;
     }
 
-    printf("[WEATHER_LOCATION] Request for city: %s%s%s%s%s\n", city,
-           region[0] ? ", " : "", region, country[0] ? " (" : "",
-           country[0] ? country : "");
+    build_weather_response_key(request->city, request->country, region,
+                               request->response_key,
+                               sizeof(request->response_key));
 
-    /* 1. Find city coordinates via geocoding */
-    GeocodingResponse* geo_response = NULL;
-    int                result;
+    if (respond_cached(callback, context, request->response_key)) {
+        request_release(arena, request);
+        return 0;
+    }
 
+    const char* country = request->country[0] ? request->country : NULL;
+
+    LOGGER_DEBUG("[WEATHER_LOCATION] Request for city: %s%s%s%s%s",
+                 request->city, region[0] ? ", " : "", region,
+                 country ? " (" : "", country ? country : "");
+
+    /* 1. Find city coordinates via geocoding */
     if (region[0] != '\0') {
-        result = geocoding_api_search_detailed(
-            city, region, country[0] ? country : NULL, &geo_response);
+        geocoding_api_search_detailed_async(request->city, region, country,
+                                            on_city_geocoded, request);
     } else {
-        result = geocoding_api_search(city, country[0] ? country : NULL,
-                                      &geo_response);
+        geocoding_api_search_async(request->city, country, on_city_geocoded,
+                                   request);
     }
 
-    if (result != 0 || !geo_response || geo_response->count == 0) {
-        char error_msg[256];
-        snprintf(error_msg, sizeof(error_msg), "City not found: %s", city);
-        *response_json = response_builder_error(
-            HTTP_NOT_FOUND, response_builder_get_error_type(HTTP_NOT_FOUND),
-            error_msg);
-        *status_code = HTTP_NOT_FOUND;
-
-        if (geo_response) {
-            geocoding_api_free_response(geo_response);
-        }
+    return 0;
+}
+
+/* ============= Batch Lookups ============= */
+
+typedef struct CityWeatherBatch CityWeatherBatch;
+
+/**
+ * @brief One location of a /v1/weather/batch request.
+ * @internal
+ */
+typedef struct {
+    CityWeatherBatch* batch;
+    char              label[160]; /* Location as given, echoed as "query" */
+    char              city[128];  /* Empty when given as coordinates */
+    char              country[8];
+    int               status; /* HTTP status once known, 0 before */
+    const char*       error;  /* Message for a failed status */
+    GeocodingResult   location;
+    WeatherData       weather;
+} CityWeatherBatchItem;
+
+/**
+ * @brief Per-request state for /v1/weather/batch.
+ * @internal
+ *
+ * pending counts the lookups of the current phase that are still out,
+ * plus one held while they are being started, so lookups that complete
+ * synchronously cannot end the phase early.
+ */
+struct CityWeatherBatch {
+    WeatherLocationOnResponse callback;
+    void*                     context;
+    RequestArena*             arena; /* Owns this struct if set */
+    size_t                    pending;
+    bool                      fetching; /* Weather phase, after geocoding */
+    size_t                    count;
+    CityWeatherBatchItem      items[WLH_BATCH_MAX_LOCATIONS];
+};
+
+/**
+ * @brief Add a location given by name.
+ * @internal
+ *
+ * @return 0 on success, -1 if the name is empty, -2 if the batch is full.
+ */
+static int batch_add_city(CityWeatherBatch* batch, const char* city,
+                          const char* country) {
+    while (isspace((unsigned char)*city)) {
+        city++;
+    }
+    if (*city == '\0') {
         return -1;
     }
+    if (batch->count == WLH_BATCH_MAX_LOCATIONS) {
+        return -2;
+    }
 
-    /* Take the best result */
-    GeocodingResult* best_location = geocoding_api_get_best_result(
-        geo_response, country[0] ? country : NULL);
-    if (!best_location) {
-        *response_json = response_builder_error(
-            HTTP_INTERNAL_ERROR,
-            response_builder_get_error_type(HTTP_INTERNAL_ERROR),
-            "Failed to determine best location");
-        *status_code = HTTP_INTERNAL_ERROR;
-        geocoding_api_free_response(geo_response);
+    CityWeatherBatchItem* item = &batch->items[batch->count++];
+    item->batch                = batch;
+    snprintf(item->city, sizeof(item->city), "%s", city);
+    snprintf(item->country, sizeof(item->country), "%s",
+             country ? country : "");
+    snprintf(item->label, sizeof(item->label), "%s%s%s", item->city,
+             item->country[0] ? "," : "", item->country);
+    return 0;
+}
+
+/**
+ * @brief Add a location given by coordinates; it needs no geocoding.
+ * @internal
+ *
+ * @return 0 on success, -1 if out of range, -2 if the batch is full.
+ */
+static int batch_add_coordinates(CityWeatherBatch* batch, double latitude,
+                                 double longitude) {
+    if (latitude < -90.0 || latitude > 90.0 || longitude < -180.0 ||
+        longitude > 180.0) {
         return -1;
     }
+    if (batch->count == WLH_BATCH_MAX_LOCATIONS) {
+        return -2;
+    }
 
-    printf("[WEATHER_LOCATION] Found: %s, %s (%.4f, %.4f)\n",
-           best_location->name, best_location->country, best_location->latitude,
-           best_location->longitude);
+    CityWeatherBatchItem* item = &batch->items[batch->count++];
+    item->batch                = batch;
+    item->location.latitude    = (float)latitude;
+    item->location.longitude   = (float)longitude;
+    snprintf(item->label, sizeof(item->label), "%.4f,%.4f", latitude,
+             longitude);
+    return 0;
+}
 
-    /* 2. Fetch weather for the found coordinates */
-    Location location = {.latitude  = best_location->latitude,
-                         .longitude = best_location->longitude,
-                         .name      = best_location->name};
+/**
+ * @brief Read locations from repeated city=NAME[,CODE] and coords=LAT,LON
+ *        query parameters.
+ * @internal
+ *
+ * @return 0 on success, -1 on an invalid location, -2 if there are too many.
+ */
+static int parse_batch_query(CityWeatherBatch* batch, const char* query) {
+    char* query_copy = strdup(query);
+    if (!query_copy) {
+        return -1;
+    }
 
-    WeatherData* weather_data = NULL;
-    result = open_meteo_api_get_current(&location, &weather_data);
+    int   result = 0;
+    char* saveptr = NULL;
+    for (char* token = strtok_r(query_copy, "&", &saveptr);
+         token && result == 0; token = strtok_r(NULL, "&", &saveptr)) {
+        char value[192];
 
-    if (result != 0 || !weather_data) {
-        *response_json = response_builder_error(
-            HTTP_INTERNAL_ERROR,
-            response_builder_get_error_type(HTTP_INTERNAL_ERROR),
-            "Failed to fetch weather data");
-        *status_code = HTTP_INTERNAL_ERROR;
-        geocoding_api_free_response(geo_response);
-        return -1;
+        if (strncmp(token, "city=", 5) == 0) {
+            url_decode(token + 5, value, sizeof(value));
+
+            /* The country code, if any, follows the last comma */
+            char* comma = strrchr(value, ',');
+            if (comma) {
+                *comma = '\0';
+            }
+            result = batch_add_city(batch, value, comma ? comma + 1 : NULL);
+        } else if (strncmp(token, "coords=", 7) == 0) {
+            double latitude  = 0.0;
+            double longitude = 0.0;
+            url_decode(token + 7, value, sizeof(value));
+            result = sscanf(value, "%lf,%lf", &latitude, &longitude) == 2
+                         ? batch_add_coordinates(batch, latitude, longitude)
+                         : -1;
+        }
     }
 
-    /* 3. Build JSON response with city and weather information */
-    json_t* data = json_object();
-
-    /* Add location information */
-    json_t* location_obj = json_object();
-    json_object_set_new(location_obj, "name", json_string(best_location->name));
-    json_object_set_new(location_obj, "country",
-                        json_string(best_location->country));
-    json_object_set_new(location_obj, "country_code",
-                        json_string(best_location->country_code));
-
-    if (best_location->admin1[0]) {
-        json_object_set_new(location_obj, "region",
-                            json_string(best_location->admin1));
-    }
-
-    json_object_set_new(location_obj, "latitude",
-                        json_real(best_location->latitude));
-    json_object_set_new(location_obj, "longitude",
-                        json_real(best_location->longitude));
-
-    if (best_location->population > 0) {
-        json_object_set_new(location_obj, "population",
-                            json_integer(best_location->population));
-    }
-
-    if (best_location->timezone[0]) {
-        json_object_set_new(location_obj, "timezone",
-                            json_string(best_location->timezone));
-    }
-
-    json_object_set_new(data, "location", location_obj);
-
-    /* Add weather data */
-    json_t* weather_obj = json_object();
-    json_object_set_new(weather_obj, "temperature",
-                        json_real(weather_data->temperature));
-    json_object_set_new(weather_obj, "temperature_unit",
-                        json_string(weather_data->temperature_unit));
-    json_object_set_new(weather_obj, "weather_code",
-                        json_integer(weather_data->weather_code));
-    json_object_set_new(weather_obj, "weather_description",
-                        json_string(open_meteo_api_get_description(
-                            weather_data->weather_code)));
-    json_object_set_new(weather_obj, "windspeed",
-                        json_real(weather_data->windspeed));
-    json_object_set_new(weather_obj, "windspeed_unit",
-                        json_string(weather_data->windspeed_unit));
-    json_object_set_new(weather_obj, "wind_direction_10m",
-                        json_integer(weather_data->winddirection));
-    json_object_set_new(weather_obj, "wind_direction_name",
-                        json_string(open_meteo_api_get_wind_direction(
-                            weather_data->winddirection)));
-    json_object_set_new(weather_obj, "humidity",
-                        json_real(weather_data->humidity));
-    json_object_set_new(weather_obj, "pressure",
-                        json_real(weather_data->pressure));
-    json_object_set_new(weather_obj, "precipitation",
-                        json_real(weather_data->precipitation));
-    json_object_set_new(weather_obj, "is_day",
-                        json_integer(weather_data->is_day ? 1 : 0));
-
-    json_object_set_new(data, "current_weather", weather_obj);
-
-    /* Cleanup weather data */
-    open_meteo_api_free_current(weather_data);
-    geocoding_api_free_response(geo_response);
-
-    /* Build standardized response */
-    *response_json = response_builder_success(data);
-
-    if (!*response_json) {
-        json_decref(data);
-        *status_code = HTTP_INTERNAL_ERROR;
+    free(query_copy);
+    return result;
+}
+
+/**
+ * @brief Read locations from a JSON body: an array (or {"locations": [...]})
+ *        of {"city": ..., "country": ...} and {"lat": ..., "lon": ...}.
+ * @internal
+ *
+ * @return 0 on success, -1 on invalid JSON or location, -2 if there are too
+ *         many.
+ */
+static int parse_batch_body(CityWeatherBatch* batch, const char* body,
+                            size_t body_length) {
+    json_error_t error;
+    json_t*      root = json_loadb(body, body_length, 0, &error);
+    json_t*      list =
+        json_is_object(root) ? json_object_get(root, "locations") : root;
+
+    if (!json_is_array(list)) {
+        json_decref(root);
         return -1;
     }
 
-    *status_code = HTTP_OK;
-    printf("[WEATHER_LOCATION] Response generated successfully\n");
-    return 0;
+    int     result = 0;
+    size_t  index;
+    json_t* value;
+    json_array_foreach(list, index, value) {
+        json_t* city      = json_object_get(value, "city");
+        json_t* latitude  = json_object_get(value, "lat");
+        json_t* longitude = json_object_get(value, "lon");
+
+        if (json_is_string(city)) {
+            json_t* country = json_object_get(value, "country");
+            result          = batch_add_city(batch, json_string_value(city),
+                                             json_string_value(country));
+        } else if (json_is_number(latitude) && json_is_number(longitude)) {
+            result = batch_add_coordinates(batch, json_number_value(latitude),
+                                           json_number_value(longitude));
+        } else {
+            result = -1;
+        }
+
+        if (result != 0) {
+            break;
+        }
+    }
+
+    json_decref(root);
+    return result;
 }
 
 /**
- * @brief Handle city search request for autocomplete.
+ * @brief Render the batch body and deliver it.
+ * @internal
  *
- * @param[in]  query_string  URL query parameters with search query.
- * @param[out] response_json Allocated JSON response (caller frees).
- * @param[out] status_code   HTTP status code.
+ * Items keep their request order. Failed items carry an "error" object
+ * instead of the weather, so one unknown city does not fail the batch.
+ */
+static void batch_finish(CityWeatherBatch* batch) {
+    JsonWriter writer;
+    begin_success(&writer, batch->arena);
+
+    json_write_key_int(&writer, "count", (long long)batch->count);
+    json_write_key_array(&writer, "results");
+    for (size_t i = 0; i < batch->count; i++) {
+        const CityWeatherBatchItem* item = &batch->items[i];
+
+        json_write_begin_object(&writer);
+        json_write_key_str(&writer, "query", item->label);
+
+        if (item->status != HTTP_OK) {
+            json_write_key_object(&writer, "error");
+            json_write_key_int(&writer, "code", item->status);
+            json_write_key_str(&writer, "message", item->error);
+            json_write_end_object(&writer);
+        } else if (item->city[0]) {
+            write_location(&writer, &item->location);
+            write_current_weather(&writer, &item->weather);
+        } else {
+            json_write_key_object(&writer, "location");
+            json_write_key_double(&writer, "latitude",
+                                  item->location.latitude);
+            json_write_key_double(&writer, "longitude",
+                                  item->location.longitude);
+            json_write_end_object(&writer);
+            write_current_weather(&writer, &item->weather);
+        }
+
+        json_write_end_object(&writer);
+    }
+    json_write_end_array(&writer);
+
+    char* response_json = finish_success(&writer);
+
+    /* Not cached: the same locations rarely come in the same order */
+    respond(batch->callback, batch->context, response_json,
+            response_json ? HTTP_OK : HTTP_INTERNAL_ERROR, NULL,
+            batch->arena);
+    request_release(batch->arena, batch);
+}
+
+static void batch_fetch_weather(CityWeatherBatch* batch);
+
+/**
+ * @brief Count one lookup of the current phase as done.
+ * @internal
+ */
+static void batch_release(CityWeatherBatch* batch) {
+    if (--batch->pending > 0) {
+        return;
+    }
+
+    if (batch->fetching) {
+        batch_finish(batch);
+    } else {
+        batch_fetch_weather(batch);
+    }
+}
+
+/**
+ * @brief Weather lookup of one batch item completed.
+ * @internal
+ */
+static void on_batch_weather(int result, const WeatherData* weather_data,
+                             void* context) {
+    CityWeatherBatchItem* item = (CityWeatherBatchItem*)context;
+
+    if (result == 0 && weather_data) {
+        item->weather = *weather_data;
+        item->status  = HTTP_OK;
+    } else {
+        item->status = HTTP_INTERNAL_ERROR;
+        item->error  = "Failed to fetch weather data";
+    }
+
+    batch_release(item->batch);
+}
+
+/**
+ * @brief Geocoding of a batch item the city index did not know completed.
+ * @internal
+ */
+static void on_batch_geocoded(int result, GeocodingResponse* geo_response,
+                              void* context) {
+    CityWeatherBatchItem* item = (CityWeatherBatchItem*)context;
+
+    GeocodingResult* best =
+        result == 0 ? geocoding_api_get_best_result(
+                          geo_response, item->country[0] ? item->country : NULL)
+                    : NULL;
+    if (best) {
+        item->location = *best;
+    } else {
+        item->status = HTTP_NOT_FOUND;
+        item->error  = "City not found";
+    }
+
+    batch_release(item->batch);
+}
+
+/**
+ * @brief Phase 2: look up the weather of every resolved item at once.
+ * @internal
  *
- * @return 0 on success, -1 on error.
+ * Misses are grouped by open_meteo_api into multi-coordinate fetches.
  */
-int weather_location_handler_search_cities(const char* query_string,
-                                           char**      response_json,
-                                           int*        status_code) {
-    if (!response_json || !status_code) {
+static void batch_fetch_weather(CityWeatherBatch* batch) {
+    Location locations[WLH_BATCH_MAX_LOCATIONS];
+    void*    contexts[WLH_BATCH_MAX_LOCATIONS];
+    size_t   count = 0;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        CityWeatherBatchItem* item = &batch->items[i];
+        if (item->status != 0) {
+            continue; /* Not found */
+        }
+
+        locations[count] = (Location){.latitude  = item->location.latitude,
+                                      .longitude = item->location.longitude,
+                                      .name      = item->location.name};
+        contexts[count]  = item;
+        count++;
+    }
+
+    batch->fetching = true;
+    batch->pending  = count + 1;
+    if (count > 0) {
+        open_meteo_api_get_current_many_async(locations, count,
+                                              on_batch_weather, contexts);
+    }
+    batch_release(batch);
+}
+
+/**
+ * @brief Handle a weather request for several locations asynchronously.
+ *
+ * @param[in] query_string URL query parameters (GET).
+ * @param[in] body         JSON request body (POST), or NULL.
+ * @param[in] body_length  Length of body.
+ * @param[in] arena        Request arena, or NULL to use the heap.
+ * @param[in] callback     Completion callback.
+ * @param[in] context      User context passed to the callback.
+ *
+ * @return 0 if the request was accepted, -1 on error.
+ */
+int weather_location_handler_batch_async(const char* query_string,
+                                         const char* body, size_t body_length,
+                                         RequestArena*             arena,
+                                         WeatherLocationOnResponse callback,
+                                         void*                     context) {
+    if (!callback) {
         return -1;
     }
 
     /* Automatic initialization on first call */
     if (ensure_initialized() != 0) {
-        *response_json = response_builder_error(
-            HTTP_INTERNAL_ERROR,
-            response_builder_get_error_type(HTTP_INTERNAL_ERROR),
-            "Failed to initialize geocoding module");
-        *status_code = HTTP_INTERNAL_ERROR;
+        respond_error(callback, context, HTTP_INTERNAL_ERROR,
+                      "Failed to initialize geocoding module");
         return -1;
     }
 
-    *response_json = NULL;
-    *status_code   = HTTP_INTERNAL_ERROR;
-
-    /* Parse query parameter */
-    char query[256] = {0};
-    if (sscanf(query_string, "query=%255[^&]", query) != 1 ||
-        query[0] == '\0') {
-        *response_json = response_builder_error(
-            HTTP_BAD_REQUEST, response_builder_get_error_type(HTTP_BAD_REQUEST),
-            "Missing required parameter: query");
-        *status_code = HTTP_BAD_REQUEST;
+    CityWeatherBatch* batch = request_alloc(arena, sizeof(CityWeatherBatch));
+    if (!batch) {
+        respond(callback, context, NULL, HTTP_INTERNAL_ERROR, NULL, NULL);
         return -1;
     }
 
-    /* URL decode the query */
-    char decoded_query[256] = {0};
-    url_decode(query, decoded_query, sizeof(decoded_query));
-
-    /* Validate minimum query length (2 characters) */
-    if (strlen(decoded_query) < 2) {
-        *response_json = response_builder_error(
-            HTTP_BAD_REQUEST, response_builder_get_error_type(HTTP_BAD_REQUEST),
-            "Query must be at least 2 characters");
-        *status_code = HTTP_BAD_REQUEST;
+    batch->callback = callback;
+    batch->context  = context;
+    batch->arena    = arena;
+
+    int parsed = body && body_length > 0
+                     ? parse_batch_body(batch, body, body_length)
+                     : parse_batch_query(batch, query_string ? query_string
+                                                             : "");
+    if (parsed != 0 || batch->count == 0) {
+        respond_error(callback, context, HTTP_BAD_REQUEST,
+                      parsed == -2
+                          ? "Too many locations (at most 50 per request)"
+                          : "Invalid location list. Expected: "
+                            "city=<name>[,<code>] or coords=<lat>,<lon>");
+        request_release(arena, batch);
         return -1;
     }
 
-    /* Search for cities using 3-tier strategy:
-     * 1. Popular Cities DB (in-memory, fastest)
-     * 2. File cache (fast)
-     * 3. Open-Meteo API (slow, uses quota)
-     */
-    GeocodingResponse* response = NULL;
-    int result = geocoding_api_search_smart(decoded_query, &response);
+    LOGGER_DEBUG("[WEATHER_LOCATION] Batch request for %zu locations",
+                 batch->count);
 
-    if (result != 0 || !response) {
-        *response_json = response_builder_error(
-            HTTP_INTERNAL_ERROR,
-            response_builder_get_error_type(HTTP_INTERNAL_ERROR),
-            "Failed to search cities");
-        *status_code = HTTP_INTERNAL_ERROR;
-        return -1;
+    /* 1. Resolve all names against the city index in one pass; only the
+     * ones it does not know wait for the geocoding API */
+    batch->pending = 1;
+    for (size_t i = 0; i < batch->count; i++) {
+        CityWeatherBatchItem* item    = &batch->items[i];
+        const char*           country = item->country[0] ? item->country : NULL;
+
+        if (item->city[0] == '\0' ||
+            geocoding_api_resolve_local(item->city, country,
+                                        &item->location) == 0) {
+            continue;
+        }
+
+        batch->pending++;
+        geocoding_api_search_async(item->city, country, on_batch_geocoded,
+                                   item);
     }
+    batch_release(batch);
 
-    /* Build JSON response */
-    json_t* data = json_object();
-    json_object_set_new(data, "query", json_string(decoded_query));
-    json_object_set_new(data, "count", json_integer(response->count));
+    return 0;
+}
+
+/**
+ * @brief Build the /v1/cities success body.
+ * @internal
+ *
+ * @param[in] decoded_query Decoded search query echoed in the response.
+ * @param[in] response      Search results.
+ * @param[in] arena         Arena to render into, or NULL for the heap.
+ *
+ * @return JSON response string (arena-owned if arena is set), or NULL on
+ *         failure.
+ */
+static char* build_city_search_response(const char*              decoded_query,
+                                        const GeocodingResponse* response,
+                                        RequestArena*            arena) {
+    JsonWriter writer;
+    begin_success(&writer, arena);
+
+    json_write_key_str(&writer, "query", decoded_query);
+    json_write_key_int(&writer, "count", response->count);
 
-    json_t* cities_array = json_array();
+    json_write_key_array(&writer, "cities");
     for (int i = 0; i < response->count; i++) {
-        GeocodingResult* city     = &response->results[i];
-        json_t*          city_obj = json_object();
+        GeocodingResult* city = &response->results[i];
 
-        json_object_set_new(city_obj, "name", json_string(city->name));
-        json_object_set_new(city_obj, "country", json_string(city->country));
-        json_object_set_new(city_obj, "country_code",
-                            json_string(city->country_code));
+        json_write_begin_object(&writer);
+        json_write_key_str(&writer, "name", city->name);
+        json_write_key_str(&writer, "country", city->country);
+        json_write_key_str(&writer, "country_code", city->country_code);
 
         if (city->admin1[0]) {
-            json_object_set_new(city_obj, "region", json_string(city->admin1));
+            json_write_key_str(&writer, "region", city->admin1);
         }
 
-        json_object_set_new(city_obj, "latitude", json_real(city->latitude));
-        json_object_set_new(city_obj, "longitude", json_real(city->longitude));
+        json_write_key_double(&writer, "latitude", city->latitude);
+        json_write_key_double(&writer, "longitude", city->longitude);
 
         if (city->population > 0) {
-            json_object_set_new(city_obj, "population",
-                                json_integer(city->population));
+            json_write_key_int(&writer, "population", city->population);
         }
 
-        json_array_append_new(cities_array, city_obj);
+        json_write_end_object(&writer);
+    }
+    json_write_end_array(&writer);
+
+    return finish_success(&writer);
+}
+
+/**
+ * @brief City search completion callback.
+ * @internal
+ */
+static void on_cities_found(int result, GeocodingResponse* response,
+                            void* context) {
+    CitySearchRequest* request = (CitySearchRequest*)context;
+
+    if (result != 0 || !response) {
+        respond_error(request->callback, request->context, HTTP_INTERNAL_ERROR,
+                      "Failed to search cities");
+        request_release(request->arena, request);
+        return;
+    }
+
+    char* response_json =
+        build_city_search_response(request->query, response, request->arena);
+
+    time_t        now        = time(NULL);
+    HttpCacheInfo cache_info = {.last_modified = now,
+                                .expires_at    = now + WLH_CITIES_RESPONSE_TTL};
+
+    if (response_json) {
+        /* The body echoes the query, so the key keeps it verbatim */
+        char key[sizeof(request->query) + 8];
+        snprintf(key, sizeof(key), "cities|%s", request->query);
+        store_response(key, NULL, response_json, &cache_info);
+    }
+
+    respond(request->callback, request->context, response_json,
+            response_json ? HTTP_OK : HTTP_INTERNAL_ERROR,
+            response_json ? &cache_info : NULL, request->arena);
+    request_release(request->arena, request);
+}
+
+/**
+ * @brief Handle city search request for autocomplete asynchronously.
+ *
+ * @param[in] query_string URL query parameters with search query.
+ * @param[in] arena        Request arena, or NULL to use the heap.
+ * @param[in] callback     Completion callback.
+ * @param[in] context      User context passed to the callback.
+ *
+ * @return 0 if the request was accepted, -1 on error.
+ */
+int weather_location_handler_search_cities_async(
+    const char* query_string, RequestArena* arena,
+    WeatherLocationOnResponse callback, void* context) {
+    if (!callback) {
+        return -1;
     }
 
-    json_object_set_new(data, "cities", cities_array);
+    /* Automatic initialization on first call */
+    if (ensure_initialized() != 0) {
+        respond_error(callback, context, HTTP_INTERNAL_ERROR,
+                      "Failed to initialize geocoding module");
+        return -1;
+    }
 
-    geocoding_api_free_response(response);
+    /* Parse query parameter */
+    char query[256] = {0};
+    if (sscanf(query_string, "query=%255[^&]", query) != 1 ||
+        query[0] == '\0') {
+        respond_error(callback, context, HTTP_BAD_REQUEST,
+                      "Missing required parameter: query");
+        return -1;
+    }
+
+    CitySearchRequest* request =
+        request_alloc(arena, sizeof(CitySearchRequest));
+    if (!request) {
+        respond(callback, context, NULL, HTTP_INTERNAL_ERROR, NULL, NULL);
+        return -1;
+    }
+
+    request->callback = callback;
+    request->context  = context;
+    request->arena    = arena;
 
-    /* Build standardized response */
-    *response_json = response_builder_success(data);
+    /* URL decode the query */
+    url_decode(query, request->query, sizeof(request->query));
 
-    if (!*response_json) {
-        json_decref(data);
-        *status_code = HTTP_INTERNAL_ERROR;
+    /* Validate minimum query length (2 characters) */
+    if (strlen(request->query) < 2) {
+        respond_error(callback, context, HTTP_BAD_REQUEST,
+                      "Query must be at least 2 characters");
+        request_release(arena, request);
         return -1;
     }
 
-    *status_code = HTTP_OK;
+    char key[sizeof(request->query) + 8];
+    snprintf(key, sizeof(key), "cities|%s", request->query);
+    if (respond_cached(callback, context, key)) {
+        request_release(arena, request);
+        return 0;
+    }
+
+    /* Search for cities using 3-tier strategy:
+     * 1. Popular Cities DB (in-memory, fastest)
+     * 2. File cache (fast)
+     * 3. Open-Meteo API (slow, uses quota)
+     */
+    geocoding_api_search_smart_async(request->query, on_cities_found, request);
+
     return 0;
 }
 
@@ -442,10 +1180,24 @@ void weather_location_handler_cleanup(void) {
         return;
     }
 
+    open_meteo_api_set_refresh_hook(NULL);
+    response_cache_destroy(g_wlh_response_cache);
+    g_wlh_response_cache = NULL;
+
     geocoding_api_cleanup();
     open_meteo_handler_cleanup();
 
     /* Cleanup popular cities database */
+    open_meteo_handler_set_city_lookup(NULL, NULL);
+    city_grid_free(g_wlh_city_grid);
+    g_wlh_city_grid = NULL;
+
+    if (g_wlh_city_index) {
+        city_index_close(g_wlh_city_index);
+        g_wlh_city_index = NULL;
+        g_city_index     = NULL;
+    }
+
     if (g_wlh_popular_cities_db) {
         popular_cities_free(g_wlh_popular_cities_db);
         g_wlh_popular_cities_db = NULL;
@@ -453,7 +1205,7 @@ void weather_location_handler_cleanup(void) {
     }
 
     g_initialized = false;
-    printf("[WEATHER_LOCATION] Handler cleaned up\n");
+    LOGGER_INFO("[WEATHER_LOCATION] Handler cleaned up");
 }
 
 /* ============= Internal Functions ============= */
@@ -545,4 +1297,45 @@ static int parse_city_query(const char* query, char* city, size_t city_size,
     }
 
     return found_city ? 0 : -1;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Build the response cache key for a /v1/weather query.
+ * @internal
+ *
+ * Case and surrounding whitespace do not change the geocoding result, so
+ * they are folded away. Bytes outside ASCII are kept as they are.
+ *
+ * @param[in]  city     Decoded city name.
+ * @param[in]  country  Decoded country code (may be empty).
+ * @param[in]  region   Decoded region (may be empty).
+ * @param[out] out      Output buffer.
+ * @param[in]  out_size Size of output buffer.
+ */
+static void build_weather_response_key(const char* city, const char* country,
+                                       const char* region, char* out,
+                                       size_t out_size) {
+    const char* parts[] = {city, country, region};
+    size_t      length  = (size_t)snprintf(out, out_size, "weather");
+
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        const char* begin = parts[i];
+        const char* end   = begin + strlen(begin);
+
+        while (begin < end && isspace((unsigned char)*begin)) {
+            begin++;
+        }
+        while (end > begin && isspace((unsigned char)end[-1])) {
+            end--;
+        }
+
+        if (length + 1 < out_size) {
+            out[length++] = '|';
+        }
+        for (; begin < end && length + 1 < out_size; begin++) {
+            out[length++] = (char)tolower((unsigned char)*begin);
+        }
+    }
+
+    out[length < out_size ? length : out_size - 1] = '\0';
+}
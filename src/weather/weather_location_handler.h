@@ -8,6 +8,7 @@
  *
  * The module supports two main endpoints:
  * - GET /v1/weather - Weather by city name (geocoding + weather lookup)
+ * - GET/POST /v1/weather/batch - Weather for up to 50 cities or coordinates
  * - GET /v1/cities - City search for autocomplete functionality
  *
  * @par Features:
@@ -26,6 +27,9 @@
 #ifndef WEATHER_LOCATION_HANDLER_H
 #define WEATHER_LOCATION_HANDLER_H
 
+#include "http_cache.h"
+#include "request_arena.h"
+
 /**
  * @brief Initialize the weather location handler.
  *
@@ -45,7 +49,25 @@
 int weather_location_handler_init(void);
 
 /**
- * @brief Handle weather request by city name.
+ * @brief Callback invoked when a handler response is ready.
+ *
+ * @param[in] response_json Null-terminated JSON response, or NULL if the
+ *                          response could not be built. Owned by the handler
+ *                          and only valid for the duration of the callback.
+ * @param[in] status_code   HTTP status code for the response.
+ * @param[in] cache_info    Validators and freshness of a successful
+ *                          response (see http_cache_send()), or NULL if it
+ *                          must not be cached.
+ * @param[in] context       User context passed to the handler.
+ *
+ * @return Currently unused.
+ */
+typedef int (*WeatherLocationOnResponse)(char* response_json, int status_code,
+                                         const HttpCacheInfo* cache_info,
+                                         void*                context);
+
+/**
+ * @brief Handle weather request by city name asynchronously.
  *
  * Processes a weather request by:
  * 1. Parsing city, country, and region from query parameters
@@ -53,18 +75,25 @@ int weather_location_handler_init(void);
  * 3. Fetching weather data for the found coordinates
  * 4. Building a combined JSON response with location and weather info
  *
+ * Steps 2 and 3 never block the event loop: on a cache miss the lookup
+ * continues from the upstream HTTP response callback. The callback is
+ * invoked exactly once, possibly before this function returns.
+ *
  * @par Endpoint:
  * GET /v1/weather?city=<name>&country=<code>
  * GET /v1/weather?city=<name>&region=<region>&country=<code>
  *
- * @param[in]  query_string  URL query parameters. Required: city.
- *                           Optional: country (ISO code), region.
- * @param[out] response_json Pointer to receive allocated JSON response.
- *                           Caller must free this memory.
- * @param[out] status_code   Pointer to receive HTTP status code.
- *                           Possible values: 200, 400, 404, 500.
+ * @param[in] query_string URL query parameters. Required: city.
+ *                         Optional: country (ISO code), region.
+ * @param[in] arena        Request arena for the request state and the
+ *                         response body (must outlive the callback), or NULL
+ *                         to use the heap.
+ * @param[in] callback     Callback receiving the response. Must not be NULL.
+ *                         Possible status values: 200, 400, 404, 500.
+ * @param[in] context      User context passed through to the callback.
  *
- * @return 0 on success, -1 on error (response_json will contain error details).
+ * @return 0 if the request was accepted, -1 on error (the callback still
+ *         receives the error details).
  *
  * @par Response Format (Success):
  * @code{.json}
@@ -99,11 +128,83 @@ int weather_location_handler_init(void);
  * /v1/weather?city=Lviv&region=Lviv%20Oblast&country=UA
  * @endcode
  */
-int weather_location_handler_by_city(const char* query_string,
-                                     char** response_json, int* status_code);
+int weather_location_handler_by_city_async(const char* query_string,
+                                           RequestArena*             arena,
+                                           WeatherLocationOnResponse callback,
+                                           void*                     context);
+
+/**
+ * @brief Handle a weather request for several locations asynchronously.
+ *
+ * Processes a batch by:
+ * 1. Parsing the locations from the query string or a JSON body
+ * 2. Resolving all city names against the city index in one pass; only
+ *    names it does not know are sent to the geocoding API
+ * 3. Looking up the weather of every location at once: cache misses are
+ *    grouped into multi-coordinate Open-Meteo requests, and each result is
+ *    stored in its own cache entry
+ * 4. Building one JSON response with a result per location, in request
+ *    order
+ *
+ * A location that cannot be resolved or fetched gets an "error" object
+ * instead of failing the whole batch. Batch responses are not cached.
+ *
+ * @par Endpoint:
+ * GET /v1/weather/batch?city=<name>[,<code>]&coords=<lat>,<lon>&...
+ * POST /v1/weather/batch with a JSON array of locations
+ *
+ * @param[in] query_string URL query parameters, read when there is no body.
+ *                         city and coords may each be repeated.
+ * @param[in] body         JSON body, or NULL: an array (or an object with a
+ *                         "locations" array) of {"city", "country"} and
+ *                         {"lat", "lon"} objects.
+ * @param[in] body_length  Length of body in bytes.
+ * @param[in] arena        Request arena for the request state and the
+ *                         response body (must outlive the callback), or NULL
+ *                         to use the heap.
+ * @param[in] callback     Callback receiving the response. Must not be NULL.
+ *                         Possible status values: 200, 400, 500.
+ * @param[in] context      User context passed through to the callback.
+ *
+ * @return 0 if the request was accepted, -1 on error (the callback still
+ *         receives the error details).
+ *
+ * @par Response Format (Success):
+ * @code{.json}
+ * {
+ *   "success": true,
+ *   "data": {
+ *     "count": 2,
+ *     "results": [
+ *       {
+ *         "query": "Stockholm,SE",
+ *         "location": { "name": "Stockholm", ... },
+ *         "current_weather": { "temperature": 12.5, ... }
+ *       },
+ *       {
+ *         "query": "Atlantis",
+ *         "error": { "code": 404, "message": "City not found" }
+ *       }
+ *     ]
+ *   }
+ * }
+ * @endcode
+ *
+ * @par Examples:
+ * @code
+ * /v1/weather/batch?city=Stockholm,SE&city=Oslo&coords=59.33,18.07
+ * POST /v1/weather/batch  [{"city": "Kyiv", "country": "UA"},
+ *                          {"lat": 50.45, "lon": 30.52}]
+ * @endcode
+ */
+int weather_location_handler_batch_async(const char* query_string,
+                                         const char* body, size_t body_length,
+                                         RequestArena*             arena,
+                                         WeatherLocationOnResponse callback,
+                                         void*                     context);
 
 /**
- * @brief Handle city search request for autocomplete.
+ * @brief Handle city search request for autocomplete asynchronously.
  *
  * Searches for cities matching the provided query string using a
  * three-tier strategy for optimal performance:
@@ -111,17 +212,20 @@ int weather_location_handler_by_city(const char* query_string,
  * 2. File cache (fast)
  * 3. Open-Meteo Geocoding API (slowest, uses network quota)
  *
+ * Tiers 1 and 2 answer synchronously; tier 3 answers from the upstream
+ * HTTP response callback.
+ *
  * @par Endpoint:
  * GET /v1/cities?query=<search>
  *
- * @param[in]  query_string  URL query parameters. Required: query (min 2
+ * @param[in] query_string URL query parameters. Required: query (min 2
  * chars).
- * @param[out] response_json Pointer to receive allocated JSON response
- *                           containing list of matching cities.
- *                           Caller must free this memory.
- * @param[out] status_code   Pointer to receive HTTP status code.
+ * @param[in] arena        Request arena, or NULL to use the heap.
+ * @param[in] callback     Callback receiving the JSON response containing
+ *                         the list of matching cities. Must not be NULL.
+ * @param[in] context      User context passed through to the callback.
  *
- * @return 0 on success, -1 on error.
+ * @return 0 if the request was accepted, -1 on error.
  *
  * @par Response Format (Success):
  * @code{.json}
@@ -151,9 +255,9 @@ int weather_location_handler_by_city(const char* query_string,
  * /v1/cities?query=Kyiv
  * @endcode
  */
-int weather_location_handler_search_cities(const char* query_string,
-                                           char**      response_json,
-                                           int*        status_code);
+int weather_location_handler_search_cities_async(
+    const char* query_string, RequestArena* arena,
+    WeatherLocationOnResponse callback, void* context);
 
 /**
  * @brief Clean up the weather location handler.
@@ -10,9 +10,18 @@
 
 #include "weather_server.h"
 
+#include "elpris_cache.h"
+#include "energy_plan_handler.h"
+#include "event_loop.h"
+#include "http_pool.h"
+#include "logger.h"
+#include "static_assets.h"
+#include "utils.h"
+#include "weather_location_handler.h"
 #include "weather_server_instance.h"
+#include "weather_warmup.h"
 
-#include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 /* ============= Internal Function Declarations ============= */
@@ -21,8 +30,8 @@
  * @brief Scheduler task callback for periodic instance work.
  * @internal
  *
- * Called periodically by the scheduler to perform maintenance
- * work on all active server instances.
+ * Called periodically by the scheduler to advance the timer wheel and
+ * run deadline work on the instances whose deadline has passed.
  *
  * @param[in] context  WeatherServer pointer cast to void*.
  * @param[in] mon_time Current scheduler time in ticks.
@@ -44,6 +53,12 @@ void weather_server_task_work(void* context, uint64_t mon_time);
 int weather_server_on_http_connection(void*                 context,
                                       HTTPServerConnection* connection);
 
+/**
+ * @brief Release the modules weather_server_initiate() loaded.
+ * @internal
+ */
+static void weather_server_unload_modules(void);
+
 /* ============= Public API Implementation ============= */
 
 /**
@@ -51,15 +66,51 @@ int weather_server_on_http_connection(void*                 context,
  *
  * @param[in,out] server Server to initialize.
  *
- * @return 0 on success.
+ * @return 0 on success, -1 if the instance pool cannot be created, -2 if
+ *         the HTTP server or its scheduler task cannot be set up.
  */
 int weather_server_initiate(WeatherServer* server) {
-    http_server_initiate(&server->httpServer,
-                         weather_server_on_http_connection);
+    if (slab_pool_initiate(&server->instances, sizeof(WeatherServerInstance),
+                           WEATHER_SERVER_MAX_INSTANCES) != 0) {
+        return -1;
+    }
+    timer_wheel_init(&server->timers, system_monotonic_ms());
+    server->drain_started_ms = 0;
+    server->drain_quiet_ms   = 0;
+
+    /* Optional: without public/ only the API routes are served */
+    static_assets_load(STATIC_ASSETS_DEFAULT_DIR);
+
+    /* Optional as well: /v1/elpris falls back to upstream on a miss */
+    elpris_cache_init();
+
+    /* Open the data modules now rather than in the first request; the
+     * handlers retry on their own if this fails */
+    if (weather_location_handler_init() == 0) {
+        weather_warmup_start();
+    } else {
+        LOGGER_WARN("[SERVER] Warning: Weather data modules not ready");
+    }
+    if (energy_plan_handler_init() != 0) {
+        LOGGER_WARN("[SERVER] Warning: Energy plan module not ready");
+    }
 
-    server->instances = linked_list_create();
+    if (http_server_initiate(&server->httpServer,
+                             weather_server_on_http_connection) != 0) {
+        LOGGER_ERROR("[SERVER] Failed to set up the HTTP server");
+        weather_server_unload_modules();
+        slab_pool_dispose(&server->instances);
+        return -2;
+    }
 
     server->task = smw_create_task(server, weather_server_task_work);
+    if (server->task == NULL) {
+        LOGGER_ERROR("[SERVER] Failed to create the server task");
+        http_server_dispose(&server->httpServer);
+        weather_server_unload_modules();
+        slab_pool_dispose(&server->instances);
+        return -2;
+    }
 
     return 0;
 }
@@ -94,6 +145,26 @@ int weather_server_initiate_ptr(WeatherServer** server_ptr) {
 
 /* ============= Internal Callback Implementations ============= */
 
+/**
+ * @brief Map a timer node back to the instance that embeds it.
+ * @internal
+ */
+static WeatherServerInstance* instance_from_timer(TimerWheelNode* node) {
+    return (WeatherServerInstance*)((char*)node -
+                                    offsetof(WeatherServerInstance, timer));
+}
+
+/**
+ * @brief Dispose an instance and return it to the pool.
+ * @internal
+ */
+static void weather_server_release_instance(WeatherServer*         server,
+                                            WeatherServerInstance* instance) {
+    timer_wheel_cancel(&server->timers, &instance->timer);
+    weather_server_instance_dispose(instance);
+    slab_pool_free(&server->instances, instance);
+}
+
 /**
  * @brief Handle new HTTP connection by creating a server instance.
  * @internal
@@ -107,23 +178,59 @@ int weather_server_on_http_connection(void*                 context,
                                       HTTPServerConnection* connection) {
     WeatherServer* server = (WeatherServer*)context;
 
-    WeatherServerInstance* instance = NULL;
-    int result = weather_server_instance_initiate_ptr(connection, &instance);
+    WeatherServerInstance* instance = slab_pool_alloc(&server->instances);
+    if (instance == NULL) {
+        LOGGER_ERROR("WeatherServer_OnHTTPConnection: Instance pool exhausted");
+        return -1;
+    }
+
+    int result = weather_server_instance_initiate(instance, connection);
     if (result != 0) {
-        printf("WeatherServer_OnHTTPConnection: Failed to initiate instance\n");
+        slab_pool_free(&server->instances, instance);
+        LOGGER_ERROR("WeatherServer_OnHTTPConnection: Failed to initiate "
+                     "instance");
         return -1;
     }
 
-    linked_list_append(server->instances, instance);
+    instance->timers = &server->timers;
+    timer_wheel_schedule(&server->timers, &instance->timer,
+                         system_monotonic_ms() +
+                             WEATHER_SERVER_INSTANCE_IDLE_MS);
 
     return 0;
 }
 
 /**
- * @brief Periodic work callback for all server instances.
+ * @brief Timer wheel callback for an instance whose deadline passed.
+ * @internal
+ */
+static void weather_server_on_instance_timer(TimerWheelNode* node,
+                                             uint64_t now_ms, void* context) {
+    WeatherServer*         server   = (WeatherServer*)context;
+    WeatherServerInstance* instance = instance_from_timer(node);
+
+    if (weather_server_instance_work(instance, now_ms) == 0) {
+        weather_server_release_instance(server, instance);
+    }
+}
+
+/**
+ * @brief Timer wheel drain callback used on shutdown.
+ * @internal
+ */
+static void weather_server_on_instance_drain(TimerWheelNode* node,
+                                             uint64_t now_ms, void* context) {
+    (void)now_ms;
+    weather_server_release_instance((WeatherServer*)context,
+                                    instance_from_timer(node));
+}
+
+/**
+ * @brief Periodic work callback for expired server instances.
  * @internal
  *
- * Iterates through all active instances and calls their work function.
+ * Advances the timer wheel; only instances with an elapsed deadline are
+ * visited, so the cost does not grow with the number of idle connections.
  *
  * @param[in] context  WeatherServer pointer.
  * @param[in] mon_time Current scheduler time.
@@ -131,29 +238,97 @@ int weather_server_on_http_connection(void*                 context,
 void weather_server_task_work(void* context, uint64_t mon_time) {
     WeatherServer* server = (WeatherServer*)context;
 
-    LinkedList_foreach(server->instances, node) {
-        WeatherServerInstance* instance = (WeatherServerInstance*)node->item;
-        weather_server_instance_work(instance, mon_time);
-    }
+    timer_wheel_advance(&server->timers, mon_time,
+                        weather_server_on_instance_timer, server);
 }
 
 /* ============= Cleanup Functions ============= */
 
+/**
+ * @brief Stop accepting connections ahead of an exit.
+ *
+ * @param[in,out] server Server to drain.
+ * @param[in]     now_ms Current scheduler time.
+ */
+void weather_server_drain(WeatherServer* server, uint64_t now_ms) {
+    if (server->drain_started_ms != 0) {
+        return;
+    }
+
+    server->drain_started_ms = now_ms;
+    server->drain_quiet_ms   = 0;
+    event_loop_stop_accepting();
+    weather_warmup_stop();
+
+    LOGGER_INFO("[SERVER] Draining: %zu requests outstanding",
+                weather_server_instance_in_flight());
+}
+
+/**
+ * @brief Check whether a drain has finished.
+ *
+ * @param[in,out] server Server being drained.
+ * @param[in]     now_ms Current scheduler time.
+ *
+ * @return true when the server can be disposed.
+ */
+bool weather_server_drained(WeatherServer* server, uint64_t now_ms) {
+    if (server->drain_started_ms == 0) {
+        return false;
+    }
+
+    if (now_ms - server->drain_started_ms >= WEATHER_SERVER_DRAIN_MAX_MS) {
+        LOGGER_WARN("[SERVER] Warning: Drain timed out with %zu requests "
+                    "outstanding",
+                    weather_server_instance_in_flight());
+        return true;
+    }
+
+    if (weather_server_instance_in_flight() > 0) {
+        server->drain_quiet_ms = 0;
+        return false;
+    }
+    if (server->drain_quiet_ms == 0) {
+        server->drain_quiet_ms = now_ms;
+    }
+    if (now_ms - server->drain_quiet_ms < WEATHER_SERVER_DRAIN_QUIET_MS) {
+        return false;
+    }
+
+    LOGGER_INFO("[SERVER] Drained in %llu ms",
+                (unsigned long long)(now_ms - server->drain_started_ms));
+    return true;
+}
+
 /**
  * @brief Dispose of a stack-allocated WeatherServer.
  *
  * @param[in] server Server to dispose.
  */
 void weather_server_dispose(WeatherServer* server) {
-    /* Cleanup all instances to prevent memory leak */
-    LinkedList_foreach(server->instances, node) {
-        WeatherServerInstance* instance = (WeatherServerInstance*)node->item;
-        weather_server_instance_dispose(instance);
-    }
-    linked_list_dispose(&server->instances, free);
+    /* Every live instance has an armed timer, so draining the wheel
+     * disposes all of them */
+    timer_wheel_drain(&server->timers, system_monotonic_ms(),
+                      weather_server_on_instance_drain, server);
+    slab_pool_dispose(&server->instances);
 
     http_server_dispose(&server->httpServer);
     smw_destroy_task(server->task);
+
+    weather_server_unload_modules();
+}
+
+/**
+ * @brief Release the modules weather_server_initiate() loaded.
+ * @internal
+ */
+static void weather_server_unload_modules(void) {
+    weather_warmup_stop();
+    weather_location_handler_cleanup();
+    energy_plan_handler_cleanup();
+    elpris_cache_cleanup();
+    static_assets_unload();
+    http_pool_dispose();
 }
 
 /**
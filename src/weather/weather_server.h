@@ -8,9 +8,15 @@
  *
  * @par Architecture:
  * - WeatherServer contains an HTTPServer for handling TCP connections
- * - Each client connection creates a WeatherServerInstance
- * - A scheduler task performs periodic work on all active instances
- * - Instances are stored in a linked list for iteration
+ * - Each client connection takes a WeatherServerInstance from a slab pool
+ * - An instance lives as long as its connection: closing the socket arms
+ *   its deadline in a timer wheel, and the scheduler task, which only
+ *   visits instances whose deadline has passed, returns it to the pool
+ *   once no request on it is in flight
+ * - Async handlers answer through a WeatherServerReply, which drops the
+ *   response if the client closed the connection in the meantime
+ * - The same deadline frees the arena of idle instances and evicts
+ *   connections idle for WEATHER_SERVER_INSTANCE_IDLE_MS
  *
  * @par Usage:
  * @code{.c}
@@ -29,8 +35,32 @@
 #define WEATHER_SERVER_H
 
 #include "http_server.h"
-#include "linked_list.h"
+#include "slab_pool.h"
 #include "smw.h"
+#include "timer_wheel.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of concurrent connection instances.
+ *
+ * Matches the RLIMIT_NOFILE set in main.c.
+ */
+#define WEATHER_SERVER_MAX_INSTANCES 65536
+
+/**
+ * @brief Time without unanswered requests after which a drain is done.
+ *
+ * Covers responses still being written and requests whose bytes are
+ * already on their way over connections accepted before the drain.
+ */
+#define WEATHER_SERVER_DRAIN_QUIET_MS 500
+
+/**
+ * @brief Longest a drain waits for outstanding requests.
+ */
+#define WEATHER_SERVER_DRAIN_MAX_MS 30000
 
 /**
  * @brief Main weather server structure.
@@ -42,12 +72,21 @@ typedef struct {
     /** @brief Embedded HTTP server for handling connections. */
     HTTPServer httpServer;
 
-    /** @brief Linked list of active WeatherServerInstance pointers. */
-    LinkedList* instances;
+    /** @brief Pool the WeatherServerInstance objects are taken from. */
+    SlabPool instances;
+
+    /** @brief Idle deadlines of all live instances. */
+    TimerWheel timers;
 
-    /** @brief Scheduler task for periodic instance work. */
+    /** @brief Scheduler task advancing the timer wheel. */
     SmwTask* task;
 
+    /** @brief When weather_server_drain() was called, or 0. */
+    uint64_t drain_started_ms;
+
+    /** @brief Since when no request has been outstanding, or 0. */
+    uint64_t drain_quiet_ms;
+
 } WeatherServer;
 
 /**
@@ -55,13 +94,13 @@ typedef struct {
  *
  * Performs complete initialization of the weather server:
  * - Initializes the embedded HTTP server with connection callback
- * - Creates an empty linked list for client instances
- * - Registers a scheduler task for periodic work
+ * - Creates the instance pool and the idle timer wheel
+ * - Registers a scheduler task for deadline work
  *
  * @param[in,out] server Pointer to the WeatherServer structure to initialize.
  *                       Must be valid, non-NULL memory.
  *
- * @return 0 on success, non-zero on failure.
+ * @return 0 on success, non-zero on failure (nothing is left to dispose).
  *
  * @note The server must be disposed with weather_server_dispose() when done.
  *
@@ -108,12 +147,38 @@ int weather_server_initiate(WeatherServer* server);
  */
 int weather_server_initiate_ptr(WeatherServer** server_ptr);
 
+/**
+ * @brief Stop taking new connections so the process can exit cleanly.
+ *
+ * Connections already accepted keep being served, and new ones wait in
+ * the listening socket's queue for the server that replaces this one.
+ * Background cache warming stops as well. Calling it again does nothing.
+ *
+ * @param[in,out] server Server to drain.
+ * @param[in]     now_ms Current scheduler time.
+ */
+void weather_server_drain(WeatherServer* server, uint64_t now_ms);
+
+/**
+ * @brief Check whether a drained server has answered everything.
+ *
+ * True once no request has been outstanding for
+ * WEATHER_SERVER_DRAIN_QUIET_MS, or WEATHER_SERVER_DRAIN_MAX_MS after the
+ * drain began. Always false before weather_server_drain().
+ *
+ * @param[in,out] server Server being drained.
+ * @param[in]     now_ms Current scheduler time.
+ *
+ * @return true when the server can be disposed.
+ */
+bool weather_server_drained(WeatherServer* server, uint64_t now_ms);
+
 /**
  * @brief Shut down and clean up a stack-allocated WeatherServer.
  *
  * Performs complete cleanup of the weather server:
  * - Disposes all active client instances
- * - Frees the instances linked list
+ * - Frees the instance pool
  * - Stops and disposes the HTTP server
  * - Destroys the scheduler task
  *
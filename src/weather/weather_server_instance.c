@@ -11,11 +11,17 @@
 
 #include "weather_server_instance.h"
 
+#include "event_loop.h"
+#include "logger.h"
+#include "metrics.h"
 #include "routes.h"
+#include "static_assets.h"
+#include "utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 
 /* ============= Internal Function Declarations ============= */
 
@@ -32,6 +38,118 @@
  */
 int weather_server_instance_on_request(void* context);
 
+/**
+ * @brief Request callback of a connection whose instance is gone.
+ * @internal
+ *
+ * @return -1, so the HTTP layer closes the connection.
+ */
+static int weather_server_instance_on_orphan_request(void* context) {
+    (void)context;
+    return -1;
+}
+
+/**
+ * @brief Close notification for the instance's socket.
+ * @internal
+ *
+ * Runs inside lib's close(), possibly from a request callback of this
+ * instance, so the release is left to the next timer wheel pass.
+ */
+static void weather_server_instance_on_close(int fd, void* context) {
+    WeatherServerInstance* instance = (WeatherServerInstance*)context;
+    (void)fd;
+
+    /* lib frees the connection after this, and may hand its address to
+     * the next one; nothing may use the pointer from here on */
+    metrics_request_discard(instance->connection);
+
+    instance->closed = true;
+    if (instance->timers) {
+        timer_wheel_schedule(instance->timers, &instance->timer,
+                             system_monotonic_ms());
+    }
+}
+
+/* Metrics route ids: one per g_routes entry, then public/ files and
+ * requests that matched nothing */
+#define METRICS_ID_STATIC ROUTE_COUNT
+#define METRICS_ID_NOT_FOUND (ROUTE_COUNT + 1)
+
+static int  g_metric_ids[ROUTE_COUNT + 2];
+static bool g_metric_ids_ready = false;
+
+/* Requests between dispatch and response, on all instances */
+static size_t g_in_flight = 0;
+
+/* Numbers every request, so a pool slot reused by another connection
+ * never repeats a generation a late reply still holds */
+static uint32_t g_generation = 0;
+
+/**
+ * @brief Register every route with the metrics module on first use.
+ * @internal
+ */
+static void register_route_metrics(void) {
+    for (size_t i = 0; i < ROUTE_COUNT; i++) {
+        g_metric_ids[i] =
+            metrics_route_register(g_routes[i].method, g_routes[i].path);
+    }
+    g_metric_ids[METRICS_ID_STATIC] = metrics_route_register("GET", "static");
+
+    g_metric_ids[METRICS_ID_NOT_FOUND] =
+        metrics_route_register("*", "unmatched");
+
+    g_metric_ids_ready = true;
+}
+
+/**
+ * @brief Mark the instance's request as answered or dropped.
+ * @internal
+ */
+static void request_finish(WeatherServerInstance* instance) {
+    instance->in_flight = false;
+    g_in_flight--;
+}
+
+/**
+ * @brief Route a request to its handler.
+ * @internal
+ */
+static int dispatch(WeatherServerInstance* inst) {
+    HTTPServerConnection* conn = inst->connection;
+
+    /* Dispatch on slices of request_path: path is everything before '?',
+     * the query (already NUL-terminated) everything after it */
+    const char* path     = conn->request_path;
+    const char* question = strchr(path, '?');
+    size_t      path_len = question ? (size_t)(question - path) : strlen(path);
+    const char* query    = question ? question + 1 : "";
+
+    if (!g_metric_ids_ready) {
+        register_route_metrics();
+    }
+
+    /* The first response sent on conn ends the timing (metrics.h) */
+    const Route* route = route_find(conn->method, path, path_len);
+    if (route) {
+        metrics_request_begin(conn, g_metric_ids[route - g_routes]);
+        return route->handler(conn, query, inst);
+    }
+
+    /* Anything else under GET may be a file from public/ */
+    if (strcmp(conn->method, "GET") == 0) {
+        const StaticAsset* asset = static_assets_find(path, path_len);
+        if (asset) {
+            metrics_request_begin(conn, g_metric_ids[METRICS_ID_STATIC]);
+            return static_assets_send(conn, asset);
+        }
+    }
+
+    metrics_request_begin(conn, g_metric_ids[METRICS_ID_NOT_FOUND]);
+    return handle_not_found(conn);
+}
+
 /* ============= Public API Implementation ============= */
 
 /**
@@ -44,10 +162,26 @@ int weather_server_instance_on_request(void* context);
  */
 int weather_server_instance_initiate(WeatherServerInstance* instance,
                                      HTTPServerConnection*  connection) {
-    instance->connection = connection;
+    instance->connection      = connection;
+    instance->timers          = NULL;
+    instance->closed          = false;
+    instance->in_flight       = false;
+    instance->deferred        = false;
+    instance->generation      = 0;
+    instance->last_request_ms = system_monotonic_ms();
+    memset(&instance->timer, 0, sizeof(instance->timer));
+    request_arena_initiate(&instance->arena);
+
+    /* lib closes this socket when it is done with the connection */
+    instance->fd = connection->tcp_client.fd;
+    if (event_loop_on_close(instance->fd, weather_server_instance_on_close,
+                            instance) != 0) {
+        instance->fd = -1;
+    }
 
     http_server_connection_set_callback(instance->connection, instance,
                                         weather_server_instance_on_request);
+    metrics_instance_opened();
 
     return 0;
 }
@@ -88,44 +222,151 @@ int weather_server_instance_initiate_ptr(HTTPServerConnection*   connection,
  */
 int weather_server_instance_on_request(void* context) {
     WeatherServerInstance* inst = (WeatherServerInstance*)context;
-    HTTPServerConnection*  conn = inst->connection;
 
-    char path[256]  = {0};
-    char query[512] = {0};
+    /* The arena still holds the callback context of the last request */
+    if (inst->in_flight) {
+        LOGGER_ERROR("[SERVER] Request before the previous one was answered");
+        return -1;
+    }
 
-    split_path_and_query(conn->request_path, path, sizeof(path), query,
-                         sizeof(query));
+    /* The previous response on this connection has been sent */
+    request_arena_reset(&inst->arena);
 
-    for (size_t i = 0; i < ROUTE_COUNT; i++) {
-        if (strcmp(conn->method, g_routes[i].method) == 0 &&
-            strcmp(path, g_routes[i].path) == 0) {
-            return g_routes[i].handler(conn, query);
-        }
+    inst->last_request_ms = system_monotonic_ms();
+    if (inst->timers) {
+        timer_wheel_schedule(inst->timers, &inst->timer,
+                             inst->last_request_ms +
+                                 WEATHER_SERVER_INSTANCE_RELEASE_MS);
     }
 
-    return handle_not_found(conn, path);
+    inst->generation = ++g_generation;
+    inst->in_flight  = true;
+    inst->deferred   = false;
+    g_in_flight++;
+
+    int result = dispatch(inst);
+
+    /* Handlers that did not defer have answered by now */
+    if (!inst->deferred && inst->in_flight) {
+        request_finish(inst);
+    }
+    return result;
 }
 
+/**
+ * @brief Keep the current request in flight past its handler.
+ *
+ * @param[in] instance Instance the request arrived on.
+ *
+ * @return Reply handle for the handler's callback context.
+ */
+WeatherServerReply
+weather_server_instance_defer(WeatherServerInstance* instance) {
+    instance->deferred = true;
+    return (WeatherServerReply){.instance   = instance,
+                                .generation = instance->generation};
+}
+
+/**
+ * @brief End a deferred request.
+ *
+ * @param[in,out] reply Handle from weather_server_instance_defer().
+ *
+ * @return Connection to answer on, or NULL to drop the response.
+ */
+HTTPServerConnection* weather_server_reply_take(WeatherServerReply* reply) {
+    WeatherServerInstance* instance = reply->instance;
+    reply->instance                 = NULL;
+
+    /* The instance is kept until the request ends; a handle used after
+     * that finds it idle or on another request, with another generation */
+    if (!instance || !instance->in_flight ||
+        instance->generation != reply->generation) {
+        return NULL;
+    }
+    request_finish(instance);
+
+    if (instance->closed) {
+        /* Its release only waited for this */
+        if (instance->timers) {
+            timer_wheel_schedule(instance->timers, &instance->timer,
+                                 system_monotonic_ms());
+        }
+        return NULL;
+    }
+    return instance->connection;
+}
+
+/**
+ * @brief Requests dispatched and not answered yet.
+ */
+size_t weather_server_instance_in_flight(void) { return g_in_flight; }
+
 /* ============= Lifecycle Functions ============= */
 
 /**
- * @brief Periodic work function (currently no-op).
+ * @brief Deadline work function: free idle memory, finish closed or
+ *        expired instances.
  *
  * @param[in] instance Instance to process.
  * @param[in] mon_time Current scheduler time.
+ *
+ * @return 0 to release the instance, 1 if its timer was re-armed.
  */
-void weather_server_instance_work(WeatherServerInstance* instance,
-                                  uint64_t               mon_time) {
-    /* Reserved for future timeout/cleanup logic */
+int weather_server_instance_work(WeatherServerInstance* instance,
+                                 uint64_t               mon_time) {
+    /* The request's reply handle and callback context point in here */
+    if (instance->in_flight) {
+        if (instance->timers) {
+            timer_wheel_schedule(instance->timers, &instance->timer,
+                                 mon_time + WEATHER_SERVER_INSTANCE_RELEASE_MS);
+        }
+        return 1;
+    }
+    if (instance->closed) {
+        return 0;
+    }
+
+    /* Idle connections keep no arena chunk; the next request gets one */
+    request_arena_dispose(&instance->arena);
+
+    uint64_t expires_ms =
+        instance->last_request_ms + WEATHER_SERVER_INSTANCE_IDLE_MS;
+    if (mon_time < expires_ms) {
+        if (instance->timers) {
+            timer_wheel_schedule(instance->timers, &instance->timer,
+                                 expires_ms);
+        }
+        return 1;
+    }
+
+    /* lib sees end of file and closes the connection itself */
+    if (instance->fd >= 0) {
+        shutdown(instance->fd, SHUT_RDWR);
+    }
+    return 0;
 }
 
 /**
- * @brief Dispose of a stack-allocated instance (currently no-op).
+ * @brief Dispose of a stack-allocated instance.
  *
  * @param[in] instance Instance to dispose.
  */
 void weather_server_instance_dispose(WeatherServerInstance* instance) {
-    /* Reserved for future cleanup logic */
+    /* The connection may outlive the instance; leave it nothing to call */
+    if (!instance->closed) {
+        event_loop_on_close(instance->fd, NULL, NULL);
+        http_server_connection_set_callback(
+            instance->connection, NULL,
+            weather_server_instance_on_orphan_request);
+        metrics_request_discard(instance->connection);
+    }
+    if (instance->in_flight) {
+        request_finish(instance); /* Only on shutdown */
+    }
+
+    metrics_instance_closed();
+    request_arena_dispose(&instance->arena);
 }
 
 /**
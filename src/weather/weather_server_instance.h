@@ -11,11 +11,15 @@
  * method.
  *
  * @par Supported Endpoints:
- * - GET / - Homepage with API documentation
+ * - GET / - public/index.html, or a built-in API overview without it
  * - GET/POST /echo - Echo endpoint for debugging
  * - GET /v1/current?lat=XX&lon=YY - Current weather by coordinates
  * - GET /v1/weather?city=NAME&country=CODE - Weather by city name
+ * - GET/POST /v1/weather/batch - Weather for several cities or coordinates
  * - GET /v1/cities?query=SEARCH - City search for autocomplete
+ * - GET /v1/energyplan?lat=XX&lon=YY&price=SE3 - Battery plan for a day
+ * - GET /metrics - Prometheus metrics of this process (see metrics.h)
+ * - GET /<file> - Any other file below public/ (see static_assets.h)
  *
  * @note Instances must be properly initialized before use and disposed of
  *       when no longer needed to prevent resource leaks.
@@ -28,6 +32,29 @@
 #define WEATHER_SERVER_INSTANCE_H
 
 #include "http_server_connection.h"
+#include "request_arena.h"
+#include "timer_wheel.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Idle time after which a connection is closed and its instance
+ *        recycled.
+ *
+ * An instance normally lives exactly as long as its connection: it is
+ * released once the HTTP layer closes the socket (event_loop_on_close()).
+ * This only evicts connections the HTTP layer keeps open for longer.
+ */
+#define WEATHER_SERVER_INSTANCE_IDLE_MS 120000
+
+/**
+ * @brief Time after a request at which an idle instance frees its arena.
+ *
+ * Rechecked at this interval while the request is still in flight.
+ */
+#define WEATHER_SERVER_INSTANCE_RELEASE_MS 1000
 
 /**
  * @brief Weather server instance for handling a single HTTP connection.
@@ -38,8 +65,52 @@
 typedef struct {
     /** @brief Pointer to the underlying HTTP connection. */
     HTTPServerConnection* connection;
+
+    /** @brief Idle deadline, armed in the owning server's timer wheel. */
+    TimerWheelNode timer;
+
+    /** @brief Wheel the deadline is re-armed in (NULL if unmanaged). */
+    TimerWheel* timers;
+
+    /** @brief Memory for the current request, reset on the next one. */
+    RequestArena arena;
+
+    /** @brief Socket of the connection (its TCP client), or -1. */
+    int fd;
+
+    /** @brief Set once the socket is closed; the connection is gone. */
+    bool closed;
+
+    /** @brief Set from dispatch until the response is sent or dropped. */
+    bool in_flight;
+
+    /** @brief Set when the handler answers after returning. */
+    bool deferred;
+
+    /** @brief Number of the current request, unique across instances. */
+    uint32_t generation;
+
+    /** @brief Time of the last request (scheduler milliseconds). */
+    uint64_t last_request_ms;
 } WeatherServerInstance;
 
+/**
+ * @brief Handle for answering a request after its handler has returned.
+ *
+ * Async route handlers keep this in their callback context instead of the
+ * connection: lib frees the connection when the client closes it, and
+ * the address may come back for the next one. The instance stays
+ * allocated while the request is in flight, so the handle can always be
+ * checked.
+ */
+typedef struct {
+    /** @brief Instance the request arrived on. */
+    WeatherServerInstance* instance;
+
+    /** @brief Value of instance->generation for that request. */
+    uint32_t generation;
+} WeatherServerReply;
+
 /**
  * @brief Initialize a stack-allocated WeatherServerInstance.
  *
@@ -101,31 +172,68 @@ int weather_server_instance_initiate_ptr(HTTPServerConnection*   connection,
                                          WeatherServerInstance** instance_ptr);
 
 /**
- * @brief Periodic work function for the instance.
+ * @brief Answer the current request later, from an async callback.
+ *
+ * Called by a route handler before it returns without sending anything.
+ * The request stays in flight until weather_server_reply_take().
+ *
+ * @param[in] instance Instance passed to the route handler.
+ *
+ * @return Handle to keep in the callback context.
+ */
+WeatherServerReply
+weather_server_instance_defer(WeatherServerInstance* instance);
+
+/**
+ * @brief End a deferred request and get the connection to answer it on.
+ *
+ * Returns NULL if the client has closed the connection or the request
+ * was already ended; the response must then be dropped. Otherwise send
+ * it on the returned connection right away. Either way the handle is
+ * used up, and later calls return NULL.
+ *
+ * @param[in,out] reply Handle from weather_server_instance_defer().
+ *
+ * @return Connection to send the response on, or NULL.
+ */
+HTTPServerConnection* weather_server_reply_take(WeatherServerReply* reply);
+
+/**
+ * @brief Number of requests dispatched and not answered yet.
+ */
+size_t weather_server_instance_in_flight(void);
+
+/**
+ * @brief Deadline work function for the instance.
  *
- * Called by the WeatherServer scheduler task for each active instance.
- * Can be used for implementing timeouts, connection cleanup, or other
- * periodic maintenance tasks.
+ * Called by the WeatherServer scheduler task when the instance's timer
+ * expires: WEATHER_SERVER_INSTANCE_RELEASE_MS after a request, once its
+ * socket is closed, and after WEATHER_SERVER_INSTANCE_IDLE_MS without a
+ * request. An idle instance frees its arena; one whose connection is gone
+ * or idle too long is finished, in the latter case after shutting the
+ * socket down so the HTTP layer closes it. Instances are kept while a
+ * request is in flight, since its reply handle and callback context
+ * still point into them.
  *
  * @param[in] instance Pointer to the WeatherServerInstance.
- * @param[in] mon_time Current scheduler time in ticks.
+ * @param[in] mon_time Current scheduler time in milliseconds.
  *
- * @note Currently a no-op, reserved for future functionality such as
- *       request timeouts or keep-alive management.
+ * @return 0 if the instance is finished and can be released, 1 if it has
+ *         re-armed its timer and must be kept.
  */
-void weather_server_instance_work(WeatherServerInstance* instance,
-                                  uint64_t               mon_time);
+int weather_server_instance_work(WeatherServerInstance* instance,
+                                 uint64_t               mon_time);
 
 /**
  * @brief Dispose of a stack-allocated WeatherServerInstance.
  *
- * Releases any resources owned by the instance, such as temporary
- * buffers or timers. The underlying connection is not disposed
- * (it is owned by the HTTP server).
+ * Releases any resources owned by the instance, such as the request
+ * arena. The underlying connection is not disposed (it is owned by the
+ * HTTP server); if it is still open, its request callback and close
+ * notification are detached from the instance.
  *
  * @param[in] instance Pointer to the WeatherServerInstance to dispose.
  *
- * @note Currently a no-op, reserved for future cleanup logic.
  * @note After calling this function, the instance should not be used
  *       unless re-initialized.
  */
@@ -0,0 +1,287 @@
+/**
+ * @file weather_warmup.c
+ * @brief Hot-city weather warmup implementation.
+ *
+ * @see weather_warmup.h
+ */
+
+#include "weather_warmup.h"
+
+#include "city_index.h"
+#include "geocoding_api.h"
+#include "logger.h"
+#include "open_meteo_api.h"
+
+#include <smw.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Owned by the weather location handler */
+extern CityIndex* g_city_index;
+
+/* ============= Internal State ============= */
+
+/**
+ * @brief Resolution progress of one city.
+ * @internal
+ */
+typedef enum {
+    WARM_CITY_UNRESOLVED = 0,
+    WARM_CITY_RESOLVING,
+    WARM_CITY_RESOLVED,
+    WARM_CITY_FAILED, /* Retried once per interval */
+} WarmCityState;
+
+/**
+ * @brief One city kept warm.
+ * @internal
+ */
+typedef struct {
+    const char*   name;         /* Points into the city index */
+    const char*   country_code; /* Same */
+    uint32_t      population;
+    WarmCityState state;
+    Location      location; /* Geocoded coordinates once resolved */
+} WarmCity;
+
+static WarmCity* g_cities     = NULL;
+static size_t    g_city_count = 0;
+static Location* g_locations  = NULL; /* Prefetch list, one per city */
+static size_t    g_resolving  = 0;    /* Geocoding lookups in flight */
+static uint64_t  g_next_pass  = 0;
+static bool      g_reported   = false; /* Every city resolved once */
+static SmwTask*  g_task       = NULL;
+
+/* ============= Internal Functions ============= */
+
+/**
+ * @brief Number of cities to keep warm, from the environment.
+ * @internal
+ */
+static size_t warmup_city_limit(void) {
+    const char* value = getenv(WEATHER_WARMUP_CITIES_ENV);
+    if (!value || !value[0]) {
+        return WEATHER_WARMUP_DEFAULT_CITIES;
+    }
+
+    char* end;
+    long  limit = strtol(value, &end, 10);
+    if (*end != '\0' || limit < 0 || limit > WEATHER_WARMUP_MAX_CITIES) {
+        LOGGER_WARN("[WARMUP] Warning: %s must be 0..%d, using %d",
+                    WEATHER_WARMUP_CITIES_ENV, WEATHER_WARMUP_MAX_CITIES,
+                    WEATHER_WARMUP_DEFAULT_CITIES);
+        return WEATHER_WARMUP_DEFAULT_CITIES;
+    }
+    return (size_t)limit;
+}
+
+/**
+ * @brief qsort comparator: most populous first.
+ * @internal
+ */
+static int compare_population(const void* a, const void* b) {
+    uint32_t pa = ((const WarmCity*)a)->population;
+    uint32_t pb = ((const WarmCity*)b)->population;
+    return (pa < pb) - (pa > pb);
+}
+
+/**
+ * @brief Collect the hot cities of the index, most populous first.
+ * @internal
+ *
+ * @return Number of cities in g_cities (at most limit), or -1 if out of
+ *         memory.
+ */
+static int select_hot_cities(size_t limit) {
+    size_t total = city_index_count(g_city_index);
+    size_t hot   = 0;
+
+    for (size_t pass = 0; pass < 2; pass++) {
+        for (uint32_t id = 0; id < total; id++) {
+            CityIndexEntry entry;
+            if (city_index_get(g_city_index, id, &entry) != CITY_INDEX_OK ||
+                !entry.hot) {
+                continue;
+            }
+            if (pass == 1) {
+                WarmCity* city     = &g_cities[g_city_count++];
+                city->name         = entry.name;
+                city->country_code = entry.country_code;
+                city->population   = entry.population;
+                city->state        = WARM_CITY_UNRESOLVED;
+            } else {
+                hot++;
+            }
+        }
+
+        if (pass == 0) {
+            if (hot == 0) {
+                return 0;
+            }
+            g_cities = calloc(hot, sizeof(WarmCity));
+            if (!g_cities) {
+                return -1;
+            }
+        }
+    }
+
+    qsort(g_cities, g_city_count, sizeof(WarmCity), compare_population);
+    if (g_city_count > limit) {
+        g_city_count = limit;
+    }
+    return (int)g_city_count;
+}
+
+/**
+ * @brief Geocoding completed for one city.
+ * @internal
+ *
+ * The context is the index of the city; lookups that complete after
+ * weather_warmup_stop() find no city there and are ignored.
+ */
+static void on_city_resolved(int result, GeocodingResponse* response,
+                             void* context) {
+    size_t index = (size_t)(uintptr_t)context;
+    if (index >= g_city_count ||
+        g_cities[index].state != WARM_CITY_RESOLVING) {
+        return;
+    }
+
+    WarmCity* city = &g_cities[index];
+    g_resolving--;
+
+    /* Same choice as /v1/weather?city=...&country=... */
+    GeocodingResult* best =
+        result == 0 && response && response->count > 0
+            ? geocoding_api_get_best_result(
+                  response, city->country_code[0] ? city->country_code : NULL)
+            : NULL;
+    if (!best) {
+        LOGGER_DEBUG("[WARMUP] Could not resolve %s (%s)", city->name,
+                     city->country_code);
+        city->state = WARM_CITY_FAILED;
+        return;
+    }
+
+    city->location.latitude  = best->latitude;
+    city->location.longitude = best->longitude;
+    city->location.name      = city->name;
+    city->state              = WARM_CITY_RESOLVED;
+}
+
+/**
+ * @brief Start the geocoding lookup of one city.
+ * @internal
+ *
+ * Cache hits and failures complete before this returns.
+ */
+static void resolve_city(size_t index) {
+    WarmCity* city = &g_cities[index];
+    city->state    = WARM_CITY_RESOLVING;
+    g_resolving++;
+
+    geocoding_api_search_async(
+        city->name, city->country_code[0] ? city->country_code : NULL,
+        on_city_resolved, (void*)(uintptr_t)index);
+}
+
+/**
+ * @brief Scheduler task: resolve cities and refetch expiring entries.
+ * @internal
+ */
+static void warmup_task_work(void* context, uint64_t mon_time) {
+    (void)context;
+    if (mon_time < g_next_pass) {
+        return;
+    }
+
+    size_t resolved = 0;
+    size_t failed   = 0;
+    for (size_t i = 0; i < g_city_count; i++) {
+        WarmCity* city = &g_cities[i];
+        if (city->state == WARM_CITY_UNRESOLVED &&
+            g_resolving < WEATHER_WARMUP_RESOLVE_CONCURRENCY) {
+            resolve_city(i);
+        }
+
+        if (city->state == WARM_CITY_RESOLVED) {
+            g_locations[resolved++] = city->location;
+        } else if (city->state == WARM_CITY_FAILED) {
+            failed++;
+        }
+    }
+
+    open_meteo_api_prefetch_many(g_locations, resolved,
+                                 WEATHER_WARMUP_LEAD_SECONDS);
+
+    /* Poll faster until every lookup has completed */
+    if (resolved + failed < g_city_count) {
+        g_next_pass = mon_time + WEATHER_WARMUP_RESOLVE_MS;
+        return;
+    }
+
+    if (!g_reported) {
+        LOGGER_INFO("[WARMUP] Keeping %zu cities warm (%zu not resolved)",
+                    resolved, failed);
+        g_reported = true;
+    }
+
+    for (size_t i = 0; i < g_city_count; i++) {
+        if (g_cities[i].state == WARM_CITY_FAILED) {
+            g_cities[i].state = WARM_CITY_UNRESOLVED;
+        }
+    }
+    g_next_pass = mon_time + WEATHER_WARMUP_INTERVAL_MS;
+}
+
+/* ============= Public API ============= */
+
+int weather_warmup_start(void) {
+    if (g_task) {
+        return (int)g_city_count;
+    }
+
+    size_t limit = warmup_city_limit();
+    if (limit == 0 || !g_city_index) {
+        LOGGER_INFO("[WARMUP] Disabled (%s)",
+                    limit == 0 ? "no cities requested" : "no city index");
+        return 0;
+    }
+
+    int count = select_hot_cities(limit);
+    if (count <= 0) {
+        if (count == 0) {
+            LOGGER_WARN("[WARMUP] Warning: no hot cities in the city index");
+        }
+        weather_warmup_stop();
+        return count;
+    }
+
+    g_locations = malloc(g_city_count * sizeof(Location));
+    g_task      = g_locations ? smw_create_task(NULL, warmup_task_work) : NULL;
+    if (!g_task) {
+        LOGGER_ERROR("[WARMUP] Failed to start the warmup task");
+        weather_warmup_stop();
+        return -1;
+    }
+
+    g_next_pass = 0; /* First pass on the next scheduler run */
+    g_reported  = false;
+    LOGGER_INFO("[WARMUP] Warming the %d most populous hot cities", count);
+    return count;
+}
+
+void weather_warmup_stop(void) {
+    if (g_task) {
+        smw_destroy_task(g_task);
+        g_task = NULL;
+    }
+
+    free(g_locations);
+    g_locations = NULL;
+    free(g_cities);
+    g_cities     = NULL;
+    g_city_count = 0;
+    g_resolving  = 0;
+}
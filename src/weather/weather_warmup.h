@@ -0,0 +1,62 @@
+/**
+ * @file weather_warmup.h
+ * @brief Keeps the weather of the hot cities cached ahead of expiry.
+ *
+ * At startup the WEATHER_WARMUP_CITIES_ENV most populous cities marked hot
+ * in the city index (hot_cities.json) are picked and their coordinates
+ * resolved through the geocoding cache, exactly as /v1/weather resolves a
+ * city name, so both land on the same weather cache entry.
+ *
+ * A scheduler task then checks every WEATHER_WARMUP_INTERVAL_MS which of
+ * those entries are missing, stale or expire within
+ * WEATHER_WARMUP_LEAD_SECONDS, and refetches them through the batched
+ * upstream path (open_meteo_api_prefetch_many()). After a restart the
+ * first pass warms every hot city in a few upstream requests, and later
+ * passes replace entries before a request could find them expired.
+ *
+ * @note Not thread-safe; used from the smw scheduler thread only.
+ */
+
+#ifndef WEATHER_WARMUP_H
+#define WEATHER_WARMUP_H
+
+/** @brief Number of cities to keep warm; 0 disables the warmup. */
+#define WEATHER_WARMUP_CITIES_ENV "JWS_WARMUP_CITIES"
+
+/** @brief Cities kept warm when WEATHER_WARMUP_CITIES_ENV is unset. */
+#define WEATHER_WARMUP_DEFAULT_CITIES 100
+
+/** @brief Upper bound for WEATHER_WARMUP_CITIES_ENV. */
+#define WEATHER_WARMUP_MAX_CITIES 1000
+
+/** @brief Time between expiry checks once every city is resolved. */
+#define WEATHER_WARMUP_INTERVAL_MS 60000
+
+/** @brief Time between passes while cities are still being resolved. */
+#define WEATHER_WARMUP_RESOLVE_MS 1000
+
+/** @brief Geocoding lookups in flight at a time. */
+#define WEATHER_WARMUP_RESOLVE_CONCURRENCY 16
+
+/** @brief Entries expiring within this many seconds are refetched. */
+#define WEATHER_WARMUP_LEAD_SECONDS 120
+
+/**
+ * @brief Pick the hot cities and start the warmup task.
+ *
+ * Requires an initialized weather location handler. Without a city index
+ * there is nothing to warm and nothing is started.
+ *
+ * @return Number of cities kept warm, or -1 on failure.
+ */
+int weather_warmup_start(void);
+
+/**
+ * @brief Stop the warmup task and free the city list.
+ *
+ * Geocoding lookups still in flight are dropped with the geocoding module,
+ * so this must run before weather_location_handler_cleanup().
+ */
+void weather_warmup_stop(void);
+
+#endif /* WEATHER_WARMUP_H */